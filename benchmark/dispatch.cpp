@@ -0,0 +1,52 @@
+// (c) 2025 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+// Measures eager dispatch overhead: ns per op for tiny tensors, where the math is negligible.
+// ON LINUX: Before running the benchmark, execute: prepare_system.sh to setup the system for performance measurements.
+
+#include <magnetron.h>
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include <nanobench.h>
+
+static auto bench_dispatch(std::int64_t numel) -> void {
+    mag_device_descriptor_t desc {};
+    desc.type = MAG_COMPUTE_DEVICE_TYPE_CPU;
+    desc.thread_count = 1;
+    mag_ctx_t* ctx = mag_ctx_create2(&desc);
+    mag_tensor_t* x = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, numel);
+    mag_tensor_fill_random_uniform(x, -1.0f, 1.0f);
+    mag_tensor_t* y = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, numel);
+    mag_tensor_fill_random_uniform(y, -1.0f, 1.0f);
+
+    ankerl::nanobench::Bench bench {};
+    bench.title("Eager dispatch | Numel: " + std::to_string(numel))
+        .unit("op")
+        .warmup(1000)
+        .minEpochIterations(10000)
+        .relative(true);
+
+    auto run = [&](const char* name, auto&& fn) {
+        bench.run(name, [&] {
+            mag_tensor_t* r = fn();
+            ankerl::nanobench::doNotOptimizeAway(r);
+            mag_tensor_decref(r);
+        });
+    };
+    run("add", [&] { return mag_add(x, y); });
+    run("mul", [&] { return mag_mul(x, y); });
+    run("adds", [&] { return mag_adds(x, 1.0f); });
+    run("abs", [&] { return mag_abs(x); });
+    run("sigmoid", [&] { return mag_sigmoid(x); });
+    run("sum", [&] { return mag_sum(x); });
+    run("abs_ (inplace)", [&] { return mag_abs_(x); });
+
+    mag_tensor_decref(y);
+    mag_tensor_decref(x);
+    mag_ctx_destroy(ctx);
+}
+
+auto main() -> int {
+    mag_set_log_mode(false);
+    for (std::int64_t numel : {1, 4, 16, 64})
+        bench_dispatch(numel);
+    return 0;
+}
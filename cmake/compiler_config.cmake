@@ -68,6 +68,9 @@ if (WIN32) # Windows (MSVC) specific config
     endif()
 else() # GCC/Clang specific config
     target_link_libraries(magnetron m) # link math library
+    if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+        target_link_libraries(magnetron rt) # shm_open on glibc before 2.34
+    endif()
 
     if (CMAKE_C_COMPILER_ID STREQUAL "GNU")
         target_compile_options(magnetron PRIVATE ${MAG_GCC_COMPILE_FLAGS})
@@ -51,11 +51,19 @@
 #include <sys/sysctl.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #else
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef __linux__
 #include <linux/prctl.h>
+#include <linux/futex.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
 #ifdef __aarch64__
 #include <sys/auxv.h>
 #endif
@@ -233,6 +241,45 @@ static FILE* mag_fopen(const char* file, const char* mode) {
     return f;
 }
 
+static const uint8_t* mag_map_file(const char* file, size_t* size) { /* Map whole file read-only, returns NULL on failure. */
+    mag_assert(file && *file && size, "Invalid file name");
+    #ifdef _WIN32
+        wchar_t w_file[1024];
+        if (MultiByteToWideChar(65001 /* UTF8 */, 0, file, -1, w_file, sizeof(w_file)/sizeof(*w_file)) == 0) return NULL;
+        HANDLE fh = CreateFileW(w_file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fh == INVALID_HANDLE_VALUE) return NULL;
+        LARGE_INTEGER len;
+        if (!GetFileSizeEx(fh, &len) || !len.QuadPart) { CloseHandle(fh); return NULL; }
+        HANDLE mh = CreateFileMappingW(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(fh);
+        if (!mh) return NULL;
+        void* p = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mh); /* The view keeps the mapping alive. */
+        if (!p) return NULL;
+        *size = (size_t)len.QuadPart;
+        return (const uint8_t*)p;
+    #else
+        int fd = open(file, O_RDONLY);
+        if (fd < 0) return NULL;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); return NULL; }
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); /* The mapping keeps the file alive. */
+        if (p == MAP_FAILED) return NULL;
+        *size = (size_t)st.st_size;
+        return (const uint8_t*)p;
+    #endif
+}
+
+static void mag_unmap_file(const uint8_t* p, size_t size) {
+    #ifdef _WIN32
+        (void)size;
+        UnmapViewOfFile(p);
+    #else
+        munmap((void*)p, size);
+    #endif
+}
+
 uintptr_t mag_thread_id(void) {
     uintptr_t tid;
     #if defined(_MSC_VER) && defined(_M_X64)
@@ -392,9 +439,84 @@ static bool MAG_AINLINE mag_imull64_ov(int64_t a, int64_t b, int64_t* out) { /*
     #endif
 }
 
+/* Guard shared context state, only needed when several threads use the context. */
+static void mag_ctx_lock(mag_ctx_t* ctx) {
+    if (mag_unlikely(ctx->concurrent)) mag_spinlock_acquire(&ctx->lock);
+}
+static void mag_ctx_unlock(mag_ctx_t* ctx) {
+    if (mag_unlikely(ctx->concurrent)) mag_spinlock_release(&ctx->lock);
+}
+
+/* Default storage allocator, backed by the global allocator. */
+static void* mag_storage_default_alloc(void* ud, size_t size, size_t align) {
+    (void)ud;
+    return mag_alloc_aligned(size, align);
+}
+static void mag_storage_default_free(void* ud, void* blk, size_t size) {
+    (void)ud, (void)size;
+    mag_free_aligned(blk);
+}
+static const mag_storage_allocator_t mag_storage_default_allocator = {
+    .alloc = &mag_storage_default_alloc,
+    .free = &mag_storage_default_free,
+    .stats = NULL,
+    .ud = NULL
+};
+
+/* All storage buffers are allocated and freed through these, which keep the storage statistics. */
+static void mag_ctx_alloc_storage(mag_ctx_t* ctx, mag_storage_buffer_t* sto, size_t size) {
+    (*ctx->device->alloc_storage)(ctx->device, sto, size);
+    mag_atomic_fetch_add(&ctx->storage_allocs, 1, MAG_MO_RELAXED);
+    mag_atomic_t live = mag_atomic_fetch_add(&ctx->storage_bytes, (mag_atomic_t)size, MAG_MO_RELAXED) + (mag_atomic_t)size;
+    mag_atomic_t peak = mag_atomic_load(&ctx->storage_peak, MAG_MO_RELAXED);
+    while (live > peak && !mag_atomic_compare_exchange_weak(&ctx->storage_peak, &peak, &live, MAG_MO_RELAXED, MAG_MO_RELAXED));
+}
+static void mag_ctx_free_storage(mag_ctx_t* ctx, mag_storage_buffer_t* sto) {
+    mag_atomic_fetch_add(&ctx->storage_frees, 1, MAG_MO_RELAXED);
+    mag_atomic_fetch_sub(&ctx->storage_bytes, (mag_atomic_t)sto->size, MAG_MO_RELAXED);
+    (*ctx->device->free_storage)(ctx->device, sto);
+}
+
+/*
+** Storage released in the deferred free modes is queued in a ring of MAG_RECLAIM_QUEUE_CAP entries.
+** Once the ring is full, every push first frees at most MAG_RECLAIM_STEP of the oldest entries, so no single release pays for a whole batch.
+** mag_ctx_reclaim frees everything still queued.
+*/
+#define MAG_RECLAIM_QUEUE_CAP 1024
+#define MAG_RECLAIM_STEP 16
+
+/* Free the n oldest queued storages, caller holds the context lock. */
+static void mag_ctx_reclaim_oldest_locked(mag_ctx_t* ctx, size_t n) {
+    for (n = mag_xmin(n, ctx->reclaim_len); n; --n) {
+        mag_storage_buffer_t* sto = ctx->reclaim[ctx->reclaim_head];
+        ctx->reclaim_head = (ctx->reclaim_head+1) % ctx->reclaim_cap;
+        --ctx->reclaim_len;
+        mag_ctx_free_storage(ctx, sto);
+        mag_fixed_intrusive_pool_free(&ctx->storage_pool, sto);
+    }
+}
+
+/* Free all queued storages, caller holds the context lock. */
+static void mag_ctx_reclaim_locked(mag_ctx_t* ctx) {
+    mag_ctx_reclaim_oldest_locked(ctx, ctx->reclaim_len);
+}
+
+static void mag_ctx_defer_free(mag_ctx_t* ctx, mag_storage_buffer_t* sto) {
+    mag_ctx_lock(ctx);
+    if (mag_unlikely(!ctx->reclaim)) {
+        ctx->reclaim_cap = MAG_RECLAIM_QUEUE_CAP;
+        ctx->reclaim = (*mag_alloc)(NULL, ctx->reclaim_cap*sizeof(*ctx->reclaim));
+    }
+    if (ctx->reclaim_len == ctx->reclaim_cap) /* Queue is full, release a few of the oldest entries. */
+        mag_ctx_reclaim_oldest_locked(ctx, MAG_RECLAIM_STEP);
+    ctx->reclaim[(ctx->reclaim_head + ctx->reclaim_len++) % ctx->reclaim_cap] = sto;
+    mag_ctx_unlock(ctx);
+}
+
 /* Generate n uniform random floats within [min, max]. */
 static void mag_prng_generate_n(mag_ctx_t* ctx, float* out_gen, int64_t out_n, float min, float max) {
     float rescale_uniform = max - min;
+    mag_ctx_lock(ctx);
     switch (ctx->prng_algorithm) {
         case MAG_PRNG_MERSENNE_TWISTER: {
             uint32_t* rem = &ctx->prng.mersenne.remaining;
@@ -439,6 +561,7 @@ static void mag_prng_generate_n(mag_ctx_t* ctx, float* out_gen, int64_t out_n, f
         default:
             mag_panic("Unknown PRNG algorithm: %d", ctx->prng_algorithm);
     }
+    mag_ctx_unlock(ctx);
 }
 
 static void mag_prng_init(mag_ctx_t* ctx, uint64_t seed) {
@@ -461,7 +584,8 @@ static void mag_prng_init(mag_ctx_t* ctx, uint64_t seed) {
     }
 }
 
-static void mag_system_host_info_query(mag_ctx_t* ctx); /* Query host system information. */
+static const mag_machine_info_t* mag_system_host_info_get(void); /* Get cached host system information. */
+static void mag_system_host_info_query_memory(uint64_t* out_phys_mem_total, uint64_t* out_phys_mem_free); /* Query physical memory, not cached. */
 static void mag_system_host_info_dump(mag_ctx_t* ctx) {
     mag_log_info("OS/Kernel: %s", ctx->machine.os_name);
     const char* cpu_arch = "?";
@@ -490,12 +614,26 @@ static void mag_system_host_info_dump(mag_ctx_t* ctx) {
             putchar('\n');
         }
     #endif
+    if (mag_log_enabled && ctx->machine.cpu_caches[0].size) {
+        printf(MAG_CC_CYAN "[magnetron] " MAG_CC_RESET "CPU caches: ");
+        for (uint32_t i=0; i < MAG_MAX_CACHE_LEVELS; ++i) {
+            const mag_cache_info_t* ci = ctx->machine.cpu_caches+i;
+            if (!ci->size) continue;
+            double size;
+            const char* unit;
+            mag_humanize_memory_size(ci->size, &size, &unit);
+            printf("L%u%s %.0f %s (%u B line, %u CPUs) ", i+1, i ? "" : "D", size, unit, ci->line_size, ci->shared_by);
+        }
+        putchar('\n');
+    }
+    uint64_t phys_mem_total = 0, phys_mem_free = 0;
+    mag_system_host_info_query_memory(&phys_mem_total, &phys_mem_free);
     double mem_total, mem_free, mem_used;
     const char* mem_unit_total, *mem_unit_free, *mem_unit_used;
-    mag_humanize_memory_size(ctx->machine.phys_mem_total, &mem_total, &mem_unit_total);
-    mag_humanize_memory_size(ctx->machine.phys_mem_free, &mem_free, &mem_unit_free);
-    mag_humanize_memory_size((size_t)llabs((int64_t)ctx->machine.phys_mem_total-(int64_t)ctx->machine.phys_mem_free), &mem_used, &mem_unit_used);
-    double mem_used_percent = fabs((double)(ctx->machine.phys_mem_total-ctx->machine.phys_mem_free))/(double)ctx->machine.phys_mem_total*100.0;
+    mag_humanize_memory_size(phys_mem_total, &mem_total, &mem_unit_total);
+    mag_humanize_memory_size(phys_mem_free, &mem_free, &mem_unit_free);
+    mag_humanize_memory_size((size_t)llabs((int64_t)phys_mem_total-(int64_t)phys_mem_free), &mem_used, &mem_unit_used);
+    double mem_used_percent = fabs((double)(phys_mem_total-phys_mem_free))/(double)phys_mem_total*100.0;
     mag_log_info("Physical Machine Memory: %.03f %s, Free: %.03f %s, Used: %.03f %s (%.02f%%)", mem_total, mem_unit_total, mem_free, mem_unit_free, mem_used, mem_unit_used, mem_used_percent);
 }
 
@@ -532,7 +670,7 @@ mag_ctx_t* mag_ctx_create2(const mag_device_descriptor_t* device_info) {
     mag_log_info("Creating magnetron context...");
 
     uint64_t time_stamp_start = mag_hpc_clock_ns();
-    mag_ctx_dump_compiler_info(); /* Dump compiler info. */
+    if (mag_log_enabled) mag_ctx_dump_compiler_info(); /* Dump compiler info. */
 
     /* Initialize context with default values or from context info. */
     mag_ctx_t* ctx = (*mag_alloc)(NULL, sizeof(*ctx)); /* Allocate context. */
@@ -540,12 +678,14 @@ mag_ctx_t* mag_ctx_create2(const mag_device_descriptor_t* device_info) {
 
     /* Init allocators */
     mag_fixed_intrusive_pool_init(&ctx->tensor_pool, sizeof(mag_tensor_t), __alignof(mag_tensor_t), 4096);
+    mag_fixed_intrusive_pool_init(&ctx->storage_pool, sizeof(mag_storage_buffer_t), __alignof(mag_storage_buffer_t), 4096);
+    mag_fixed_intrusive_pool_init(&ctx->tensor_cold_pool, sizeof(mag_tensor_cold_t), __alignof(mag_tensor_cold_t), 256);
 
     ctx->tr_id = mag_thread_id(); /* Get thread ID. */
 
-    /* Query and print host system information. */
-    mag_system_host_info_query(ctx);
-    mag_system_host_info_dump(ctx);
+    /* Copy host system information, queried only by the first context of the process. */
+    ctx->machine = *mag_system_host_info_get();
+    if (mag_log_enabled) mag_system_host_info_dump(ctx);
 
     /* Configure configureable media processors */
     ctx->image_load_fn = &mag_default_image_load_impl;
@@ -556,8 +696,15 @@ mag_ctx_t* mag_ctx_create2(const mag_device_descriptor_t* device_info) {
     ctx->prng_algorithm = MAG_PRNG_MERSENNE_TWISTER;
     mag_prng_init(ctx, ctx->tr_id^(uintptr_t)ctx^(uintptr_t)&ctx); /* Initialize PRNG state. */
 
+    ctx->storage_alloc = mag_storage_default_allocator;
+
     /* Create selected compute device. */
     ctx->exec_mode = MAG_EXEC_MODE_EAGER;
+#ifdef MAG_APPROXMATH
+    ctx->math_mode = MAG_MATH_MODE_APPROX; /* Build default, can be changed at runtime with mag_ctx_set_math_mode. */
+#else
+    ctx->math_mode = MAG_MATH_MODE_PRECISE;
+#endif
     ctx->device_type = device_info->type;
     ctx->device = mag_init_dynamic_device(ctx, device_info);
     mag_log_info("Compute device: %s", ctx->device->name);
@@ -571,6 +718,7 @@ mag_ctx_t* mag_ctx_create2(const mag_device_descriptor_t* device_info) {
 static void mag_tensor_destroy(mag_tensor_t* t);
 
 void mag_ctx_destroy(mag_ctx_t* ctx) {
+    if (ctx->capture) mag_plan_destroy(mag_ctx_end_capture(ctx)); /* Release unfinished capture. */
 #ifdef MAG_DEBUG /* Check for leaked tensors in RC tracking list and print them */
     mag_tensor_node_t** head = &ctx->rc_tracked;
     mag_tensor_node_t* curr = *head;
@@ -590,7 +738,17 @@ void mag_ctx_destroy(mag_ctx_t* ctx) {
     }
     *head = NULL;
 #endif
+    mag_ctx_reclaim_locked(ctx); /* Release storages still queued by the deferred free modes. */
+    if (ctx->reclaim) (*mag_alloc)(ctx->reclaim, 0);
+    for (size_t i=0; i < ctx->frozen_len; ++i) { /* Release pinned storages of frozen tensors. */
+        mag_storage_buffer_t* sto = ctx->frozen[i];
+        mag_assert(!mag_atomic_load(&sto->borrowers, MAG_MO_ACQUIRE), "Frozen storage %p is still borrowed by another context, release its shared views first.", (void*)sto->base);
+        mag_ctx_free_storage(ctx, sto);
+    }
+    if (ctx->frozen) (*mag_alloc)(ctx->frozen, 0);
     mag_fixed_intrusive_pool_destroy(&ctx->tensor_pool);
+    mag_fixed_intrusive_pool_destroy(&ctx->storage_pool);
+    mag_fixed_intrusive_pool_destroy(&ctx->tensor_cold_pool);
     mag_destroy_dynamic_device(ctx->device); ctx->device = NULL;
     memset(ctx, 0, sizeof(*ctx));
     (*mag_alloc)(ctx, 0);
@@ -605,6 +763,102 @@ void mag_ctx_set_exec_mode(mag_ctx_t* ctx, mag_exec_mode_t mode) {
     mag_log_info("Execution mode set to: %s", mode == MAG_EXEC_MODE_EAGER ? "Eager" : "Deferred");
 }
 
+mag_math_mode_t mag_ctx_get_math_mode(const mag_ctx_t* ctx) { return ctx->math_mode; }
+
+void mag_ctx_set_math_mode(mag_ctx_t* ctx, mag_math_mode_t mode) {
+    mag_assert(mode < MAG_MATH_MODE__NUM, "Invalid math mode: %d", mode);
+    mag_assert(!ctx->concurrent, "Math mode can not be changed while concurrent mode is on, other threads may be dispatching kernels.");
+    ctx->math_mode = mode;
+    if (ctx->device->set_math_mode) /* Let device swap kernels. */
+        (*ctx->device->set_math_mode)(ctx->device, mode);
+    mag_log_info("Math mode set to: %s", mode == MAG_MATH_MODE_PRECISE ? "Precise" : "Approx");
+}
+
+bool mag_ctx_is_concurrent(const mag_ctx_t* ctx) { return ctx->concurrent; }
+
+void mag_ctx_set_concurrent(mag_ctx_t* ctx, bool concurrent) {
+    mag_assert(mag_thread_id() == ctx->tr_id, "Concurrent mode must be toggled by the thread that created the context, while no other thread uses it.");
+    ctx->concurrent = concurrent;
+    ctx->atomic_rc = concurrent || ctx->atomic_rc_opt_in; /* Tensors of a concurrent context are likely handed between threads. */
+    mag_fixed_intrusive_pool_set_concurrent(&ctx->tensor_pool, concurrent);
+    mag_fixed_intrusive_pool_set_concurrent(&ctx->storage_pool, concurrent);
+    mag_fixed_intrusive_pool_set_concurrent(&ctx->tensor_cold_pool, concurrent);
+    if (ctx->device->set_concurrent) /* Let device make its allocators thread-safe. */
+        (*ctx->device->set_concurrent)(ctx->device, concurrent);
+    mag_log_info("Concurrent mode %s", concurrent ? "enabled" : "disabled");
+}
+
+mag_free_mode_t mag_ctx_get_free_mode(const mag_ctx_t* ctx) { return ctx->free_mode; }
+
+void mag_ctx_set_free_mode(mag_ctx_t* ctx, mag_free_mode_t mode) {
+    mag_assert(mode < MAG_FREE_MODE__NUM, "Invalid free mode: %d", mode);
+    mag_assert(mag_thread_id() == ctx->tr_id, "Free mode must be set by the thread that created the context.");
+    if (mode == MAG_FREE_MODE_IMMEDIATE) mag_ctx_reclaim(ctx);
+    ctx->free_mode = mode;
+    if (ctx->device->set_free_mode) /* Let device enable its buffer cache and background release. */
+        (*ctx->device->set_free_mode)(ctx->device, mode);
+    static const char* const names[MAG_FREE_MODE__NUM] = {"Immediate", "Deferred", "Background"};
+    mag_log_info("Free mode set to: %s", names[mode]);
+}
+
+bool mag_ctx_is_async(const mag_ctx_t* ctx) { return ctx->device->is_async; }
+
+void mag_ctx_synchronize(mag_ctx_t* ctx) {
+    mag_compute_device_t* dvc = ctx->device;
+    if (dvc->wait_event) (*dvc->wait_event)(dvc, (*dvc->record_event)(dvc));
+}
+
+mag_event_t mag_ctx_record_event(mag_ctx_t* ctx) {
+    mag_compute_device_t* dvc = ctx->device;
+    return dvc->record_event ? (*dvc->record_event)(dvc) : 0;
+}
+
+bool mag_ctx_query_event(mag_ctx_t* ctx, mag_event_t ev) {
+    mag_compute_device_t* dvc = ctx->device;
+    return !dvc->query_event || (*dvc->query_event)(dvc, ev);
+}
+
+void mag_ctx_wait_event(mag_ctx_t* ctx, mag_event_t ev) {
+    mag_compute_device_t* dvc = ctx->device;
+    if (dvc->wait_event) (*dvc->wait_event)(dvc, ev);
+}
+
+void mag_ctx_reclaim(mag_ctx_t* ctx) {
+    mag_ctx_lock(ctx);
+    mag_ctx_reclaim_locked(ctx);
+    mag_ctx_unlock(ctx);
+}
+
+void mag_ctx_get_storage_allocator(const mag_ctx_t* ctx, mag_storage_allocator_t* out) { *out = ctx->storage_alloc; }
+
+void mag_ctx_set_storage_allocator(mag_ctx_t* ctx, const mag_storage_allocator_t* allocator) {
+    mag_assert(mag_thread_id() == ctx->tr_id, "Storage allocator must be set by the thread that created the context.");
+    mag_assert(!allocator || (allocator->alloc && allocator->free), "Storage allocator requires alloc and free callbacks");
+    mag_ctx_reclaim(ctx);
+    mag_atomic_t live = mag_atomic_load(&ctx->storage_allocs, MAG_MO_RELAXED) - mag_atomic_load(&ctx->storage_frees, MAG_MO_RELAXED);
+    mag_assert(live == 0, "Storage allocator can only be changed while the context holds no storage, %" PRIi64 " buffers are alive", (int64_t)live);
+    ctx->storage_alloc = allocator ? *allocator : mag_storage_default_allocator;
+    ctx->storage_alloc_custom = allocator != NULL;
+}
+
+void mag_ctx_get_storage_stats(const mag_ctx_t* ctx, mag_storage_stats_t* out) {
+    mag_ctx_t* mctx = (mag_ctx_t*)ctx; /* Atomic loads take non-const pointers. */
+    *out = (mag_storage_stats_t) {
+        .num_allocs = (uint64_t)mag_atomic_load(&mctx->storage_allocs, MAG_MO_RELAXED),
+        .num_frees = (uint64_t)mag_atomic_load(&mctx->storage_frees, MAG_MO_RELAXED),
+        .bytes_live = (uint64_t)mag_atomic_load(&mctx->storage_bytes, MAG_MO_RELAXED),
+        .bytes_peak = (uint64_t)mag_atomic_load(&mctx->storage_peak, MAG_MO_RELAXED),
+        .bytes_reserved = 0
+    };
+    if (ctx->storage_alloc.stats) (*ctx->storage_alloc.stats)(ctx->storage_alloc.ud, out);
+}
+
+bool mag_ctx_get_atomic_refcount(const mag_ctx_t* ctx) { return ctx->atomic_rc; }
+void mag_ctx_set_atomic_refcount(mag_ctx_t* ctx, bool atomic) {
+    ctx->atomic_rc_opt_in = atomic;
+    ctx->atomic_rc = atomic || ctx->concurrent;
+}
+
 mag_prng_algorithm_t mag_ctx_get_prng_algorithm(const mag_ctx_t* ctx) { return ctx->prng_algorithm; }
 
 void mag_ctx_set_prng_algorithm(mag_ctx_t* ctx, mag_prng_algorithm_t algorithm, uint64_t seed) {
@@ -619,8 +873,21 @@ const char* mag_ctx_get_cpu_name(const mag_ctx_t* ctx) { return ctx->machine.cpu
 uint32_t mag_ctx_get_cpu_virtual_cores(const mag_ctx_t* ctx) { return ctx->machine.cpu_virtual_cores; }
 uint32_t mag_ctx_get_cpu_physical_cores(const mag_ctx_t* ctx) { return ctx->machine.cpu_physical_cores; }
 uint32_t mag_ctx_get_cpu_sockets(const mag_ctx_t* ctx) { return ctx->machine.cpu_sockets; }
-uint64_t mag_ctx_get_physical_memory_total(const mag_ctx_t* ctx) { return ctx->machine.phys_mem_total; }
-uint64_t mag_ctx_get_physical_memory_free(const mag_ctx_t* ctx) { return ctx->machine.phys_mem_free; }
+uint64_t mag_ctx_get_physical_memory_total(const mag_ctx_t* ctx) {
+    (void)ctx;
+    uint64_t total = 0, free = 0;
+    mag_system_host_info_query_memory(&total, &free);
+    return total;
+}
+uint64_t mag_ctx_get_physical_memory_free(const mag_ctx_t* ctx) {
+    (void)ctx;
+    uint64_t total = 0, free = 0;
+    mag_system_host_info_query_memory(&total, &free);
+    return free;
+}
+uint64_t mag_ctx_get_cpu_cache_size(const mag_ctx_t* ctx, uint32_t level) { return level && level <= MAG_MAX_CACHE_LEVELS ? ctx->machine.cpu_caches[level-1].size : 0; }
+uint32_t mag_ctx_get_cpu_cache_line_size(const mag_ctx_t* ctx, uint32_t level) { return level && level <= MAG_MAX_CACHE_LEVELS ? ctx->machine.cpu_caches[level-1].line_size : 0; }
+uint32_t mag_ctx_get_cpu_cache_shared_by(const mag_ctx_t* ctx, uint32_t level) { return level && level <= MAG_MAX_CACHE_LEVELS ? ctx->machine.cpu_caches[level-1].shared_by : 0; }
 bool mag_ctx_is_numa_system(const mag_ctx_t* ctx) { return false; /* TODO */ }
 size_t mag_ctx_get_total_tensors_created(const mag_ctx_t* ctx) { return 0; /* TODO */ }
 
@@ -673,6 +940,7 @@ static mag_intrusive_chunk* mag_fixed_pool_chunk_new(size_t block_size, size_t b
     uintptr_t size = 0;
     mag_pincr((void**)&size, sizeof(mag_intrusive_chunk), __alignof(mag_intrusive_chunk));
     mag_pincr((void**)&size, cap, block_align);
+    size += block_align; /* Slack, the offsets above assume an aligned base but the allocator only guarantees malloc alignment. */
     void* base = (*mag_alloc)(NULL, size), *pos = base;
     mag_intrusive_chunk* chunk = mag_pincr(&pos, sizeof(mag_intrusive_chunk), __alignof(mag_intrusive_chunk));
     uint8_t* bot = mag_pincr(&pos, cap, block_align);
@@ -684,6 +952,8 @@ static mag_intrusive_chunk* mag_fixed_pool_chunk_new(size_t block_size, size_t b
     return chunk;
 }
 
+static volatile mag_atomic_t mag_fixed_pool_next_id = 0;
+
 void mag_fixed_intrusive_pool_init(mag_fixed_intrusive_pool* pool, size_t block_size, size_t block_align, size_t blocks_per_chunk) {
     mag_assert2(blocks_per_chunk);
     block_size = mag_xmax(sizeof(void*), block_size); /* Ensure block size is at least sizeof(void*) to store intrusive free list. */
@@ -698,11 +968,15 @@ void mag_fixed_intrusive_pool_init(mag_fixed_intrusive_pool* pool, size_t block_
         .num_freelist_hits = 0,
         .num_pool_hits = 0,
         .num_chunks = 1,
-        .num_allocs = 0
+        .num_allocs = 0,
+        .id = (uint64_t)mag_atomic_fetch_add(&mag_fixed_pool_next_id, 1, MAG_MO_RELAXED)+1,
+        .lock = 0,
+        .concurrent = false,
+        .magazines = NULL
     };
 }
 
-void* mag_fixed_intrusive_pool_malloc(mag_fixed_intrusive_pool* pool) {
+static void* mag_fixed_pool_malloc_serial(mag_fixed_intrusive_pool* pool) {
     ++pool->num_allocs;
     if (mag_likely(pool->free_list)) { /* 1. Try to pop from free_list (fastest path) */
         ++pool->num_freelist_hits;
@@ -726,12 +1000,101 @@ void* mag_fixed_intrusive_pool_malloc(mag_fixed_intrusive_pool* pool) {
     return new_chunk->top;
 }
 
-void mag_fixed_intrusive_pool_free(mag_fixed_intrusive_pool* pool, void* blk) { /* Push chunk into free list */
+static void mag_fixed_pool_free_serial(mag_fixed_intrusive_pool* pool, void* blk) { /* Push chunk into free list */
     *(void**)blk = pool->free_list;
     pool->free_list = blk;
 }
 
+/*
+** Concurrent mode: every thread keeps a small magazine of free blocks per pool, so most allocations and frees touch no shared state.
+** Only refilling an empty or draining a full magazine takes the pool lock, and then moves half a magazine at once.
+** Magazines are owned by their pool and linked into its registry, threads only cache pointers to them keyed by pool id.
+** Leaving concurrent mode drains every registered magazine, including those of exited threads and evicted cache slots,
+** and a pool entering concurrent mode takes a fresh id, so cached pointers of a previous epoch never match again.
+*/
+#define MAG_POOL_MAGAZINE_CAP 32
+#define MAG_POOL_MAGAZINE_SLOTS 8
+
+struct mag_pool_magazine_t {
+    uint32_t len;
+    void* blocks[MAG_POOL_MAGAZINE_CAP];
+    mag_pool_magazine_t* next; /* Next magazine in the registry of the pool. */
+};
+
+typedef struct mag_pool_magazine_slot_t {
+    uint64_t pool_id;
+    mag_pool_magazine_t* mag;
+} mag_pool_magazine_slot_t;
+
+static MAG_THREAD_LOCAL mag_pool_magazine_slot_t mag_pool_magazine_slots[MAG_POOL_MAGAZINE_SLOTS];
+
+static mag_pool_magazine_t* mag_pool_magazine_of(mag_fixed_intrusive_pool* pool) {
+    mag_pool_magazine_slot_t* free_slot = NULL;
+    for (uint32_t i=0; i < MAG_POOL_MAGAZINE_SLOTS; ++i) {
+        mag_pool_magazine_slot_t* slot = mag_pool_magazine_slots+i;
+        if (mag_likely(slot->pool_id == pool->id)) return slot->mag;
+        if (!free_slot && !slot->pool_id) free_slot = slot;
+    }
+    if (!free_slot) free_slot = mag_pool_magazine_slots + pool->id % MAG_POOL_MAGAZINE_SLOTS; /* Evict, the magazine stays in the registry of its pool. */
+    mag_pool_magazine_t* mag = (*mag_alloc)(NULL, sizeof(*mag));
+    mag->len = 0;
+    mag_spinlock_acquire(&pool->lock);
+    mag->next = pool->magazines;
+    pool->magazines = mag;
+    mag_spinlock_release(&pool->lock);
+    free_slot->pool_id = pool->id;
+    free_slot->mag = mag;
+    return mag;
+}
+
+static void mag_fixed_pool_drain_magazines(mag_fixed_intrusive_pool* pool) { /* Return all magazine blocks to the free list and release the magazines. */
+    for (mag_pool_magazine_t* mag = pool->magazines, *next; mag; mag = next) {
+        next = mag->next;
+        while (mag->len) mag_fixed_pool_free_serial(pool, mag->blocks[--mag->len]);
+        (*mag_alloc)(mag, 0);
+    }
+    pool->magazines = NULL;
+}
+
+static void* mag_fixed_pool_malloc_concurrent(mag_fixed_intrusive_pool* pool) {
+    mag_pool_magazine_t* mag = mag_pool_magazine_of(pool);
+    if (mag_likely(mag->len)) return mag->blocks[--mag->len];
+    mag_spinlock_acquire(&pool->lock); /* Refill half a magazine from the shared pool. */
+    while (mag->len < MAG_POOL_MAGAZINE_CAP>>1)
+        mag->blocks[mag->len++] = mag_fixed_pool_malloc_serial(pool);
+    mag_spinlock_release(&pool->lock);
+    return mag->blocks[--mag->len];
+}
+
+static void mag_fixed_pool_free_concurrent(mag_fixed_intrusive_pool* pool, void* blk) {
+    mag_pool_magazine_t* mag = mag_pool_magazine_of(pool);
+    if (mag_unlikely(mag->len == MAG_POOL_MAGAZINE_CAP)) { /* Drain half a magazine into the shared free list. */
+        mag_spinlock_acquire(&pool->lock);
+        while (mag->len > MAG_POOL_MAGAZINE_CAP>>1)
+            mag_fixed_pool_free_serial(pool, mag->blocks[--mag->len]);
+        mag_spinlock_release(&pool->lock);
+    }
+    mag->blocks[mag->len++] = blk;
+}
+
+void* mag_fixed_intrusive_pool_malloc(mag_fixed_intrusive_pool* pool) {
+    return mag_unlikely(pool->concurrent) ? mag_fixed_pool_malloc_concurrent(pool) : mag_fixed_pool_malloc_serial(pool);
+}
+
+void mag_fixed_intrusive_pool_free(mag_fixed_intrusive_pool* pool, void* blk) {
+    if (mag_unlikely(pool->concurrent)) mag_fixed_pool_free_concurrent(pool, blk);
+    else mag_fixed_pool_free_serial(pool, blk);
+}
+
+void mag_fixed_intrusive_pool_set_concurrent(mag_fixed_intrusive_pool* pool, bool concurrent) { /* Other threads must be done with the pool. */
+    if (pool->concurrent == concurrent) return;
+    if (concurrent) pool->id = (uint64_t)mag_atomic_fetch_add(&mag_fixed_pool_next_id, 1, MAG_MO_RELAXED)+1;
+    else mag_fixed_pool_drain_magazines(pool);
+    pool->concurrent = concurrent;
+}
+
 void mag_fixed_intrusive_pool_destroy(mag_fixed_intrusive_pool* pool) {
+    mag_fixed_pool_drain_magazines(pool);
     mag_intrusive_chunk* chunk = pool->chunks;
     while (chunk) {
         mag_intrusive_chunk* next = chunk->next;
@@ -790,12 +1153,14 @@ void mag_ctx_profile_stop_recording(mag_ctx_t* ctx, const char* export_csv_file)
         mag_print_separator(stdout);
         printf("OS/Kernel: %s\n", ctx->machine.os_name);
         printf("CPU: %s, Virtual Cores: %u, Physical Cores: %u, Sockets: %u\n", ctx->machine.cpu_name, ctx->machine.cpu_virtual_cores, ctx->machine.cpu_physical_cores, ctx->machine.cpu_sockets);
+        uint64_t phys_mem_total = 0, phys_mem_free = 0;
+        mag_system_host_info_query_memory(&phys_mem_total, &phys_mem_free);
         double mem_total, mem_free, mem_used;
         const char* mem_unit_total, *mem_unit_free, *mem_unit_used;
-        mag_humanize_memory_size(ctx->machine.phys_mem_total, &mem_total, &mem_unit_total);
-        mag_humanize_memory_size(ctx->machine.phys_mem_free, &mem_free, &mem_unit_free);
-        mag_humanize_memory_size((size_t)llabs((int64_t)ctx->machine.phys_mem_total-(int64_t)ctx->machine.phys_mem_free), &mem_used, &mem_unit_used);
-        double mem_used_percent = fabs((double)(ctx->machine.phys_mem_total-ctx->machine.phys_mem_free))/(double)ctx->machine.phys_mem_total*100.0;
+        mag_humanize_memory_size(phys_mem_total, &mem_total, &mem_unit_total);
+        mag_humanize_memory_size(phys_mem_free, &mem_free, &mem_unit_free);
+        mag_humanize_memory_size((size_t)llabs((int64_t)phys_mem_total-(int64_t)phys_mem_free), &mem_used, &mem_unit_used);
+        double mem_used_percent = fabs((double)(phys_mem_total-phys_mem_free))/(double)phys_mem_total*100.0;
         printf("Physical memory: %.03f %s, Free: %.03f %s, Used: %.03f %s (%.02f%%)\n", mem_total, mem_unit_total, mem_free, mem_unit_free, mem_used, mem_unit_used, mem_used_percent);
         mag_print_separator(stdout);
         printf("%16s %16s %16s %16s %16s\n", "Operation", "Executions", "Usage (%)", "AVG Time (μs)", "Total Time (μs)");
@@ -856,6 +1221,7 @@ const char* mag_device_type_get_name(mag_compute_device_type_t op) {
     static const char* const names[MAG_COMPUTE_DEVICE_TYPE__NUM] = {
         [MAG_COMPUTE_DEVICE_TYPE_CPU] = "CPU",
         [MAG_COMPUTE_DEVICE_TYPE_GPU_CUDA] = "CUDA GPU",
+        [MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM] = "CPU Stream",
     };
     return names[op];
 }
@@ -870,6 +1236,7 @@ const mag_dtype_meta_t* mag_dtype_meta_of(mag_dtype_t type) {
     return &infos[type];
 }
 
+#ifdef MAG_DEBUG /* Arity and parameter checks are only run in debug builds, see mag_tensor_operator. */
 static bool mag_check_are_inputs_valid(mag_op_t op, mag_tensor_t** inputs, uint32_t numin) {
     const mag_op_meta_t* meta = mag_op_meta_of(op);
     if (mag_unlikely(meta->argcount != numin || numin > MAG_MAX_INPUT_TENSORS)) {
@@ -947,30 +1314,7 @@ static bool mag_check_are_op_params_valid(mag_op_t op, const mag_op_param_t* par
     }
     return true;
 }
-
-static bool mag_check_is_shape_eq(mag_op_t op, const mag_tensor_t* a, const mag_tensor_t* b) {
-    const mag_op_meta_t* meta = mag_op_meta_of(op);
-    if (mag_likely(mag_tensor_is_shape_eq(a, b))) return true;
-    mag_print_separator(stderr);
-    char shape_1[MAG_FMT_DIM_BUF_SIZE];
-    char shape_2[MAG_FMT_DIM_BUF_SIZE];
-    mag_fmt_dims(&shape_1, &a->shape, a->rank);
-    mag_fmt_dims(&shape_2, &b->shape, b->rank);
-    fprintf(stderr,
-        "Failed to execute operation: %s.\n"
-        "ERROR: Tensor shapes must be equal.\n"
-        "    - Tensor 1 '%s' Shape: %s\n"
-        "    - Tensor 2 '%s' Shape: %s\n"
-        "    Hint: Adjust tensor shapes using transpose() or permute().\n",
-        meta->mnemonic,
-        a->name, shape_1,
-        b->name, shape_2
-    );
-    mag_print_separator(stderr);
-    fputc('\n', stderr);
-    fflush(stderr);
-    return false;
-}
+#endif
 
 static bool mag_check_is_shape_broadcastable(mag_op_t op, const mag_tensor_t* a, const mag_tensor_t* b) { /* Check if tensor shapes are broadcast-able. (b into a) */
     const mag_op_meta_t* meta = mag_op_meta_of(op);
@@ -996,8 +1340,8 @@ static bool mag_check_is_shape_broadcastable(mag_op_t op, const mag_tensor_t* a,
         "    Broadcast-able: %s\n"
         "    Hint: Adjust tensor shapes using transpose() or permute().\n",
         meta->mnemonic,
-        a->name, shape_1,
-        b->name, shape_2,
+        mag_tensor_get_name(a), shape_1,
+        mag_tensor_get_name(b), shape_2,
         broadcast_able_str
     );
     mag_print_separator(stderr);
@@ -1026,8 +1370,8 @@ static bool mag_check_is_shape_matmulable(mag_op_t op, const mag_tensor_t* a, co
         "    - Input Tensor 2 '%s' Shape: %s\n"
         "    Hint: Adjust tensor shapes using transpose() or permute().\n",
         meta->mnemonic,
-        a->name, shape_1,
-        b->name, shape_2
+        mag_tensor_get_name(a), shape_1,
+        mag_tensor_get_name(b), shape_2
     );
     mag_print_separator(stderr);
     fputc('\n', stderr);
@@ -1046,7 +1390,7 @@ static bool mag_check_is_contiguous(mag_op_t op, const mag_tensor_t* a) {
         "ERROR: Tensor '%s' must be contiguous. Shape: %s\n"
         "    Hint: Make tensor contiguous using clone().\n",
         meta->mnemonic,
-        a->name,
+        mag_tensor_get_name(a),
         shape
     );
     mag_print_separator(stderr);
@@ -1055,27 +1399,29 @@ static bool mag_check_is_contiguous(mag_op_t op, const mag_tensor_t* a) {
     return false;
 }
 
-static bool mag_validate_op_unary(mag_op_t op, mag_tensor_t* result, mag_tensor_t** inputs, const mag_op_param_t* params) {
-   return mag_check_is_shape_eq(op, result, inputs[0]);
+/*
+** Validators only inspect the inputs and run before the result is constructed.
+** Results are always freshly allocated or viewed with the input shape and contiguous strides,
+** so shape equality and contiguity of the result hold by construction and are not checked.
+*/
+
+static bool mag_validate_op_unary(mag_op_t op, mag_tensor_t** inputs, const mag_op_param_t* params) {
+    return true;
 }
 
-static bool mag_validate_op_binary(mag_op_t op, mag_tensor_t* result, mag_tensor_t** inputs, const mag_op_param_t* params) {
-    bool valid = true;
-    valid = valid && mag_check_is_shape_eq(op, result, inputs[0]);
-    valid = valid && mag_check_is_shape_broadcastable(op, inputs[0], inputs[1]);
-    valid = valid && mag_check_is_contiguous(op, result);
-    return valid;
+static bool mag_validate_op_binary(mag_op_t op, mag_tensor_t** inputs, const mag_op_param_t* params) {
+    return mag_check_is_shape_broadcastable(op, inputs[0], inputs[1]);
 }
 
-static bool mag_validate_op_transpose(mag_op_t op, mag_tensor_t* result, mag_tensor_t** inputs, const mag_op_param_t* params) {
+static bool mag_validate_op_transpose(mag_op_t op, mag_tensor_t** inputs, const mag_op_param_t* params) {
     return true;
 }
 
-static bool mag_validate_op_scalar(mag_op_t op, mag_tensor_t* result, mag_tensor_t** inputs, const mag_op_param_t* params) {
+static bool mag_validate_op_scalar(mag_op_t op, mag_tensor_t** inputs, const mag_op_param_t* params) {
     return mag_check_is_contiguous(op, inputs[0]);
 }
 
-static bool mag_validate_op_matmul(mag_op_t op, mag_tensor_t* result, mag_tensor_t** inputs, const mag_op_param_t* params) {
+static bool mag_validate_op_matmul(mag_op_t op, mag_tensor_t** inputs, const mag_op_param_t* params) {
     bool valid = true;
     valid = valid && mag_check_is_shape_matmulable(op, inputs[0], inputs[1]);
     valid = valid && mag_check_is_contiguous(op, inputs[0]);
@@ -1135,368 +1481,435 @@ static mag_tensor_t* mag_result_constructor_routine_matmul(mag_tensor_t** inputs
     return mag_tensor_create(inputs[0]->ctx, MAG_DTYPE_F32, shape, 2, NULL, 0);
 }
 
-const mag_op_meta_t* mag_op_meta_of(mag_op_t type) {
-    static const mag_op_meta_t infos[MAG_OP__NUM] = {
-        [MAG_OP_NOP] = {
-            .mnemonic = "nop",
-            .argcount = 0,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = NULL,
-            .validator = NULL
-        },
-        [MAG_OP_CLONE] = {
-            .mnemonic = "clone",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_VIEW] = {
-            .mnemonic = "view",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_view,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_TRANSPOSE] = {
-            .mnemonic = "transpose",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_transposed,
-            .validator = &mag_validate_op_transpose
-        },
-        [MAG_OP_PERMUTE] = {
-            .mnemonic = "permute",
-            .argcount = 1,
-            .paramcount = MAG_MAX_DIMS,
-            .param_types = {
-                MAG_OP_TPARAM_U32,
-                MAG_OP_TPARAM_U32,
-                MAG_OP_TPARAM_U32,
-                MAG_OP_TPARAM_U32,
-                MAG_OP_TPARAM_U32,
-                MAG_OP_TPARAM_U32,
-            },
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_permuted,
-            .validator = &mag_validate_op_transpose
-        },
-        [MAG_OP_MEAN] = {
-            .mnemonic = "mean",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_scalar,
-            .validator = &mag_validate_op_scalar
-        },
-        [MAG_OP_MIN] = {
-            .mnemonic = "min",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_scalar,
-            .validator = &mag_validate_op_scalar
-        },
-        [MAG_OP_MAX] = {
-            .mnemonic = "max",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_scalar,
-            .validator = &mag_validate_op_scalar
-        },
-        [MAG_OP_SUM] = {
-            .mnemonic = "sum",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = false,
-            .r_alloc = &mag_result_constructor_routine_scalar,
-            .validator = &mag_validate_op_scalar
-        },
-        [MAG_OP_ABS] = {
-            .mnemonic = "abs",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_NEG] = {
-            .mnemonic = "neg",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_LOG] = {
-            .mnemonic = "log",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SQR] = {
-            .mnemonic = "sqr",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SQRT] = {
-            .mnemonic = "sqrt",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SIN] = {
-            .mnemonic = "sin",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_COS] = {
-            .mnemonic = "cos",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_STEP] = {
-            .mnemonic = "step",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SOFTMAX] = {
-            .mnemonic = "softmax",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SOFTMAX_DV] = {
-            .mnemonic = "softmax_dv",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SIGMOID] = {
-            .mnemonic = "sigmoid",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SIGMOID_DV] = {
-            .mnemonic = "sigmoid_dv",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_HARD_SIGMOID] = {
-            .mnemonic = "hard_sigmoid",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SILU] = {
-            .mnemonic = "silu",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SILU_DV] = {
-            .mnemonic = "silu_dv",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_TANH] = {
-            .mnemonic = "tanh",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_TANH_DV] = {
-            .mnemonic = "tanh_dv",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_RELU] = {
-            .mnemonic = "relu",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_RELU_DV] = {
-            .mnemonic = "relu_dv",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_GELU] = {
-            .mnemonic = "gelu",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_GELU_DV] = {
-            .mnemonic = "gelu_dv",
-            .argcount = 1,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_ADD] = {
-            .mnemonic = "add",
-            .argcount = 2,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_binary
-        },
-        [MAG_OP_SUB] = {
-            .mnemonic = "sub",
-            .argcount = 2,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_binary
-        },
-        [MAG_OP_MUL] = {
-            .mnemonic = "mul",
-            .argcount = 2,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_binary
-        },
-        [MAG_OP_DIV] = {
-            .mnemonic = "div",
-            .argcount = 2,
-            .paramcount = 0,
-            .param_types = {MAG_OP_TPARAM_NONE},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_binary
-        },
-        [MAG_OP_ADDS] = {
-            .mnemonic = "adds",
-            .argcount = 1,
-            .paramcount = 1,
-            .param_types = {MAG_OP_TPARAM_F32},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_SUBS] = {
-            .mnemonic = "subs",
-            .argcount = 1,
-            .paramcount = 1,
-            .param_types = {MAG_OP_TPARAM_F32},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_MULS] = {
-            .mnemonic = "muls",
-            .argcount = 1,
-            .paramcount = 1,
-            .param_types = {MAG_OP_TPARAM_F32},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
-        },
-        [MAG_OP_DIVS] = {
-            .mnemonic = "divs",
-            .argcount = 1,
-            .paramcount = 1,
-            .param_types = {MAG_OP_TPARAM_F32},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_isomorph,
-            .validator = &mag_validate_op_unary
+/* Shape and dtype of the result, without constructing it. False for ops whose result is a view of the input. */
+static bool mag_op_result_shape(const mag_op_meta_t* meta, mag_tensor_t** inputs, int64_t (*shape)[MAG_MAX_DIMS], int64_t* rank, mag_dtype_t* dtype) {
+    for (uint32_t i=0; i < MAG_MAX_DIMS; ++i) (*shape)[i] = 1;
+    if (meta->r_alloc == &mag_result_constructor_routine_isomorph) {
+        memcpy(*shape, inputs[0]->shape, sizeof(*shape));
+        *rank = inputs[0]->rank;
+        *dtype = inputs[0]->dtype;
+        return true;
+    }
+    if (meta->r_alloc == &mag_result_constructor_routine_scalar) {
+        *rank = 1;
+        *dtype = inputs[0]->dtype;
+        return true;
+    }
+    if (meta->r_alloc == &mag_result_constructor_routine_matmul) {
+        (*shape)[0] = inputs[0]->shape[0];
+        (*shape)[1] = inputs[1]->shape[1];
+        *rank = 2;
+        *dtype = MAG_DTYPE_F32;
+        return true;
+    }
+    return false;
+}
+
+static bool mag_check_is_valid_out(mag_op_t op, mag_tensor_t** inputs, uint32_t numin, const mag_tensor_t* out) {
+    const mag_op_meta_t* meta = mag_op_meta_of(op);
+    int64_t shape[MAG_MAX_DIMS], rank;
+    mag_dtype_t dtype;
+    const char* error = NULL;
+    if (mag_unlikely(!mag_op_result_shape(meta, inputs, &shape, &rank, &dtype))) error = "Operation result is a view and cannot be written into an output tensor.";
+    else if (mag_unlikely(out->ctx != inputs[0]->ctx)) error = "Output tensor belongs to another context.";
+    else if (mag_unlikely(out->dtype != dtype)) error = "Output tensor dtype does not match the result dtype.";
+    else if (mag_unlikely(out->rank != rank || memcmp(out->shape, shape, sizeof(shape)) != 0)) error = "Output tensor shape does not match the result shape.";
+    else if (mag_unlikely(!mag_tensor_is_contiguous(out))) error = "Output tensor must be contiguous.";
+    else if (mag_unlikely(op == MAG_OP_MATMUL)) { /* Matmul reads its inputs while writing the result, so they must not alias. */
+        for (uint32_t i=0; i < numin; ++i)
+            if (inputs[i]->storage == out->storage) error = "Output tensor of matmul must not alias an input.";
+    }
+    if (mag_unlikely(!error && out->ctx->exec_mode != MAG_EXEC_MODE_EAGER)) { /* Out is re-wired to this op before anything runs. */
+        for (uint32_t i=0; i < numin; ++i)
+            if (inputs[i]->storage == out->storage) error = "Output tensor must not alias an input outside eager mode, the graph would contain a cycle.";
+        if (!error && out->op != MAG_OP_NOP && !out->ctx->capture) error = "Output tensor has an unexecuted producer, which re-targeting would drop.";
+    }
+    if (mag_likely(!error)) return true;
+    mag_print_separator(stderr);
+    char shape_r[MAG_FMT_DIM_BUF_SIZE];
+    char shape_o[MAG_FMT_DIM_BUF_SIZE];
+    mag_fmt_dims(&shape_r, &shape, rank);
+    mag_fmt_dims(&shape_o, &out->shape, out->rank);
+    fprintf(stderr,
+        "Failed to execute operation: %s.\n"
+        "ERROR: %s\n"
+        "    - Result Shape: %s\n"
+        "    - Output Tensor '%s' Shape: %s\n"
+        "    Hint: Create the output tensor with the result shape, or use the allocating variant of the operation.\n",
+        meta->mnemonic,
+        error,
+        shape_r,
+        mag_tensor_get_name(out), shape_o
+    );
+    mag_print_separator(stderr);
+    fputc('\n', stderr);
+    fflush(stderr);
+    return false;
+}
+
+static const mag_op_meta_t mag_op_meta_table[MAG_OP__NUM] = { /* File scope, so the operator dispatch can index it directly. */
+    [MAG_OP_NOP] = {
+        .mnemonic = "nop",
+        .argcount = 0,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = NULL,
+        .validator = NULL
+    },
+    [MAG_OP_CLONE] = {
+        .mnemonic = "clone",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_VIEW] = {
+        .mnemonic = "view",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_view,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_TRANSPOSE] = {
+        .mnemonic = "transpose",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_transposed,
+        .validator = &mag_validate_op_transpose
+    },
+    [MAG_OP_PERMUTE] = {
+        .mnemonic = "permute",
+        .argcount = 1,
+        .paramcount = MAG_MAX_DIMS,
+        .param_types = {
+            MAG_OP_TPARAM_U32,
+            MAG_OP_TPARAM_U32,
+            MAG_OP_TPARAM_U32,
+            MAG_OP_TPARAM_U32,
+            MAG_OP_TPARAM_U32,
+            MAG_OP_TPARAM_U32,
         },
-        [MAG_OP_MATMUL] = {
-            .mnemonic = "matmul",
-            .argcount = 2,
-            .paramcount = 0,
-            .param_types = {},
-            .inplace = true,
-            .r_alloc = &mag_result_constructor_routine_matmul,
-            .validator = &mag_validate_op_matmul
-        }
-    };
-    return infos+type;
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_permuted,
+        .validator = &mag_validate_op_transpose
+    },
+    [MAG_OP_MEAN] = {
+        .mnemonic = "mean",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_scalar,
+        .validator = &mag_validate_op_scalar
+    },
+    [MAG_OP_MIN] = {
+        .mnemonic = "min",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_scalar,
+        .validator = &mag_validate_op_scalar
+    },
+    [MAG_OP_MAX] = {
+        .mnemonic = "max",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_scalar,
+        .validator = &mag_validate_op_scalar
+    },
+    [MAG_OP_SUM] = {
+        .mnemonic = "sum",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = false,
+        .r_alloc = &mag_result_constructor_routine_scalar,
+        .validator = &mag_validate_op_scalar
+    },
+    [MAG_OP_ABS] = {
+        .mnemonic = "abs",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_NEG] = {
+        .mnemonic = "neg",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_LOG] = {
+        .mnemonic = "log",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SQR] = {
+        .mnemonic = "sqr",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SQRT] = {
+        .mnemonic = "sqrt",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SIN] = {
+        .mnemonic = "sin",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_COS] = {
+        .mnemonic = "cos",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_STEP] = {
+        .mnemonic = "step",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SOFTMAX] = {
+        .mnemonic = "softmax",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SOFTMAX_DV] = {
+        .mnemonic = "softmax_dv",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SIGMOID] = {
+        .mnemonic = "sigmoid",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SIGMOID_DV] = {
+        .mnemonic = "sigmoid_dv",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_HARD_SIGMOID] = {
+        .mnemonic = "hard_sigmoid",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SILU] = {
+        .mnemonic = "silu",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SILU_DV] = {
+        .mnemonic = "silu_dv",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_TANH] = {
+        .mnemonic = "tanh",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_TANH_DV] = {
+        .mnemonic = "tanh_dv",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_RELU] = {
+        .mnemonic = "relu",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_RELU_DV] = {
+        .mnemonic = "relu_dv",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_GELU] = {
+        .mnemonic = "gelu",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_GELU_DV] = {
+        .mnemonic = "gelu_dv",
+        .argcount = 1,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_ADD] = {
+        .mnemonic = "add",
+        .argcount = 2,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_binary
+    },
+    [MAG_OP_SUB] = {
+        .mnemonic = "sub",
+        .argcount = 2,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_binary
+    },
+    [MAG_OP_MUL] = {
+        .mnemonic = "mul",
+        .argcount = 2,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_binary
+    },
+    [MAG_OP_DIV] = {
+        .mnemonic = "div",
+        .argcount = 2,
+        .paramcount = 0,
+        .param_types = {MAG_OP_TPARAM_NONE},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_binary
+    },
+    [MAG_OP_ADDS] = {
+        .mnemonic = "adds",
+        .argcount = 1,
+        .paramcount = 1,
+        .param_types = {MAG_OP_TPARAM_F32},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_SUBS] = {
+        .mnemonic = "subs",
+        .argcount = 1,
+        .paramcount = 1,
+        .param_types = {MAG_OP_TPARAM_F32},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_MULS] = {
+        .mnemonic = "muls",
+        .argcount = 1,
+        .paramcount = 1,
+        .param_types = {MAG_OP_TPARAM_F32},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_DIVS] = {
+        .mnemonic = "divs",
+        .argcount = 1,
+        .paramcount = 1,
+        .param_types = {MAG_OP_TPARAM_F32},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_isomorph,
+        .validator = &mag_validate_op_unary
+    },
+    [MAG_OP_MATMUL] = {
+        .mnemonic = "matmul",
+        .argcount = 2,
+        .paramcount = 0,
+        .param_types = {},
+        .inplace = true,
+        .r_alloc = &mag_result_constructor_routine_matmul,
+        .validator = &mag_validate_op_matmul
+    }
+};
+
+const mag_op_meta_t* mag_op_meta_of(mag_op_t type) {
+    return mag_op_meta_table+type;
 }
 
 #undef mag_validate_inputs
@@ -1516,12 +1929,45 @@ int64_t mag_tensor_num_cols(const mag_tensor_t* t) { return *t->shape; }
     }
 #endif
 
-static mag_tensor_t* mag_tensor_create(mag_ctx_t* ctx, mag_dtype_t type, const int64_t* dims, int64_t rank, mag_tensor_t* view, size_t view_offs) {
+static void mag_ctx_check_thread(const mag_ctx_t* ctx) {
+    if (ctx->concurrent) return; /* Any thread may use a concurrent context. */
     uintptr_t tr_id = mag_thread_id();
     mag_assert(tr_id == ctx->tr_id, "%" PRIx64 " != %" PRIx64 " Tensor must be created on the same thread as the context.", tr_id, ctx->tr_id);
+}
+
+/* Storage of frozen tensors or tensors with atomic refcounts can be referenced from several threads, so its refcount is atomic then. */
+static void mag_storage_incref(mag_storage_buffer_t* sto, bool frozen) {
+    if (mag_unlikely(frozen)) mag_atomic_fetch_add(&sto->rc, 1, MAG_MO_RELAXED);
+    else ++sto->rc;
+}
+static bool mag_storage_decref(mag_storage_buffer_t* sto, bool frozen) { /* Returns true if the last reference was dropped. */
+    if (mag_unlikely(frozen)) return mag_atomic_fetch_sub(&sto->rc, 1, MAG_MO_ACQ_REL) == 1;
+    return !--sto->rc;
+}
+
+static void mag_storage_release(mag_ctx_t* ctx, mag_storage_buffer_t* sto, bool frozen) {
+    if (mag_storage_decref(sto, frozen)) { /* Free device memory when the last tensor sharing the storage dies. */
+        if (ctx->free_mode != MAG_FREE_MODE_IMMEDIATE) { /* Queue for batched release. */
+            mag_ctx_defer_free(ctx, sto);
+        } else {
+            mag_ctx_free_storage(ctx, sto);
+            mag_fixed_intrusive_pool_free(&ctx->storage_pool, sto);
+        }
+    }
+}
+
+/*
+** Thread ownership is checked by the public constructors, and for every op only in debug builds (see mag_tensor_operator).
+** A view from another context (see mag_tensor_share) only borrows the frozen storage and does not link to the viewed tensor.
+*/
+static mag_tensor_t* mag_tensor_create(mag_ctx_t* ctx, mag_dtype_t type, const int64_t* dims, int64_t rank, mag_tensor_t* view, size_t view_offs) {
     mag_assert(dims != NULL && rank >= 0 && rank <= MAG_MAX_DIMS, "Rank must be within (0, %d]", MAG_MAX_DIMS);
     mag_assert2(view_offs == 0); /* NYI. TODO */
-    if (view) {
+    bool borrowed = view && view->ctx != ctx;
+    mag_tensor_flags_t flags = view ? MAG_TFLAG_VIEW|(view->flags & (MAG_TFLAG_FROZEN|MAG_TFLAG_ATOMIC_RC)) : MAG_TFLAG_OWNER;
+    if (ctx->atomic_rc) flags |= MAG_TFLAG_ATOMIC_RC;
+    mag_assert2(!borrowed || (view->flags & MAG_TFLAG_FROZEN));
+    if (view && !borrowed) {
         if (view->view_uplink) { /* Traverse view chain and accumulate offset */
             view_offs += view->view_offs;
             view = view->view_uplink;
@@ -1544,30 +1990,34 @@ static mag_tensor_t* mag_tensor_create(mag_ctx_t* ctx, mag_dtype_t type, const i
                 .dtor = &mag_tensor_sanitize_dtor
             #endif
         },
+        .storage = NULL,
+        .op_inputs = {0},
+        .op = MAG_OP_NOP,
+        .dtype = type,
+        .flags = flags,
         .ctx = ctx,
+        .numel = numel,
         .rank = rank,
         .shape = {0},
         .strides = {0},
-        .dtype = type,
-        .storage = {0},
-        .numel = numel,
-        .flags = view ? MAG_TFLAG_VIEW : MAG_TFLAG_OWNER,
-        .op = MAG_OP_NOP,
-        .op_inputs = {0},
         .op_params = {{0}},
-        .view_uplink = view,
+        .view_uplink = borrowed ? NULL : view,
         .view_offs = view_offs,
         .grad = NULL,
-        .pmon = {0},
-        .name = "",
-        .ud = NULL
+        .cold = NULL
     };
     mag_tensor_incref(t); /* First strong RC=1 */
     /* Allocate device memory */
-    mag_compute_device_t* dvc = ctx->device;
-    void (*allocator)(mag_compute_device_t*, mag_storage_buffer_t*, size_t) = dvc->alloc_storage;
-    if (view) t->storage = view->storage; /* Reference memory from view */
-    else (*allocator)(dvc, &t->storage, numbytes); /* Allocate new device memory */
+    if (view) { /* Share storage descriptor of viewed tensor */
+        t->storage = view->storage;
+        mag_storage_incref(t->storage, t->flags & (MAG_TFLAG_FROZEN|MAG_TFLAG_ATOMIC_RC));
+        if (borrowed) mag_atomic_fetch_add(&t->storage->borrowers, 1, MAG_MO_RELAXED);
+    } else { /* Allocate new descriptor and device memory */
+        t->storage = mag_fixed_intrusive_pool_malloc(&ctx->storage_pool);
+        mag_ctx_alloc_storage(ctx, t->storage, numbytes);
+        t->storage->rc = 1;
+        t->storage->borrowers = 0;
+    }
     #pragma GCC unroll 6
     for (uint32_t i=0; i < MAG_MAX_DIMS; ++i)    /* Copy dimensions and set unused to identity. */
         t->shape[i] = i < rank ? dims[i] : 1;
@@ -1576,22 +2026,37 @@ static mag_tensor_t* mag_tensor_create(mag_ctx_t* ctx, mag_dtype_t type, const i
     for (uint32_t i=1; i < MAG_MAX_DIMS; ++i)    /* Calculate strides and check for overflow. */
         mag_assert2(!mag_imull64_ov(t->strides[i-1], t->shape[i-1], t->strides+i));
 #ifdef MAG_DEBUG /* If tensor RC sanitize is enabled, insert into tracking list */
-    mag_tensor_node_t** head = &ctx->rc_tracked;
     mag_tensor_node_t* node = (*mag_alloc)(NULL, sizeof(*node));
+    mag_ctx_lock(ctx);
+    mag_tensor_node_t** head = &ctx->rc_tracked;
     *node = (mag_tensor_node_t) {
         .tensor = t,
         .next = *head
     };
     *head = node;
+    mag_ctx_unlock(ctx);
 #endif
     return t;
 }
 
+/* Returns the cold side table of a tensor, allocating it on first use. */
+static mag_tensor_cold_t* mag_tensor_cold(mag_tensor_t* t) {
+    if (mag_likely(t->cold)) return t->cold;
+    t->cold = mag_fixed_intrusive_pool_malloc(&t->ctx->tensor_cold_pool);
+    memset(t->cold, 0, sizeof(*t->cold));
+    return t->cold;
+}
+
+static void mag_tensor_check_mutable(const mag_tensor_t* t) {
+    mag_assert(!(t->flags & MAG_TFLAG_FROZEN), "Tensor '%s' is frozen and cannot be modified.", mag_tensor_get_name(t));
+}
+
 static void mag_tensor_destroy(mag_tensor_t* t) {
     mag_ctx_t* ctx = t->ctx;
 #ifdef MAG_DEBUG  /* If tensor RC sanitize is enabled, invoke destructor and erase from tracking list */
     void (*dtor)(mag_tensor_t*) = t->rcb.dtor;  /* Invoke Debug destructor. */
     if (dtor) (*dtor)(t);
+    mag_ctx_lock(ctx);
     mag_tensor_node_t** head = &ctx->rc_tracked;
     if (*head) {
         mag_tensor_node_t* curr = *head, *prev = NULL;
@@ -1609,92 +2074,528 @@ static void mag_tensor_destroy(mag_tensor_t* t) {
             }
         }
     }
+    mag_ctx_unlock(ctx);
 #endif
-    if (t->flags & MAG_TFLAG_OWNER) { /* Free device memory if tensor owns it. */
-        mag_compute_device_t* dvc = t->ctx->device;
-        void (*dtor)(mag_compute_device_t*, mag_storage_buffer_t*) = dvc->free_storage;
-        (*dtor)(dvc, &t->storage);
-    }
+    if ((t->flags & MAG_TFLAG_VIEW) && !t->view_uplink) /* Borrowed view of another context's frozen storage. */
+        mag_atomic_fetch_sub(&t->storage->borrowers, 1, MAG_MO_RELEASE);
+    mag_storage_release(ctx, t->storage, t->flags & (MAG_TFLAG_FROZEN|MAG_TFLAG_ATOMIC_RC));
+    if (t->cold) mag_fixed_intrusive_pool_free(&ctx->tensor_cold_pool, t->cold);
     mag_fixed_intrusive_pool_free(&ctx->tensor_pool, t);
 }
 
+/* Atomic refcounts: relaxed increments, the decrement that hits zero synchronizes with all prior releases (acquire-release). */
 void mag_tensor_incref(mag_tensor_t* t) {
-    mag_assert2(t->rcb.rc_strong < UINT32_MAX);
-    ++t->rcb.rc_strong;
+    if (mag_unlikely(t->flags & MAG_TFLAG_ATOMIC_RC)) {
+        uint32_t prev = (uint32_t)mag_atomic32_fetch_add((volatile mag_atomic32_t*)&t->rcb.rc_strong, 1, MAG_MO_RELAXED);
+        mag_assert2(prev < UINT32_MAX);
+    } else {
+        mag_assert2(t->rcb.rc_strong < UINT32_MAX);
+        ++t->rcb.rc_strong;
+    }
 }
 
 bool mag_tensor_decref(mag_tensor_t* t) {
     if (t->view_uplink) { /* If tensor is a view, decrement base RC and free tensor chain */
         mag_tensor_decref(t->view_uplink);
     }
-    if (!--t->rcb.rc_strong) { /* Strong RC reaches zero, destroy. */
+    bool last = mag_unlikely(t->flags & MAG_TFLAG_ATOMIC_RC)
+        ? mag_atomic32_fetch_sub((volatile mag_atomic32_t*)&t->rcb.rc_strong, 1, MAG_MO_ACQ_REL) == 1
+        : !--t->rcb.rc_strong;
+    if (last) { /* Strong RC reaches zero, destroy. */
         mag_tensor_destroy(t);
         return true;
     }
     return false;
 }
 
-mag_tensor_t* mag_tensor_create_1d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1) {
-    return mag_tensor_create(ctx, type, (int64_t[]) {d1}, 1, NULL, 0);
+mag_tensor_t* mag_tensor_create_1d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1) {
+    mag_ctx_check_thread(ctx);
+    return mag_tensor_create(ctx, type, (int64_t[]) {d1}, 1, NULL, 0);
+}
+
+mag_tensor_t* mag_tensor_create_2d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2) {
+    mag_ctx_check_thread(ctx);
+    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2}, 2, NULL, 0);
+}
+
+mag_tensor_t* mag_tensor_create_3d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3) {
+    mag_ctx_check_thread(ctx);
+    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3}, 3, NULL, 0);
+}
+
+mag_tensor_t* mag_tensor_create_4d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3, int64_t d4) {
+    mag_ctx_check_thread(ctx);
+    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3, d4}, 4, NULL, 0);
+}
+
+mag_tensor_t* mag_tensor_create_5d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3, int64_t d4, int64_t d5) {
+    mag_ctx_check_thread(ctx);
+    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3, d4, d5}, 5, NULL, 0);
+}
+
+mag_tensor_t* mag_tensor_create_6d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3, int64_t d4, int64_t d5, int64_t d6) {
+    mag_ctx_check_thread(ctx);
+    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3, d4, d5, d6}, 6, NULL, 0);
+}
+
+static void MAG_HOTPROC mag_op_exec(mag_tensor_t* R, mag_compute_device_t* dvc, mag_graph_eval_order_t ord) {
+    void (*exec)(mag_compute_device_t*, mag_tensor_t*) = ord == MAG_GRAPH_EVAL_ORDER_FORWARD ? dvc->eager_exec_fwd : dvc->eager_exec_bwd;
+    if (mag_likely(!R->ctx->profiler_enabled)) { /* Fast path: plain dispatch without timing. */
+        (*exec)(dvc, R);
+        return;
+    }
+    mag_perf_mon_t* pmon = &mag_tensor_cold(R)->pmon;
+    mag_op_perf_info_t* pmon_op = R->ctx->op_perf_mons_total+R->op;
+    uint64_t start = mag_hpc_clock_ns(); /* Profiling monitoring */
+    (*exec)(dvc, R); /* Dispatch to backend. */
+    pmon->elapsed_ns = mag_hpc_clock_elapsed_ns(start);
+    pmon->elapsed_ns_acc += pmon->elapsed_ns;
+    ++pmon->n_execs;
+    if (mag_unlikely(R->ctx->concurrent)) { /* Op totals are shared between threads. */
+        mag_atomic_fetch_add((volatile mag_atomic_t*)&pmon_op->elapsed_ns_acc, (mag_atomic_t)pmon->elapsed_ns, MAG_MO_RELAXED);
+        mag_atomic_fetch_add((volatile mag_atomic_t*)&pmon_op->n_execs, 1, MAG_MO_RELAXED);
+    } else {
+        pmon_op->elapsed_ns_acc += pmon->elapsed_ns;
+        ++pmon_op->n_execs;
+    }
+}
+
+static void mag_plan_record(mag_ctx_t* ctx, mag_tensor_t* R) {
+    mag_ctx_lock(ctx);
+    mag_plan_t* plan = ctx->capture;
+    if (plan->len == plan->cap) {
+        plan->cap = plan->cap ? plan->cap<<1 : 64;
+        plan->nodes = (*mag_alloc)(plan->nodes, plan->cap*sizeof(*plan->nodes));
+    }
+    mag_plan_node_t* node = plan->nodes + plan->len++;
+    node->r = R;
+    node->op = R->op;
+    memcpy(node->inputs, R->op_inputs, sizeof(node->inputs));
+    memcpy(node->params, R->op_params, sizeof(node->params));
+    mag_ctx_unlock(ctx);
+    mag_tensor_incref(R);
+    for (uint32_t i=0; i < MAG_MAX_INPUT_TENSORS; ++i)
+        if (node->inputs[i]) mag_tensor_incref(node->inputs[i]);
+}
+
+void mag_ctx_begin_capture(mag_ctx_t* ctx) {
+    mag_assert(!ctx->capture, "Context is already capturing");
+    mag_plan_t* plan = (*mag_alloc)(NULL, sizeof(*plan));
+    *plan = (mag_plan_t){.ctx = ctx, .nodes = NULL, .len = 0, .cap = 0, .outputs = NULL, .num_outputs = 0, .kernels_planned = false};
+    ctx->capture = plan;
+}
+
+mag_plan_t* mag_ctx_end_capture(mag_ctx_t* ctx) {
+    mag_assert(ctx->capture, "Context is not capturing");
+    mag_plan_t* plan = ctx->capture;
+    ctx->capture = NULL;
+    mag_log_info("Captured plan with %zu ops", plan->len);
+    return plan;
+}
+
+bool mag_ctx_is_capturing(const mag_ctx_t* ctx) { return ctx->capture != NULL; }
+
+size_t mag_plan_get_num_nodes(const mag_plan_t* plan) { return plan->len; }
+size_t mag_plan_get_num_outputs(const mag_plan_t* plan) { return plan->num_outputs; }
+
+mag_tensor_t* mag_plan_get_output(const mag_plan_t* plan, size_t idx) {
+    mag_assert(idx < plan->num_outputs, "Output index %zu out of bounds, plan has %zu outputs", idx, plan->num_outputs);
+    return plan->outputs[idx];
+}
+
+mag_tensor_t* mag_plan_find_tensor(const mag_plan_t* plan, const char* name) {
+    for (size_t i=0; i < plan->len; ++i) {
+        const mag_plan_node_t* node = plan->nodes+i;
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j)
+            if (node->inputs[j] && !strcmp(mag_tensor_get_name(node->inputs[j]), name)) return node->inputs[j];
+        if (!strcmp(mag_tensor_get_name(node->r), name)) return node->r;
+    }
+    return NULL;
+}
+
+void mag_plan_bind(mag_plan_t* plan, mag_tensor_t* handle, mag_tensor_t* input) {
+    mag_assert(input->ctx == plan->ctx && input->dtype == handle->dtype && input->rank == handle->rank
+        && !memcmp(input->shape, handle->shape, sizeof(input->shape)), "Bound input must match the shape and dtype of the captured tensor");
+    mag_assert(mag_tensor_is_contiguous(input) || !mag_tensor_is_contiguous(handle), "Bound input must be contiguous like the captured tensor");
+    size_t nbound = 0;
+    for (size_t i=0; i < plan->len; ++i) {
+        mag_tensor_t** inputs = plan->nodes[i].inputs;
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j) {
+            if (inputs[j] != handle) continue;
+            mag_tensor_incref(input);
+            mag_tensor_decref(inputs[j]);
+            inputs[j] = input;
+            ++nbound;
+        }
+    }
+    mag_assert(nbound, "Tensor is not an input of the plan");
+    plan->kernels_planned = false; /* Strides of the bound input may differ. */
+}
+
+static void mag_plan_select_kernels(mag_plan_t* plan) { /* Shapes and strides are fixed, so each node decides its kernel once. */
+    mag_compute_device_t* dvc = plan->ctx->device;
+    size_t nspec = 0;
+    for (size_t i=0; i < plan->len; ++i) {
+        mag_plan_node_t* node = plan->nodes+i;
+        mag_tensor_t* R = node->r;
+        R->op = node->op;
+        memcpy(R->op_inputs, node->inputs, sizeof(R->op_inputs));
+        memcpy(R->op_params, node->params, sizeof(R->op_params));
+        node->kernel = (mag_kernel_plan_t){.fn = NULL, .variant = MAG_KVAR_GENERIC, .workers = 1, .dims = {0}};
+        (*dvc->plan_kernel)(dvc, R, &node->kernel);
+        nspec += node->kernel.variant != MAG_KVAR_GENERIC;
+    }
+    plan->kernels_planned = true;
+    mag_log_info("Selected kernels for plan, %zu of %zu ops specialized", nspec, plan->len);
+}
+
+static void mag_tensor_detach_producer(mag_tensor_t* t) { /* Turn an executed result into a leaf. */
+    t->op = MAG_OP_NOP;
+    memset(t->op_inputs, 0, sizeof(t->op_inputs));
+    memset(t->op_params, 0, sizeof(t->op_params));
+}
+
+void mag_plan_replay(mag_plan_t* plan) {
+    mag_compute_device_t* dvc = plan->ctx->device;
+    bool planned = dvc->plan_kernel && !plan->ctx->profiler_enabled; /* Profiled replays go through the timed eager dispatch. */
+    if (planned && !plan->kernels_planned) mag_plan_select_kernels(plan);
+    for (size_t i=0; i < plan->len; ++i) {
+        const mag_plan_node_t* node = plan->nodes+i;
+        mag_tensor_t* R = node->r;
+        R->op = node->op;
+        memcpy(R->op_inputs, node->inputs, sizeof(R->op_inputs));
+        memcpy(R->op_params, node->params, sizeof(R->op_params));
+        if (planned) (*dvc->exec_planned_fwd)(dvc, R, &node->kernel);
+        else mag_op_exec(R, dvc, MAG_GRA_FWD);
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j) /* Recorded x += y, leave no self-loop behind. */
+            if (node->inputs[j] == R) { mag_tensor_detach_producer(R); break; }
+    }
+}
+
+void mag_plan_destroy(mag_plan_t* plan) {
+    if (!plan) return;
+    for (size_t i=0; i < plan->len; ++i) {
+        mag_plan_node_t* node = plan->nodes+i;
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j)
+            if (node->inputs[j]) mag_tensor_decref(node->inputs[j]);
+        mag_tensor_decref(node->r);
+    }
+    for (size_t i=0; i < plan->num_outputs; ++i)
+        mag_tensor_decref(plan->outputs[i]);
+    if (plan->outputs) (*mag_alloc)(plan->outputs, 0);
+    if (plan->nodes) (*mag_alloc)(plan->nodes, 0);
+    (*mag_alloc)(plan, 0);
+}
+
+/*
+** Plan optimization. Removed nodes get r = NULL and are compacted at the end of the pass.
+** Ops write their result storage, except view ops. Inplace and out= results share storage with other tensors,
+** so every rewrite first checks that the storage it relies on is written by no other node of the plan.
+*/
+static bool mag_op_is_view(mag_op_t op) { return op == MAG_OP_VIEW || op == MAG_OP_TRANSPOSE || op == MAG_OP_PERMUTE; }
+
+static bool mag_plan_is_sole_writer(const mag_plan_t* plan, const mag_storage_buffer_t* sto, size_t idx) { /* No node except idx writes sto. */
+    for (size_t i=0; i < plan->len; ++i) {
+        const mag_plan_node_t* node = plan->nodes+i;
+        if (i != idx && node->r && !mag_op_is_view(node->op) && node->r->storage == sto) return false;
+    }
+    return true;
+}
+
+static bool mag_plan_is_written_between(const mag_plan_t* plan, const mag_storage_buffer_t* sto, size_t lo, size_t hi) {
+    for (size_t i=lo+1; i < hi; ++i) {
+        const mag_plan_node_t* node = plan->nodes+i;
+        if (node->r && !mag_op_is_view(node->op) && node->r->storage == sto) return true;
+    }
+    return false;
+}
+
+static bool mag_plan_is_stable(const mag_plan_t* plan, const mag_tensor_t* t, size_t before) { /* Value of t is final once read at node before. */
+    size_t producer = SIZE_MAX;
+    for (size_t i=0; i < before; ++i)
+        if (plan->nodes[i].r == t && !mag_op_is_view(plan->nodes[i].op)) producer = i;
+    return mag_plan_is_sole_writer(plan, t->storage, producer);
+}
+
+static bool mag_plan_is_own_result(const mag_plan_t* plan, size_t i) { /* Node writes a result no other node or alias writes. */
+    const mag_plan_node_t* node = plan->nodes+i;
+    return !mag_op_is_view(node->op) && !(node->r->flags & MAG_TFLAG_VIEW) && mag_plan_is_sole_writer(plan, node->r->storage, i);
+}
+
+static void mag_plan_replace_uses(mag_plan_t* plan, size_t from, mag_tensor_t* old, mag_tensor_t* rep) {
+    for (size_t i=from; i < plan->len; ++i) {
+        mag_plan_node_t* node = plan->nodes+i;
+        if (!node->r) continue;
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j) {
+            if (node->inputs[j] != old) continue;
+            mag_tensor_incref(rep);
+            mag_tensor_decref(old);
+            node->inputs[j] = rep;
+        }
+    }
+}
+
+static void mag_plan_drop(mag_plan_t* plan, size_t i) {
+    mag_plan_node_t* node = plan->nodes+i;
+    for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j)
+        if (node->inputs[j]) mag_tensor_decref(node->inputs[j]);
+    mag_tensor_decref(node->r);
+    node->r = NULL;
+}
+
+static bool mag_plan_is_dead(const mag_plan_t* plan, size_t i) { /* Only this node references the result and dropping it loses no write. */
+    const mag_plan_node_t* node = plan->nodes+i;
+    return (uint32_t)mag_tensor_get_packed_refcounts(node->r) == 1 && (mag_op_is_view(node->op) || !(node->r->flags & MAG_TFLAG_VIEW));
+}
+
+static uint64_t mag_plan_node_hash(const mag_plan_node_t* node) { /* FNV-1a over op, inputs and params. */
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = (h ^ (uint64_t)node->op)*0x100000001b3ull;
+    for (uint32_t i=0; i < MAG_MAX_INPUT_TENSORS; ++i)
+        h = (h ^ (uint64_t)(uintptr_t)node->inputs[i])*0x100000001b3ull;
+    for (uint32_t i=0; i < MAG_MAX_OP_PARAMS; ++i)
+        h = (h ^ ((uint64_t)node->params[i].type<<32 | node->params[i].x.u32))*0x100000001b3ull;
+    return h ^ (h>>29);
+}
+
+static bool mag_plan_node_eq(const mag_plan_node_t* a, const mag_plan_node_t* b) {
+    if (a->op != b->op || memcmp(a->inputs, b->inputs, sizeof(a->inputs)) != 0) return false;
+    for (uint32_t i=0; i < MAG_MAX_OP_PARAMS; ++i)
+        if (a->params[i].type != b->params[i].type || a->params[i].x.u32 != b->params[i].x.u32) return false;
+    return true;
 }
 
-mag_tensor_t* mag_tensor_create_2d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2) {
-    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2}, 2, NULL, 0);
+static mag_tensor_t* mag_plan_identity_of(const mag_plan_t* plan, size_t i) { /* Input the node result equals, NULL if none. */
+    const mag_plan_node_t* node = plan->nodes+i;
+    switch (node->op) {
+        case MAG_OP_ADDS: case MAG_OP_SUBS: return node->params[0].x.f32 == 0.0f ? node->inputs[0] : NULL;   /* x+0, x-0 */
+        case MAG_OP_MULS: case MAG_OP_DIVS: return node->params[0].x.f32 == 1.0f ? node->inputs[0] : NULL;   /* x*1, x/1 */
+        case MAG_OP_TRANSPOSE: {   /* (xᵀ)ᵀ, views of contiguous x have x's strides */
+            for (size_t j=i; j--;) {
+                const mag_plan_node_t* inner = plan->nodes+j;
+                if (inner->r != node->inputs[0]) continue;
+                return inner->op == MAG_OP_TRANSPOSE && mag_tensor_is_contiguous(inner->inputs[0]) ? inner->inputs[0] : NULL;
+            }
+        } return NULL;
+        default: return NULL;
+    }
 }
 
-mag_tensor_t* mag_tensor_create_3d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3) {
-    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3}, 3, NULL, 0);
+static size_t mag_plan_count_uses(const mag_plan_t* plan, const mag_tensor_t* t, size_t from) { /* Input slots reading t at or after node from. */
+    size_t n = 0;
+    for (size_t i=from; i < plan->len; ++i) {
+        const mag_plan_node_t* node = plan->nodes+i;
+        if (!node->r) continue;
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j) n += node->inputs[j] == t;
+    }
+    return n;
 }
 
-mag_tensor_t* mag_tensor_create_4d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3, int64_t d4) {
-    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3, d4}, 4, NULL, 0);
+typedef struct mag_plan_shared_sto_t {
+    const mag_storage_buffer_t* sto;
+    size_t num_merged;                  /* Dead tensors which already share the storage. */
+} mag_plan_shared_sto_t;
+
+/*
+** Storage reuse: an element-wise op writes into the buffer of an input which nothing reads afterwards, as if the inplace op had been called.
+** The input must be a plan result nobody else references, so the clobbered value is unobservable.
+*/
+static size_t mag_plan_reuse_storage(mag_plan_t* plan) {
+    mag_plan_shared_sto_t* shared = NULL;
+    size_t num_shared = 0, cap_shared = 0, num_reused = 0;
+    for (size_t i=0; i < plan->len; ++i) {
+        mag_plan_node_t* node = plan->nodes+i;
+        const mag_op_meta_t* meta = mag_op_meta_of(node->op);
+        mag_tensor_t* R = node->r;
+        if (meta->r_alloc != &mag_result_constructor_routine_isomorph || !meta->inplace || !mag_plan_is_own_result(plan, i)) continue;
+        if (R->storage->rc != 1 || (R->flags & (MAG_TFLAG_FROZEN|MAG_TFLAG_ATOMIC_RC))) continue;
+        for (uint32_t j=0; j < meta->argcount; ++j) {
+            mag_tensor_t* in = node->inputs[j];
+            if (in->dtype != R->dtype || (in->flags & (MAG_TFLAG_VIEW|MAG_TFLAG_FROZEN|MAG_TFLAG_ATOMIC_RC))) continue;
+            if (memcmp(in->shape, R->shape, sizeof(R->shape)) != 0 || memcmp(in->strides, R->strides, sizeof(R->strides)) != 0) continue;
+            size_t p = SIZE_MAX; /* Producer of the input. */
+            for (size_t k=i; k--;) if (plan->nodes[k].r == in) { p = k; break; }
+            size_t s = 0;
+            while (s < num_shared && shared[s].sto != in->storage) ++s;
+            size_t merged = s < num_shared ? shared[s].num_merged : 0;
+            if (p == SIZE_MAX || (!merged && !mag_plan_is_own_result(plan, p))) continue; /* Merged writers all precede p. */
+            if (mag_plan_count_uses(plan, in, i+1)) continue; /* Read later. */
+            if ((uint32_t)mag_tensor_get_packed_refcounts(in) != 1 + mag_plan_count_uses(plan, in, 0)) continue; /* Referenced outside the plan. */
+            if ((size_t)in->storage->rc != 1 + merged) continue; /* Shared with a live view. */
+            size_t nb = mag_tensor_data_size(R);
+            void* tmp = (*mag_alloc)(NULL, nb); /* Keep the captured result, the input's value is dead. */
+            (*R->storage->cpy_device_host)(R->storage, 0, tmp, nb);
+            (*in->storage->cpy_host_device)(in->storage, 0, tmp, nb);
+            (*mag_alloc)(tmp, 0);
+            mag_storage_incref(in->storage, false);
+            mag_storage_release(plan->ctx, R->storage, false);
+            R->storage = in->storage;
+            if (s == num_shared) {
+                if (num_shared == cap_shared) {
+                    cap_shared = cap_shared ? cap_shared<<1 : 16;
+                    shared = (*mag_alloc)(shared, cap_shared*sizeof(*shared));
+                }
+                shared[num_shared++] = (mag_plan_shared_sto_t){.sto = in->storage, .num_merged = 0};
+            }
+            ++shared[s].num_merged;
+            ++num_reused;
+            break;
+        }
+    }
+    if (shared) (*mag_alloc)(shared, 0);
+    return num_reused;
 }
 
-mag_tensor_t* mag_tensor_create_5d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3, int64_t d4, int64_t d5) {
-    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3, d4, d5}, 5, NULL, 0);
+static bool mag_plan_is_const(mag_tensor_t* const* consts, size_t n, const mag_tensor_t* t) {
+    if (t->flags & MAG_TFLAG_FROZEN) return true;
+    for (size_t i=0; i < n; ++i) if (consts[i] == t) return true;
+    return false;
 }
 
-mag_tensor_t* mag_tensor_create_6d(mag_ctx_t* ctx, mag_dtype_t type, int64_t d1, int64_t d2, int64_t d3, int64_t d4, int64_t d5, int64_t d6) {
-    return mag_tensor_create(ctx, type, (int64_t[]) {d1, d2, d3, d4, d5, d6}, 6, NULL, 0);
+size_t mag_plan_optimize(mag_plan_t* plan) {
+    mag_assert(plan->ctx->capture != plan, "Plan is still capturing");
+    size_t cap = 16;
+    while (cap < plan->len<<1) cap <<= 1;
+    size_t* cse = (*mag_alloc)(NULL, cap*sizeof(*cse)); /* Open addressing table of node index + 1, 0 is empty. */
+    memset(cse, 0, cap*sizeof(*cse));
+    mag_tensor_t** consts = NULL; /* Folded results. */
+    size_t num_consts = 0, cap_consts = 0;
+    size_t num_folded = 0, num_simplified = 0, num_merged = 0, num_dead = 0;
+    for (size_t i=0; i < plan->len; ++i) {
+        mag_plan_node_t* node = plan->nodes+i;
+        const mag_op_meta_t* meta = mag_op_meta_of(node->op);
+        bool is_const = true;   /* Constant folding: inputs are frozen tensors or folded results. */
+        for (uint32_t j=0; j < meta->argcount && is_const; ++j)
+            is_const = mag_plan_is_const(consts, num_consts, node->inputs[j]);
+        if (is_const && (mag_op_is_view(node->op) || mag_plan_is_own_result(plan, i))) {
+            mag_tensor_t* R = node->r;
+            R->op = node->op;
+            memcpy(R->op_inputs, node->inputs, sizeof(R->op_inputs));
+            memcpy(R->op_params, node->params, sizeof(R->op_params));
+            mag_op_exec(R, plan->ctx->device, MAG_GRA_FWD); /* Evaluate once, consumers read the result as a fixed buffer. */
+            if (num_consts == cap_consts) {
+                cap_consts = cap_consts ? cap_consts<<1 : 16;
+                consts = (*mag_alloc)(consts, cap_consts*sizeof(*consts));
+            }
+            consts[num_consts++] = R;
+            mag_plan_drop(plan, i);
+            ++num_folded;
+            continue;
+        }
+        mag_tensor_t* id = mag_plan_identity_of(plan, i); /* Algebraic simplification: forward the input the result equals. */
+        if (id && (node->op == MAG_OP_TRANSPOSE || (mag_plan_is_own_result(plan, i) && mag_plan_is_stable(plan, id, i)))) {
+            mag_plan_replace_uses(plan, i+1, node->r, id);
+            ++num_simplified;
+            if (mag_plan_is_dead(plan, i)) mag_plan_drop(plan, i);
+            continue;
+        }
+        if (mag_op_is_view(node->op) || !mag_plan_is_own_result(plan, i)) continue;
+        size_t slot = mag_plan_node_hash(node) & (cap-1); /* Common subexpression elimination. */
+        for (; cse[slot]; slot = (slot+1) & (cap-1)) {
+            size_t k = cse[slot]-1;
+            const mag_plan_node_t* prev = plan->nodes+k;
+            if (!prev->r || !mag_plan_node_eq(prev, node)) continue;
+            bool unchanged = true; /* Inputs must not be written between both nodes. */
+            for (uint32_t j=0; j < meta->argcount && unchanged; ++j)
+                unchanged = !mag_plan_is_written_between(plan, node->inputs[j]->storage, k, i);
+            if (unchanged) break;
+        }
+        if (cse[slot]) {
+            mag_plan_replace_uses(plan, i+1, node->r, plan->nodes[cse[slot]-1].r);
+            ++num_merged;
+            if (mag_plan_is_dead(plan, i)) mag_plan_drop(plan, i);
+        } else cse[slot] = i+1;
+    }
+    for (size_t i=plan->len; i--;) { /* Dead code elimination, backwards so whole chains go. */
+        if (plan->nodes[i].r && mag_plan_is_dead(plan, i)) {
+            mag_plan_drop(plan, i);
+            ++num_dead;
+        }
+    }
+    size_t len = 0;
+    for (size_t i=0; i < plan->len; ++i)
+        if (plan->nodes[i].r) plan->nodes[len++] = plan->nodes[i];
+    size_t removed = plan->len - len;
+    plan->len = len;
+    plan->kernels_planned = false;
+    size_t num_reused = mag_plan_reuse_storage(plan);
+    if (consts) (*mag_alloc)(consts, 0);
+    (*mag_alloc)(cse, 0);
+    mag_log_info("Optimized plan: %zu folded, %zu simplified, %zu merged, %zu dead, %zu ops left, %zu reuse an input buffer", num_folded, num_simplified, num_merged, num_dead, len, num_reused);
+    return removed;
 }
 
-static void MAG_HOTPROC mag_op_exec(mag_tensor_t* R, mag_compute_device_t* dvc, mag_graph_eval_order_t ord) {
-    mag_perf_mon_t* pmon = &R->pmon;
-    mag_op_perf_info_t (*pmon_ops)[MAG_OP__NUM] = &R->ctx->op_perf_mons_total;
-    mag_op_perf_info_t* pmon_op = (*pmon_ops)+R->op;
-    uint64_t start = R->ctx->profiler_enabled ? mag_hpc_clock_ns() : 0;    /* Profiling monitoring */
-    void (*exec)(mag_compute_device_t*, mag_tensor_t*) = ord == MAG_GRAPH_EVAL_ORDER_FORWARD ? dvc->eager_exec_fwd : dvc->eager_exec_bwd;
-    (*exec)(dvc, R); /* Dispatch to backend. */
-    if (!R->ctx->profiler_enabled) return; /* Profiling disabled. */
-    pmon->elapsed_ns = mag_hpc_clock_elapsed_ns(start);
-    pmon->elapsed_ns_acc += pmon->elapsed_ns;
-    pmon_op->elapsed_ns_acc += pmon->elapsed_ns;
-    ++pmon->n_execs;
-    ++pmon_op->n_execs;
+/*
+** Eager storage reuse: a consumed input the op only reads element by element donates its buffer to the result, like the plan's reuse pass.
+** It must be the last reference to a contiguous buffer nothing else views, and the result must have its shape and dtype.
+*/
+static bool mag_tensor_is_donor(mag_ctx_t* ctx, const mag_op_meta_t* meta, mag_tensor_t** inputs, uint32_t idx) {
+    const mag_tensor_t* t = inputs[idx];
+    if (!meta->inplace || meta->r_alloc != &mag_result_constructor_routine_isomorph || ctx->capture) return false;
+    if (t->flags & (MAG_TFLAG_VIEW|MAG_TFLAG_FROZEN)) return false;
+    if (t->dtype != inputs[0]->dtype || t->rank != inputs[0]->rank || memcmp(t->shape, inputs[0]->shape, sizeof(t->shape)) != 0) return false;
+    return mag_tensor_is_contiguous(t) && (uint32_t)mag_tensor_get_packed_refcounts(t) == 1 && t->storage->rc == 1;
+}
+
+static void mag_tensor_release_consumed(mag_tensor_t** inputs, uint32_t numin, const mag_tensor_t* R) {
+    for (uint32_t i=0; i < numin; ++i) { /* An input passed twice is released once. */
+        mag_tensor_t* t = inputs[i];
+        if (!(t->flags & MAG_TFLAG_CONSUMED)) continue;
+        t->flags &= ~MAG_TFLAG_CONSUMED;
+        if (t != R) mag_tensor_decref(t); /* A donor's reference now belongs to the result. */
+    }
 }
 
-static mag_tensor_t* MAG_HOTPROC mag_tensor_operator(
+/* Out is NULL to construct a new result, else the result is written into out (see mag_add_out). */
+static mag_tensor_t* MAG_HOTPROC mag_tensor_operator_into(
     mag_ctx_t* ctx,
     mag_op_t op,
     bool inplace,
     mag_tensor_t** inputs,
     uint32_t numin,
     const mag_op_param_t* params,
-    uint32_t numparams
+    uint32_t numparams,
+    mag_tensor_t* out
 ) {
-    /* Validate inputs and params first */
-    mag_assert2(op != MAG_OP_NOP);
-    mag_assert(inputs && mag_check_are_inputs_valid(op, inputs, numin), "Invalid input tensors for operation %s.", mag_op_meta_of(op)->mnemonic);
-    mag_assert(mag_check_are_op_params_valid(op, params, numparams), "Invalid parameters for operation %s.", mag_op_meta_of(op)->mnemonic);
-
-    const mag_op_meta_t* meta = mag_op_meta_of(op);
+    mag_assert2(op != MAG_OP_NOP && op < MAG_OP__NUM);
+    const mag_op_meta_t* meta = mag_op_meta_table+op;
+#ifdef MAG_DEBUG /* Full arity, parameter and thread validation. The op wrappers pass fixed counts, so release builds only check for NULL inputs. */
+    mag_assert(inputs && mag_check_are_inputs_valid(op, inputs, numin), "Invalid input tensors for operation %s.", meta->mnemonic);
+    mag_assert(mag_check_are_op_params_valid(op, params, numparams), "Invalid parameters for operation %s.", meta->mnemonic);
+    mag_ctx_check_thread(ctx);
+#else
+    for (uint32_t i=0; i < numin; ++i)
+        mag_assert(inputs[i], "Input tensor %u of operation %s is NULL.", i, meta->mnemonic);
+#endif
+    bool consumes = false;
+    for (uint32_t i=0; i < numin; ++i) {
+        if (mag_likely(!(inputs[i]->flags & MAG_TFLAG_CONSUMED))) continue;
+        consumes = true;
+        if (!out && !inplace && mag_tensor_is_donor(ctx, meta, inputs, i)) out = inputs[i]; /* Runs as the inplace op would. */
+    }
+    if (mag_unlikely(!(*meta->validator)(op, inputs, params))) { /* Validation failed. */
+        if (mag_unlikely(consumes)) mag_tensor_release_consumed(inputs, numin, NULL);
+        return NULL;
+    }
+    if (inplace && numin) mag_tensor_check_mutable(*inputs);
     mag_graph_eval_order_t gra = MAG_GRA_FWD; /* TODO */
-    mag_tensor_t* (*r_alloc)(mag_tensor_t**, const mag_op_param_t*) = meta->r_alloc;
-    bool (*validate_op)(mag_op_t, mag_tensor_t*, mag_tensor_t**, const mag_op_param_t*) = meta->validator;
-    mag_tensor_t* R = (inplace && numin && meta->inplace)                                                   /* Inplace requested? */
-        ? mag_tensor_create(ctx, (*inputs)->dtype, (*inputs)->shape, (*inputs)->rank, *inputs, 0)  /* View R <- X for inplace aliasing op. */
-        : (*r_alloc)(inputs, params);                                                                       /* Construct new result tensor. */
-    if (mag_unlikely(!(*validate_op)(op, R, inputs, params))) return NULL;                                  /* Validation failed. */
+    mag_tensor_t* R;
+    if (out) {                                                          /* Write into existing output, which is re-targeted to this op. */
+        if (mag_unlikely(!mag_check_is_valid_out(op, inputs, numin, out))) {
+            if (mag_unlikely(consumes)) mag_tensor_release_consumed(inputs, numin, NULL);
+            return NULL;
+        }
+        mag_tensor_check_mutable(out);
+        R = out;
+        R->op = MAG_OP_NOP;
+        memset(R->op_inputs, 0, sizeof(R->op_inputs));
+        memset(R->op_params, 0, sizeof(R->op_params));
+    } else if (inplace && numin && meta->inplace)                              /* View R <- X for inplace aliasing op. */
+        R = mag_tensor_create(ctx, (*inputs)->dtype, (*inputs)->shape, (*inputs)->rank, *inputs, 0);
+    else if (meta->r_alloc == &mag_result_constructor_routine_isomorph) /* Most common result, constructed directly without the indirect call. */
+        R = mag_tensor_create(ctx, (*inputs)->dtype, (*inputs)->shape, (*inputs)->rank, NULL, 0);
+    else                                                                /* Construct new result tensor. */
+        R = (*meta->r_alloc)(inputs, params);
     mag_tensor_t* grad = NULL;                                                                              /* ∇ᵦL = ∂L/∂B - Upper gradient tensor. */  /* TODO */
     if (gra == MAG_GRA_BWD && grad) {
         R->grad = R->grad                       /* ∇ₐL = ∑ᵢ (∂L/∂Bᵢ) ⋅ (∂Bᵢ/∂A) - Chain rule accumulate. */
@@ -1706,13 +2607,29 @@ static mag_tensor_t* MAG_HOTPROC mag_tensor_operator(
     for (uint32_t i=0; i < numin; ++i) {                             /* Set input tensors and flags. */
         R->op_inputs[i] = inputs[i];
     }
-    if (params) memcpy(R->op_params, params, sizeof(*params));   /* Copy operation parameters */
+    if (params) memcpy(R->op_params, params, numparams*sizeof(*params)); /* Copy operation parameters */
+    if (mag_unlikely(ctx->capture)) mag_plan_record(ctx, R);           /* Record op for replay. */
     if (ctx->exec_mode == MAG_EXEC_MODE_EAGER) {                    /* In eager execution mode, we execute immediately. */
         mag_op_exec(R, ctx->device, gra);                           /* Execute the operation immediately. */
+        for (uint32_t i=0; out && i < numin; ++i)                   /* Out written into itself holds just data now, else it would link back to itself. */
+            if (inputs[i] == out) { mag_tensor_detach_producer(R); break; }
     }
+    if (mag_unlikely(consumes)) mag_tensor_release_consumed(inputs, numin, R);
     return R;
 }
 
+static MAG_AINLINE mag_tensor_t* mag_tensor_operator(
+    mag_ctx_t* ctx,
+    mag_op_t op,
+    bool inplace,
+    mag_tensor_t** inputs,
+    uint32_t numin,
+    const mag_op_param_t* params,
+    uint32_t numparams
+) {
+    return mag_tensor_operator_into(ctx, op, inplace, inputs, numin, params, numparams, NULL);
+}
+
 mag_tensor_t* mag_clone(mag_tensor_t* x) {
     return mag_tensor_operator(x->ctx, MAG_OP_CLONE, false, &x, 1, NULL, 0);
 }
@@ -1836,6 +2753,61 @@ mag_tensor_t* mag_matmul(mag_tensor_t* x, mag_tensor_t* y) {
     return mag_tensor_operator(x->ctx, MAG_OP_MATMUL, false, (mag_tensor_t*[]){x, y}, 2, NULL, 0);
 }
 
+mag_tensor_t* mag_clone_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_CLONE, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_mean_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_MEAN, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_min_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_MIN, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_max_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_MAX, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_sum_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SUM, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_abs_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_ABS, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_neg_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_NEG, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_log_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_LOG, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_sqr_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SQR, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_sqrt_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SQRT, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_sin_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SIN, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_cos_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_COS, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_step_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_STEP, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_softmax_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SOFTMAX, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_softmax_dv_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SOFTMAX_DV, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_sigmoid_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SIGMOID, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_sigmoid_dv_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SIGMOID_DV, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_hard_sigmoid_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_HARD_SIGMOID, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_silu_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SILU, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_silu_dv_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SILU_DV, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_tanh_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_TANH, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_tanh_dv_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_TANH_DV, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_relu_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_RELU, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_relu_dv_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_RELU_DV, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_gelu_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_GELU, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_gelu_dv_out(mag_tensor_t* x, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_GELU_DV, false, &x, 1, NULL, 0, out); }
+mag_tensor_t* mag_add_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_ADD, false, (mag_tensor_t*[]){x, y}, 2, NULL, 0, out); }
+mag_tensor_t* mag_sub_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_SUB, false, (mag_tensor_t*[]){x, y}, 2, NULL, 0, out); }
+mag_tensor_t* mag_mul_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_MUL, false, (mag_tensor_t*[]){x, y}, 2, NULL, 0, out); }
+mag_tensor_t* mag_div_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out) { return mag_tensor_operator_into(x->ctx, MAG_OP_DIV, false, (mag_tensor_t*[]){x, y}, 2, NULL, 0, out); }
+
+mag_tensor_t* mag_adds_out(mag_tensor_t* x, float xi, mag_tensor_t* out) {
+    mag_op_param_t param = {.type=MAG_OP_TPARAM_F32, .x.f32=xi};
+    return mag_tensor_operator_into(x->ctx, MAG_OP_ADDS, false, &x, 1, &param, 1, out);
+}
+
+mag_tensor_t* mag_subs_out(mag_tensor_t* x, float xi, mag_tensor_t* out) {
+    mag_op_param_t param = {.type=MAG_OP_TPARAM_F32, .x.f32=xi};
+    return mag_tensor_operator_into(x->ctx, MAG_OP_SUBS, false, &x, 1, &param, 1, out);
+}
+
+mag_tensor_t* mag_muls_out(mag_tensor_t* x, float xi, mag_tensor_t* out) {
+    mag_op_param_t param = {.type=MAG_OP_TPARAM_F32, .x.f32=xi};
+    return mag_tensor_operator_into(x->ctx, MAG_OP_MULS, false, &x, 1, &param, 1, out);
+}
+
+mag_tensor_t* mag_divs_out(mag_tensor_t* x, float xi, mag_tensor_t* out) {
+    mag_op_param_t param = {.type=MAG_OP_TPARAM_F32, .x.f32=xi};
+    return mag_tensor_operator_into(x->ctx, MAG_OP_DIVS, false, &x, 1, &param, 1, out);
+}
+
+mag_tensor_t* mag_matmul_out(mag_tensor_t* a, mag_tensor_t* b, mag_tensor_t* out) {
+    return mag_tensor_operator_into(a->ctx, MAG_OP_MATMUL, false, (mag_tensor_t*[]){a, b}, 2, NULL, 0, out);
+}
+
 static MAG_AINLINE void mag_tensor_virtual_to_physical_index(const mag_tensor_t* t, int64_t v_idx, int64_t(*p_idx)[MAG_MAX_DIMS]) {
     mag_static_assert(MAG_MAX_DIMS == 6);
     mag_load_local_storage_group(t, d, shape);
@@ -1866,23 +2838,31 @@ void mag_tensor_set_arg(mag_tensor_t* t, size_t slot, mag_tensor_t* arg) {
 }
 
 void mag_tensor_copy_buffer_from(mag_tensor_t* t, const void* data, size_t size) {
+    mag_tensor_check_mutable(t);
     mag_assert(size == (size_t) mag_tensor_data_size(t), "Buffer size mismatch: %zu != %lld", size, mag_tensor_data_size(t));
-    mag_storage_buffer_t* sto = &t->storage;
+    mag_storage_buffer_t* sto = t->storage;
     (*sto->cpy_host_device)(sto, 0, data, size);
 }
 
+/* Direct access to the storage of a tensor: the buffer must be host memory and queued device work must be done. */
+static void mag_tensor_sync_host(const mag_tensor_t* t) {
+    mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU || t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM);
+    mag_ctx_synchronize(t->ctx);
+}
+
 void mag_tensor_fill(mag_tensor_t* t, float x) {
+    mag_tensor_check_mutable(t);
     if (x == 0.0f) {
-        mag_storage_buffer_t* sto = &t->storage;
+        mag_storage_buffer_t* sto = t->storage;
         (*sto->set)(sto, 0, 0); /* Zero out the buffer. */
         return;
     }
-    mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_sync_host(t);
 
     switch (t->dtype) {
         case MAG_DTYPE_F32: {
             int64_t n = mag_tensor_numel(t);
-            float* buf = (float*)t->storage.base;
+            float* buf = (float*)t->storage->base;
             for (int64_t i=0; i < n; ++i) buf[i] = x;
         } break;
         default: mag_panic("Unsupported DType: %d", t->dtype);
@@ -1890,11 +2870,12 @@ void mag_tensor_fill(mag_tensor_t* t, float x) {
 }
 
 void mag_tensor_fill_random_uniform(mag_tensor_t* t, float min, float max) {
-    mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_check_mutable(t);
+    mag_tensor_sync_host(t);
     switch (t->dtype) {
         case MAG_DTYPE_F32: {
             int64_t n = mag_tensor_numel(t);
-            float* buf = (float*)t->storage.base;
+            float* buf = (float*)t->storage->base;
             mag_prng_generate_n(t->ctx, buf, n, min, max); /* Generate uniform random numbers. */
         } break;
         default: mag_panic("Unsupported DType: %d", t->dtype);
@@ -1902,12 +2883,13 @@ void mag_tensor_fill_random_uniform(mag_tensor_t* t, float min, float max) {
 }
 
 void mag_tensor_fill_random_normal(mag_tensor_t* t, float mean, float stddev) {
-    mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_check_mutable(t);
+    mag_tensor_sync_host(t);
     switch (t->dtype) {
         case MAG_DTYPE_F32: {
             int64_t n = mag_tensor_numel(t);
             mag_assert((n & 1) == 0, "Number of elements must be even");
-            float* buf = (float*)t->storage.base;
+            float* buf = (float*)t->storage->base;
             mag_prng_generate_n(t->ctx, buf, n, 0.0f, 1.0f); /* Generate uniform random numbers. */
             for (int64_t i=0; i < n; i += 2) { /* Map uniform to normal distribution using Box-Muller transform. */
                 float* u1 = buf+i;
@@ -1928,7 +2910,46 @@ uint64_t mag_tensor_get_packed_refcounts(const mag_tensor_t* t) {
 }
 
 void mag_tensor_retain(mag_tensor_t* t) {
-    ++t->rcb.rc_strong;
+    mag_tensor_incref(t);
+}
+
+bool mag_tensor_consume(mag_tensor_t* t) {
+    if (t->ctx->exec_mode != MAG_EXEC_MODE_EAGER) return false; /* Deferred ops run later and still read t. */
+    t->flags |= MAG_TFLAG_CONSUMED;
+    return true;
+}
+
+void mag_tensor_set_atomic_refcount(mag_tensor_t* t) {
+    if (t->flags & MAG_TFLAG_ATOMIC_RC) return;
+    mag_assert(t->rcb.rc_strong == 1 && t->storage->rc == 1, "Atomic refcount of tensor '%s' must be enabled before views of it are created.", mag_tensor_get_name(t));
+    t->flags |= MAG_TFLAG_ATOMIC_RC;
+}
+
+bool mag_tensor_has_atomic_refcount(const mag_tensor_t* t) { return t->flags & MAG_TFLAG_ATOMIC_RC; }
+
+void mag_tensor_freeze(mag_tensor_t* t) {
+    if (t->flags & MAG_TFLAG_FROZEN) return;
+    mag_assert(t->flags & MAG_TFLAG_OWNER, "Only tensors owning their storage can be frozen, freeze the base tensor instead of a view.");
+    mag_assert(mag_atomic_load(&t->storage->rc, MAG_MO_ACQUIRE) == 1, "Tensor '%s' must be frozen before views of it are created.", mag_tensor_get_name(t));
+    mag_ctx_t* ctx = t->ctx;
+    mag_ctx_lock(ctx);
+    if (ctx->frozen_len == ctx->frozen_cap) {
+        ctx->frozen_cap = mag_xmax(16, ctx->frozen_cap<<1);
+        ctx->frozen = (*mag_alloc)(ctx->frozen, ctx->frozen_cap*sizeof(*ctx->frozen));
+    }
+    ctx->frozen[ctx->frozen_len++] = t->storage;
+    mag_ctx_unlock(ctx);
+    t->flags |= MAG_TFLAG_FROZEN;
+    mag_atomic_store(&t->storage->rc, 2, MAG_MO_RELEASE); /* Owner and the context pin, so borrowers never free the storage. */
+}
+
+bool mag_tensor_is_frozen(const mag_tensor_t* t) { return t->flags & MAG_TFLAG_FROZEN; }
+
+mag_tensor_t* mag_tensor_share(mag_ctx_t* ctx, mag_tensor_t* src) {
+    mag_ctx_check_thread(ctx);
+    mag_assert(src->flags & MAG_TFLAG_FROZEN, "Tensor '%s' must be frozen to be shared.", mag_tensor_get_name(src));
+    mag_assert(ctx->device_type == src->ctx->device_type, "Shared tensors require the same compute device type.");
+    return mag_tensor_create(ctx, src->dtype, src->shape, src->rank, src, 0);
 }
 
 size_t mag_tensor_get_memory_usage(const mag_tensor_t* t) {
@@ -1936,7 +2957,7 @@ size_t mag_tensor_get_memory_usage(const mag_tensor_t* t) {
 }
 
 static void mag_print_tensor_recursive(FILE* f, const mag_tensor_t* t, int64_t (*idx)[MAG_MAX_DIMS], const int64_t (*stri)[MAG_MAX_DIMS], int64_t curr_dim, int64_t total_dims, int indent) {
-    mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_sync_host(t);
     int64_t dim_size = t->shape[curr_dim];
     mag_load_local_storage_group_arr(*stri, s);
     if (curr_dim == total_dims - 1) {
@@ -1944,7 +2965,7 @@ static void mag_print_tensor_recursive(FILE* f, const mag_tensor_t* t, int64_t (
         for (int64_t i = 0; i < dim_size; ++i) {
             (*idx)[curr_dim] = i;
             mag_load_local_storage_group_arr(*idx, i);
-            float val = *((const float*)t->storage.base + i0*s0 + i1*s1 + i2*s2 + i3*s3 + i4*s4 + i5*s5);
+            float val = *((const float*)t->storage->base + i0*s0 + i1*s1 + i2*s2 + i3*s3 + i4*s4 + i5*s5);
             fprintf(f, "%g", val);
             if (i < dim_size - 1) {
                 fprintf(f, " ");
@@ -1981,7 +3002,7 @@ void mag_tensor_print(const mag_tensor_t* t, bool with_header, bool with_data) {
         char strides[MAG_FMT_DIM_BUF_SIZE];
         mag_fmt_dims(&shape, &t->shape, t->rank);
         mag_fmt_dims(&strides, &t->strides, MAG_MAX_DIMS);
-        static const char* flag_abbrs = "OVGE";
+        static const char* flag_abbrs = "OVGEFAC";
         mag_assert2(strlen(flag_abbrs) == MAG_TFLAG_LEN);
         char flags[MAG_TFLAG_LEN+1] = {0};
         for (uint32_t i=0, k=0; i < MAG_TFLAG_LEN; ++i)
@@ -1989,7 +3010,7 @@ void mag_tensor_print(const mag_tensor_t* t, bool with_header, bool with_data) {
                 flags[k++] = flag_abbrs[i];
         flags[MAG_TFLAG_LEN] = '\0';
         fprintf(f, "Tensor '%s', DType: %s, Rank: %" PRIi64 ", Elements: %" PRIi64 ", Shape: %s, Strides: %s, Mem: %.03f %s, Flags: %s (%x)\n",
-            t->name,
+            mag_tensor_get_name(t),
             mag_dtype_meta_of(t->dtype)->name,
             t->rank,
             mag_tensor_numel(t),
@@ -2012,19 +3033,21 @@ void mag_tensor_print(const mag_tensor_t* t, bool with_header, bool with_data) {
 }
 
 void mag_tensor_set_name(mag_tensor_t* t, const char* name) {
-    strncpy(t->name, name, MAG_MAX_TENSOR_NAME_LEN);
-    t->name[MAG_MAX_TENSOR_NAME_LEN-1] = '\0';
+    mag_tensor_cold_t* cold = mag_tensor_cold(t);
+    strncpy(cold->name, name, MAG_MAX_TENSOR_NAME_LEN);
+    cold->name[MAG_MAX_TENSOR_NAME_LEN-1] = '\0';
 }
 
 void mag_tensor_fmt_name(mag_tensor_t* t, const char* fmt, ...) {
+    mag_tensor_cold_t* cold = mag_tensor_cold(t);
     va_list args;
     va_start(args, fmt);
-    vsnprintf(t->name, sizeof(t->name), fmt, args);
+    vsnprintf(cold->name, sizeof(cold->name), fmt, args);
     va_end(args);
 }
 
 const char* mag_tensor_get_name(const mag_tensor_t* t) {
-    return t->name;
+    return t->cold ? t->cold->name : "";
 }
 
 int64_t mag_tensor_rank(const mag_tensor_t* t) { return t->rank; }
@@ -2033,7 +3056,8 @@ const int64_t* mag_tensor_strides(const mag_tensor_t* t) { return t->strides; }
 mag_dtype_t mag_tensor_dtype(const mag_tensor_t* t) { return t->dtype; }
 
 void* mag_tensor_data_ptr(const mag_tensor_t* t) {
-    return (void*)t->storage.base;
+    mag_ctx_synchronize(t->ctx); /* Queued ops might still write the buffer. */
+    return (void*)t->storage->base;
 }
 
 bool mag_tensor_is_scalar(const mag_tensor_t* t) {
@@ -2104,7 +3128,7 @@ float mag_tensor_get_scalar_physical_index(mag_tensor_t* t, int64_t d0, int64_t
     switch (t->dtype) {
         case MAG_DTYPE_F32: {
             float r;
-            mag_storage_buffer_t* sto = &t->storage;
+            mag_storage_buffer_t* sto = t->storage;
             (*sto->cpy_device_host)(sto, sizeof(r)*(d0*s0 + d1*s1 + d2*s2 + d3*s3 + d4*s4 + d5*s5), &r, sizeof(r));
             return r;
         }
@@ -2113,11 +3137,12 @@ float mag_tensor_get_scalar_physical_index(mag_tensor_t* t, int64_t d0, int64_t
 }
 
 void mag_tensor_set_scalar_physical_index(mag_tensor_t* t, int64_t d0, int64_t d1, int64_t d2, int64_t d3, int64_t d4, int64_t d5, float x) {
+    mag_tensor_check_mutable(t);
     mag_static_assert(MAG_MAX_DIMS == 6);
     mag_load_local_storage_group(t, s, strides);
     switch (t->dtype) {
         case MAG_DTYPE_F32: {
-            mag_storage_buffer_t* sto = &t->storage;
+            mag_storage_buffer_t* sto = t->storage;
             (*sto->cpy_host_device)(sto, sizeof(x)*(d0*s0 + d1*s1 + d2*s2 + d3*s3 + d4*s4 + d5*s5), &x, sizeof(x));
         } break;
         default: mag_panic("Unsupported data type: %s", mag_dtype_meta_of(t->dtype)->name);
@@ -2133,7 +3158,7 @@ float mag_tensor_get_scalar_virtual_index(mag_tensor_t* t, int64_t v_idx) {
     switch (t->dtype) {
         case MAG_DTYPE_F32: {
             float r;
-            mag_storage_buffer_t* sto = &t->storage;
+            mag_storage_buffer_t* sto = t->storage;
             (*sto->cpy_device_host)(sto, sizeof(r)*v_idx, &r, sizeof(r));
             return r;
         }
@@ -2143,6 +3168,7 @@ float mag_tensor_get_scalar_virtual_index(mag_tensor_t* t, int64_t v_idx) {
 }
 
 void mag_tensor_set_scalar_virtual_index(mag_tensor_t* t, int64_t v_idx, float x) {
+    mag_tensor_check_mutable(t);
     if (!mag_tensor_is_contiguous(t)) {
         int64_t pidx[MAG_MAX_DIMS];
         mag_tensor_virtual_to_physical_index(t, v_idx, &pidx);
@@ -2151,7 +3177,7 @@ void mag_tensor_set_scalar_virtual_index(mag_tensor_t* t, int64_t v_idx, float x
     }
     switch (t->dtype) {
         case MAG_DTYPE_F32: {
-            mag_storage_buffer_t* sto = &t->storage;
+            mag_storage_buffer_t* sto = t->storage;
             (*sto->cpy_host_device)(sto, sizeof(x)*v_idx, &x, sizeof(x));
         } break;
         default:
@@ -2203,6 +3229,7 @@ bool mag_tensor_is_close(const mag_tensor_t* a, const mag_tensor_t* b, float eps
 }
 
 void mag_tensor_img_draw_box(mag_tensor_t* t, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t wi, uint32_t rgb) {
+    mag_tensor_check_mutable(t);
     mag_assert(t->rank == 3, "Tensor must be 3D image tensor");
     mag_assert2(x2 > x1 && y2 > y1 && x1 > 0 && y1 > 0 && x2 > 0 && y2 > 0);
     float* buf = mag_tensor_data_ptr(t);
@@ -2287,10 +3314,11 @@ static bool mag_glyph(uint32_t c, uint32_t x, uint32_t y) {
 }
 
 void mag_tensor_img_draw_text(mag_tensor_t* t, int32_t x, int32_t y, int32_t size, uint32_t rgb, const char* txt) { /* TODO: Implement font scaling, size is ignored currently */
+    mag_tensor_check_mutable(t);
     mag_assert(t->rank == 3, "Tensor must be a 3D image tensor");
     mag_assert2(x >= 0 && y >= 0 && size >= 8 && txt && *txt);
-    mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU);
-    float* buf = (float*)t->storage.base;
+    mag_tensor_sync_host(t);
+    float* buf = (float*)t->storage->base;
     int32_t w = (int32_t)mag_tensor_image_width(t);
     int32_t h = (int32_t)mag_tensor_image_height(t);
     int32_t c = (int32_t)mag_tensor_image_channels(t);
@@ -2320,8 +3348,8 @@ void mag_tensor_img_draw_text(mag_tensor_t* t, int32_t x, int32_t y, int32_t siz
 }
 
 mag_ctx_t* mag_tensor_get_ctx(const mag_tensor_t* t) { return t->ctx; }
-void* mag_tensor_get_user_data(const mag_tensor_t* t) { return t->ud; }
-void mag_tensor_set_user_data(mag_tensor_t* t, void* ud) { t->ud = ud; }
+void* mag_tensor_get_user_data(const mag_tensor_t* t) { return t->cold ? t->cold->ud : NULL; }
+void mag_tensor_set_user_data(mag_tensor_t* t, void* ud) { mag_tensor_cold(t)->ud = ud; }
 
 #ifdef __APPLE__
     static bool mag_sysctl_mib01(uint8_t (*out)[256], size_t* o_len, int mib0, int mib1) { /* Get sysctl data */
@@ -2807,18 +3835,159 @@ static void MAG_COLDPROC mag_system_info_query_arm64_cpu_caps(uint64_t* caps, in
 }
 #endif
 
-static void MAG_COLDPROC mag_system_host_info_query(mag_ctx_t* ctx) {
-    mag_system_host_info_query_os_name(&ctx->machine.os_name);
-    mag_system_host_info_query_cpu_name(&ctx->machine.cpu_name);
-    mag_system_host_info_query_cpu_cores(&ctx->machine.cpu_virtual_cores, &ctx->machine.cpu_physical_cores, &ctx->machine.cpu_sockets);
-    mag_system_host_info_query_memory(&ctx->machine.phys_mem_total, &ctx->machine.phys_mem_free);
+static void mag_cache_info_insert(mag_cache_info_t (*caches)[MAG_MAX_CACHE_LEVELS], uint32_t level, uint64_t size, uint32_t line_size, uint32_t shared_by) { /* Record data or unified cache at level (1-based) */
+    if (mag_unlikely(!level || level > MAG_MAX_CACHE_LEVELS || !size)) return;
+    mag_cache_info_t* ci = *caches+level-1;
+    if (ci->size) return; /* First instance wins, e.g. L1D before a unified L1 */
+    *ci = (mag_cache_info_t){.size = size, .line_size = line_size, .shared_by = shared_by};
+}
+
+#if defined(__linux__) && !defined(_WIN32)
+    static bool mag_sysfs_read_line(const char* path, char (*out)[64]) { /* Read first line of small sysfs file */
+        FILE* f = mag_fopen(path, "r");
+        if (mag_unlikely(!f)) return false;
+        bool ok = fgets(*out, sizeof(*out), f) != NULL;
+        fclose(f);
+        return ok;
+    }
+    static uint32_t mag_cpu_list_count(const char* list) { /* Count CPUs in a sysfs cpu list, e.g. "0-3,8-11" */
+        uint32_t n = 0;
+        for (const char* p = list; *p >= '0' && *p <= '9';) {
+            char* end;
+            long a = strtol(p, &end, 10), b = a;
+            if (*end == '-') b = strtol(end+1, &end, 10);
+            n += (uint32_t)(b-a+1);
+            if (*end != ',') break;
+            p = end+1;
+        }
+        return n;
+    }
+#endif
+
+static void MAG_COLDPROC mag_system_host_info_query_caches(mag_cache_info_t (*out_caches)[MAG_MAX_CACHE_LEVELS]) { /* Get data and unified cache hierarchy */
     #if defined(__x86_64__) || defined(_M_X64)
-        mag_system_info_query_amd64_cpu_caps(&ctx->machine.amd64_cpu_caps);
+        uint32_t eax, ebx, ecx, edx;
+        mag_cpuid(0x80000000, -1, &eax, &ebx, &ecx, &edx);
+        uint32_t leaf = 0;
+        if (eax >= 0x8000001d) { /* AMD: topology extensions */
+            mag_cpuid(0x80000001, -1, &eax, &ebx, &ecx, &edx);
+            if (ecx & (1u<<22)) leaf = 0x8000001d;
+        }
+        if (!leaf) { /* Intel: deterministic cache parameters */
+            mag_cpuid(0, -1, &eax, &ebx, &ecx, &edx);
+            if (eax >= 4) leaf = 4;
+        }
+        for (int32_t sub=0; leaf && sub < 16; ++sub) {
+            mag_cpuid(leaf, sub, &eax, &ebx, &ecx, &edx);
+            uint32_t type = eax & 31; /* 0 = no more caches, 1 = data, 2 = instruction, 3 = unified */
+            if (!type) break;
+            if (type == 2) continue;
+            uint32_t level = (eax>>5) & 7;
+            uint32_t shared_by = ((eax>>14) & 0xfff) + 1;
+            uint64_t ways = ((ebx>>22) & 0x3ff) + 1;
+            uint64_t partitions = ((ebx>>12) & 0x3ff) + 1;
+            uint64_t line = (ebx & 0xfff) + 1;
+            uint64_t sets = (uint64_t)ecx + 1;
+            mag_cache_info_insert(out_caches, level, ways*partitions*line*sets, (uint32_t)line, shared_by);
+        }
+        if ((*out_caches)[0].size) return;
+    #endif
+    #ifdef _WIN32
+        DWORD size = 0;
+        GetLogicalProcessorInformation(NULL, &size);
+        if (mag_unlikely(!size)) return;
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION* info = (*mag_alloc)(NULL, size);
+        if (mag_likely(GetLogicalProcessorInformation(info, &size))) {
+            for (DWORD i=0; i < size/sizeof(*info); ++i) {
+                if (info[i].Relationship != RelationCache || info[i].Cache.Type == CacheInstruction) continue;
+                uint32_t shared_by = 0;
+                for (uintptr_t m = (uintptr_t)info[i].ProcessorMask; m; m &= m-1) ++shared_by;
+                mag_cache_info_insert(out_caches, info[i].Cache.Level, info[i].Cache.Size, info[i].Cache.LineSize, shared_by);
+            }
+        }
+        (*mag_alloc)(info, 0);
+    #elif defined(__APPLE__)
+        uint8_t tmp[256];
+        size_t len;
+        uint32_t line = 0;
+        if (mag_likely(mag_sysctl_key(&tmp, &len, "hw.cachelinesize") && len))
+            line = (uint32_t)mag_sysctl_unpack_int(&tmp, len);
+        static const char* const keys[3][2] = { /* Size, CPUs sharing. Apple silicon reports the performance cluster as perflevel0. */
+            {"hw.l1dcachesize", NULL},
+            {"hw.l2cachesize", "hw.perflevel0.cpusperl2"},
+            {"hw.l3cachesize", "hw.perflevel0.cpusperl3"}
+        };
+        for (uint32_t i=0; i < 3; ++i) {
+            uint64_t size = 0;
+            uint32_t shared_by = 1;
+            if (mag_sysctl_key(&tmp, &len, keys[i][0]) && len)
+                size = mag_sysctl_unpack_int(&tmp, len);
+            if (keys[i][1] && mag_sysctl_key(&tmp, &len, keys[i][1]) && len)
+                shared_by = (uint32_t)mag_sysctl_unpack_int(&tmp, len);
+            mag_cache_info_insert(out_caches, i+1, size, line, shared_by);
+        }
+    #elif defined(__linux__)
+        for (int idx=0; idx < 16; ++idx) {
+            char path[128], val[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", idx);
+            if (!mag_sysfs_read_line(path, &val)) break;
+            if (strncmp(val, "Instruction", sizeof("Instruction")-1) == 0) continue;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", idx);
+            if (!mag_sysfs_read_line(path, &val)) continue;
+            uint32_t level = (uint32_t)strtoul(val, NULL, 10);
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", idx);
+            if (!mag_sysfs_read_line(path, &val)) continue;
+            char* unit;
+            uint64_t size = strtoull(val, &unit, 10);
+            if (*unit == 'K') size <<= 10;
+            else if (*unit == 'M') size <<= 20;
+            else if (*unit == 'G') size <<= 30;
+            uint32_t line = 0, shared_by = 1;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/coherency_line_size", idx);
+            if (mag_sysfs_read_line(path, &val)) line = (uint32_t)strtoul(val, NULL, 10);
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/shared_cpu_list", idx);
+            if (mag_sysfs_read_line(path, &val)) shared_by = mag_xmax(1, mag_cpu_list_count(val));
+            mag_cache_info_insert(out_caches, level, size, line, shared_by);
+        }
+    #endif
+}
+
+static uint64_t mag_cache_info_llc_size(const mag_cache_info_t (*caches)[MAG_MAX_CACHE_LEVELS]) { /* Size of the outermost present cache level */
+    for (int i=MAG_MAX_CACHE_LEVELS-1; i >= 0; --i)
+        if ((*caches)[i].size) return (*caches)[i].size;
+    return 0;
+}
+
+static void MAG_COLDPROC mag_system_host_info_query(mag_machine_info_t* machine) {
+    mag_system_host_info_query_os_name(&machine->os_name);
+    mag_system_host_info_query_cpu_name(&machine->cpu_name);
+    mag_system_host_info_query_cpu_cores(&machine->cpu_virtual_cores, &machine->cpu_physical_cores, &machine->cpu_sockets);
+    #if defined(__x86_64__) || defined(_M_X64)
+        mag_system_info_query_amd64_cpu_caps(&machine->amd64_cpu_caps);
     #elif defined(__aarch64__)
-        mag_system_info_query_arm64_cpu_caps(&ctx->machine.arm64_cpu_caps, &ctx->machine.arm64_cpu_sve_width);
+        mag_system_info_query_arm64_cpu_caps(&machine->arm64_cpu_caps, &machine->arm64_cpu_sve_width);
     #endif
-    if (mag_unlikely(!*ctx->machine.os_name)) snprintf(ctx->machine.os_name, sizeof(ctx->machine.os_name), "Unknown");
-    if (mag_unlikely(!*ctx->machine.cpu_name)) snprintf(ctx->machine.cpu_name, sizeof(ctx->machine.cpu_name), "Unknown");
+    mag_system_host_info_query_caches(&machine->cpu_caches);
+    machine->cpu_llc_size = mag_cache_info_llc_size(&machine->cpu_caches);
+    if (mag_unlikely(!*machine->os_name)) snprintf(machine->os_name, sizeof(machine->os_name), "Unknown");
+    if (mag_unlikely(!*machine->cpu_name)) snprintf(machine->cpu_name, sizeof(machine->cpu_name), "Unknown");
+}
+
+static mag_machine_info_t mag_host_info;                /* Process-wide host description. */
+static volatile mag_atomic_t mag_host_info_state = 0;   /* 0 = not queried, 1 = query in progress, 2 = ready. */
+
+/* Queries the host on first use only. Contexts created concurrently wait for the first query to finish. */
+static const mag_machine_info_t* mag_system_host_info_get(void) {
+    if (mag_likely(mag_atomic_load(&mag_host_info_state, MAG_MO_ACQUIRE) == 2)) return &mag_host_info;
+    mag_atomic_t expected = 0, desired = 1;
+    if (mag_atomic_compare_exchange_strong(&mag_host_info_state, &expected, &desired, MAG_MO_ACQ_REL, MAG_MO_ACQUIRE)) {
+        mag_system_host_info_query(&mag_host_info);
+        mag_atomic_store(&mag_host_info_state, 2, MAG_MO_RELEASE);
+    } else {
+        while (mag_atomic_load(&mag_host_info_state, MAG_MO_ACQUIRE) != 2)
+            mag_thread_yield();
+    }
+    return &mag_host_info;
 }
 
 static MAG_AINLINE void mag_sto_write_u32_le(uint8_t** p, uint32_t x) {
@@ -3027,21 +4196,24 @@ static size_t mag_sto_total_size(const mag_tensor_t** tensors, size_t n) {
     return total;
 }
 
-static uint8_t* mag_sto_write_buffered(const mag_tensor_t** tensors, size_t n_tensors, size_t* out_size, uint32_t version) {
+/* Tail reserves trailing bytes after the tensor data for an extension section, written by the caller (see mag_graph_save). */
+static uint8_t* mag_sto_write_buffered(const mag_tensor_t** tensors, size_t n_tensors, size_t tail, uint32_t ud, size_t* out_size, uint32_t version) {
     if (mag_unlikely(!tensors || !n_tensors || n_tensors > UINT32_MAX || !out_size || !version || version > MAG_STORAGE_VERSION)) return NULL;  /* Check input */
-    *out_size = mag_sto_total_size(tensors, n_tensors);
+    *out_size = mag_sto_total_size(tensors, n_tensors) + tail;
     uint8_t* base = (uint8_t*)(*mag_alloc)(NULL, *out_size );     /* Allocate buffer */
     uint8_t* needle = base;
     const uint8_t* end = base + *out_size ;
-    if (mag_unlikely(!mag_sto_write_file_header(&needle, end, version, (uint32_t)n_tensors, 0))) goto error;     /* Write file header */
+    if (mag_unlikely(!mag_sto_write_file_header(&needle, end, version, (uint32_t)n_tensors, ud))) goto error;     /* Write file header */
     for (size_t i=0; i < n_tensors; ++i) {   /* Write tensor headers */
         const mag_tensor_t* t = tensors[i];
         mag_assert2(t != NULL);
+        char name[MAG_MAX_TENSOR_NAME_LEN] = {0};
+        strncpy(name, mag_tensor_get_name(t), MAG_MAX_TENSOR_NAME_LEN-1);
         if (mag_unlikely(!mag_sto_write_tensor_header(
             &needle,
             end,
             version,
-            &t->name,
+            &name,
             t->flags,
             t->dtype,
             t->rank,
@@ -3051,8 +4223,8 @@ static uint8_t* mag_sto_write_buffered(const mag_tensor_t** tensors, size_t n_te
     mag_assert2(needle - base == MAG_STO_FILE_HEADER_SIZE + n_tensors*MAG_STO_TENSOR_HEADER_SIZE);    /* Check written data size */
     for (size_t i=0; i < n_tensors; ++i) {  /* Write tensor data */
         const mag_tensor_t* t = tensors[i];
-        mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU);
-        if (mag_unlikely(!mag_sto_write_tensor_data(&needle, end, version, t->dtype, (const void*)t->storage.base, mag_tensor_data_size(t)))) goto error;     /* Write data */
+        mag_tensor_sync_host(t);
+        if (mag_unlikely(!mag_sto_write_tensor_data(&needle, end, version, t->dtype, (const void*)t->storage->base, mag_tensor_data_size(t)))) goto error;     /* Write data */
     }
     return base;
     error: /* Error handling */
@@ -3060,13 +4232,11 @@ static uint8_t* mag_sto_write_buffered(const mag_tensor_t** tensors, size_t n_te
         return NULL;
 }
 
-MAG_EXPORT mag_tensor_t** mag_sto_read_buffered(mag_ctx_t* ctx, const uint8_t* buf, size_t size, uint32_t* out_n_tensors, uint32_t* out_version) { /* Load stored tensors from buffer. Function is exported for fuzzing test. */
-    if (mag_unlikely(!ctx || !buf || !out_n_tensors || !out_version || size <= MAG_STO_FILE_HEADER_SIZE + MAG_STO_TENSOR_HEADER_SIZE + 1)) return NULL;    /* Check input */
-    const uint8_t* needle = buf;
-    const uint8_t* end = buf + size;
+/* Reads header and tensors, leaving the needle behind the tensor data. */
+static mag_tensor_t** mag_sto_read_tensors(mag_ctx_t* ctx, const uint8_t** p, const uint8_t* end, uint32_t* out_n_tensors, uint32_t* out_version, uint32_t* out_ud) {
+    const uint8_t* needle = *p;
     uint32_t n_tensors;
-    uint32_t ud;
-    if (mag_unlikely(!mag_sto_read_file_header(&needle, end, out_version, &n_tensors, &ud))) return NULL;   /* Read file header */
+    if (mag_unlikely(!mag_sto_read_file_header(&needle, end, out_version, &n_tensors, out_ud))) return NULL;   /* Read file header */
     if (mag_unlikely(!*out_version || *out_version > MAG_VERSION)) return NULL;
     if (mag_unlikely(!n_tensors)) return NULL;
     mag_tensor_t** tensors = (*mag_alloc)(NULL, n_tensors*sizeof(*tensors));   /* Allocate return tensor array */
@@ -3079,23 +4249,32 @@ MAG_EXPORT mag_tensor_t** mag_sto_read_buffered(mag_ctx_t* ctx, const uint8_t* b
         if (mag_unlikely(!mag_sto_read_tensor_header(&needle, end, *out_version, &name, &flags, &dtype, &rank, &shape))) goto error;   /* Read tensor header */
         mag_tensor_t* t = mag_tensor_create(ctx, dtype, shape, rank, NULL, 0);   /* Create placeholder tensor */
         mag_tensor_fmt_name(t, "%s", name);
-        t->flags = flags;
+        t->flags = flags & ~MAG_TFLAG_FROZEN;
+        if ((flags & MAG_TFLAG_FROZEN) && (t->flags & MAG_TFLAG_OWNER)) mag_tensor_freeze(t); /* Pins the storage, the data is read directly into the buffer below. */
         tensors[i] = t;
     }
     for (size_t i=0; i < n_tensors; ++i) {  /* Read tensor data */
         mag_tensor_t* t = tensors[i];
-        mag_assert2(t->ctx->device_type == MAG_COMPUTE_DEVICE_TYPE_CPU);
+        mag_tensor_sync_host(t);
         size_t data_size = mag_accumulate_data_size(t->dtype, &t->shape);
         mag_assert2(needle + data_size <= end && data_size == mag_tensor_data_size(t));
-        if (mag_unlikely(!mag_sto_read_tensor_data(&needle, end, *out_version, t->dtype, (void*)t->storage.base, data_size))) goto error;  /* Read data into tensor's buffer */
+        if (mag_unlikely(!mag_sto_read_tensor_data(&needle, end, *out_version, t->dtype, (void*)t->storage->base, data_size))) goto error;  /* Read data into tensor's buffer */
     }
     *out_n_tensors = n_tensors;
+    *p = needle;
     return tensors;
     error:
         (*mag_alloc)(tensors, 0);
         return NULL;
 }
 
+MAG_EXPORT mag_tensor_t** mag_sto_read_buffered(mag_ctx_t* ctx, const uint8_t* buf, size_t size, uint32_t* out_n_tensors, uint32_t* out_version) { /* Load stored tensors from buffer. Function is exported for fuzzing test. */
+    if (mag_unlikely(!ctx || !buf || !out_n_tensors || !out_version || size <= MAG_STO_FILE_HEADER_SIZE + MAG_STO_TENSOR_HEADER_SIZE + 1)) return NULL;    /* Check input */
+    const uint8_t* needle = buf;
+    uint32_t ud;
+    return mag_sto_read_tensors(ctx, &needle, buf + size, out_n_tensors, out_version, &ud);
+}
+
 static bool mag_sto_has_mag_ext(const char* file) { /* Check if file path has magnetron extension. */
     if (mag_unlikely(!file || strlen(file) < sizeof(MAG_STORAGE_EXT))) return false;
     const char* dot = strrchr(file, '.');
@@ -3109,7 +4288,7 @@ void mag_tensor_save(const mag_tensor_t* t, const char* file) {
     uint32_t version = MAG_STORAGE_VERSION;
     size_t n_tensors = 1;
     size_t n_bytes = 0;
-    uint8_t* ser = mag_sto_write_buffered(&t, n_tensors, &n_bytes, version);   /* Serialize tensor */
+    uint8_t* ser = mag_sto_write_buffered(&t, n_tensors, 0, 0, &n_bytes, version);   /* Serialize tensor */
     mag_assert(ser && n_bytes, "Failed to serialize tensor to file: %s", file);   /* Check serialization */
     mag_assert(fwrite(ser, 1, n_bytes, f) == n_bytes, "Failed to write %zu bytes to file: %s", n_bytes, file);    /* Write to file */
     (*mag_alloc)(ser, 0);     /* Free buffer */
@@ -3146,6 +4325,817 @@ mag_tensor_t* mag_tensor_load(mag_ctx_t* ctx, const char* file) {
     return target;
 }
 
+/*
+** Graph files are regular storage files holding the leaf tensors (weights and inputs) with their data,
+** followed by a graph section with the op nodes in topological order. Node inputs index into the tensor table,
+** which holds the leaves first and then the node results. Loaders which ignore the section see a plain weight file.
+*/
+#define MAG_STO_UD_GRAPH 0x1
+#define MAG_STO_GRAPH_MAGIC "magraph!"
+mag_static_assert(sizeof(MAG_STO_GRAPH_MAGIC)-1 == sizeof(uint64_t));
+#define MAG_STO_GRAPH_HEADER_SIZE ((sizeof(MAG_STO_GRAPH_MAGIC)-1) + sizeof(uint32_t)*2)
+#define MAG_STO_GRAPH_NODE_SIZE (MAG_MAX_TENSOR_NAME_LEN + sizeof(uint32_t)*(2 + MAG_MAX_INPUT_TENSORS + 2*MAG_MAX_OP_PARAMS))
+#define MAG_STO_GRAPH_NO_INPUT UINT32_MAX
+#define MAG_STO_GRAPH_INPLACE 0x1
+
+typedef struct mag_sto_graph_t {
+    mag_tensor_t** leaves;
+    size_t num_leaves;
+    mag_tensor_t** nodes;
+    size_t num_nodes;
+    size_t cap_leaves;
+    size_t cap_nodes;
+    mag_tensor_t** active; /* Nodes on the DFS stack, a revisit means the graph has a cycle. */
+    size_t num_active;
+    size_t cap_active;
+} mag_sto_graph_t;
+
+static int64_t mag_sto_graph_index_of(const mag_sto_graph_t* g, const mag_tensor_t* t) { /* Linear scan, graphs are saved once. */
+    for (size_t i=0; i < g->num_leaves; ++i) if (g->leaves[i] == t) return (int64_t)i;
+    for (size_t i=0; i < g->num_nodes; ++i) if (g->nodes[i] == t) return (int64_t)(g->num_leaves + i);
+    return -1;
+}
+
+static void mag_sto_graph_push(mag_tensor_t*** arr, size_t* len, size_t* cap, mag_tensor_t* t) {
+    if (*len == *cap) {
+        *cap = *cap ? *cap<<1 : 32;
+        *arr = (*mag_alloc)(*arr, *cap*sizeof(**arr));
+    }
+    (*arr)[(*len)++] = t;
+}
+
+static void mag_sto_graph_visit(mag_sto_graph_t* g, mag_tensor_t* t) { /* Post-order DFS, nodes are appended after their inputs. */
+    if (mag_sto_graph_index_of(g, t) >= 0) return;
+    if (t->op == MAG_OP_NOP) {
+        mag_assert(!(t->flags & MAG_TFLAG_VIEW), "Leaf tensor '%s' of the graph must not be a view", mag_tensor_get_name(t));
+        mag_sto_graph_push(&g->leaves, &g->num_leaves, &g->cap_leaves, t);
+        return;
+    }
+    for (size_t i=0; i < g->num_active; ++i) /* An output written into one of its own inputs (see mag_add_out) closes a cycle. */
+        mag_assert(g->active[i] != t, "Graph has a cycle at tensor '%s', an op output aliases one of its inputs", mag_tensor_get_name(t));
+    mag_sto_graph_push(&g->active, &g->num_active, &g->cap_active, t);
+    for (uint32_t i=0; i < MAG_MAX_INPUT_TENSORS; ++i)
+        if (t->op_inputs[i]) mag_sto_graph_visit(g, t->op_inputs[i]);
+    --g->num_active;
+    mag_sto_graph_push(&g->nodes, &g->num_nodes, &g->cap_nodes, t);
+}
+
+static void mag_sto_write_name(uint8_t** p, const char* name) {
+    char buf[MAG_MAX_TENSOR_NAME_LEN] = {0};
+    strncpy(buf, name, MAG_MAX_TENSOR_NAME_LEN-1);
+    memcpy(*p, buf, sizeof(buf));
+    *p += sizeof(buf);
+}
+
+static bool mag_sto_write_graph(uint8_t** p, const uint8_t* end, const mag_sto_graph_t* g, mag_tensor_t** outputs, size_t num_outputs) {
+    mag_sto_sanitize(*p + MAG_STO_GRAPH_HEADER_SIZE + g->num_nodes*MAG_STO_GRAPH_NODE_SIZE + num_outputs*sizeof(uint32_t) == end, false);
+    uint64_t magic;
+    memcpy(&magic, MAG_STO_GRAPH_MAGIC, sizeof(magic));
+    mag_sto_write_u64_le(p, magic);
+    mag_sto_write_u32_le(p, (uint32_t)g->num_nodes);
+    mag_sto_write_u32_le(p, (uint32_t)num_outputs);
+    for (size_t i=0; i < g->num_nodes; ++i) {
+        const mag_tensor_t* t = g->nodes[i];
+        const mag_op_meta_t* meta = mag_op_meta_of(t->op);
+        bool inplace = (t->flags & MAG_TFLAG_VIEW) && meta->r_alloc == &mag_result_constructor_routine_isomorph; /* Only inplace calls alias an isomorph result. */
+        mag_sto_write_name(p, mag_tensor_get_name(t));
+        mag_sto_write_u32_le(p, (uint32_t)t->op);
+        mag_sto_write_u32_le(p, inplace ? MAG_STO_GRAPH_INPLACE : 0);
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j)
+            mag_sto_write_u32_le(p, t->op_inputs[j] ? (uint32_t)mag_sto_graph_index_of(g, t->op_inputs[j]) : MAG_STO_GRAPH_NO_INPUT);
+        for (uint32_t j=0; j < MAG_MAX_OP_PARAMS; ++j) {
+            mag_sto_write_u32_le(p, (uint32_t)t->op_params[j].type);
+            mag_sto_write_u32_le(p, t->op_params[j].x.u32);
+        }
+    }
+    for (size_t i=0; i < num_outputs; ++i)
+        mag_sto_write_u32_le(p, (uint32_t)mag_sto_graph_index_of(g, outputs[i]));
+    return mag_likely(*p == end);
+}
+
+void mag_graph_save(mag_tensor_t** outputs, size_t num_outputs, const char* file) {
+    mag_assert(mag_sto_has_mag_ext(file), "Invalid file extension: %s", file);
+    mag_assert(outputs && num_outputs && num_outputs <= UINT32_MAX, "Graph needs at least one output");
+    mag_sto_graph_t g = {0};
+    for (size_t i=0; i < num_outputs; ++i) {
+        mag_assert(outputs[i] && outputs[i]->ctx == outputs[0]->ctx, "Graph outputs must be non-NULL and share one context");
+        mag_sto_graph_visit(&g, outputs[i]);
+    }
+    mag_assert(g.num_leaves && g.num_leaves + g.num_nodes < MAG_STO_GRAPH_NO_INPUT, "Graph must have between one and %u tensors", MAG_STO_GRAPH_NO_INPUT-1);
+    uint32_t version = MAG_STORAGE_VERSION;
+    size_t tail = MAG_STO_GRAPH_HEADER_SIZE + g.num_nodes*MAG_STO_GRAPH_NODE_SIZE + num_outputs*sizeof(uint32_t);
+    size_t n_bytes = 0;
+    uint8_t* ser = mag_sto_write_buffered((const mag_tensor_t**)g.leaves, g.num_leaves, tail, MAG_STO_UD_GRAPH, &n_bytes, version);   /* Serialize leaves */
+    mag_assert(ser && n_bytes, "Failed to serialize graph to file: %s", file);
+    uint8_t* needle = ser + n_bytes - tail;
+    mag_assert(mag_sto_write_graph(&needle, ser + n_bytes, &g, outputs, num_outputs), "Failed to serialize graph to file: %s", file);   /* Serialize nodes */
+    FILE* f = mag_fopen(file, "wb");
+    mag_assert(f, "Failed to open file stream: %s", file);
+    mag_assert(fwrite(ser, 1, n_bytes, f) == n_bytes, "Failed to write %zu bytes to file: %s", n_bytes, file);
+    fflush(f);
+    fclose(f);
+    (*mag_alloc)(ser, 0);
+    if (g.leaves) (*mag_alloc)(g.leaves, 0);
+    if (g.nodes) (*mag_alloc)(g.nodes, 0);
+    if (g.active) (*mag_alloc)(g.active, 0);
+    double mem;
+    const char* unit;
+    mag_humanize_memory_size(n_bytes, &mem, &unit);
+    mag_log_info("Saved graph with %zu ops and %zu tensors to file: %s, %.03f %s written, storage v.%u", g.num_nodes, g.num_leaves, file, mem, unit, version);
+}
+
+/* Rebuilds the nodes in deferred mode under capture, so the ops are planned but not run until the first replay. */
+static bool mag_sto_read_graph(const uint8_t** p, const uint8_t* end, mag_ctx_t* ctx, mag_tensor_t** table, size_t num_leaves, mag_plan_t** out_plan) {
+    mag_sto_sanitize(*p + MAG_STO_GRAPH_HEADER_SIZE <= end, false);
+    uint64_t magic = mag_sto_read_u64_le(p);
+    mag_sto_sanitize(memcmp(&magic, MAG_STO_GRAPH_MAGIC, sizeof(magic)) == 0, false);
+    uint32_t num_nodes = mag_sto_read_u32_le(p);
+    uint32_t num_outputs = mag_sto_read_u32_le(p);
+    mag_sto_sanitize(num_outputs && num_nodes < MAG_STO_GRAPH_NO_INPUT - num_leaves, false);
+    mag_sto_sanitize((size_t)(end - *p) == num_nodes*MAG_STO_GRAPH_NODE_SIZE + num_outputs*sizeof(uint32_t), false);
+    mag_exec_mode_t mode = ctx->exec_mode;
+    ctx->exec_mode = MAG_EXEC_MODE_DEFERRED;
+    mag_ctx_begin_capture(ctx);
+    size_t len = num_leaves;
+    bool ok = false;
+    for (uint32_t i=0; i < num_nodes; ++i) {
+        char name[MAG_MAX_TENSOR_NAME_LEN];
+        memcpy(name, *p, sizeof(name));
+        name[sizeof(name)-1] = '\0';
+        *p += sizeof(name);
+        mag_op_t op = (mag_op_t)mag_sto_read_u32_le(p);
+        uint32_t flags = mag_sto_read_u32_le(p);
+        if (mag_unlikely(op == MAG_OP_NOP || op >= MAG_OP__NUM)) goto done;
+        const mag_op_meta_t* meta = mag_op_meta_of(op);
+        mag_tensor_t* inputs[MAG_MAX_INPUT_TENSORS] = {NULL};
+        for (uint32_t j=0; j < MAG_MAX_INPUT_TENSORS; ++j) {
+            uint32_t idx = mag_sto_read_u32_le(p);
+            if (j < meta->argcount) { if (mag_unlikely(idx >= len)) goto done; } /* Inputs must precede their node. */
+            else if (mag_unlikely(idx != MAG_STO_GRAPH_NO_INPUT)) goto done;
+            if (idx != MAG_STO_GRAPH_NO_INPUT) inputs[j] = table[idx];
+        }
+        mag_op_param_t params[MAG_MAX_OP_PARAMS] = {0};
+        for (uint32_t j=0; j < MAG_MAX_OP_PARAMS; ++j) {
+            params[j].type = (mag_op_param_type_t)mag_sto_read_u32_le(p);
+            params[j].x.u32 = mag_sto_read_u32_le(p);
+            if (mag_unlikely(j < meta->paramcount ? params[j].type != meta->param_types[j] : params[j].type != MAG_OP_TPARAM_NONE)) goto done;
+        }
+        mag_tensor_t* R = mag_tensor_operator(ctx, op, flags & MAG_STO_GRAPH_INPLACE, inputs, meta->argcount, params, meta->paramcount);
+        if (mag_unlikely(!R)) goto done;
+        mag_tensor_set_name(R, name);
+        table[len++] = R;
+    }
+    mag_plan_t* plan = ctx->capture;
+    plan->outputs = (*mag_alloc)(NULL, num_outputs*sizeof(*plan->outputs));
+    for (uint32_t i=0; i < num_outputs; ++i) {
+        uint32_t idx = mag_sto_read_u32_le(p);
+        if (mag_unlikely(idx >= len)) goto done;
+        mag_tensor_incref(table[idx]);
+        plan->outputs[plan->num_outputs++] = table[idx];
+    }
+    ok = true;
+    done:
+        ctx->exec_mode = mode;
+        *out_plan = mag_ctx_end_capture(ctx);
+        for (size_t i=num_leaves; i < len; ++i) /* The plan retains the node results. */
+            mag_tensor_decref(table[i]);
+        return ok;
+}
+
+mag_plan_t* mag_graph_load(mag_ctx_t* ctx, const char* file) {
+    mag_assert(mag_sto_has_mag_ext(file), "Invalid file extension: %s", file);
+    size_t n_bytes = 0;
+    const uint8_t* buf = mag_map_file(file, &n_bytes);   /* Map file */
+    mag_assert(buf, "Failed to map file: %s", file);
+    mag_assert(n_bytes > MAG_STO_FILE_HEADER_SIZE + MAG_STO_TENSOR_HEADER_SIZE + 1, "Malformed file size");
+    const uint8_t* needle = buf;
+    const uint8_t* end = buf + n_bytes;
+    uint32_t n_tensors = 0, version = 0, ud = 0;
+    mag_tensor_t** leaves = mag_sto_read_tensors(ctx, &needle, end, &n_tensors, &version, &ud);   /* Deserialize leaves */
+    mag_assert(leaves && n_tensors > 0, "Failed to load graph from file: %s", file);
+    mag_assert(ud & MAG_STO_UD_GRAPH, "File has no graph section: %s", file);
+    size_t max_nodes = (size_t)(end - needle)/MAG_STO_GRAPH_NODE_SIZE;
+    mag_tensor_t** table = (*mag_alloc)(NULL, (n_tensors + max_nodes)*sizeof(*table));
+    memcpy(table, leaves, n_tensors*sizeof(*table));
+    (*mag_alloc)(leaves, 0);
+    mag_plan_t* plan = NULL;
+    bool ok = mag_sto_read_graph(&needle, end, ctx, table, n_tensors, &plan);   /* Rebuild and plan nodes */
+    for (size_t i=0; i < n_tensors; ++i) /* The plan retains the leaves it uses. */
+        mag_tensor_decref(table[i]);
+    (*mag_alloc)(table, 0);
+    mag_unmap_file(buf, n_bytes);
+    if (mag_unlikely(!ok)) { /* The plan is NULL if the graph header was rejected. */
+        mag_plan_destroy(plan);
+        mag_log_error("Corrupt graph section in file: %s", file);
+        return NULL;
+    }
+    double mem;
+    const char* unit;
+    mag_humanize_memory_size(n_bytes, &mem, &unit);
+    mag_log_info("Loaded graph with %zu ops and %u tensors from file: %s, %.03f %s mapped, storage v.%u", plan->len, n_tensors, file, mem, unit, version);
+    return plan;
+}
+
+/*
+** Collectives for data-parallel training in several processes on one host. All ranks map one POSIX shared memory segment,
+** which holds the barrier words and two sets of world_size slots, used by alternating chunks. For each chunk of a tensor, every
+** rank copies the chunk into its slot and sums its 1/world_size share over all slots (reduce-scatter). After a barrier it copies
+** the reduced shares of all ranks back (all-gather). Alternating slot sets save the barrier after the gather.
+** Barriers sleep on a futex on Linux and yield on other POSIX systems.
+*/
+#define MAG_COMM_MAGIC 0x316d6d6f6367616dull                /* "magcomm1" */
+#define MAG_COMM_SLOT_SIZE_DEFAULT (4ull<<20)               /* Bytes per rank and chunk. */
+#define MAG_COMM_SPIN 4096                                  /* Barrier polls before sleeping. */
+#define MAG_COMM_JOIN_TIMEOUT_NS (120ull*1000*1000*1000)    /* Max wait for the other ranks to join. */
+
+typedef struct mag_comm_header_t {
+    volatile mag_atomic_t magic;                /* Set by rank 0 once the header is initialized. */
+    volatile mag_atomic_t arrived;              /* Ranks waiting at the current barrier. */
+    uint32_t generation;                        /* Barrier generation, futex word. */
+    uint32_t world_size;
+    uint64_t slot_size;
+    uint64_t session;                           /* Launch the segment belongs to, written before the magic. */
+} mag_comm_header_t;
+
+#define MAG_COMM_HEADER_SIZE ((sizeof(mag_comm_header_t)+MAG_CACHE_LINE_SIZE-1) & ~(size_t)(MAG_CACHE_LINE_SIZE-1))
+
+typedef struct mag_comm_job_t {
+    mag_tensor_t* t;                            /* Retained until mag_comm_wait. */
+    float* x;
+    int64_t numel;
+    bool average;
+} mag_comm_job_t;
+
+struct mag_comm_t {
+    mag_compute_device_t* dvc;                  /* Provides the add kernel. */
+    uint32_t rank;
+    uint32_t world_size;
+    size_t slot_size;
+    uint8_t* shm;                               /* Mapped segment. */
+    size_t shm_size;
+    mag_comm_header_t* hdr;
+    float* slots;                               /* 2*world_size slots of slot_size bytes. */
+    uint64_t num_chunks;                        /* Chunks reduced so far, selects the slot set. */
+    mag_comm_job_t* jobs;                       /* Reductions started by mag_comm_all_reduce_start. */
+    size_t num_jobs;
+    size_t cap_jobs;
+    size_t num_done;                            /* Jobs finished by the background thread. */
+    bool online;                                /* Background thread runs. */
+    bool stop;
+    mag_thread_t thread;
+    mag_mutex_t mtx;
+    mag_cond_var_t cv_work;
+    mag_cond_var_t cv_done;
+};
+
+static void mag_comm_barrier_wait(mag_comm_t* comm) {
+    mag_comm_header_t* hdr = comm->hdr;
+    uint32_t gen = __atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE);
+    if (mag_atomic_fetch_add(&hdr->arrived, 1, MAG_MO_ACQ_REL) == comm->world_size-1) { /* Last rank releases the others. */
+        mag_atomic_store(&hdr->arrived, 0, MAG_MO_RELAXED);
+        __atomic_store_n(&hdr->generation, gen+1, __ATOMIC_RELEASE);
+        #ifdef __linux__
+            syscall(SYS_futex, &hdr->generation, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0); /* Not private, waiters live in other processes. */
+        #endif
+        return;
+    }
+    for (uint32_t spin=0; __atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE) == gen; ++spin) {
+        if (spin < MAG_COMM_SPIN) continue;
+        #ifdef __linux__
+            syscall(SYS_futex, &hdr->generation, FUTEX_WAIT, gen, NULL, NULL, 0); /* Returns at once if the generation moved on. */
+        #else
+            mag_thread_yield();
+        #endif
+    }
+}
+
+static void mag_comm_vadd(mag_comm_t* comm, int64_t numel, float* o, const float* x, const float* y) {
+    if (comm->dvc->vadd_host) {
+        (*comm->dvc->vadd_host)(comm->dvc, numel, o, x, y);
+        return;
+    }
+    for (int64_t i=0; i < numel; ++i)
+        o[i] = x[i] + y[i];
+}
+
+static void mag_comm_reduce(mag_comm_t* comm, float* x, int64_t numel, bool average) {
+    uint32_t rank = comm->rank, world = comm->world_size;
+    int64_t cap = (int64_t)(comm->slot_size/sizeof(float));
+    float scale = 1.0f/(float)world;
+    for (int64_t offs=0; offs < numel; offs += cap) {
+        int64_t n = mag_xmin(cap, numel-offs);
+        int64_t share = (n+world-1)/world;
+        float* set = comm->slots + (comm->num_chunks++ & 1)*world*cap;
+        memcpy(set + rank*cap, x+offs, n*sizeof(*x));
+        mag_comm_barrier_wait(comm);
+        int64_t lo = mag_xmin(n, rank*share);
+        int64_t hi = mag_xmin(n, lo+share);
+        float* acc = set + rank*cap + lo;
+        for (uint32_t r=0; r < world; ++r) /* Own share of the chunk, in rank order on top of the own values. */
+            if (r != rank) mag_comm_vadd(comm, hi-lo, acc, acc, set + r*cap + lo);
+        if (average)
+            for (int64_t i=0; i < hi-lo; ++i) acc[i] *= scale;
+        mag_comm_barrier_wait(comm);
+        for (uint32_t r=0; r < world; ++r) {
+            int64_t rlo = mag_xmin(n, r*share);
+            int64_t rhi = mag_xmin(n, rlo+share);
+            memcpy(x+offs+rlo, set + r*cap + rlo, (rhi-rlo)*sizeof(*x));
+        }
+    }
+}
+
+static mag_thread_ret_t mag_comm_exec(void* arg) {
+    mag_comm_t* comm = arg;
+    mag_thread_set_name("mag_comm");
+    mag_mutex_lock(&comm->mtx);
+    for (;;) {
+        while (comm->num_done == comm->num_jobs && !comm->stop)
+            mag_cv_wait(&comm->cv_work, &comm->mtx);
+        if (comm->num_done == comm->num_jobs) break; /* Stopped and drained. */
+        mag_comm_job_t job = comm->jobs[comm->num_done];
+        mag_mutex_unlock(&comm->mtx);
+        mag_comm_reduce(comm, job.x, job.numel, job.average);
+        mag_mutex_lock(&comm->mtx);
+        ++comm->num_done;
+        mag_cv_signal(&comm->cv_done);
+    }
+    mag_mutex_unlock(&comm->mtx);
+    return MAG_THREAD_RET_NONE;
+}
+
+mag_comm_t* mag_comm_create(mag_ctx_t* ctx, const char* name, uint64_t session, uint32_t rank, uint32_t world_size, size_t slot_size) {
+    mag_ctx_check_thread(ctx);
+    mag_assert(name && *name && !strchr(name, '/') && strlen(name) < 200, "Invalid communicator name");
+    mag_assert(world_size && rank < world_size, "Invalid rank %u for world size %u", rank, world_size);
+    #ifdef _WIN32
+        (void)slot_size;
+        mag_panic("Shared memory collectives need a POSIX system");
+    #else
+        slot_size = slot_size ? slot_size : MAG_COMM_SLOT_SIZE_DEFAULT;
+        slot_size = (slot_size+MAG_CACHE_LINE_SIZE-1) & ~(size_t)(MAG_CACHE_LINE_SIZE-1);
+        size_t shm_size = MAG_COMM_HEADER_SIZE + 2*world_size*slot_size;
+        char path[256];
+        snprintf(path, sizeof(path), "/mag_%s", name);
+        uint64_t start = mag_hpc_clock_ns();
+        void* p;
+        mag_comm_header_t* hdr;
+        if (rank == 0) {
+            int fd = shm_open(path, O_CREAT|O_EXCL|O_RDWR, 0600);
+            if (fd < 0 && errno == EEXIST) { /* Left over by a crashed group, ranks still mapping it see the wrong session and reopen. */
+                mag_log_warn("Removing stale shared memory segment: %s", path);
+                shm_unlink(path);
+                fd = shm_open(path, O_CREAT|O_EXCL|O_RDWR, 0600);
+            }
+            mag_assert(fd >= 0 && ftruncate(fd, (off_t)shm_size) == 0, "Failed to create shared memory segment %s: %s", path, strerror(errno));
+            p = mmap(NULL, shm_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd); /* The mapping keeps the segment alive. */
+            mag_assert(p != MAP_FAILED, "Failed to map shared memory segment %s: %s", path, strerror(errno));
+            hdr = p;
+            hdr->world_size = world_size;
+            hdr->slot_size = slot_size;
+            hdr->session = session;
+            mag_atomic_store(&hdr->magic, (mag_atomic_t)MAG_COMM_MAGIC, MAG_MO_RELEASE);
+        } else { /* Wait for rank 0 to create and initialize the segment of this session. */
+            for (;;) {
+                mag_assert(mag_hpc_clock_ns() - start < MAG_COMM_JOIN_TIMEOUT_NS, "Rank %u timed out waiting for rank 0", rank);
+                struct stat st;
+                int fd = shm_open(path, O_RDWR, 0);
+                mag_assert(fd >= 0 || errno == ENOENT, "Failed to open shared memory segment %s: %s", path, strerror(errno));
+                if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < shm_size) {
+                    if (fd >= 0) close(fd);
+                    mag_thread_yield();
+                    continue;
+                }
+                p = mmap(NULL, shm_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                mag_assert(p != MAP_FAILED, "Failed to map shared memory segment %s: %s", path, strerror(errno));
+                hdr = p;
+                if (mag_atomic_load(&hdr->magic, MAG_MO_ACQUIRE) == (mag_atomic_t)MAG_COMM_MAGIC && hdr->session == session) break;
+                munmap(p, shm_size); /* Not initialized yet, or a stale segment rank 0 is about to replace, open the name again. */
+                mag_thread_yield();
+            }
+            mag_assert(hdr->world_size == world_size && hdr->slot_size == slot_size, "Rank %u disagrees with rank 0 on world or slot size", rank);
+            /* No barrier completes before every rank joined, a segment that has seen one belongs to another group. */
+            mag_assert(__atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE) == 0 && (uint32_t)mag_atomic_load(&hdr->arrived, MAG_MO_ACQUIRE) < world_size,
+                "Rank %u joined communicator %s after its first barrier, is the session %" PRIu64 " used twice?", rank, name, session);
+        }
+        mag_comm_t* comm = (*mag_alloc)(NULL, sizeof(*comm));
+        memset(comm, 0, sizeof(*comm));
+        comm->dvc = ctx->device;
+        comm->rank = rank;
+        comm->world_size = world_size;
+        comm->slot_size = slot_size;
+        comm->shm = p;
+        comm->shm_size = shm_size;
+        comm->hdr = hdr;
+        comm->slots = (float*)((uint8_t*)p + MAG_COMM_HEADER_SIZE);
+        mag_comm_barrier_wait(comm); /* All ranks mapped the segment. */
+        if (rank == 0) shm_unlink(path); /* Nothing is left behind when the ranks exit. */
+        mag_log_info("Joined communicator %s as rank %u of %u", name, rank, world_size);
+        return comm;
+    #endif
+}
+
+void mag_comm_wait(mag_comm_t* comm) {
+    if (!comm->online) return;
+    mag_mutex_lock(&comm->mtx);
+    while (comm->num_done < comm->num_jobs)
+        mag_cv_wait(&comm->cv_done, &comm->mtx);
+    size_t n = comm->num_jobs;
+    comm->num_jobs = comm->num_done = 0;
+    mag_mutex_unlock(&comm->mtx);
+    for (size_t i=0; i < n; ++i)
+        mag_tensor_decref(comm->jobs[i].t);
+}
+
+void mag_comm_destroy(mag_comm_t* comm) {
+    mag_comm_wait(comm);
+    if (comm->online) {
+        mag_mutex_lock(&comm->mtx);
+        comm->stop = true;
+        mag_cv_signal(&comm->cv_work);
+        mag_mutex_unlock(&comm->mtx);
+        mag_thread_join(comm->thread);
+        mag_cv_destroy(&comm->cv_done);
+        mag_cv_destroy(&comm->cv_work);
+        mag_mutex_destroy(&comm->mtx);
+    }
+    #ifndef _WIN32
+        munmap(comm->shm, comm->shm_size);
+    #endif
+    if (comm->jobs) (*mag_alloc)(comm->jobs, 0);
+    (*mag_alloc)(comm, 0);
+}
+
+uint32_t mag_comm_get_rank(const mag_comm_t* comm) { return comm->rank; }
+uint32_t mag_comm_get_world_size(const mag_comm_t* comm) { return comm->world_size; }
+
+void mag_comm_barrier(mag_comm_t* comm) {
+    mag_comm_wait(comm);
+    mag_comm_barrier_wait(comm);
+}
+
+static float* mag_comm_data(mag_tensor_t* t) {
+    mag_assert(t->dtype == MAG_DTYPE_F32, "Only F32 tensors can be reduced");
+    mag_assert(mag_tensor_is_contiguous(t), "Only contiguous tensors can be reduced");
+    return mag_tensor_data_ptr(t); /* Waits for queued ops of asynchronous devices. */
+}
+
+void mag_comm_all_reduce(mag_comm_t* comm, mag_tensor_t* t, bool average) {
+    mag_comm_wait(comm); /* Keep the order of collectives. */
+    mag_comm_reduce(comm, mag_comm_data(t), t->numel, average);
+}
+
+void mag_comm_all_reduce_start(mag_comm_t* comm, mag_tensor_t* t, bool average) {
+    float* x = mag_comm_data(t);
+    if (!comm->online) {
+        mag_mutex_create(&comm->mtx);
+        mag_cv_create(&comm->cv_work);
+        mag_cv_create(&comm->cv_done);
+        mag_thread_create(&comm->thread, &mag_comm_exec, comm);
+        comm->online = true;
+    }
+    mag_tensor_incref(t);
+    mag_mutex_lock(&comm->mtx);
+    if (comm->num_jobs == comm->cap_jobs) {
+        comm->cap_jobs = comm->cap_jobs ? comm->cap_jobs<<1 : 16;
+        comm->jobs = (*mag_alloc)(comm->jobs, comm->cap_jobs*sizeof(*comm->jobs));
+    }
+    comm->jobs[comm->num_jobs++] = (mag_comm_job_t){.t = t, .x = x, .numel = t->numel, .average = average};
+    mag_cv_signal(&comm->cv_work);
+    mag_mutex_unlock(&comm->mtx);
+}
+
+/*
+** Dynamic batching: callers queue single samples, a scheduler thread copies up to max batch of them into the batch slots of
+** the plan input, replays the plan once and copies each sample's slot of the output back. A batch starts when it is full or
+** when the oldest queued sample waited for the timeout. Slots past the last sample keep stale data, their results are dropped.
+*/
+typedef struct mag_batch_request_t {
+    const float* x;
+    float* y;
+    bool done;
+    struct mag_batch_request_t* next;
+} mag_batch_request_t;
+
+struct mag_batcher_t {
+    mag_plan_t* plan;
+    mag_tensor_t* input;                /* Retained, written per sample slot before every replay. */
+    mag_tensor_t* output;               /* Retained, read per sample slot after every replay. */
+    int64_t in_dim;                     /* Batch dimension of the input. */
+    int64_t out_dim;                    /* Batch dimension of the output. */
+    int64_t max_batch;
+    uint64_t timeout_ns;
+    mag_batch_request_t* head;          /* Queued samples, oldest first. */
+    mag_batch_request_t* tail;
+    uint64_t head_arrival;              /* Queue time of the oldest sample. */
+    uint64_t num_requests;
+    uint64_t num_batches;
+    bool stop;
+    mag_thread_t thread;
+    mag_mutex_t mtx;
+    mag_cond_var_t cv_queue;            /* Signals queued samples and stop. */
+    mag_cond_var_t cv_done;             /* Signals finished batches. */
+};
+
+/* Copies sample j between a contiguous buffer and slot j of a contiguous row-major 2D batch tensor, whose dimension dim indexes samples. */
+static void mag_batch_copy_slot(mag_tensor_t* t, int64_t dim, int64_t j, float* sample, bool store) {
+    int64_t n = t->shape[dim^1];
+    float* base = (float*)t->storage->base + (dim == 0 ? j*n : j);
+    int64_t stride = dim == 0 ? 1 : t->shape[1];
+    for (int64_t i=0; i < n; ++i) {
+        if (store) base[i*stride] = sample[i];
+        else sample[i] = base[i*stride];
+    }
+}
+
+static mag_thread_ret_t mag_batcher_exec(void* arg) {
+    mag_batcher_t* b = arg;
+    mag_batch_request_t* batch[MAG_BATCHER_MAX_BATCH];
+    mag_thread_set_name("mag_batcher");
+    mag_mutex_lock(&b->mtx);
+    for (;;) {
+        while (!b->head && !b->stop)
+            mag_cv_wait(&b->cv_queue, &b->mtx);
+        if (!b->head) break; /* Stopped and drained. */
+        for (;;) { /* Wait for a full batch until the oldest sample timed out. */
+            int64_t queued = 0;
+            for (mag_batch_request_t* r=b->head; r && queued < b->max_batch; r=r->next) ++queued;
+            uint64_t waited = mag_hpc_clock_ns() - b->head_arrival;
+            if (queued == b->max_batch || waited >= b->timeout_ns || b->stop) break;
+            mag_cv_wait_for(&b->cv_queue, &b->mtx, b->timeout_ns - waited);
+        }
+        int64_t n = 0;
+        while (b->head && n < b->max_batch) {
+            batch[n++] = b->head;
+            b->head = b->head->next;
+        }
+        if (!b->head) b->tail = NULL;
+        else b->head_arrival = mag_hpc_clock_ns(); /* Leftovers start a new batch window. */
+        mag_mutex_unlock(&b->mtx);
+        mag_tensor_sync_host(b->input);
+        for (int64_t j=0; j < n; ++j)
+            mag_batch_copy_slot(b->input, b->in_dim, j, (float*)batch[j]->x, true);
+        mag_plan_replay(b->plan);
+        mag_tensor_sync_host(b->output);
+        for (int64_t j=0; j < n; ++j)
+            mag_batch_copy_slot(b->output, b->out_dim, j, batch[j]->y, false);
+        mag_mutex_lock(&b->mtx);
+        for (int64_t j=0; j < n; ++j)
+            batch[j]->done = true;
+        b->num_requests += (uint64_t)n;
+        ++b->num_batches;
+        mag_cv_broadcast(&b->cv_done);
+    }
+    mag_mutex_unlock(&b->mtx);
+    return MAG_THREAD_RET_NONE;
+}
+
+mag_batcher_t* mag_batcher_create(mag_plan_t* plan, mag_tensor_t* input, int64_t in_dim, mag_tensor_t* output, int64_t out_dim, uint64_t timeout_us) {
+    mag_assert(plan && input && output, "Invalid batcher arguments");
+    mag_assert(input->rank == 2 && output->rank == 2 && input->dtype == MAG_DTYPE_F32 && output->dtype == MAG_DTYPE_F32, "Batch tensors must be 2D F32 tensors");
+    mag_assert((in_dim == 0 || in_dim == 1) && (out_dim == 0 || out_dim == 1), "Invalid batch dimension");
+    mag_assert(mag_tensor_is_contiguous(input) && mag_tensor_is_contiguous(output), "Batch tensors must be contiguous");
+    mag_assert(input->shape[in_dim] == output->shape[out_dim], "Input and output batch sizes differ: %" PRIi64 " != %" PRIi64, input->shape[in_dim], output->shape[out_dim]);
+    mag_assert(input->shape[in_dim] <= MAG_BATCHER_MAX_BATCH, "Batch size %" PRIi64 " exceeds %d", input->shape[in_dim], MAG_BATCHER_MAX_BATCH);
+    mag_batcher_t* b = (*mag_alloc)(NULL, sizeof(*b));
+    memset(b, 0, sizeof(*b));
+    b->plan = plan;
+    b->input = input;
+    b->output = output;
+    b->in_dim = in_dim;
+    b->out_dim = out_dim;
+    b->max_batch = input->shape[in_dim];
+    b->timeout_ns = timeout_us*1000;
+    mag_tensor_incref(input);
+    mag_tensor_incref(output);
+    mag_mutex_create(&b->mtx);
+    mag_cv_create(&b->cv_queue);
+    mag_cv_create(&b->cv_done);
+    mag_thread_create(&b->thread, &mag_batcher_exec, b);
+    return b;
+}
+
+void mag_batcher_destroy(mag_batcher_t* b) {
+    mag_mutex_lock(&b->mtx);
+    b->stop = true;
+    mag_cv_signal(&b->cv_queue);
+    mag_mutex_unlock(&b->mtx);
+    mag_thread_join(b->thread); /* Runs the queued samples. */
+    mag_cv_destroy(&b->cv_done);
+    mag_cv_destroy(&b->cv_queue);
+    mag_mutex_destroy(&b->mtx);
+    mag_tensor_decref(b->output);
+    mag_tensor_decref(b->input);
+    (*mag_alloc)(b, 0);
+}
+
+void mag_batcher_infer(mag_batcher_t* b, const float* x, float* y) {
+    mag_batch_request_t req = {.x = x, .y = y, .done = false, .next = NULL};
+    mag_mutex_lock(&b->mtx);
+    mag_assert(!b->stop, "Batcher is shutting down");
+    if (b->tail) b->tail->next = &req;
+    else b->head = &req, b->head_arrival = mag_hpc_clock_ns();
+    b->tail = &req;
+    mag_cv_signal(&b->cv_queue);
+    while (!req.done)
+        mag_cv_wait(&b->cv_done, &b->mtx);
+    mag_mutex_unlock(&b->mtx);
+}
+
+void mag_batcher_get_stats(mag_batcher_t* b, uint64_t* num_requests, uint64_t* num_batches) {
+    mag_mutex_lock(&b->mtx);
+    *num_requests = b->num_requests;
+    *num_batches = b->num_batches;
+    mag_mutex_unlock(&b->mtx);
+}
+
+static mag_csr_t* mag_csr_alloc(mag_ctx_t* ctx, int64_t rows, int64_t cols, int64_t nnz) {
+    mag_assert(rows > 0 && cols > 0 && nnz >= 0, "Invalid sparse matrix: %" PRIi64 "x%" PRIi64 " with %" PRIi64 " nonzeros", rows, cols, nnz);
+    mag_assert(cols <= INT32_MAX, "Sparse matrix has %" PRIi64 " columns, indices are 32-bit", cols);
+    mag_csr_t* a = (*mag_alloc)(NULL, sizeof(*a));
+    *a = (mag_csr_t){.ctx = ctx, .rows = rows, .cols = cols, .nnz = nnz};
+    a->row_ptr = (*mag_alloc)(NULL, (size_t)(rows+1)*sizeof(*a->row_ptr));
+    a->col_idx = (*mag_alloc)(NULL, (size_t)mag_xmax(1, nnz)*sizeof(*a->col_idx));
+    a->values = (*mag_alloc)(NULL, (size_t)mag_xmax(1, nnz)*sizeof(*a->values));
+    return a;
+}
+
+mag_csr_t* mag_csr_from_dense(mag_tensor_t* t) {
+    mag_assert(t->rank == 2 && t->dtype == MAG_DTYPE_F32 && mag_tensor_is_contiguous(t), "Sparse matrices are built from contiguous 2D F32 tensors");
+    mag_tensor_sync_host(t);
+    const float* x = (const float*)t->storage->base;
+    int64_t rows = t->shape[0], cols = t->shape[1], nnz = 0;
+    for (int64_t i=0; i < rows*cols; ++i)
+        nnz += x[i] != 0.0f;
+    mag_csr_t* a = mag_csr_alloc(t->ctx, rows, cols, nnz);
+    int64_t k = 0;
+    for (int64_t r=0; r < rows; ++r) {
+        a->row_ptr[r] = k;
+        for (int64_t c=0; c < cols; ++c) {
+            float v = x[r*cols + c];
+            if (v == 0.0f) continue;
+            a->col_idx[k] = (int32_t)c;
+            a->values[k++] = v;
+        }
+    }
+    a->row_ptr[rows] = k;
+    return a;
+}
+
+mag_csr_t* mag_csr_from_coo(mag_ctx_t* ctx, int64_t rows, int64_t cols, int64_t nnz, const int64_t* row_idx, const int64_t* col_idx, const float* values) {
+    mag_csr_t* a = mag_csr_alloc(ctx, rows, cols, nnz);
+    for (int64_t k=0; k < nnz; ++k)
+        mag_assert(row_idx[k] >= 0 && row_idx[k] < rows && col_idx[k] >= 0 && col_idx[k] < cols, "Sparse entry %" PRIi64 " out of bounds", k);
+    size_t n = (size_t)mag_xmax(1, nnz);
+    int64_t* by_col = (*mag_alloc)(NULL, n*sizeof(*by_col));
+    int64_t* order = (*mag_alloc)(NULL, n*sizeof(*order));
+    int64_t* next = (*mag_alloc)(NULL, (size_t)(mag_xmax(rows, cols)+1)*sizeof(*next));
+    memset(next, 0, (size_t)(cols+1)*sizeof(*next)); /* Stable counting sorts by column, then by row: sorted columns within each row. */
+    for (int64_t k=0; k < nnz; ++k) ++next[col_idx[k]+1];
+    for (int64_t c=0; c < cols; ++c) next[c+1] += next[c];
+    for (int64_t k=0; k < nnz; ++k) by_col[next[col_idx[k]]++] = k;
+    memset(next, 0, (size_t)(rows+1)*sizeof(*next));
+    for (int64_t k=0; k < nnz; ++k) ++next[row_idx[k]+1];
+    for (int64_t r=0; r < rows; ++r) next[r+1] += next[r];
+    for (int64_t i=0; i < nnz; ++i) order[next[row_idx[by_col[i]]]++] = by_col[i];
+    memset(a->row_ptr, 0, (size_t)(rows+1)*sizeof(*a->row_ptr));
+    int64_t len = 0;
+    for (int64_t i=0; i < nnz; ++i) {
+        int64_t k = order[i], r = row_idx[k];
+        if (len && a->row_ptr[r+1] && a->col_idx[len-1] == col_idx[k]) { /* Duplicates are adjacent and add up in input order. */
+            a->values[len-1] += values[k];
+            continue;
+        }
+        a->col_idx[len] = (int32_t)col_idx[k];
+        a->values[len++] = values[k];
+        ++a->row_ptr[r+1];
+    }
+    for (int64_t r=0; r < rows; ++r)
+        a->row_ptr[r+1] += a->row_ptr[r];
+    a->nnz = len;
+    (*mag_alloc)(next, 0);
+    (*mag_alloc)(order, 0);
+    (*mag_alloc)(by_col, 0);
+    return a;
+}
+
+mag_tensor_t* mag_csr_to_dense(const mag_csr_t* a) {
+    mag_tensor_t* t = mag_tensor_create_2d(a->ctx, MAG_DTYPE_F32, a->rows, a->cols);
+    mag_tensor_fill(t, 0.0f);
+    mag_tensor_sync_host(t);
+    float* x = (float*)t->storage->base;
+    for (int64_t r=0; r < a->rows; ++r)
+        for (int64_t k=a->row_ptr[r]; k < a->row_ptr[r+1]; ++k)
+            x[r*a->cols + a->col_idx[k]] += a->values[k];
+    return t;
+}
+
+void mag_csr_destroy(mag_csr_t* a) {
+    (*mag_alloc)(a->values, 0);
+    (*mag_alloc)(a->col_idx, 0);
+    (*mag_alloc)(a->row_ptr, 0);
+    (*mag_alloc)(a, 0);
+}
+
+int64_t mag_csr_get_rows(const mag_csr_t* a) { return a->rows; }
+int64_t mag_csr_get_cols(const mag_csr_t* a) { return a->cols; }
+int64_t mag_csr_get_nnz(const mag_csr_t* a) { return a->nnz; }
+
+static void mag_csr_mul_host(const mag_csr_t* a, mag_tensor_t* b, mag_tensor_t* r, int64_t n) {
+    mag_compute_device_t* dvc = a->ctx->device;
+    mag_assert(b->ctx == a->ctx, "Sparse and dense operands belong to different contexts");
+    mag_assert(b->dtype == MAG_DTYPE_F32 && mag_tensor_is_contiguous(b), "Dense operand of a sparse product must be a contiguous F32 tensor");
+    mag_assert(dvc->spmm_host, "Sparse products are not supported on %s", dvc->name);
+    mag_tensor_sync_host(b);
+    (*dvc->spmm_host)(dvc, r, a, (const float*)b->storage->base, n);
+}
+
+mag_tensor_t* mag_spmv(const mag_csr_t* a, mag_tensor_t* x) {
+    mag_assert(x->rank == 1 && x->shape[0] == a->cols, "SpMV expects a 1D tensor of %" PRIi64 " elements", a->cols);
+    mag_tensor_t* r = mag_tensor_create_1d(a->ctx, MAG_DTYPE_F32, a->rows);
+    mag_csr_mul_host(a, x, r, 1);
+    return r;
+}
+
+mag_tensor_t* mag_spmm(const mag_csr_t* a, mag_tensor_t* b) {
+    mag_assert(b->rank == 2 && b->shape[0] == a->cols, "SpMM expects a 2D tensor with %" PRIi64 " rows", a->cols);
+    mag_tensor_t* r = mag_tensor_create_2d(a->ctx, MAG_DTYPE_F32, a->rows, b->shape[1]);
+    mag_csr_mul_host(a, b, r, b->shape[1]);
+    return r;
+}
+
+mag_sp24_t* mag_sp24_from_dense(mag_tensor_t* t, bool prune) {
+    mag_assert(t->rank == 2 && t->dtype == MAG_DTYPE_F32 && mag_tensor_is_contiguous(t), "2:4 matrices are built from contiguous 2D F32 tensors");
+    int64_t rows = t->shape[0], cols = t->shape[1];
+    mag_assert((cols & 3) == 0, "2:4 matrices need a multiple of 4 columns, got %" PRIi64, cols);
+    mag_tensor_sync_host(t);
+    const float* x = (const float*)t->storage->base;
+    mag_sp24_t* w = (*mag_alloc)(NULL, sizeof(*w));
+    *w = (mag_sp24_t){.ctx = t->ctx, .rows = rows, .cols = cols, .meta_stride = ((cols>>2) + 1)>>1};
+    w->values = (*mag_alloc)(NULL, (size_t)(rows*(cols>>1))*sizeof(*w->values));
+    w->meta = (*mag_alloc)(NULL, (size_t)(rows*w->meta_stride));
+    memset(w->meta, 0, (size_t)(rows*w->meta_stride));
+    for (int64_t r=0; r < rows; ++r) {
+        for (int64_t g=0; g < cols>>2; ++g) {
+            const float* p = x + r*cols + (g<<2);
+            int i0 = 0, i1 = 1; /* Two largest magnitudes, lower position on ties. */
+            if (fabsf(p[1]) > fabsf(p[0])) i0 = 1, i1 = 0;
+            for (int i=2; i < 4; ++i) {
+                if (fabsf(p[i]) > fabsf(p[i0])) i1 = i0, i0 = i;
+                else if (fabsf(p[i]) > fabsf(p[i1])) i1 = i;
+            }
+            if (i0 > i1) mag_swap(int, i0, i1);
+            if (!prune)
+                for (int i=0; i < 4; ++i)
+                    mag_assert(i == i0 || i == i1 || p[i] == 0.0f, "Row %" PRIi64 ", columns %" PRIi64 "..%" PRIi64 " have more than 2 nonzeros", r, g<<2, (g<<2)+3);
+            float* v = w->values + r*(cols>>1) + (g<<1);
+            v[0] = p[i0];
+            v[1] = p[i1];
+            w->meta[r*w->meta_stride + (g>>1)] |= (uint8_t)((i0 | i1<<2) << ((g&1)<<2));
+        }
+    }
+    return w;
+}
+
+mag_tensor_t* mag_sp24_to_dense(const mag_sp24_t* w) {
+    mag_tensor_t* t = mag_tensor_create_2d(w->ctx, MAG_DTYPE_F32, w->rows, w->cols);
+    mag_tensor_fill(t, 0.0f);
+    mag_tensor_sync_host(t);
+    float* x = (float*)t->storage->base;
+    for (int64_t r=0; r < w->rows; ++r) {
+        for (int64_t g=0; g < w->cols>>2; ++g) {
+            uint32_t nib = (w->meta[r*w->meta_stride + (g>>1)] >> ((g&1)<<2)) & 15;
+            const float* v = w->values + r*(w->cols>>1) + (g<<1);
+            x[r*w->cols + (g<<2) + (nib&3)] = v[0];
+            x[r*w->cols + (g<<2) + (nib>>2)] = v[1];
+        }
+    }
+    return t;
+}
+
+void mag_sp24_destroy(mag_sp24_t* w) {
+    (*mag_alloc)(w->meta, 0);
+    (*mag_alloc)(w->values, 0);
+    (*mag_alloc)(w, 0);
+}
+
+int64_t mag_sp24_get_rows(const mag_sp24_t* w) { return w->rows; }
+int64_t mag_sp24_get_cols(const mag_sp24_t* w) { return w->cols; }
+
+mag_tensor_t* mag_sp24_matmul(const mag_sp24_t* w, mag_tensor_t* x) {
+    mag_compute_device_t* dvc = w->ctx->device;
+    mag_assert(x->ctx == w->ctx, "2:4 and dense operands belong to different contexts");
+    mag_assert((x->rank == 1 || x->rank == 2) && x->shape[0] == w->cols, "2:4 matmul expects a 1D or 2D tensor with %" PRIi64 " rows", w->cols);
+    mag_assert(x->dtype == MAG_DTYPE_F32 && mag_tensor_is_contiguous(x), "Dense operand of a 2:4 matmul must be a contiguous F32 tensor");
+    mag_assert(dvc->sp24_matmul_host, "2:4 matmul is not supported on %s", dvc->name);
+    int64_t n = x->rank == 2 ? x->shape[1] : 1;
+    mag_tensor_t* r = x->rank == 2 ? mag_tensor_create_2d(w->ctx, MAG_DTYPE_F32, w->rows, n) : mag_tensor_create_1d(w->ctx, MAG_DTYPE_F32, w->rows);
+    mag_tensor_sync_host(x);
+    (*dvc->sp24_matmul_host)(dvc, r, w, (const float*)x->storage->base, n);
+    return r;
+}
+
 mag_tensor_t* mag_tensor_load_image(mag_ctx_t* ctx, const char* file, mag_color_channels_t channels, uint32_t resize_w, uint32_t resize_h) {
     uint8_t* (*loader)(const char*, uint32_t(*)[3], mag_color_channels_t) = ctx->image_load_fn;
     void (*load_free)(uint8_t*) = ctx->image_load_free_fn;
@@ -44,6 +44,7 @@ extern "C" {
 typedef enum mag_compute_device_type_t {
     MAG_COMPUTE_DEVICE_TYPE_CPU = 0, /* CPU compute device */
     MAG_COMPUTE_DEVICE_TYPE_GPU_CUDA = 1,  /* CUDA GPU compute device */
+    MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM = 2, /* Asynchronous CPU device, ops run in order on a submission thread */
 
     MAG_COMPUTE_DEVICE_TYPE__NUM
 } mag_compute_device_type_t;
@@ -56,6 +57,43 @@ typedef enum mag_exec_mode_t {
     MAG_EXEC_MODE__NUM
 } mag_exec_mode_t;
 
+/*
+** Accuracy of transcendental functions (exp, log, sin, cos, tanh, sigmoid, silu, gelu) on the CPU.
+** Both variants are compiled into every BLAS specialization and can be switched at runtime per context.
+** Max. error over all float32 inputs in range, measured against a double precision reference (x86-64 SSE2, AVX2 and AVX-512 specializations):
+**  +-----------+----------------------+-------------------------------------------------------+
+**  | Function  | PRECISE (libm)       | APPROX (SIMD polynomials)                             |
+**  +-----------+----------------------+-------------------------------------------------------+
+**  | exp       | 0.5 ULP              | 2.2 ULP, x in [-87.3, 88.3]                           |
+**  | log       | 0.9 ULP              | 0.9 ULP, x > 0 (NaN for x <= 0)                       |
+**  | sin, cos  | 0.6 ULP              | 1.5 ULP for |x| <= 100, 8e-8 abs. for |x| <= 8192      |
+**  | tanh      | 2.2 ULP              | 3.1e-7 abs. (relative error is unbounded near 0)      |
+**  | sigmoid   | 2.4 ULP              | 3.8 ULP                                               |
+**  | silu      | 2.3 ULP              | 3.9 ULP                                               |
+**  | gelu      | 4.4e-7 abs.          | 9.6e-7 abs.                                           |
+**  +-----------+----------------------+-------------------------------------------------------+
+** Specializations without a SIMD approximation for a function (e.g. log, sin, cos with AVX2/AVX-512) use libm in both modes.
+*/
+typedef enum mag_math_mode_t {
+    MAG_MATH_MODE_PRECISE = 0,      /* Use libm, accurate to ~1 ULP. */
+    MAG_MATH_MODE_APPROX = 1,       /* Use SIMD approximations. Much faster, slightly less accurate. */
+
+    MAG_MATH_MODE__NUM
+} mag_math_mode_t;
+
+/*
+** When storage of dead tensors is released. The deferred modes queue released storage and free it in batches,
+** which keeps bursts of frees (e.g. tearing down a graph after a training step) off the critical path.
+** Freed CPU buffers go into a bounded buffer cache first and are only returned to the OS when it is full.
+*/
+typedef enum mag_free_mode_t {
+    MAG_FREE_MODE_IMMEDIATE = 0,    /* Free storage as soon as the last tensor referencing it dies. */
+    MAG_FREE_MODE_DEFERRED = 1,     /* Queue storage, a full queue frees a few of its oldest entries per release, the rest on mag_ctx_reclaim. */
+    MAG_FREE_MODE_BACKGROUND = 2,   /* Like deferred, and buffers that do not fit into the cache are returned to the OS by a background thread. */
+
+    MAG_FREE_MODE__NUM
+} mag_free_mode_t;
+
 typedef enum mag_prng_algorithm_t {
     MAG_PRNG_MERSENNE_TWISTER = 0,  /* Mersenne Twister PRNG */
     MAG_PRNG_PCG = 1,               /* Permuted Congruential Generator PRNG */
@@ -90,14 +128,60 @@ typedef struct mag_ctx_t mag_ctx_t; /* Opaque context type for managing memory p
 
 typedef struct mag_device_descriptor_t {
     mag_compute_device_type_t type; /* Device type */
-    uint32_t thread_count;   /* Number of threads if type == MAG_COMPUTE_DEVICE_TYPE_CPU. If set to 0, hardware concurrency of host CPU is detected. */
+    uint32_t thread_count;   /* Number of threads if type == MAG_COMPUTE_DEVICE_TYPE_CPU or MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM. If set to 0, hardware concurrency of host CPU is detected. */
     uint32_t cuda_device_id; /* CUDA device ID if type == MAG_COMPUTE_DEVICE_TYPE_GPU_CUDA. Default: 0 (first GPU). */
+    uint64_t stream_threshold; /* Output size in bytes above which CPU element-wise kernels use non-temporal stores. If set to 0, the last level cache size is used. */
 } mag_device_descriptor_t;
 
+typedef struct mag_storage_stats_t {
+    uint64_t num_allocs;        /* Storage buffers allocated. */
+    uint64_t num_frees;         /* Storage buffers freed. */
+    uint64_t bytes_live;        /* Bytes of live storage buffers. */
+    uint64_t bytes_peak;        /* Peak of bytes_live. */
+    uint64_t bytes_reserved;    /* Bytes held by the allocator, reported by its stats callback. 0 if unknown. */
+} mag_storage_stats_t;
+
+/*
+** Allocator for the tensor storage of one context, e.g. a jemalloc or mimalloc arena, huge pages or pinned memory.
+** Everything else (contexts, tensor headers, graphs) still goes through the global allocator set by mag_set_alloc_fn.
+** The CPU device bypasses its slab and buffer cache for custom allocators, so they see every storage buffer.
+*/
+typedef struct mag_storage_allocator_t {
+    void* (*alloc)(void* ud, size_t size, size_t align);    /* Allocate size bytes aligned to align (power of two). Must not return NULL. */
+    void (*free)(void* ud, void* blk, size_t size);         /* Free a block returned by alloc, size is the requested size. */
+    void (*stats)(void* ud, mag_storage_stats_t* out);      /* Optional, fill allocator specific statistics like bytes_reserved. */
+    void* ud;                                               /* User data passed to every callback. */
+} mag_storage_allocator_t;
+
 extern MAG_EXPORT mag_ctx_t* mag_ctx_create(mag_compute_device_type_t device); /* Create context with default config, and only specify device type. */
 extern MAG_EXPORT mag_ctx_t* mag_ctx_create2(const mag_device_descriptor_t* device_info); /* Create context with customized device config, and only specify device type. */
 extern MAG_EXPORT mag_exec_mode_t mag_ctx_get_exec_mode(const mag_ctx_t* ctx); /* Get execution mode */
 extern MAG_EXPORT void mag_ctx_set_exec_mode(mag_ctx_t* ctx, mag_exec_mode_t mode); /* Set execution mode */
+extern MAG_EXPORT mag_math_mode_t mag_ctx_get_math_mode(const mag_ctx_t* ctx); /* Get accuracy mode of transcendental functions */
+extern MAG_EXPORT void mag_ctx_set_math_mode(mag_ctx_t* ctx, mag_math_mode_t mode); /* Set accuracy mode of transcendental functions, not allowed in concurrent mode */
+extern MAG_EXPORT bool mag_ctx_is_concurrent(const mag_ctx_t* ctx); /* Check if several threads may use the context */
+extern MAG_EXPORT void mag_ctx_set_concurrent(mag_ctx_t* ctx, bool concurrent); /* Allow tensor creation and eager ops from several threads, toggle from the creating thread only */
+extern MAG_EXPORT mag_free_mode_t mag_ctx_get_free_mode(const mag_ctx_t* ctx); /* Get when storage of dead tensors is released */
+extern MAG_EXPORT void mag_ctx_set_free_mode(mag_ctx_t* ctx, mag_free_mode_t mode); /* Set when storage of dead tensors is released, switching to immediate reclaims the queue */
+extern MAG_EXPORT void mag_ctx_reclaim(mag_ctx_t* ctx); /* Free all storage queued by the deferred free modes */
+
+/*
+** Asynchronous devices queue ops, memsets and host to device copies and return before they ran. Device to host copies, tensor data
+** pointers, printing and serialization wait for the queue. An event marks the end of the queue when it is recorded.
+** Synchronous devices finish every op before returning, their events are always complete.
+*/
+typedef uint64_t mag_event_t;
+
+extern MAG_EXPORT bool mag_ctx_is_async(const mag_ctx_t* ctx); /* Check if the compute device runs ops asynchronously */
+extern MAG_EXPORT void mag_ctx_synchronize(mag_ctx_t* ctx); /* Wait until the device finished all submitted work */
+extern MAG_EXPORT mag_event_t mag_ctx_record_event(mag_ctx_t* ctx); /* Record an event after the work submitted so far */
+extern MAG_EXPORT bool mag_ctx_query_event(mag_ctx_t* ctx, mag_event_t ev); /* Check if the work before the event completed, without blocking */
+extern MAG_EXPORT void mag_ctx_wait_event(mag_ctx_t* ctx, mag_event_t ev); /* Wait until the work before the event completed */
+extern MAG_EXPORT void mag_ctx_get_storage_allocator(const mag_ctx_t* ctx, mag_storage_allocator_t* out); /* Get allocator for tensor storage */
+extern MAG_EXPORT void mag_ctx_set_storage_allocator(mag_ctx_t* ctx, const mag_storage_allocator_t* allocator); /* Set allocator for tensor storage, NULL restores the default. Only while the context holds no storage */
+extern MAG_EXPORT void mag_ctx_get_storage_stats(const mag_ctx_t* ctx, mag_storage_stats_t* out); /* Get tensor storage statistics */
+extern MAG_EXPORT bool mag_ctx_get_atomic_refcount(const mag_ctx_t* ctx); /* Check if new tensors get atomic reference counts */
+extern MAG_EXPORT void mag_ctx_set_atomic_refcount(mag_ctx_t* ctx, bool atomic); /* Give new tensors atomic reference counts, enabled by concurrent mode */
 extern MAG_EXPORT mag_prng_algorithm_t mag_ctx_get_prng_algorithm(const mag_ctx_t* ctx); /* Get PRNG algorithm */
 extern MAG_EXPORT void mag_ctx_set_prng_algorithm(mag_ctx_t* ctx, mag_prng_algorithm_t algorithm, uint64_t seed); /* Set PRNG algorithm */
 extern MAG_EXPORT mag_compute_device_type_t mag_ctx_get_compute_device_type(const mag_ctx_t* ctx); /* Get compute device type */
@@ -109,6 +193,9 @@ extern MAG_EXPORT uint32_t mag_ctx_get_cpu_physical_cores(const mag_ctx_t* ctx);
 extern MAG_EXPORT uint32_t mag_ctx_get_cpu_sockets(const mag_ctx_t* ctx); /* Get the number of CPU sockets */
 extern MAG_EXPORT uint64_t mag_ctx_get_physical_memory_total(const mag_ctx_t* ctx); /* Get the total physical memory in bytes */
 extern MAG_EXPORT uint64_t mag_ctx_get_physical_memory_free(const mag_ctx_t* ctx); /* Get the free physical memory in bytes */
+extern MAG_EXPORT uint64_t mag_ctx_get_cpu_cache_size(const mag_ctx_t* ctx, uint32_t level); /* Get the size in bytes of the data/unified CPU cache at level (1 = L1D, 2 = L2, ...). 0 if not present or unknown */
+extern MAG_EXPORT uint32_t mag_ctx_get_cpu_cache_line_size(const mag_ctx_t* ctx, uint32_t level); /* Get the line size in bytes of the CPU cache at level. 0 if unknown */
+extern MAG_EXPORT uint32_t mag_ctx_get_cpu_cache_shared_by(const mag_ctx_t* ctx, uint32_t level); /* Get the number of logical CPUs sharing one instance of the CPU cache at level. 0 if unknown */
 extern MAG_EXPORT bool mag_ctx_is_numa_system(const mag_ctx_t* ctx); /* Check if the system is NUMA */
 extern MAG_EXPORT size_t mag_ctx_get_total_tensors_created(const mag_ctx_t* ctx); /* Get total tensors created. (Including views) */
 extern MAG_EXPORT void mag_ctx_profile_start_recording(mag_ctx_t* ctx); /* Start profiling */
@@ -294,6 +381,139 @@ extern MAG_EXPORT mag_tensor_t* mag_divs(mag_tensor_t* x, float xi);
 extern MAG_EXPORT mag_tensor_t* mag_divs_(mag_tensor_t* x, float xi);
 extern MAG_EXPORT mag_tensor_t* mag_matmul(mag_tensor_t* a, mag_tensor_t* b);
 
+/*
+** Out variants write the result into an existing tensor instead of allocating a new one, so steady-state loops run allocation-free.
+** out must have the result shape and dtype, be contiguous and mutable and belong to the same context. It may alias an input,
+** except for matmul. out then holds the op as its producer in place of any previous one. Returns out (no new reference), or NULL if validation fails.
+*/
+extern MAG_EXPORT mag_tensor_t* mag_clone_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_mean_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_min_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_max_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_sum_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_abs_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_neg_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_log_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_sqr_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_sqrt_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_sin_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_cos_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_step_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_softmax_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_softmax_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_sigmoid_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_sigmoid_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_hard_sigmoid_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_silu_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_silu_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_tanh_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_tanh_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_relu_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_relu_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_gelu_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_gelu_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_add_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_sub_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_mul_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_div_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_adds_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_subs_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_muls_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_divs_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern MAG_EXPORT mag_tensor_t* mag_matmul_out(mag_tensor_t* a, mag_tensor_t* b, mag_tensor_t* out);
+
+/*
+** Graph capture: ops run between mag_ctx_begin_capture and mag_ctx_end_capture are recorded into a plan, which retains their
+** results as fixed buffers. Replay re-runs the recorded kernels in order, skipping validation, allocation and result construction.
+** Only ops are recorded. Tensor creation, fills and copies are not, so feed new inputs by writing into them or with mag_plan_bind.
+** mag_plan_optimize treats frozen tensors as constants and evaluates ops on them once. It forwards x+0, x-0, x*1, x/1 and (xᵀ)ᵀ to x,
+** merges ops with equal inputs and parameters, and drops ops whose results nothing else references. Consumers of a merged or forwarded op
+** read the surviving tensor, so optimize before binding inputs, and keep a reference to any result you read after replay.
+** Element-wise ops whose input is a dead intermediate write into the input's buffer instead of their own, which changes their data pointer.
+*/
+typedef struct mag_plan_t mag_plan_t;
+
+extern MAG_EXPORT void mag_ctx_begin_capture(mag_ctx_t* ctx); /* Start recording ops into a new plan */
+extern MAG_EXPORT mag_plan_t* mag_ctx_end_capture(mag_ctx_t* ctx); /* Stop recording and return the plan, which must be destroyed before the context */
+extern MAG_EXPORT bool mag_ctx_is_capturing(const mag_ctx_t* ctx); /* Check if ops are being recorded */
+extern MAG_EXPORT size_t mag_plan_get_num_nodes(const mag_plan_t* plan); /* Get the number of recorded ops */
+extern MAG_EXPORT size_t mag_plan_get_num_outputs(const mag_plan_t* plan); /* Get the number of graph outputs, zero for captured plans */
+extern MAG_EXPORT mag_tensor_t* mag_plan_get_output(const mag_plan_t* plan, size_t idx); /* Get graph output, the reference is owned by the plan */
+extern MAG_EXPORT mag_tensor_t* mag_plan_find_tensor(const mag_plan_t* plan, const char* name); /* Find an input or result of the plan by name, NULL if none. The reference is owned by the plan */
+extern MAG_EXPORT void mag_plan_bind(mag_plan_t* plan, mag_tensor_t* handle, mag_tensor_t* input); /* Replace the captured input tensor handle by input, which must have the same shape and dtype */
+extern MAG_EXPORT void mag_plan_replay(mag_plan_t* plan); /* Re-run all recorded ops */
+extern MAG_EXPORT size_t mag_plan_optimize(mag_plan_t* plan); /* Fold constants, simplify, merge duplicate and drop unused ops, returns the number of removed ops. See below */
+extern MAG_EXPORT void mag_plan_destroy(mag_plan_t* plan); /* Release the plan and the tensors it retains */
+
+/*
+** Graph files: the op graph computing the given outputs is saved together with the data of its leaf tensors (weights and inputs).
+** Loading maps the file, rebuilds the ops without running them and returns them as a plan. Fill the inputs (see mag_plan_find_tensor) and replay.
+*/
+extern MAG_EXPORT void mag_graph_save(mag_tensor_t** outputs, size_t num_outputs, const char* file); /* Save graph and leaf data to magnetron binary file */
+extern MAG_EXPORT mag_plan_t* mag_graph_load(mag_ctx_t* ctx, const char* file); /* Load graph from magnetron binary file as plan, NULL if the graph section is corrupt */
+
+/*
+** Data-parallel training in several processes on one host, without network services. The ranks exchange tensors through a POSIX
+** shared memory segment and meet at futex barriers. Every rank must issue the same collectives in the same order, on F32 tensors
+** of equal size. mag_comm_all_reduce_start queues a reduction on a background thread and returns, so gradients of later layers
+** reduce while the backward pass of earlier ones runs. Do not touch a started tensor before mag_comm_wait returns.
+*/
+typedef struct mag_comm_t mag_comm_t;
+
+extern MAG_EXPORT mag_comm_t* mag_comm_create(mag_ctx_t* ctx, const char* name, uint64_t session, uint32_t rank, uint32_t world_size, size_t slot_size); /* Join the group called name, waits for all ranks. session must be the same on all ranks and new for every launch, e.g. the launcher's pid. slot_size is the bytes reduced per step, 0 for the default */
+extern MAG_EXPORT void mag_comm_destroy(mag_comm_t* comm); /* Wait for started reductions and leave the group */
+extern MAG_EXPORT uint32_t mag_comm_get_rank(const mag_comm_t* comm); /* Get rank of this process */
+extern MAG_EXPORT uint32_t mag_comm_get_world_size(const mag_comm_t* comm); /* Get number of ranks */
+extern MAG_EXPORT void mag_comm_barrier(mag_comm_t* comm); /* Wait until all ranks arrived */
+extern MAG_EXPORT void mag_comm_all_reduce(mag_comm_t* comm, mag_tensor_t* t, bool average); /* Sum t over all ranks in place, divided by the world size if average */
+extern MAG_EXPORT void mag_comm_all_reduce_start(mag_comm_t* comm, mag_tensor_t* t, bool average); /* Start mag_comm_all_reduce in the background */
+extern MAG_EXPORT void mag_comm_wait(mag_comm_t* comm); /* Wait for all started reductions */
+
+/*
+** Dynamic batching for inference serving. The plan computes a batch of outputs from a 2D F32 input, in_dim and out_dim are the
+** dimensions which index the samples. Threads call mag_batcher_infer with one sample each. A scheduler thread gathers queued samples
+** until the batch is full or the oldest one waited timeout_us, replays the plan once and scatters the results.
+** Only the scheduler thread replays the plan while the batcher lives.
+*/
+#define MAG_BATCHER_MAX_BATCH 1024
+typedef struct mag_batcher_t mag_batcher_t;
+
+extern MAG_EXPORT mag_batcher_t* mag_batcher_create(mag_plan_t* plan, mag_tensor_t* input, int64_t in_dim, mag_tensor_t* output, int64_t out_dim, uint64_t timeout_us); /* Start the scheduler thread */
+extern MAG_EXPORT void mag_batcher_destroy(mag_batcher_t* b); /* Finish queued samples and stop. Does not destroy the plan */
+extern MAG_EXPORT void mag_batcher_infer(mag_batcher_t* b, const float* x, float* y); /* Queue sample x, wait and write its output into y. Thread-safe */
+extern MAG_EXPORT void mag_batcher_get_stats(mag_batcher_t* b, uint64_t* num_requests, uint64_t* num_batches); /* Get samples and batches run so far */
+
+/*
+** Sparse matrices in CSR format (compressed sparse rows). Only nonzeros are stored, so memory and the cost of products
+** grow with the number of nonzeros (nnz) instead of rows x cols. The matrix lives in host memory of the context.
+** Products take and return dense row-major F32 tensors and run on the CPU devices.
+*/
+typedef struct mag_csr_t mag_csr_t;
+
+extern MAG_EXPORT mag_csr_t* mag_csr_from_dense(mag_tensor_t* t); /* Compress a contiguous 2D F32 tensor, dropping zeros */
+extern MAG_EXPORT mag_csr_t* mag_csr_from_coo(mag_ctx_t* ctx, int64_t rows, int64_t cols, int64_t nnz, const int64_t* row_idx, const int64_t* col_idx, const float* values); /* Build from coordinate lists in any order. Duplicates add up into one entry, columns are sorted within each row */
+extern MAG_EXPORT mag_tensor_t* mag_csr_to_dense(const mag_csr_t* a); /* Expand into a new 2D tensor */
+extern MAG_EXPORT void mag_csr_destroy(mag_csr_t* a);
+extern MAG_EXPORT int64_t mag_csr_get_rows(const mag_csr_t* a);
+extern MAG_EXPORT int64_t mag_csr_get_cols(const mag_csr_t* a);
+extern MAG_EXPORT int64_t mag_csr_get_nnz(const mag_csr_t* a);
+extern MAG_EXPORT mag_tensor_t* mag_spmv(const mag_csr_t* a, mag_tensor_t* x); /* a x x for a 1D tensor x of a's columns */
+extern MAG_EXPORT mag_tensor_t* mag_spmm(const mag_csr_t* a, mag_tensor_t* b); /* a x b for a 2D tensor b with a's columns as rows */
+
+/*
+** Weight matrices with 2:4 structured sparsity: at most 2 nonzeros in every group of 4 consecutive columns of a row.
+** Only the 2 kept values and their 2-bit positions are stored, so the matrix takes a little over half the bytes of the dense one.
+** Products expand the groups in registers, weight-bound products read about half the memory.
+*/
+typedef struct mag_sp24_t mag_sp24_t;
+
+extern MAG_EXPORT mag_sp24_t* mag_sp24_from_dense(mag_tensor_t* t, bool prune); /* Compress a contiguous 2D F32 tensor with a multiple of 4 columns. If prune, keeps the 2 largest magnitudes per group, else the tensor must already be 2:4 sparse */
+extern MAG_EXPORT mag_tensor_t* mag_sp24_to_dense(const mag_sp24_t* w); /* Expand into a new 2D tensor */
+extern MAG_EXPORT void mag_sp24_destroy(mag_sp24_t* w);
+extern MAG_EXPORT int64_t mag_sp24_get_rows(const mag_sp24_t* w);
+extern MAG_EXPORT int64_t mag_sp24_get_cols(const mag_sp24_t* w);
+extern MAG_EXPORT mag_tensor_t* mag_sp24_matmul(const mag_sp24_t* w, mag_tensor_t* x); /* w x x for a 1D tensor or a 2D tensor with w's columns as rows */
+
 /**
  * @brief Increment reference count of tensor.
  *      Increment the strong reference count of the tensor. The tensor is not destroyed until the strong reference count reaches zero.
@@ -322,6 +542,12 @@ extern MAG_EXPORT void mag_tensor_fill_random_normal(mag_tensor_t* t, float mean
 
 extern MAG_EXPORT uint64_t mag_tensor_get_packed_refcounts(const mag_tensor_t* t); /* Return strong refcount is loword, weak refcount is hiword. */
 extern MAG_EXPORT void mag_tensor_retain(mag_tensor_t* t); /* Increment refcount */
+extern MAG_EXPORT bool mag_tensor_consume(mag_tensor_t* t); /* Hand the caller's reference to the next op t is passed to, which releases it. If it was the last reference, an element-wise op writes its result into t's buffer and returns t. False outside eager mode, where nothing changes */
+extern MAG_EXPORT void mag_tensor_freeze(mag_tensor_t* t); /* Make tensor data immutable and shareable across contexts, call before creating views of it */
+extern MAG_EXPORT bool mag_tensor_is_frozen(const mag_tensor_t* t); /* Check if tensor data is immutable */
+extern MAG_EXPORT void mag_tensor_set_atomic_refcount(mag_tensor_t* t); /* Make the refcount of a tensor atomic so it can be handed between threads, call before creating views of it */
+extern MAG_EXPORT bool mag_tensor_has_atomic_refcount(const mag_tensor_t* t); /* Check if the tensor refcount is atomic */
+extern MAG_EXPORT mag_tensor_t* mag_tensor_share(mag_ctx_t* ctx, mag_tensor_t* src); /* Create a copy-free view of a frozen tensor inside another context. Destroying the source context while such views live panics. */
 extern MAG_EXPORT size_t mag_tensor_get_memory_usage(const mag_tensor_t* t); /* Return memory used by this tensor in bytes. */
 extern MAG_EXPORT void mag_tensor_print(const mag_tensor_t* t, bool with_header, bool with_data); /* Print tensor info (with or without data) */
 extern MAG_EXPORT void mag_tensor_set_name(mag_tensor_t* t, const char* name); /* Set the name of the tensor */
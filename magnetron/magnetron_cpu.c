@@ -4,19 +4,22 @@
 
 #include <math.h>
 
-extern void mag_cpu_blas_specialization_fallback(mag_kernel_registry_t* kernels); /* Generic any CPU impl */
+/* Fills the kernel registry with a BLAS specialization. Called at boot and whenever the math mode changes. */
+typedef void (mag_cpu_blas_inject_fn)(mag_kernel_registry_t* kernels, mag_math_mode_t mode);
+
+extern void mag_cpu_blas_specialization_fallback(mag_kernel_registry_t* kernels, mag_math_mode_t mode); /* Generic any CPU impl */
 
 #if defined(__x86_64__) || defined(_M_X64) /* Specialized impls for x86-64 with runtime CPU detection */
 
 typedef struct mag_amd64_blas_specialization {
     const char* name;
     uint64_t (*get_feature_permutation)(void);
-    void (*inject_kernels)(mag_kernel_registry_t* kernels);
+    mag_cpu_blas_inject_fn* inject_kernels;
 } mag_amd64_blas_specialization;
 
 #define mag_amd64_blas_spec_decl(feat) \
     uint64_t mag_cpu_blas_specialization_amd64_v##feat##_features(void); \
-    extern void mag_cpu_blas_specialization_amd64_v##feat(mag_kernel_registry_t* kernels)
+    extern void mag_cpu_blas_specialization_amd64_v##feat(mag_kernel_registry_t* kernels, mag_math_mode_t mode)
 
 #define mag_amd64_blas_spec_permute(feat) \
     (mag_amd64_blas_specialization) { \
@@ -31,7 +34,7 @@ mag_amd64_blas_spec_decl(3);
 mag_amd64_blas_spec_decl(2_5);
 mag_amd64_blas_spec_decl(2);
 
-static bool mag_blas_detect_gen_optimal_spec(const mag_ctx_t* ctx, mag_kernel_registry_t* kernels) {
+static mag_cpu_blas_inject_fn* mag_blas_detect_gen_optimal_spec(const mag_ctx_t* ctx) {
     const mag_amd64_blas_specialization mag_amd64_blas_specializations[] = { /* Dynamic selectable BLAS permutations, sorted from best to worst score. */
         mag_amd64_blas_spec_permute(4_5),
         mag_amd64_blas_spec_permute(4),
@@ -45,15 +48,13 @@ static bool mag_blas_detect_gen_optimal_spec(const mag_ctx_t* ctx, mag_kernel_re
         const mag_amd64_blas_specialization* spec = mag_amd64_blas_specializations+i;
         uint64_t cap_required = (*spec->get_feature_permutation)(); /* Get requires features */
         if ((cap_avail & cap_required) == cap_required) { /* Since specializations are sorted by score, we found the perfect spec. */
-            (*spec->inject_kernels)(kernels);
             mag_log_info("Using tuned BLAS specialization: %s", spec->name);
-            return true;
+            return spec->inject_kernels;
         }
     }
     /* No matching specialization found, use generic */
-    mag_cpu_blas_specialization_fallback(kernels);
     mag_log_info("Using fallback BLAS specialization");
-    return false; /* No spec used, fallback is active */
+    return &mag_cpu_blas_specialization_fallback; /* No spec used, fallback is active */
 }
 
 #undef mag_amd64_blas_spec_permute
@@ -64,12 +65,12 @@ static bool mag_blas_detect_gen_optimal_spec(const mag_ctx_t* ctx, mag_kernel_re
 typedef struct mag_arm64_blas_specialization {
     const char* name;
     uint64_t (*get_cap_permutation)(void);
-    void (*inject_kernels)(mag_kernel_registry_t* kernels);
+    mag_cpu_blas_inject_fn* inject_kernels;
 } mag_arm64_blas_specialization;
 
 #define mag_arm64_blas_spec_decl(feat) \
     uint64_t mag_cpu_blas_specialization_arm64_v_##feat##_features(void); \
-    extern void mag_cpu_blas_specialization_arm64_v_##feat(mag_kernel_registry_t* kernels)
+    extern void mag_cpu_blas_specialization_arm64_v_##feat(mag_kernel_registry_t* kernels, mag_math_mode_t mode)
 
 #define mag_arm64_blas_spec_permute(feat) \
     (mag_arm64_blas_specialization) { \
@@ -81,7 +82,7 @@ typedef struct mag_arm64_blas_specialization {
 mag_arm64_blas_spec_decl(9);
 mag_arm64_blas_spec_decl(8_2);
 
-static bool mag_blas_detect_gen_optimal_spec(const mag_ctx_t* ctx, mag_kernel_registry_t* kernels) {
+static mag_cpu_blas_inject_fn* mag_blas_detect_gen_optimal_spec(const mag_ctx_t* ctx) {
     const mag_arm64_blas_specialization mag_arm64_blas_specializations[] = { /* Dynamic selectable BLAS permutations, sorted from best to worst score. */
         mag_arm64_blas_spec_permute(9),
         mag_arm64_blas_spec_permute(8_2),
@@ -92,25 +93,25 @@ static bool mag_blas_detect_gen_optimal_spec(const mag_ctx_t* ctx, mag_kernel_re
         const mag_arm64_blas_specialization* spec = mag_arm64_blas_specializations+i;
         uint64_t cap_required = (*spec->get_cap_permutation)(); /* Get requires features */
         if ((cap_avail & cap_required) == cap_required) { /* Since specializations are sorted by score, we found the perfect spec. */
-            (*spec->inject_kernels)(kernels);
             mag_log_info("Using tuned BLAS specialization: %s", spec->name);
-            return true;
+            return spec->inject_kernels;
         }
     }
     /* No matching specialization found, use generic */
-    mag_cpu_blas_specialization_fallback(kernels);
     mag_log_info("Using fallback BLAS specialization");
-    return false; /* No spec used, fallback is active */
+    return &mag_cpu_blas_specialization_fallback; /* No spec used, fallback is active */
 }
 
 #undef mag_cpu_blas_spec_decl
 
 #endif
 
-static bool mag_blas_detect_optimal_specialization(const mag_ctx_t* ctx, mag_kernel_registry_t* kernels) {
-    if (mag_likely(mag_blas_detect_gen_optimal_spec(ctx, kernels))) return true;
-    mag_cpu_blas_specialization_fallback(kernels);
-    return false; /* No spec used, fallback is active */
+static mag_cpu_blas_inject_fn* mag_blas_detect_optimal_specialization(const mag_ctx_t* ctx) {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__) || defined(_M_ARM64)
+    return mag_blas_detect_gen_optimal_spec(ctx);
+#else
+    return &mag_cpu_blas_specialization_fallback; /* No specializations for this arch */
+#endif
 }
 
 typedef struct mag_cpu_op_info_t {
@@ -184,11 +185,42 @@ struct mag_worker_t {
     mag_thread_t thread;                    /* Thread handle */
 } mag_alignas(MAG_CACHE_LINE_SIZE);
 
+/*
+** Cache for storage buffers above the slab size. Each power of two is split into 4 size classes, freed buffers
+** are chained through their first word into one list per class. Only filled while a deferred free mode is active.
+*/
+#define MAG_CPU_BUF_CACHE_MIN_LG 8 /* log2 of MAG_CPU_SMALL_BUF_SIZE. */
+#define MAG_CPU_BUF_CACHE_MAX_LG 26 /* Buffers up to 64 MiB are cached. */
+#define MAG_CPU_BUF_CACHE_BINS ((MAG_CPU_BUF_CACHE_MAX_LG-MAG_CPU_BUF_CACHE_MIN_LG)*4)
+#define MAG_CPU_BUF_CACHE_CAP (256ull<<20) /* Max bytes held in the bins, the rest goes back to the OS. */
+
+typedef struct mag_cpu_buf_cache_t {
+    void* bins[MAG_CPU_BUF_CACHE_BINS]; /* Free lists per size class. */
+    size_t bytes;                       /* Bytes held in the bins. */
+    bool enabled;                       /* Freed buffers are kept, set by a deferred free mode. */
+    bool concurrent;                    /* Bins, enabled and reclaimer_online are guarded by the lock. */
+    volatile mag_atomic_t lock;
+    bool reclaimer_online;              /* Background thread returns evicted buffers to the OS. */
+    bool reclaimer_stop;
+    void* reclaim_list;                 /* Buffers waiting for the background thread. */
+    mag_thread_t reclaimer;
+    mag_mutex_t reclaim_mtx;
+    mag_cond_var_t reclaim_cv;
+} mag_cpu_buf_cache_t;
+
+typedef struct mag_cpu_stream_t mag_cpu_stream_t;
+
 typedef struct mag_cpu_device_t {
     mag_ctx_t* ctx;
-    mag_threadpool_t* pool;             /* Thread pool. NULL if num_allocated_workers <= 1 */
+    mag_threadpool_t* pool;             /* Thread pool. Created lazily by the first parallel op, NULL until then and if num_allocated_workers <= 1 */
     uint32_t num_allocated_workers;     /* Amount of worker thread used. if == 1 then single threaded mode and thread pool is not created */
+    mag_thread_sched_prio_t sched_prio; /* Scheduling priority of the workers */
     mag_kernel_registry_t kernels;      /* Compute kernels. Specialized by arch optimized version at boot (e.g. AVX, AVX512 etc..) */
+    mag_cpu_blas_inject_fn* inject_kernels; /* Selected BLAS specialization, re-injected when the math mode changes. */
+    mag_fixed_intrusive_pool small_bufs; /* Slab for small storage buffers (scalars, reduction results, small biases). */
+    volatile mag_atomic_t pool_busy;    /* Held while a parallel op runs on the pool, concurrent callers then compute inline. */
+    mag_cpu_buf_cache_t buf_cache;      /* Recycled storage buffers above the slab size. */
+    mag_cpu_stream_t* stream;           /* Command queue of the asynchronous device, NULL for the synchronous one. */
 } mag_cpu_device_t;
 
 /* Await signal to start work */
@@ -208,7 +240,8 @@ static bool mag_worker_await_work(mag_worker_t* worker, mag_threadpool_t* pool)
 /* Execute the operation on the current thread */
 static void mag_worker_exec_thread_local(const mag_kernel_registry_t* kernels, mag_compute_payload_t* payload) {
     if (mag_likely(payload->node)) { /* Do the work 🦾 */
-        (*kernels->fwd[payload->node->op])(payload);
+        const mag_kernel_plan_t* kp = payload->kplan;
+        (*(kp && kp->fn ? kp->fn : kernels->fwd[payload->node->op]))(payload);
         payload->node = NULL;
     }
 }
@@ -262,7 +295,7 @@ static mag_threadpool_t* mag_threadpool_create(uint32_t num_workers, const mag_k
     for (uint32_t ti=0; ti < num_workers; ++ti) { /* Initialize workers */
         workers[ti] = (mag_worker_t){
             .phase = 0,
-            .payload = (mag_compute_payload_t){.thread_num = num_workers, .thread_idx = ti, .node = NULL, },
+            .payload = (mag_compute_payload_t){.thread_num = num_workers, .thread_idx = ti, .node = NULL, .kplan = NULL, .kernels = kernels},
             .pool = pool,
             .is_async = ti != 0 /* Main thread is worker but without thread */
         };
@@ -293,12 +326,13 @@ static void mag_threadpool_destroy(mag_threadpool_t* pool) {
 }
 
 /* Submits work payload and awakens all threads */
-static void mag_threadpool_kickoff(mag_threadpool_t* pool, mag_tensor_t* node, uint32_t num_active_workers) {
+static void mag_threadpool_kickoff(mag_threadpool_t* pool, mag_tensor_t* node, const mag_kernel_plan_t* kp, uint32_t num_active_workers) {
     mag_mutex_lock(&pool->mtx);
     pool->num_active_workers = num_active_workers;
     for (uint32_t i=0; i < pool->num_allocated_workers; ++i) { /* Set up payload */
         mag_compute_payload_t* payload = &pool->workers[i].payload;
         payload->node = node;
+        payload->kplan = kp;
         payload->thread_num = num_active_workers;
     }
     ++pool->phase;
@@ -312,16 +346,16 @@ static void mag_threadpool_barrier(mag_threadpool_t* pool) {
     while (pool->num_completed != pool->num_allocated_workers) /* Wait for all workers to finish */
         mag_cv_wait(&pool->cv, &pool->mtx);
     #ifdef MAG_DEBUG
-        for (uint32_t i=0; i < pool->num_workers; ++i) /* Verify phases executed */
+        for (uint32_t i=0; i < pool->num_allocated_workers; ++i) /* Verify phases executed */
             mag_assert2(pool->workers[i].phase == pool->phase);
     #endif
     mag_mutex_unlock(&pool->mtx);
 }
 
 /* Execute an operator tensor on the CPU */
-static MAG_HOTPROC void mag_threadpool_parallel_compute(mag_threadpool_t* pool, mag_tensor_t* node, uint32_t num_active_workers) {
+static MAG_HOTPROC void mag_threadpool_parallel_compute(mag_threadpool_t* pool, mag_tensor_t* node, const mag_kernel_plan_t* kp, uint32_t num_active_workers) {
     mag_assert2(pool != NULL);
-    mag_threadpool_kickoff(pool, node, num_active_workers);                         /* Kick off workers */
+    mag_threadpool_kickoff(pool, node, kp, num_active_workers);                     /* Kick off workers */
     mag_cv_broadcast(&pool->cv);                                  /* Wake up all workers */
     mag_worker_exec_and_broadcast(pool, pool->kernels, &pool->workers->payload);    /* Main thread does work too */
     mag_threadpool_barrier(pool);                                                   /* Wait for all workers to finish */
@@ -329,19 +363,32 @@ static MAG_HOTPROC void mag_threadpool_parallel_compute(mag_threadpool_t* pool,
 
 static uint32_t mag_cpu_dynamic_work_scaling(mag_cpu_device_t* dvc, mag_op_t op, int64_t numel);
 
-static MAG_HOTPROC void mag_cpu_exec_fwd(mag_compute_device_t* dvc, mag_tensor_t* node) {
-    mag_cpu_device_t* cpu_dvc = dvc->impl;
-    uint32_t intraop_workers = mag_cpu_dynamic_work_scaling(cpu_dvc, node->op, node->numel);
-    if (intraop_workers <= 1) { /* Main thread does the work (single threaded mode). */
+static MAG_HOTPROC void mag_cpu_exec(mag_cpu_device_t* cpu_dvc, mag_tensor_t* node, const mag_kernel_plan_t* kp, uint32_t intraop_workers) {
+    /* Calling thread does the work in single threaded mode, or when another thread of a concurrent context owns the pool. */
+    if (intraop_workers <= 1 || mag_unlikely(!mag_spinlock_try_acquire(&cpu_dvc->pool_busy))) {
         mag_compute_payload_t payload = {
             .node = node,
+            .kplan = kp,
+            .kernels = &cpu_dvc->kernels,
             .thread_idx = 0,
             .thread_num = 1
         };
         mag_worker_exec_thread_local(&cpu_dvc->kernels, &payload);
         return; /* Done */
     }
-    mag_threadpool_parallel_compute(cpu_dvc->pool, node, intraop_workers); /* Multithreaded mode. */
+    if (mag_unlikely(!cpu_dvc->pool)) /* Spawn workers on the first parallel op, so short-lived contexts never pay for them. */
+        cpu_dvc->pool = mag_threadpool_create(cpu_dvc->num_allocated_workers, &cpu_dvc->kernels, cpu_dvc->sched_prio);
+    mag_threadpool_parallel_compute(cpu_dvc->pool, node, kp, intraop_workers); /* Multithreaded mode. */
+    mag_spinlock_release(&cpu_dvc->pool_busy);
+}
+
+static MAG_HOTPROC void mag_cpu_exec_fwd(mag_compute_device_t* dvc, mag_tensor_t* node) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    mag_cpu_exec(cpu_dvc, node, NULL, mag_cpu_dynamic_work_scaling(cpu_dvc, node->op, node->numel));
+}
+
+static MAG_HOTPROC void mag_cpu_exec_planned_fwd(mag_compute_device_t* dvc, mag_tensor_t* node, const mag_kernel_plan_t* kp) {
+    mag_cpu_exec(dvc->impl, node, kp, kp->workers); /* Worker count and kernel were fixed by mag_cpu_plan_kernel. */
 }
 
 static MAG_HOTPROC void mag_cpu_exec_bwd(mag_compute_device_t* dvc, mag_tensor_t* root) {
@@ -370,9 +417,153 @@ mag_static_assert((MAG_CPU_BUF_ALIGN & 15) == 0);
 mag_static_assert((MAG_CPU_BUF_ALIGN & 31) == 0);
 mag_static_assert((MAG_CPU_BUF_ALIGN & 63) == 0);
 
+/* Storage buffers up to this size are served from a per-device slab, so scalar-heavy code never calls the heap allocator. */
+#define MAG_CPU_SMALL_BUF_SIZE 256
+#define MAG_CPU_SMALL_BUFS_PER_CHUNK 256
+mag_static_assert(MAG_CPU_SMALL_BUF_SIZE % MAG_CPU_BUF_ALIGN == 0);
+
+/* Size class of a cacheable buffer: (2^lg, 2^(lg+1)] is split into 4 steps, so at most 20% are wasted. */
+static size_t mag_cpu_buf_class(size_t size, uint32_t* bin) {
+    uint32_t lg = mag_fls64(size-1);
+    size_t step = (size_t)1<<(lg-2);
+    size_t cls = (size+step-1) & ~(step-1);
+    *bin = (lg-MAG_CPU_BUF_CACHE_MIN_LG)*4 + (uint32_t)(cls/step - 5);
+    return cls;
+}
+
+static bool mag_cpu_buf_cacheable(size_t size) {
+    return size > MAG_CPU_SMALL_BUF_SIZE && size <= (size_t)1<<MAG_CPU_BUF_CACHE_MAX_LG;
+}
+
+static void mag_cpu_buf_cache_lock(mag_cpu_buf_cache_t* cache) {
+    if (mag_unlikely(cache->concurrent)) mag_spinlock_acquire(&cache->lock);
+}
+static void mag_cpu_buf_cache_unlock(mag_cpu_buf_cache_t* cache) {
+    if (mag_unlikely(cache->concurrent)) mag_spinlock_release(&cache->lock);
+}
+
+/* Background thread: frees evicted buffers in bulk, so the threads releasing tensors never wait on the OS. */
+static mag_thread_ret_t mag_cpu_reclaimer_exec(void* arg) {
+    mag_cpu_buf_cache_t* cache = arg;
+    mag_thread_set_name("mag_reclaimer");
+    mag_mutex_lock(&cache->reclaim_mtx);
+    for (;;) {
+        while (!cache->reclaim_list && !cache->reclaimer_stop)
+            mag_cv_wait(&cache->reclaim_cv, &cache->reclaim_mtx);
+        void* list = cache->reclaim_list;
+        if (!list) break; /* Stopped and drained. */
+        cache->reclaim_list = NULL;
+        mag_mutex_unlock(&cache->reclaim_mtx);
+        while (list) {
+            void* next = *(void**)list;
+            mag_free_aligned(list);
+            list = next;
+        }
+        mag_mutex_lock(&cache->reclaim_mtx);
+    }
+    mag_mutex_unlock(&cache->reclaim_mtx);
+    return MAG_THREAD_RET_NONE;
+}
+
+/* Return buffer to the OS, on the background thread if it runs. Caller holds the cache lock. */
+static void mag_cpu_buf_release_locked(mag_cpu_buf_cache_t* cache, void* p) {
+    if (cache->reclaimer_online) {
+        mag_mutex_lock(&cache->reclaim_mtx);
+        bool was_empty = !cache->reclaim_list;
+        *(void**)p = cache->reclaim_list;
+        cache->reclaim_list = p;
+        if (was_empty) mag_cv_signal(&cache->reclaim_cv);
+        mag_mutex_unlock(&cache->reclaim_mtx);
+        return;
+    }
+    mag_free_aligned(p);
+}
+
+static void mag_cpu_buf_release(mag_cpu_buf_cache_t* cache, void* p) {
+    mag_cpu_buf_cache_lock(cache);
+    mag_cpu_buf_release_locked(cache, p);
+    mag_cpu_buf_cache_unlock(cache);
+}
+
+/* Start and stop run without the cache lock. Freeing threads use the reclaimer only while reclaimer_online is set under the lock. */
+static void mag_cpu_buf_cache_start_reclaimer(mag_cpu_buf_cache_t* cache) {
+    mag_mutex_create(&cache->reclaim_mtx);
+    mag_cv_create(&cache->reclaim_cv);
+    cache->reclaim_list = NULL;
+    cache->reclaimer_stop = false;
+    mag_thread_create(&cache->reclaimer, &mag_cpu_reclaimer_exec, cache);
+}
+
+static void mag_cpu_buf_cache_stop_reclaimer(mag_cpu_buf_cache_t* cache) { /* Drains pending buffers. */
+    mag_mutex_lock(&cache->reclaim_mtx);
+    cache->reclaimer_stop = true;
+    mag_cv_signal(&cache->reclaim_cv);
+    mag_mutex_unlock(&cache->reclaim_mtx);
+    mag_thread_join(cache->reclaimer);
+    mag_cv_destroy(&cache->reclaim_cv);
+    mag_mutex_destroy(&cache->reclaim_mtx);
+}
+
+/* Empty the bins and return their buffers as one list, caller holds the cache lock. */
+static void* mag_cpu_buf_cache_detach_locked(mag_cpu_buf_cache_t* cache) {
+    void* list = NULL;
+    for (uint32_t i=0; i < MAG_CPU_BUF_CACHE_BINS; ++i) {
+        for (void* p = cache->bins[i]; p;) {
+            void* next = *(void**)p;
+            *(void**)p = list;
+            list = p;
+            p = next;
+        }
+        cache->bins[i] = NULL;
+    }
+    cache->bytes = 0;
+    return list;
+}
+
+static void mag_cpu_buf_free_list(void* list) {
+    while (list) {
+        void* next = *(void**)list;
+        mag_free_aligned(list);
+        list = next;
+    }
+}
+
+static void* mag_cpu_buf_cache_get(mag_cpu_buf_cache_t* cache, size_t size) {
+    uint32_t bin;
+    size_t cls = mag_cpu_buf_class(size, &bin);
+    mag_cpu_buf_cache_lock(cache);
+    void* p = cache->bins[bin];
+    if (p) {
+        cache->bins[bin] = *(void**)p;
+        cache->bytes -= cls;
+    }
+    mag_cpu_buf_cache_unlock(cache);
+    return p ? p : mag_alloc_aligned(cls, MAG_CPU_BUF_ALIGN); /* Always allocate the full class, so any buffer can be cached later. */
+}
+
+static void mag_cpu_buf_cache_put(mag_cpu_buf_cache_t* cache, void* p, size_t size) {
+    uint32_t bin;
+    size_t cls = mag_cpu_buf_class(size, &bin);
+    mag_cpu_buf_cache_lock(cache);
+    if (cache->enabled && cache->bytes + cls <= MAG_CPU_BUF_CACHE_CAP) {
+        *(void**)p = cache->bins[bin];
+        cache->bins[bin] = p;
+        cache->bytes += cls;
+    } else {
+        mag_cpu_buf_release_locked(cache, p);
+    }
+    mag_cpu_buf_cache_unlock(cache);
+}
+
 static void mag_cpu_alloc_storage(mag_compute_device_t* host, mag_storage_buffer_t* out, size_t size) {
     mag_assert2(size);
-    void* block = mag_alloc_aligned(size, MAG_CPU_BUF_ALIGN);
+    mag_cpu_device_t* cpu_dvc = host->impl;
+    const mag_ctx_t* ctx = cpu_dvc->ctx;
+    void* block;
+    if (mag_unlikely(ctx->storage_alloc_custom)) block = (*ctx->storage_alloc.alloc)(ctx->storage_alloc.ud, size, MAG_CPU_BUF_ALIGN);
+    else if (size <= MAG_CPU_SMALL_BUF_SIZE) block = mag_fixed_intrusive_pool_malloc(&cpu_dvc->small_bufs);
+    else if (mag_cpu_buf_cacheable(size)) block = mag_cpu_buf_cache_get(&cpu_dvc->buf_cache, size);
+    else block = mag_alloc_aligned(size, MAG_CPU_BUF_ALIGN);
     *out = (mag_storage_buffer_t){ /* Set up storage buffer. */
         .base = (uintptr_t)block,
         .size = size,
@@ -385,25 +576,37 @@ static void mag_cpu_alloc_storage(mag_compute_device_t* host, mag_storage_buffer
 }
 
 static void mag_cpu_free_storage(mag_compute_device_t* dvc, mag_storage_buffer_t* buf) {
-    mag_free_aligned((void*)buf->base);
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    const mag_ctx_t* ctx = cpu_dvc->ctx;
+    if (mag_unlikely(ctx->storage_alloc_custom)) (*ctx->storage_alloc.free)(ctx->storage_alloc.ud, (void*)buf->base, buf->size);
+    else if (buf->size <= MAG_CPU_SMALL_BUF_SIZE) mag_fixed_intrusive_pool_free(&cpu_dvc->small_bufs, (void*)buf->base);
+    else if (mag_cpu_buf_cacheable(buf->size)) mag_cpu_buf_cache_put(&cpu_dvc->buf_cache, (void*)buf->base, buf->size);
+    else mag_cpu_buf_release(&cpu_dvc->buf_cache, (void*)buf->base);
     memset(buf, 0, sizeof(*buf)); /* Set to zero. */
 }
 
-static mag_cpu_device_t* mag_cpu_init_device(mag_ctx_t* ctx, uint32_t num_threads) {
-    mag_thread_sched_prio_t sched_prio = MAG_THREAD_SCHED_PRIO_HIGH;
+#define MAG_CPU_STREAM_THRESHOLD_DEFAULT (32ll<<20) /* Used if the last level cache size is unknown. */
+
+/* Outputs larger than the last level cache would only evict the inputs and other hot data, so they are streamed past it. */
+static int64_t mag_cpu_stream_threshold(const mag_ctx_t* ctx, uint64_t requested) {
+    if (requested) return (int64_t)mag_xmin(requested, (uint64_t)INT64_MAX);
+    uint64_t llc = ctx->machine.cpu_llc_size;
+    return llc ? (int64_t)llc : MAG_CPU_STREAM_THRESHOLD_DEFAULT;
+}
+
+static mag_cpu_device_t* mag_cpu_init_device(mag_ctx_t* ctx, uint32_t num_threads, uint64_t stream_threshold) {
     mag_cpu_device_t* dvc = (*mag_alloc)(NULL, sizeof(*dvc));
     memset(dvc, 0, sizeof(*dvc));
     *dvc = (mag_cpu_device_t) {
         .ctx = ctx,
         .pool = NULL,
-        .num_allocated_workers = 0,
-        .kernels = {},
+        .num_allocated_workers = mag_xmax(1, num_threads),
+        .sched_prio = MAG_THREAD_SCHED_PRIO_HIGH,
+        .kernels = {.stream_threshold = mag_cpu_stream_threshold(ctx, stream_threshold)},
+        .inject_kernels = mag_blas_detect_optimal_specialization(ctx)
     };
-    mag_blas_detect_optimal_specialization(ctx, &dvc->kernels);
-    if (num_threads > 1) {
-        dvc->pool = mag_threadpool_create(num_threads, &dvc->kernels, sched_prio);
-        dvc->num_allocated_workers = num_threads;
-    }
+    (*dvc->inject_kernels)(&dvc->kernels, ctx->math_mode);
+    mag_fixed_intrusive_pool_init(&dvc->small_bufs, MAG_CPU_SMALL_BUF_SIZE, MAG_CPU_BUF_ALIGN, MAG_CPU_SMALL_BUFS_PER_CHUNK);
     return dvc;
 }
 
@@ -414,21 +617,147 @@ static mag_cpu_device_t* mag_cpu_init_device(mag_ctx_t* ctx, uint32_t num_thread
 */
 static uint32_t mag_cpu_dynamic_work_scaling(mag_cpu_device_t* dvc, mag_op_t op, int64_t numel) {
     const mag_cpu_op_info_t* info = mag_cpu_op_infos+op;
-    if (!dvc->pool || !info->mt_support || numel < info->threshold) return 1;       /* Use a single worker (main thread). */
+    if (dvc->num_allocated_workers <= 1 || !info->mt_support || numel < info->threshold) return 1; /* Use a single worker (main thread). */
     numel -= info->threshold;                                                       /* Saturate threshold */
     uint32_t workers = (uint32_t)ceil(info->growth * log2((double)numel));       /* Logarithmic scaling */
     workers = mag_xmin(dvc->num_allocated_workers, mag_xmax(1, workers));
     return workers;
 }
 
+static void mag_cpu_plan_kernel(mag_compute_device_t* dvc, const mag_tensor_t* node, mag_kernel_plan_t* out) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    out->workers = mag_cpu_dynamic_work_scaling(cpu_dvc, node->op, node->numel);
+    if (cpu_dvc->kernels.select) (*cpu_dvc->kernels.select)(&cpu_dvc->kernels, node, out);
+    if (out->variant == MAG_KVAR_SMALL_GEMM) out->workers = 1; /* Waking the pool costs more than the product. */
+}
+
+static void mag_cpu_vadd_host(mag_compute_device_t* dvc, int64_t numel, float* o, const float* x, const float* y) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    (*cpu_dvc->kernels.vadd)(numel, o, x, y);
+}
+
+/* Sparse products run on the pool like an op, the job recovers its operands from the kernel plan it extends. */
+typedef struct mag_cpu_spmm_job_t {
+    mag_kernel_plan_t kp;   /* Must be first. */
+    const mag_kernel_registry_t* kernels;
+    const mag_csr_t* a;
+    const float* b;
+    int64_t n;
+} mag_cpu_spmm_job_t;
+
+#define MAG_CPU_SPMM_COST_PER_WORKER 32768 /* Multiply-adds per worker below which waking more workers does not pay off. */
+
+/* First row whose cost prefix reaches cost. Each row costs its nonzeros plus one, so dense rows are balanced against many empty ones. */
+static int64_t mag_cpu_csr_row_at(const mag_csr_t* a, int64_t cost) {
+    int64_t lo = 0, hi = a->rows;
+    while (lo < hi) {
+        int64_t mid = lo + ((hi-lo)>>1);
+        if (a->row_ptr[mid] + mid < cost) lo = mid+1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void mag_cpu_spmm_worker(const mag_compute_payload_t* payload) {
+    const mag_cpu_spmm_job_t* job = (const mag_cpu_spmm_job_t*)payload->kplan;
+    const mag_csr_t* a = job->a;
+    int64_t total = a->nnz + a->rows;
+    int64_t r0 = mag_cpu_csr_row_at(a, total*payload->thread_idx/payload->thread_num);
+    int64_t r1 = mag_cpu_csr_row_at(a, total*(payload->thread_idx+1)/payload->thread_num);
+    if (r0 < r1)
+        (*job->kernels->spmm)(a, r0, r1, job->b, job->n, (float*)payload->node->storage->base);
+}
+
+static void mag_cpu_spmm_host(mag_compute_device_t* dvc, mag_tensor_t* r, const mag_csr_t* a, const float* b, int64_t n) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    mag_cpu_spmm_job_t job = {
+        .kp = {.fn = &mag_cpu_spmm_worker},
+        .kernels = &cpu_dvc->kernels,
+        .a = a,
+        .b = b,
+        .n = n
+    };
+    int64_t cost = (a->nnz + a->rows)*n;
+    uint32_t workers = (uint32_t)mag_xmin((int64_t)cpu_dvc->num_allocated_workers, mag_xmax(1, cost/MAG_CPU_SPMM_COST_PER_WORKER));
+    mag_cpu_exec(cpu_dvc, r, &job.kp, workers);
+}
+
+typedef struct mag_cpu_sp24_job_t {
+    mag_kernel_plan_t kp;   /* Must be first. */
+    const mag_kernel_registry_t* kernels;
+    const mag_sp24_t* w;
+    const float* x;
+    int64_t n;
+} mag_cpu_sp24_job_t;
+
+static void mag_cpu_sp24_worker(const mag_compute_payload_t* payload) { /* Every row holds cols/2 values, so rows are split evenly. */
+    const mag_cpu_sp24_job_t* job = (const mag_cpu_sp24_job_t*)payload->kplan;
+    int64_t rows = job->w->rows;
+    int64_t chunk = (rows + payload->thread_num - 1)/payload->thread_num;
+    int64_t r0 = payload->thread_idx*chunk;
+    int64_t r1 = mag_xmin(r0 + chunk, rows);
+    if (r0 < r1)
+        (*job->kernels->sp24_matmul)(job->w, r0, r1, job->x, job->n, (float*)payload->node->storage->base);
+}
+
+static void mag_cpu_sp24_matmul_host(mag_compute_device_t* dvc, mag_tensor_t* r, const mag_sp24_t* w, const float* x, int64_t n) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    mag_cpu_sp24_job_t job = {
+        .kp = {.fn = &mag_cpu_sp24_worker},
+        .kernels = &cpu_dvc->kernels,
+        .w = w,
+        .x = x,
+        .n = n
+    };
+    int64_t cost = w->rows*(w->cols>>1)*n;
+    uint32_t workers = (uint32_t)mag_xmin((int64_t)cpu_dvc->num_allocated_workers, mag_xmax(1, cost/MAG_CPU_SPMM_COST_PER_WORKER));
+    mag_cpu_exec(cpu_dvc, r, &job.kp, workers);
+}
+
+static void mag_cpu_set_math_mode(mag_compute_device_t* dvc, mag_math_mode_t mode) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    mag_spinlock_acquire(&cpu_dvc->pool_busy); /* No parallel op may read the registry while it is rewritten. Inline callers are excluded by the context, which refuses the change in concurrent mode. */
+    (*cpu_dvc->inject_kernels)(&cpu_dvc->kernels, mode);
+    mag_spinlock_release(&cpu_dvc->pool_busy);
+}
+
+static void mag_cpu_set_concurrent(mag_compute_device_t* dvc, bool concurrent) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    mag_fixed_intrusive_pool_set_concurrent(&cpu_dvc->small_bufs, concurrent);
+    cpu_dvc->buf_cache.concurrent = concurrent;
+}
+
+static void mag_cpu_set_free_mode(mag_compute_device_t* dvc, mag_free_mode_t mode) {
+    mag_cpu_device_t* cpu_dvc = dvc->impl;
+    mag_cpu_buf_cache_t* cache = &cpu_dvc->buf_cache;
+    bool background = mode == MAG_FREE_MODE_BACKGROUND;
+    bool start = background && !cache->reclaimer_online; /* Only the context thread changes the reclaimer. */
+    if (start) mag_cpu_buf_cache_start_reclaimer(cache);
+    mag_cpu_buf_cache_lock(cache); /* Threads freeing storage read the flags under the lock, it only covers flag flips and the bins. */
+    if (start) cache->reclaimer_online = true;
+    cache->enabled = mode != MAG_FREE_MODE_IMMEDIATE;
+    void* evicted = cache->enabled ? NULL : mag_cpu_buf_cache_detach_locked(cache);
+    bool stop = !background && cache->reclaimer_online;
+    if (stop) cache->reclaimer_online = false; /* No freeing thread touches reclaim_mtx from here on. */
+    mag_cpu_buf_cache_unlock(cache);
+    mag_cpu_buf_free_list(evicted);
+    if (stop) mag_cpu_buf_cache_stop_reclaimer(cache);
+}
+
 static void mag_cpu_destroy_device(mag_cpu_device_t* dvc) {
     if (dvc->pool)
         mag_threadpool_destroy(dvc->pool);
+    mag_fixed_intrusive_pool_destroy(&dvc->small_bufs);
+    mag_cpu_buf_free_list(mag_cpu_buf_cache_detach_locked(&dvc->buf_cache)); /* No other thread uses the device anymore. */
+    if (dvc->buf_cache.reclaimer_online) {
+        dvc->buf_cache.reclaimer_online = false;
+        mag_cpu_buf_cache_stop_reclaimer(&dvc->buf_cache);
+    }
     (*mag_alloc)(dvc, 0);
 }
 
-static mag_compute_device_t* mag_cpu_init_interface(mag_ctx_t* ctx, uint32_t num_threads) {
-    mag_cpu_device_t* cpu_dvc = mag_cpu_init_device(ctx, num_threads);
+static mag_compute_device_t* mag_cpu_init_interface(mag_ctx_t* ctx, uint32_t num_threads, uint64_t stream_threshold) {
+    mag_cpu_device_t* cpu_dvc = mag_cpu_init_device(ctx, num_threads, stream_threshold);
     mag_compute_device_t* dvc = (*mag_alloc)(NULL, sizeof(*dvc));
     *dvc = (mag_compute_device_t){ /* Initialize device interface */
         .name = "CPU",
@@ -438,7 +767,15 @@ static mag_compute_device_t* mag_cpu_init_interface(mag_ctx_t* ctx, uint32_t num
         .eager_exec_fwd = &mag_cpu_exec_fwd,
         .eager_exec_bwd = &mag_cpu_exec_bwd,
         .alloc_storage = &mag_cpu_alloc_storage,
-        .free_storage = &mag_cpu_free_storage
+        .free_storage = &mag_cpu_free_storage,
+        .set_math_mode = &mag_cpu_set_math_mode,
+        .set_concurrent = &mag_cpu_set_concurrent,
+        .set_free_mode = &mag_cpu_set_free_mode,
+        .plan_kernel = &mag_cpu_plan_kernel,
+        .exec_planned_fwd = &mag_cpu_exec_planned_fwd,
+        .vadd_host = &mag_cpu_vadd_host,
+        .spmm_host = &mag_cpu_spmm_host,
+        .sp24_matmul_host = &mag_cpu_sp24_matmul_host
     };
     snprintf(dvc->name, sizeof(dvc->name), "%s", ctx->machine.cpu_name);
     return dvc;
@@ -454,10 +791,283 @@ mag_compute_device_t* mag_init_device_cpu(mag_ctx_t* ctx, const mag_device_descr
     uint32_t hw_concurrency = mag_xmax(1, ctx->machine.cpu_virtual_cores);
     uint32_t num_threads = desc->thread_count;
     num_threads = num_threads ? num_threads : hw_concurrency;
-    mag_compute_device_t* dvc = mag_cpu_init_interface(ctx, num_threads);
+    mag_compute_device_t* dvc = mag_cpu_init_interface(ctx, num_threads, desc->stream_threshold);
     return dvc;
 }
 
 void mag_destroy_device_cpu(mag_compute_device_t* dvc) {
     mag_cpu_release_interface(dvc);
 }
+
+/*
+** Asynchronous CPU device: ops, memsets and host to device copies are queued and run in order on a submission thread, which drives
+** the regular CPU kernels and thread pool. Commands carry copies of their tensor headers and storage descriptors, so callers may modify
+** or release the tensors right after submitting. Storage freed while commands are in flight is held back until the queue has passed the
+** free, so allocator and refcount updates stay on the submitting thread.
+*/
+#define MAG_CPU_STREAM_CAP 256          /* Max commands in flight, submission waits for the oldest when the queue is full. */
+#define MAG_CPU_STREAM_INLINE_CPY 64    /* Host to device copies up to this size are staged inside the command. */
+
+typedef enum mag_cpu_cmd_type_t {
+    MAG_CPU_CMD_EXEC,
+    MAG_CPU_CMD_SET,
+    MAG_CPU_CMD_COPY
+} mag_cpu_cmd_type_t;
+
+typedef struct mag_cpu_cmd_t {
+    mag_cpu_cmd_type_t type;
+    bool planned;                                       /* Run with the kernel selected for a plan node. */
+    uint32_t workers;                                   /* Intra-op workers. */
+    mag_kernel_plan_t kplan;
+    mag_tensor_t t[1+MAG_MAX_INPUT_TENSORS];            /* Result and input headers at submission. */
+    mag_storage_buffer_t sto[1+MAG_MAX_INPUT_TENSORS];  /* Storage descriptors at submission. */
+    size_t offs;                                        /* Byte offset of memsets and copies. */
+    size_t n;                                           /* Bytes to copy. */
+    uint8_t x;                                          /* Memset byte. */
+    void* staging;                                      /* Heap copy of large host data, released on retire. */
+    uint8_t inline_data[MAG_CPU_STREAM_INLINE_CPY];
+} mag_cpu_cmd_t;
+
+typedef struct mag_cpu_pending_free_t {
+    uint64_t seq;                       /* Last command which might use the storage. */
+    mag_storage_buffer_t sto;
+} mag_cpu_pending_free_t;
+
+struct mag_cpu_stream_t {
+    mag_compute_device_t* dvc;          /* Device interface. */
+    mag_cpu_cmd_t* cmds;                /* Ring of MAG_CPU_STREAM_CAP commands, command seq lives in slot (seq-1) % cap. */
+    uint64_t submitted;                 /* Seq of the last submitted command. */
+    uint64_t completed;                 /* Seq of the last completed command. */
+    uint64_t retired;                   /* Seq of the last command whose resources were released. Submitting thread only. */
+    mag_cpu_pending_free_t* frees;      /* Storage waiting for in-flight commands. */
+    size_t num_frees;
+    size_t cap_frees;
+    bool stop;
+    mag_thread_t thread;
+    mag_mutex_t mtx;
+    mag_cond_var_t cv_work;             /* Signals submitted commands and stop. */
+    mag_cond_var_t cv_done;             /* Signals completed commands. */
+};
+
+static void mag_cpu_stream_run(mag_cpu_device_t* cpu_dvc, mag_cpu_cmd_t* cmd) {
+    switch (cmd->type) {
+        case MAG_CPU_CMD_EXEC: mag_cpu_exec(cpu_dvc, cmd->t, cmd->planned ? &cmd->kplan : NULL, cmd->workers); break;
+        case MAG_CPU_CMD_SET: mag_cpu_buf_set(cmd->sto, cmd->offs, cmd->x); break;
+        case MAG_CPU_CMD_COPY: mag_cpu_buf_cpy_host_device(cmd->sto, cmd->offs, cmd->staging ? cmd->staging : cmd->inline_data, cmd->n); break;
+        default: mag_panic("Invalid stream command: %d", cmd->type);
+    }
+}
+
+/* Submission thread: runs commands in order until stopped and drained. */
+static mag_thread_ret_t mag_cpu_stream_exec(void* arg) {
+    mag_cpu_stream_t* stream = arg;
+    mag_cpu_device_t* cpu_dvc = stream->dvc->impl;
+    mag_thread_set_name("mag_stream");
+    mag_mutex_lock(&stream->mtx);
+    for (;;) {
+        while (stream->completed == stream->submitted && !stream->stop)
+            mag_cv_wait(&stream->cv_work, &stream->mtx);
+        if (stream->completed == stream->submitted) break; /* Stopped and drained. */
+        mag_cpu_cmd_t* cmd = stream->cmds + stream->completed%MAG_CPU_STREAM_CAP;
+        mag_mutex_unlock(&stream->mtx);
+        mag_cpu_stream_run(cpu_dvc, cmd);
+        mag_mutex_lock(&stream->mtx);
+        ++stream->completed;
+        mag_cv_broadcast(&stream->cv_done);
+    }
+    mag_mutex_unlock(&stream->mtx);
+    return MAG_THREAD_RET_NONE;
+}
+
+/* Release staging buffers and held storage of completed commands. */
+static void mag_cpu_stream_retire(mag_cpu_stream_t* stream) {
+    mag_mutex_lock(&stream->mtx);
+    uint64_t completed = stream->completed;
+    mag_mutex_unlock(&stream->mtx);
+    for (; stream->retired < completed; ++stream->retired) {
+        mag_cpu_cmd_t* cmd = stream->cmds + stream->retired%MAG_CPU_STREAM_CAP;
+        if (cmd->staging) (*mag_alloc)(cmd->staging, 0), cmd->staging = NULL;
+    }
+    size_t n = 0;
+    for (size_t i=0; i < stream->num_frees; ++i) {
+        mag_cpu_pending_free_t* f = stream->frees+i;
+        if (f->seq <= completed) mag_cpu_free_storage(stream->dvc, &f->sto);
+        else stream->frees[n++] = *f;
+    }
+    stream->num_frees = n;
+}
+
+static void mag_cpu_stream_wait(mag_cpu_stream_t* stream, uint64_t seq) {
+    mag_mutex_lock(&stream->mtx);
+    while (stream->completed < seq)
+        mag_cv_wait(&stream->cv_done, &stream->mtx);
+    mag_mutex_unlock(&stream->mtx);
+    mag_cpu_stream_retire(stream);
+}
+
+/* Get the slot of the next command. */
+static mag_cpu_cmd_t* mag_cpu_stream_acquire(mag_cpu_stream_t* stream, mag_cpu_cmd_type_t type) {
+    mag_cpu_stream_retire(stream);
+    if (stream->submitted - stream->retired == MAG_CPU_STREAM_CAP) /* Queue full. */
+        mag_cpu_stream_wait(stream, stream->retired+1);
+    mag_cpu_cmd_t* cmd = stream->cmds + stream->submitted%MAG_CPU_STREAM_CAP;
+    cmd->type = type;
+    cmd->staging = NULL;
+    return cmd;
+}
+
+static void mag_cpu_stream_submit(mag_cpu_stream_t* stream) {
+    mag_mutex_lock(&stream->mtx);
+    ++stream->submitted;
+    mag_cv_signal(&stream->cv_work);
+    mag_mutex_unlock(&stream->mtx);
+}
+
+static void mag_cpu_stream_snapshot(mag_cpu_cmd_t* cmd, uint32_t i, const mag_tensor_t* t) {
+    cmd->t[i] = *t;
+    cmd->sto[i] = *t->storage;
+    cmd->t[i].storage = cmd->sto+i;
+}
+
+static void mag_cpu_stream_submit_exec(mag_compute_device_t* dvc, mag_tensor_t* node, const mag_kernel_plan_t* kp, uint32_t workers) {
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)dvc->impl)->stream;
+    mag_cpu_cmd_t* cmd = mag_cpu_stream_acquire(stream, MAG_CPU_CMD_EXEC);
+    cmd->planned = kp != NULL;
+    if (kp) cmd->kplan = *kp;
+    cmd->workers = workers;
+    mag_cpu_stream_snapshot(cmd, 0, node);
+    for (uint32_t i=0; i < MAG_MAX_INPUT_TENSORS; ++i) {
+        if (!node->op_inputs[i]) continue;
+        mag_cpu_stream_snapshot(cmd, 1+i, node->op_inputs[i]);
+        cmd->t->op_inputs[i] = cmd->t+1+i;
+    }
+    mag_cpu_stream_submit(stream);
+}
+
+static void mag_cpu_stream_exec_fwd(mag_compute_device_t* dvc, mag_tensor_t* node) {
+    mag_cpu_stream_submit_exec(dvc, node, NULL, mag_cpu_dynamic_work_scaling(dvc->impl, node->op, node->numel));
+}
+
+static void mag_cpu_stream_exec_planned_fwd(mag_compute_device_t* dvc, mag_tensor_t* node, const mag_kernel_plan_t* kp) {
+    mag_cpu_stream_submit_exec(dvc, node, kp, kp->workers);
+}
+
+static void mag_cpu_stream_buf_set(mag_storage_buffer_t* sto, size_t offs, uint8_t x) {
+    mag_assert2(sto->base+offs <= sto->base+sto->size);
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)sto->host->impl)->stream;
+    mag_cpu_cmd_t* cmd = mag_cpu_stream_acquire(stream, MAG_CPU_CMD_SET);
+    *cmd->sto = *sto;
+    cmd->offs = offs;
+    cmd->x = x;
+    mag_cpu_stream_submit(stream);
+}
+
+static void mag_cpu_stream_buf_cpy_host_device(mag_storage_buffer_t* sto, size_t offs, const void* src, size_t n) {
+    mag_assert2(sto->base+offs+n <= sto->base+sto->size);
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)sto->host->impl)->stream;
+    mag_cpu_cmd_t* cmd = mag_cpu_stream_acquire(stream, MAG_CPU_CMD_COPY);
+    *cmd->sto = *sto;
+    cmd->offs = offs;
+    cmd->n = n;
+    if (n > sizeof(cmd->inline_data)) cmd->staging = (*mag_alloc)(NULL, n); /* The caller may reuse src right after returning. */
+    memcpy(cmd->staging ? cmd->staging : cmd->inline_data, src, n);
+    mag_cpu_stream_submit(stream);
+}
+
+static void mag_cpu_stream_buf_cpy_device_host(mag_storage_buffer_t* sto, size_t offs, void* dst, size_t n) {
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)sto->host->impl)->stream;
+    mag_cpu_stream_wait(stream, stream->submitted);
+    mag_cpu_buf_cpy_device_host(sto, offs, dst, n);
+}
+
+static void mag_cpu_stream_alloc_storage(mag_compute_device_t* dvc, mag_storage_buffer_t* out, size_t size) {
+    mag_cpu_stream_retire(((mag_cpu_device_t*)dvc->impl)->stream); /* Recycle storage held back by completed commands first. */
+    mag_cpu_alloc_storage(dvc, out, size);
+    out->set = &mag_cpu_stream_buf_set;
+    out->cpy_host_device = &mag_cpu_stream_buf_cpy_host_device;
+    out->cpy_device_host = &mag_cpu_stream_buf_cpy_device_host;
+}
+
+static void mag_cpu_stream_free_storage(mag_compute_device_t* dvc, mag_storage_buffer_t* buf) {
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)dvc->impl)->stream;
+    mag_cpu_stream_retire(stream);
+    if (stream->retired == stream->submitted) { /* Idle, nothing can still use the buffer. */
+        mag_cpu_free_storage(dvc, buf);
+        return;
+    }
+    if (stream->num_frees == stream->cap_frees) {
+        stream->cap_frees = stream->cap_frees ? stream->cap_frees<<1 : 64;
+        stream->frees = (*mag_alloc)(stream->frees, stream->cap_frees*sizeof(*stream->frees));
+    }
+    stream->frees[stream->num_frees++] = (mag_cpu_pending_free_t){.seq = stream->submitted, .sto = *buf};
+    memset(buf, 0, sizeof(*buf));
+}
+
+static uint64_t mag_cpu_stream_record_event(mag_compute_device_t* dvc) {
+    return ((mag_cpu_device_t*)dvc->impl)->stream->submitted;
+}
+
+static bool mag_cpu_stream_query_event(mag_compute_device_t* dvc, uint64_t ev) {
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)dvc->impl)->stream;
+    mag_cpu_stream_retire(stream);
+    return stream->retired >= ev;
+}
+
+static void mag_cpu_stream_wait_event(mag_compute_device_t* dvc, uint64_t ev) {
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)dvc->impl)->stream;
+    mag_assert(ev <= stream->submitted, "Event %" PRIu64 " was not recorded on this device", ev);
+    mag_cpu_stream_wait(stream, ev);
+}
+
+static void mag_cpu_stream_set_math_mode(mag_compute_device_t* dvc, mag_math_mode_t mode) {
+    mag_cpu_stream_wait_event(dvc, mag_cpu_stream_record_event(dvc)); /* Queued ops must not see the registry change. */
+    mag_cpu_set_math_mode(dvc, mode);
+}
+
+static void mag_cpu_stream_set_concurrent(mag_compute_device_t* dvc, bool concurrent) {
+    mag_assert(!concurrent, "The CPU stream device has a single submitting thread and does not support concurrent contexts");
+    mag_cpu_set_concurrent(dvc, concurrent);
+}
+
+mag_compute_device_t* mag_init_device_cpu_stream(mag_ctx_t* ctx, const mag_device_descriptor_t* desc) {
+    mag_compute_device_t* dvc = mag_init_device_cpu(ctx, desc);
+    mag_cpu_stream_t* stream = (*mag_alloc)(NULL, sizeof(*stream));
+    memset(stream, 0, sizeof(*stream));
+    stream->dvc = dvc;
+    stream->cmds = (*mag_alloc)(NULL, MAG_CPU_STREAM_CAP*sizeof(*stream->cmds));
+    mag_mutex_create(&stream->mtx);
+    mag_cv_create(&stream->cv_work);
+    mag_cv_create(&stream->cv_done);
+    ((mag_cpu_device_t*)dvc->impl)->stream = stream;
+    dvc->is_async = true;
+    dvc->type = MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM;
+    dvc->eager_exec_fwd = &mag_cpu_stream_exec_fwd;
+    dvc->exec_planned_fwd = &mag_cpu_stream_exec_planned_fwd;
+    dvc->alloc_storage = &mag_cpu_stream_alloc_storage;
+    dvc->free_storage = &mag_cpu_stream_free_storage;
+    dvc->set_math_mode = &mag_cpu_stream_set_math_mode;
+    dvc->set_concurrent = &mag_cpu_stream_set_concurrent;
+    dvc->record_event = &mag_cpu_stream_record_event;
+    dvc->query_event = &mag_cpu_stream_query_event;
+    dvc->wait_event = &mag_cpu_stream_wait_event;
+    mag_thread_create(&stream->thread, &mag_cpu_stream_exec, stream);
+    return dvc;
+}
+
+void mag_destroy_device_cpu_stream(mag_compute_device_t* dvc) {
+    mag_cpu_stream_t* stream = ((mag_cpu_device_t*)dvc->impl)->stream;
+    mag_mutex_lock(&stream->mtx);
+    stream->stop = true;
+    mag_cv_signal(&stream->cv_work);
+    mag_mutex_unlock(&stream->mtx);
+    mag_thread_join(stream->thread); /* Runs the remaining commands. */
+    mag_cpu_stream_retire(stream);
+    mag_assert2(!stream->num_frees);
+    mag_cv_destroy(&stream->cv_done);
+    mag_cv_destroy(&stream->cv_work);
+    mag_mutex_destroy(&stream->mtx);
+    if (stream->frees) (*mag_alloc)(stream->frees, 0);
+    (*mag_alloc)(stream->cmds, 0);
+    (*mag_alloc)(stream, 0);
+    mag_cpu_release_interface(dvc);
+}
@@ -62,10 +62,15 @@
 typedef float mag_f32_t;
 typedef double mag_f64_t;
 
-#define mag_f32p(t) ((const mag_f32_t*)(t)->storage.base)
-#define mag_f32p_mut(t) ((mag_f32_t*)(t)->storage.base)
+#define mag_f32p(t) ((const mag_f32_t*)(t)->storage->base)
+#define mag_f32p_mut(t) ((mag_f32_t*)(t)->storage->base)
 
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+/*
+** SIMD approximations of transcendental functions, used by the MAG_MATH_MODE_APPROX kernels below.
+** Both precise and approximate kernels are compiled into every BLAS specialization, the active set is selected at runtime per context (see mag_ctx_set_math_mode).
+*/
+
+#if (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
 
 static float32x4_t mag_simd_expf(float32x4_t x) { /* exp(x) : ℝ -> (0, ∞), x |-> e^x. Error = 1.45358 + 0.5 ulps. x > 88.38 -> INF, x < -103.97 -> 0  */
     float32x4_t r = vdupq_n_f32(0x1.8p23f);
@@ -134,7 +139,124 @@ static void mag_simd_sincos(float32x4_t x, float32x4_t *osin, float32x4_t *ocos)
     *ocos = vbslq_f32(sign_mask_cos, yc, vnegq_f32(yc));
 }
 
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
+static float32x4_t mag_simd_logf(float32x4_t xi) { /* log x : (0, ∞) -> ℝ, NaN for x <= 0 */
+    const float32x4_t one = vdupq_n_f32(1);
+    xi = vmaxq_f32(xi, vdupq_n_f32(0));
+    uint32x4_t invalid_mask = vcleq_f32(xi, vdupq_n_f32(0));
+    int32x4_t ux = vreinterpretq_s32_f32(xi);
+    int32x4_t emm0 = vshrq_n_s32(ux, 23);
+    ux = vandq_s32(ux, vdupq_n_s32(~0x7f800000u));
+    ux = vorrq_s32(ux, vreinterpretq_s32_f32(vdupq_n_f32(0.5f)));
+    xi = vreinterpretq_f32_s32(ux);
+    emm0 = vsubq_s32(emm0, vdupq_n_s32(0x7f));
+    float32x4_t e = vcvtq_f32_s32(emm0);
+    e = vaddq_f32(e, one);
+    uint32x4_t mask = vcltq_f32(xi, vdupq_n_f32(0.707106781186547524f));
+    float32x4_t tmp = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(xi), mask));
+    xi = vsubq_f32(xi, one);
+    e = vsubq_f32(e, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(one), mask)));
+    xi = vaddq_f32(xi, tmp);
+    float32x4_t z = vmulq_f32(xi, xi);
+    float32x4_t y = vdupq_n_f32(7.0376836292e-2f);
+    y = vmlaq_f32(vdupq_n_f32(-1.1514610310e-1f), y, xi);
+    y = vmlaq_f32(vdupq_n_f32(1.1676998740e-1f), y, xi);
+    y = vmlaq_f32(vdupq_n_f32(-1.2420140846e-1f), y, xi);
+    y = vmlaq_f32(vdupq_n_f32(1.4249322787e-1f), y, xi);
+    y = vmlaq_f32(vdupq_n_f32(-1.6668057665e-1f), y, xi);
+    y = vmlaq_f32(vdupq_n_f32(2.0000714765e-1f), y, xi);
+    y = vmlaq_f32(vdupq_n_f32(-2.4999993993e-1f), y, xi);
+    y = vmlaq_f32(vdupq_n_f32(3.3333331174e-1f), y, xi);
+    y = vmulq_f32(y, xi);
+    y = vmulq_f32(y, z);
+    y = vmlaq_f32(y, e, vdupq_n_f32(-2.12194440e-4f));
+    y = vmlsq_f32(y, z, vdupq_n_f32(0.5f));
+    xi = vaddq_f32(xi, y);
+    xi = vmlaq_f32(xi, e, vdupq_n_f32(0.693359375f));
+    xi = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(xi), invalid_mask));
+    return xi;
+}
+
+static float32x4_t mag_simd_sinf(float32x4_t x) {
+    float32x4_t osin, ocos;
+    mag_simd_sincos(x, &osin, &ocos);
+    return osin;
+}
+
+static float32x4_t mag_simd_cosf(float32x4_t x) {
+    float32x4_t osin, ocos;
+    mag_simd_sincos(x, &osin, &ocos);
+    return ocos;
+}
+
+static float32x4_t mag_simd_sigmoid(float32x4_t x) { /* σ : ℝ -> (0, 1), x |-> 1/(1 + e^(-x)) */
+    float32x4_t one = vdupq_n_f32(1.0f);
+    return vdivq_f32(one, vaddq_f32(one, mag_simd_expf(vnegq_f32(x))));
+}
+
+static float32x4_t mag_simd_silu(float32x4_t x) { /* silu : ℝ -> ℝ, x |-> x/(1 + e^(-x)) */
+    float32x4_t one = vdupq_n_f32(1.0f);
+    return vdivq_f32(x, vaddq_f32(one, mag_simd_expf(vnegq_f32(x))));
+}
+
+static float32x4_t mag_simd_gelu(float32x4_t x) { /* gelu : ℝ -> ℝ, tanh approximation */
+    float32x4_t half = vdupq_n_f32(0.5f);
+    float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t coeff1 = vdupq_n_f32(0.79788456080286535587989211986876f);
+    float32x4_t coeff2 = vdupq_n_f32(MAG_GELU_COEFF);
+    float32x4_t a = vaddq_f32(one, vmulq_f32(coeff2, vmulq_f32(x, x)));
+    float32x4_t b = vaddq_f32(one, mag_simd_tanh(vmulq_f32(coeff1, vmulq_f32(x, a))));
+    return vmulq_f32(half, vmulq_f32(x, b));
+}
+
+/*
+** Applies fn to numel elements. The tail is handled by recomputing the last full vector, overlapping already processed elements.
+** The overlapping input is loaded before the first store, so in-place ops (o == x) stay correct.
+** Only vectors shorter than one register are left to the scalar loop of the caller.
+*/
+#define mag_simd_map_f32(fn, numel, o, x, i) \
+    if ((numel) >= 4) { \
+        float32x4_t tail = vld1q_f32((x)+(numel)-4); \
+        for (; (i)+3 < (numel); (i) += 4) \
+            vst1q_f32((o)+(i), fn(vld1q_f32((x)+(i)))); \
+        if ((i) < (numel)) vst1q_f32((o)+(numel)-4, fn(tail)); \
+        (i) = (numel); \
+    }
+
+static MAG_AINLINE float32x4_t mag_simd_add(float32x4_t x, float32x4_t y) { return vaddq_f32(x, y); }
+static MAG_AINLINE float32x4_t mag_simd_sub(float32x4_t x, float32x4_t y) { return vsubq_f32(x, y); }
+static MAG_AINLINE float32x4_t mag_simd_mul(float32x4_t x, float32x4_t y) { return vmulq_f32(x, y); }
+static MAG_AINLINE float32x4_t mag_simd_div(float32x4_t x, float32x4_t y) { return vdivq_f32(x, y); }
+static MAG_AINLINE float32x4_t mag_simd_abs(float32x4_t x) { return vabsq_f32(x); }
+static MAG_AINLINE float32x4_t mag_simd_neg(float32x4_t x) { return vnegq_f32(x); }
+static MAG_AINLINE float32x4_t mag_simd_sqr(float32x4_t x) { return vmulq_f32(x, x); }
+static MAG_AINLINE float32x4_t mag_simd_sqrt(float32x4_t x) { return vsqrtq_f32(x); }
+static MAG_AINLINE float32x4_t mag_simd_relu(float32x4_t x) { return vmaxq_f32(x, vdupq_n_f32(0.0f)); }
+
+/* Binary variant of mag_simd_map_f32, o = fn(x, y). Both overlapping tails are loaded before the first store. */
+#define mag_simd_map2_f32(fn, numel, o, x, y, i) \
+    if ((numel) >= 4) { \
+        float32x4_t tx = vld1q_f32((x)+(numel)-4); \
+        float32x4_t ty = vld1q_f32((y)+(numel)-4); \
+        for (; (i)+3 < (numel); (i) += 4) \
+            vst1q_f32((o)+(i), fn(vld1q_f32((x)+(i)), vld1q_f32((y)+(i)))); \
+        if ((i) < (numel)) vst1q_f32((o)+(numel)-4, fn(tx, ty)); \
+        (i) = (numel); \
+    }
+
+/* Binary variant with a scalar right operand, o = fn(x, s). */
+#define mag_simd_map2s_f32(fn, numel, o, x, s, i) \
+    if ((numel) >= 4) { \
+        float32x4_t vs = vdupq_n_f32(s); \
+        float32x4_t tx = vld1q_f32((x)+(numel)-4); \
+        for (; (i)+3 < (numel); (i) += 4) \
+            vst1q_f32((o)+(i), fn(vld1q_f32((x)+(i)), vs)); \
+        if ((i) < (numel)) vst1q_f32((o)+(numel)-4, fn(tx, vs)); \
+        (i) = (numel); \
+    }
+
+#define MAG_SIMD_LOG_SINCOS /* SIMD log, sin and cos available */
+
+#elif defined(__AVX512F__) && defined(__AVX512DQ__)
 
 static __m512 mag_simd_expf(const __m512 x) { /* exp(x) : ℝ -> (0, ∞), x |-> e^x. Error = 1.45358 + 0.5 ulps. x > 88.38 -> INF, x < -103.97 -> 0 */
     __m512 r = _mm512_set1_ps(0x1.8p23f);
@@ -163,12 +285,72 @@ static __m512 mag_simd_tanh(__m512 x) { /* tanh' : ℝ -> (-1, 1), x |-> 1 / ((c
     __m512 b = mag_simd_expf(a);
     __m512 c = _mm512_add_ps(one, b);
     __m512 inv = _mm512_rcp14_ps(c);
-    inv = _mm512_mul_ps(_mm512_rcp14_ps(_mm512_mul_ps(c, inv)), inv); /* Newton–Raphson method */
-    inv = _mm512_mul_ps(_mm512_rcp14_ps(_mm512_mul_ps(c, inv)), inv); /* Newton–Raphson method */
+    inv = _mm512_mul_ps(_mm512_fnmadd_ps(c, inv, two), inv); /* Newton–Raphson method */
+    inv = _mm512_mul_ps(_mm512_fnmadd_ps(c, inv, two), inv); /* Newton–Raphson method */
     return _mm512_fmadd_ps(two, inv, neg_one);
 }
 
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
+static __m512 mag_simd_sigmoid(__m512 x) { /* σ : ℝ -> (0, 1), x |-> 1/(1 + e^(-x)) */
+    __m512 one = _mm512_set1_ps(1.0f);
+    return _mm512_div_ps(one, _mm512_add_ps(one, mag_simd_expf(_mm512_sub_ps(_mm512_setzero_ps(), x))));
+}
+
+static __m512 mag_simd_silu(__m512 x) { /* silu : ℝ -> ℝ, x |-> x/(1 + e^(-x)) */
+    __m512 one = _mm512_set1_ps(1.0f);
+    return _mm512_div_ps(x, _mm512_add_ps(one, mag_simd_expf(_mm512_sub_ps(_mm512_setzero_ps(), x))));
+}
+
+static __m512 mag_simd_gelu(__m512 x) { /* gelu : ℝ -> ℝ, tanh approximation */
+    __m512 half = _mm512_set1_ps(0.5f);
+    __m512 one = _mm512_set1_ps(1.0f);
+    __m512 coeff1 = _mm512_set1_ps(0.79788456080286535587989211986876f);
+    __m512 coeff2 = _mm512_set1_ps(MAG_GELU_COEFF);
+    __m512 a = _mm512_fmadd_ps(coeff2, _mm512_mul_ps(x, x), one);
+    __m512 b = _mm512_add_ps(one, mag_simd_tanh(_mm512_mul_ps(coeff1, _mm512_mul_ps(x, a))));
+    return _mm512_mul_ps(half, _mm512_mul_ps(x, b));
+}
+
+/* Applies fn to numel elements. The tail is processed with a masked load/store, so no scalar leftovers remain. */
+#define mag_simd_map_f32(fn, numel, o, x, i) \
+    for (; (i)+15 < (numel); (i) += 16) \
+        _mm512_storeu_ps((o)+(i), fn(_mm512_loadu_ps((x)+(i)))); \
+    if ((i) < (numel)) { \
+        __mmask16 tail = (__mmask16)((1u<<((numel)-(i)))-1); \
+        _mm512_mask_storeu_ps((o)+(i), tail, fn(_mm512_maskz_loadu_ps(tail, (x)+(i)))); \
+        (i) = (numel); \
+    }
+
+static MAG_AINLINE __m512 mag_simd_add(__m512 x, __m512 y) { return _mm512_add_ps(x, y); }
+static MAG_AINLINE __m512 mag_simd_sub(__m512 x, __m512 y) { return _mm512_sub_ps(x, y); }
+static MAG_AINLINE __m512 mag_simd_mul(__m512 x, __m512 y) { return _mm512_mul_ps(x, y); }
+static MAG_AINLINE __m512 mag_simd_div(__m512 x, __m512 y) { return _mm512_div_ps(x, y); }
+static MAG_AINLINE __m512 mag_simd_abs(__m512 x) { return _mm512_abs_ps(x); }
+static MAG_AINLINE __m512 mag_simd_neg(__m512 x) { return _mm512_xor_ps(x, _mm512_set1_ps(-0.0f)); }
+static MAG_AINLINE __m512 mag_simd_sqr(__m512 x) { return _mm512_mul_ps(x, x); }
+static MAG_AINLINE __m512 mag_simd_sqrt(__m512 x) { return _mm512_sqrt_ps(x); }
+static MAG_AINLINE __m512 mag_simd_relu(__m512 x) { return _mm512_max_ps(x, _mm512_setzero_ps()); }
+
+/* Binary variant of mag_simd_map_f32, o = fn(x, y). */
+#define mag_simd_map2_f32(fn, numel, o, x, y, i) \
+    for (; (i)+15 < (numel); (i) += 16) \
+        _mm512_storeu_ps((o)+(i), fn(_mm512_loadu_ps((x)+(i)), _mm512_loadu_ps((y)+(i)))); \
+    if ((i) < (numel)) { \
+        __mmask16 tail = (__mmask16)((1u<<((numel)-(i)))-1); \
+        _mm512_mask_storeu_ps((o)+(i), tail, fn(_mm512_maskz_loadu_ps(tail, (x)+(i)), _mm512_maskz_loadu_ps(tail, (y)+(i)))); \
+        (i) = (numel); \
+    }
+
+/* Binary variant with a scalar right operand, o = fn(x, s). */
+#define mag_simd_map2s_f32(fn, numel, o, x, s, i) \
+    for (__m512 vs = _mm512_set1_ps(s); (i)+15 < (numel); (i) += 16) \
+        _mm512_storeu_ps((o)+(i), fn(_mm512_loadu_ps((x)+(i)), vs)); \
+    if ((i) < (numel)) { \
+        __mmask16 tail = (__mmask16)((1u<<((numel)-(i)))-1); \
+        _mm512_mask_storeu_ps((o)+(i), tail, fn(_mm512_maskz_loadu_ps(tail, (x)+(i)), _mm512_set1_ps(s))); \
+        (i) = (numel); \
+    }
+
+#elif defined(__AVX2__) && defined(__FMA__)
 
 static __m256 mag_simd_expf(const __m256 x) { /* exp(x) : ℝ -> (0, ∞), x |-> e^x. Error = 1.45358 + 0.5 ulps. x > 88.38 -> INF, x < -103.97 -> 0 */
     __m256 r = _mm256_set1_ps(0x1.8p23f);
@@ -205,12 +387,78 @@ static __m256 mag_simd_tanh(__m256 x) { /* tanh' : ℝ -> (-1, 1), x |-> 1 / ((c
     __m256 b = mag_simd_expf(a);
     __m256 c = _mm256_add_ps(one, b);
     __m256 inv = _mm256_rcp_ps(c);
-    inv = _mm256_mul_ps(_mm256_rcp_ps(_mm256_mul_ps(c, inv)), inv); /* Newton–Raphson method */
-    inv = _mm256_mul_ps(_mm256_rcp_ps(_mm256_mul_ps(c, inv)), inv); /* Newton–Raphson method */
+    inv = _mm256_mul_ps(_mm256_fnmadd_ps(c, inv, two), inv); /* Newton–Raphson method */
+    inv = _mm256_mul_ps(_mm256_fnmadd_ps(c, inv, two), inv); /* Newton–Raphson method */
     return _mm256_fmadd_ps(two, inv, neg_one);
 }
 
-#elif MAG_APPROXMATH && defined(__SSE2__)
+static __m256 mag_simd_sigmoid(__m256 x) { /* σ : ℝ -> (0, 1), x |-> 1/(1 + e^(-x)) */
+    __m256 one = _mm256_set1_ps(1.0f);
+    return _mm256_div_ps(one, _mm256_add_ps(one, mag_simd_expf(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+}
+
+static __m256 mag_simd_silu(__m256 x) { /* silu : ℝ -> ℝ, x |-> x/(1 + e^(-x)) */
+    __m256 one = _mm256_set1_ps(1.0f);
+    return _mm256_div_ps(x, _mm256_add_ps(one, mag_simd_expf(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+}
+
+static __m256 mag_simd_gelu(__m256 x) { /* gelu : ℝ -> ℝ, tanh approximation */
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 coeff1 = _mm256_set1_ps(0.79788456080286535587989211986876f);
+    __m256 coeff2 = _mm256_set1_ps(MAG_GELU_COEFF);
+    __m256 a = _mm256_fmadd_ps(coeff2, _mm256_mul_ps(x, x), one);
+    __m256 b = _mm256_add_ps(one, mag_simd_tanh(_mm256_mul_ps(coeff1, _mm256_mul_ps(x, a))));
+    return _mm256_mul_ps(half, _mm256_mul_ps(x, b));
+}
+
+/*
+** Applies fn to numel elements. The tail is handled by recomputing the last full vector, overlapping already processed elements.
+** The overlapping input is loaded before the first store, so in-place ops (o == x) stay correct.
+** Only vectors shorter than one register are left to the scalar loop of the caller.
+*/
+#define mag_simd_map_f32(fn, numel, o, x, i) \
+    if ((numel) >= 8) { \
+        __m256 tail = _mm256_loadu_ps((x)+(numel)-8); \
+        for (; (i)+7 < (numel); (i) += 8) \
+            _mm256_storeu_ps((o)+(i), fn(_mm256_loadu_ps((x)+(i)))); \
+        if ((i) < (numel)) _mm256_storeu_ps((o)+(numel)-8, fn(tail)); \
+        (i) = (numel); \
+    }
+
+static MAG_AINLINE __m256 mag_simd_add(__m256 x, __m256 y) { return _mm256_add_ps(x, y); }
+static MAG_AINLINE __m256 mag_simd_sub(__m256 x, __m256 y) { return _mm256_sub_ps(x, y); }
+static MAG_AINLINE __m256 mag_simd_mul(__m256 x, __m256 y) { return _mm256_mul_ps(x, y); }
+static MAG_AINLINE __m256 mag_simd_div(__m256 x, __m256 y) { return _mm256_div_ps(x, y); }
+static MAG_AINLINE __m256 mag_simd_abs(__m256 x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+static MAG_AINLINE __m256 mag_simd_neg(__m256 x) { return _mm256_xor_ps(x, _mm256_set1_ps(-0.0f)); }
+static MAG_AINLINE __m256 mag_simd_sqr(__m256 x) { return _mm256_mul_ps(x, x); }
+static MAG_AINLINE __m256 mag_simd_sqrt(__m256 x) { return _mm256_sqrt_ps(x); }
+static MAG_AINLINE __m256 mag_simd_relu(__m256 x) { return _mm256_max_ps(x, _mm256_setzero_ps()); }
+
+/* Binary variant of mag_simd_map_f32, o = fn(x, y). Both overlapping tails are loaded before the first store. */
+#define mag_simd_map2_f32(fn, numel, o, x, y, i) \
+    if ((numel) >= 8) { \
+        __m256 tx = _mm256_loadu_ps((x)+(numel)-8); \
+        __m256 ty = _mm256_loadu_ps((y)+(numel)-8); \
+        for (; (i)+7 < (numel); (i) += 8) \
+            _mm256_storeu_ps((o)+(i), fn(_mm256_loadu_ps((x)+(i)), _mm256_loadu_ps((y)+(i)))); \
+        if ((i) < (numel)) _mm256_storeu_ps((o)+(numel)-8, fn(tx, ty)); \
+        (i) = (numel); \
+    }
+
+/* Binary variant with a scalar right operand, o = fn(x, s). */
+#define mag_simd_map2s_f32(fn, numel, o, x, s, i) \
+    if ((numel) >= 8) { \
+        __m256 vs = _mm256_set1_ps(s); \
+        __m256 tx = _mm256_loadu_ps((x)+(numel)-8); \
+        for (; (i)+7 < (numel); (i) += 8) \
+            _mm256_storeu_ps((o)+(i), fn(_mm256_loadu_ps((x)+(i)), vs)); \
+        if ((i) < (numel)) _mm256_storeu_ps((o)+(numel)-8, fn(tx, vs)); \
+        (i) = (numel); \
+    }
+
+#elif defined(__SSE2__)
 static __m128 mag_simd_expf(const __m128 x) { /* exp(x) : ℝ -> (0, ∞), x |-> e^x. Error = 1.45358 + 0.5 ulps. x > 88.38 -> INF, x < -103.97 -> 0 */
     __m128 r = _mm_set1_ps(0x1.8p23f);
     __m128 z = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(0x1.715476p+0f)), r);
@@ -245,8 +493,8 @@ static __m128 mag_simd_tanh(__m128 x) { /* tanh' : ℝ -> (-1, 1), x |-> 1 / ((c
     __m128 b = mag_simd_expf(a);
     __m128 c = _mm_add_ps(one, b);
     __m128 inv = _mm_rcp_ps(c);
-    inv = _mm_mul_ps(_mm_rcp_ps(_mm_mul_ps(c, inv)), inv); /* Newton–Raphson method */
-    inv = _mm_mul_ps(_mm_rcp_ps(_mm_mul_ps(c, inv)), inv); /* Newton–Raphson method */
+    inv = _mm_mul_ps(_mm_sub_ps(two, _mm_mul_ps(c, inv)), inv); /* Newton–Raphson method */
+    inv = _mm_mul_ps(_mm_sub_ps(two, _mm_mul_ps(c, inv)), inv); /* Newton–Raphson method */
     return _mm_add_ps(neg_one, _mm_mul_ps(two, inv));
 }
 
@@ -255,17 +503,17 @@ static void mag_simd_sincos(__m128 x, __m128 *osin, __m128 *ocos) {
     __m128i sign_mask_sin = _mm_castps_si128(sign_mask_sin_ps);
     x = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
     __m128 y = _mm_mul_ps(x, _mm_set1_ps(1.27323954473516f));
-    __m128i emm2 = _mm_cvtps_epi32(y);
+    __m128i emm2 = _mm_cvttps_epi32(y);
     emm2 = _mm_add_epi32(emm2, _mm_set1_epi32(1));
     emm2 = _mm_and_si128(emm2, _mm_set1_epi32(~1));
     y = _mm_cvtepi32_ps(emm2);
-    __m128i poly_mask = _mm_cmpeq_epi32(emm2, _mm_set1_epi32(2));
+    __m128i poly_mask = _mm_cmpeq_epi32(_mm_and_si128(emm2, _mm_set1_epi32(2)), _mm_set1_epi32(2));
     x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
     x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
     x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
-    __m128i tmp = _mm_cmpeq_epi32(emm2, _mm_set1_epi32(4));
+    __m128i tmp = _mm_cmpeq_epi32(_mm_and_si128(emm2, _mm_set1_epi32(4)), _mm_set1_epi32(4));
     sign_mask_sin = _mm_xor_si128(sign_mask_sin, tmp);
-    __m128i sign_mask_cos = _mm_cmpeq_epi32(_mm_sub_epi32(emm2, _mm_set1_epi32(2)), _mm_set1_epi32(4));
+    __m128i sign_mask_cos = _mm_cmpeq_epi32(_mm_and_si128(_mm_sub_epi32(emm2, _mm_set1_epi32(2)), _mm_set1_epi32(4)), _mm_set1_epi32(4));
     __m128 z = _mm_mul_ps(x, x);
     __m128 y1 = _mm_add_ps(_mm_set1_ps(-1.388731625493765e-003f), _mm_mul_ps(z, _mm_set1_ps(2.443315711809948e-005f)));
     __m128 y2 = _mm_add_ps(_mm_set1_ps(8.3321608736e-3f), _mm_mul_ps(z, _mm_set1_ps(-1.9515295891e-4f)));
@@ -290,6 +538,119 @@ static void mag_simd_sincos(__m128 x, __m128 *osin, __m128 *ocos) {
     *ocos = ocos_ps;
 }
 
+
+static __m128 mag_simd_logf(__m128 xi) { /* log x : (0, ∞) -> ℝ, NaN for x <= 0 */
+    const __m128 one = _mm_set1_ps(1.0f);
+    xi = _mm_max_ps(xi, _mm_set1_ps(0.0f));
+    __m128 invalid_mask = _mm_cmple_ps(xi, _mm_set1_ps(0.0f));
+    __m128i ux = _mm_castps_si128(xi);
+    __m128i emm0 = _mm_srli_epi32(ux, 23);
+    ux = _mm_and_si128(ux, _mm_set1_epi32(~0x7f800000u));
+    ux = _mm_or_si128(ux, _mm_castps_si128(_mm_set1_ps(0.5f)));
+    xi = _mm_castsi128_ps(ux);
+    emm0 = _mm_sub_epi32(emm0, _mm_set1_epi32(0x7f));
+    __m128 e = _mm_cvtepi32_ps(emm0);
+    e = _mm_add_ps(e, one);
+    __m128 mask = _mm_cmplt_ps(xi, _mm_set1_ps(0.707106781186547524f));
+    __m128 tmp = _mm_and_ps(xi, mask);
+    xi = _mm_sub_ps(xi, one);
+    e = _mm_sub_ps(e, _mm_and_ps(one, mask));
+    xi = _mm_add_ps(xi, tmp);
+    __m128 z = _mm_mul_ps(xi, xi);
+    __m128 y = _mm_set1_ps(7.0376836292e-2f);
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-1.1514610310e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(1.1676998740e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-1.2420140846e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(1.4249322787e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-1.6668057665e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(2.0000714765e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-2.4999993993e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(3.3333331174e-1f));
+    y = _mm_mul_ps(y, xi);
+    y = _mm_mul_ps(y, z);
+    y = _mm_add_ps(_mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)), y);
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    xi = _mm_add_ps(xi, y);
+    xi = _mm_add_ps(_mm_mul_ps(e, _mm_set1_ps(0.693359375f)), xi);
+    xi = _mm_or_ps(xi, invalid_mask);
+    return xi;
+}
+
+static __m128 mag_simd_sinf(__m128 x) {
+    __m128 osin, ocos;
+    mag_simd_sincos(x, &osin, &ocos);
+    return osin;
+}
+
+static __m128 mag_simd_cosf(__m128 x) {
+    __m128 osin, ocos;
+    mag_simd_sincos(x, &osin, &ocos);
+    return ocos;
+}
+
+static __m128 mag_simd_sigmoid(__m128 x) { /* σ : ℝ -> (0, 1), x |-> 1/(1 + e^(-x)) */
+    __m128 one = _mm_set1_ps(1.0f);
+    return _mm_div_ps(one, _mm_add_ps(one, mag_simd_expf(_mm_sub_ps(_mm_setzero_ps(), x))));
+}
+
+static __m128 mag_simd_silu(__m128 x) { /* silu : ℝ -> ℝ, x |-> x/(1 + e^(-x)) */
+    __m128 one = _mm_set1_ps(1.0f);
+    return _mm_div_ps(x, _mm_add_ps(one, mag_simd_expf(_mm_sub_ps(_mm_setzero_ps(), x))));
+}
+
+static __m128 mag_simd_gelu(__m128 x) { /* gelu : ℝ -> ℝ, tanh approximation */
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 coeff1 = _mm_set1_ps(0.79788456080286535587989211986876f);
+    __m128 coeff2 = _mm_set1_ps(MAG_GELU_COEFF);
+    __m128 a = _mm_add_ps(one, _mm_mul_ps(coeff2, _mm_mul_ps(x, x)));
+    __m128 b = _mm_add_ps(one, mag_simd_tanh(_mm_mul_ps(coeff1, _mm_mul_ps(x, a))));
+    return _mm_mul_ps(half, _mm_mul_ps(x, b));
+}
+
+/* Applies fn to numel elements, with an overlapping last vector like the AVX2 and NEON variants. */
+#define mag_simd_map_f32(fn, numel, o, x, i) \
+    if ((numel) >= 4) { \
+        __m128 tail = _mm_loadu_ps((x)+(numel)-4); \
+        for (; (i)+3 < (numel); (i) += 4) \
+            _mm_storeu_ps((o)+(i), fn(_mm_loadu_ps((x)+(i)))); \
+        if ((i) < (numel)) _mm_storeu_ps((o)+(numel)-4, fn(tail)); \
+        (i) = (numel); \
+    }
+
+static MAG_AINLINE __m128 mag_simd_add(__m128 x, __m128 y) { return _mm_add_ps(x, y); }
+static MAG_AINLINE __m128 mag_simd_sub(__m128 x, __m128 y) { return _mm_sub_ps(x, y); }
+static MAG_AINLINE __m128 mag_simd_mul(__m128 x, __m128 y) { return _mm_mul_ps(x, y); }
+static MAG_AINLINE __m128 mag_simd_div(__m128 x, __m128 y) { return _mm_div_ps(x, y); }
+static MAG_AINLINE __m128 mag_simd_abs(__m128 x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+static MAG_AINLINE __m128 mag_simd_neg(__m128 x) { return _mm_xor_ps(x, _mm_set1_ps(-0.0f)); }
+static MAG_AINLINE __m128 mag_simd_sqr(__m128 x) { return _mm_mul_ps(x, x); }
+static MAG_AINLINE __m128 mag_simd_sqrt(__m128 x) { return _mm_sqrt_ps(x); }
+static MAG_AINLINE __m128 mag_simd_relu(__m128 x) { return _mm_max_ps(x, _mm_setzero_ps()); }
+
+/* Binary variant of mag_simd_map_f32, o = fn(x, y), with overlapping last vectors. */
+#define mag_simd_map2_f32(fn, numel, o, x, y, i) \
+    if ((numel) >= 4) { \
+        __m128 tx = _mm_loadu_ps((x)+(numel)-4); \
+        __m128 ty = _mm_loadu_ps((y)+(numel)-4); \
+        for (; (i)+3 < (numel); (i) += 4) \
+            _mm_storeu_ps((o)+(i), fn(_mm_loadu_ps((x)+(i)), _mm_loadu_ps((y)+(i)))); \
+        if ((i) < (numel)) _mm_storeu_ps((o)+(numel)-4, fn(tx, ty)); \
+        (i) = (numel); \
+    }
+
+/* Binary variant with a scalar right operand, o = fn(x, s). */
+#define mag_simd_map2s_f32(fn, numel, o, x, s, i) \
+    if ((numel) >= 4) { \
+        __m128 vs = _mm_set1_ps(s); \
+        __m128 tx = _mm_loadu_ps((x)+(numel)-4); \
+        for (; (i)+3 < (numel); (i) += 4) \
+            _mm_storeu_ps((o)+(i), fn(_mm_loadu_ps((x)+(i)), vs)); \
+        if ((i) < (numel)) _mm_storeu_ps((o)+(numel)-4, fn(tx, vs)); \
+        (i) = (numel); \
+    }
+
+#define MAG_SIMD_LOG_SINCOS /* SIMD log, sin and cos available */
 #endif
 
 static void MAG_HOTPROC mag_vadd_f32(
@@ -301,7 +662,11 @@ static void MAG_HOTPROC mag_vadd_f32(
 #ifdef MAG_ACCELERATE
     vDSP_vadd(y, 1, x, 1, o, 1, numel);
 #else
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2_f32
+    mag_simd_map2_f32(mag_simd_add, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] + y[i];
     }
 #endif
@@ -316,7 +681,11 @@ static void MAG_HOTPROC mag_vsub_f32(
 #ifdef MAG_ACCELERATE
     vDSP_vsub(y, 1, x, 1, o, 1, numel);
 #else
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2_f32
+    mag_simd_map2_f32(mag_simd_sub, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] - y[i];
     }
 #endif
@@ -331,7 +700,11 @@ static void MAG_HOTPROC mag_vmul_f32(
 #ifdef MAG_ACCELERATE
     vDSP_vmul(y, 1, x, 1, o, 1, numel);
 #else
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2_f32
+    mag_simd_map2_f32(mag_simd_mul, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] * y[i];
     }
 #endif
@@ -346,7 +719,11 @@ static void MAG_HOTPROC mag_vdiv_f32(
 #ifdef MAG_ACCELERATE
     vDSP_vdiv(y, 1, x, 1, o, 1, numel);
 #else
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2_f32
+    mag_simd_map2_f32(mag_simd_div, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] / y[i];
     }
 #endif
@@ -358,7 +735,11 @@ static void MAG_HOTPROC mag_vadds_f32(
     const mag_f32_t* x,
     const mag_f32_t y
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2s_f32
+    mag_simd_map2s_f32(mag_simd_add, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] + y;
     }
 }
@@ -369,7 +750,11 @@ static void MAG_HOTPROC mag_vsubs_f32(
     const mag_f32_t* x,
     const mag_f32_t y
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2s_f32
+    mag_simd_map2s_f32(mag_simd_sub, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] - y;
     }
 }
@@ -380,7 +765,11 @@ static void MAG_HOTPROC mag_vmuls_f32(
     const mag_f32_t* x,
     const mag_f32_t y
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2s_f32
+    mag_simd_map2s_f32(mag_simd_mul, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] * y;
     }
 }
@@ -391,7 +780,11 @@ static void MAG_HOTPROC mag_vdivs_f32(
     const mag_f32_t* x,
     const mag_f32_t y
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map2s_f32
+    mag_simd_map2s_f32(mag_simd_div, numel, o, x, y, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] / y;
     }
 }
@@ -565,7 +958,11 @@ static void MAG_HOTPROC mag_vabs_f32( /* o = |x| */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_abs, numel, o, x, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = fabsf(x[i]);
     }
 }
@@ -575,7 +972,11 @@ static void MAG_HOTPROC mag_vneg_f32( /* o = -x */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_neg, numel, o, x, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = -x[i];
     }
 }
@@ -585,87 +986,19 @@ static void MAG_HOTPROC mag_vlog_f32( /* o = log x */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    const float32x4_t one = vdupq_n_f32(1);
-    for (; i+3 < numel; i += 4) {
-        float32x4_t xi = vld1q_f32(x+i);
-        xi = vmaxq_f32(xi, vdupq_n_f32(0));
-        uint32x4_t invalid_mask = vcleq_f32(xi, vdupq_n_f32(0));
-        int32x4_t ux = vreinterpretq_s32_f32(xi);
-        int32x4_t emm0 = vshrq_n_s32(ux, 23);
-        ux = vandq_s32(ux, vdupq_n_s32(~0x7f800000u));
-        ux = vorrq_s32(ux, vreinterpretq_s32_f32(vdupq_n_f32(0.5f)));
-        xi = vreinterpretq_f32_s32(ux);
-        emm0 = vsubq_s32(emm0, vdupq_n_s32(0x7f));
-        float32x4_t e = vcvtq_f32_s32(emm0);
-        e = vaddq_f32(e, one);
-        uint32x4_t mask = vcltq_f32(xi, vdupq_n_f32(0.707106781186547524f));
-        float32x4_t tmp = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(xi), mask));
-        xi = vsubq_f32(xi, one);
-        e = vsubq_f32(e, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(one), mask)));
-        xi = vaddq_f32(xi, tmp);
-        float32x4_t z = vmulq_f32(xi, xi);
-        float32x4_t y = vdupq_n_f32(7.0376836292e-2f);
-        y = vmlaq_f32(vdupq_n_f32(-1.1514610310e-1f), y, xi);
-        y = vmlaq_f32(vdupq_n_f32(1.1676998740e-1f), y, xi);
-        y = vmlaq_f32(vdupq_n_f32(-1.2420140846e-1f), y, xi);
-        y = vmlaq_f32(vdupq_n_f32(1.4249322787e-1f), y, xi);
-        y = vmlaq_f32(vdupq_n_f32(-1.6668057665e-1f), y, xi);
-        y = vmlaq_f32(vdupq_n_f32(2.0000714765e-1f), y, xi);
-        y = vmlaq_f32(vdupq_n_f32(-2.4999993993e-1f), y, xi);
-        y = vmlaq_f32(vdupq_n_f32(3.3333331174e-1f), y, xi);
-        y = vmulq_f32(y, xi);
-        y = vmulq_f32(y, z);
-        y = vmlaq_f32(y, e, vdupq_n_f32(-2.12194440e-4f));
-        y = vmlsq_f32(y, z, vdupq_n_f32(0.5f));
-        xi = vaddq_f32(xi, y);
-        xi = vmlaq_f32(xi, e, vdupq_n_f32(0.693359375f));
-        xi = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(xi), invalid_mask));
-        vst1q_f32(o+i, xi);
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-/* TODO */
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-/* TODO */
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    const __m128 one = _mm_set1_ps(1.0f);
-    for (; i+3 < numel; i += 4) {
-        __m128 xi = _mm_loadu_ps(x+i);
-        xi = _mm_max_ps(xi, _mm_set1_ps(0.0f));
-        __m128 invalid_mask = _mm_cmple_ps(xi, _mm_set1_ps(0.0f));
-        __m128i ux = _mm_castps_si128(xi);
-        __m128i emm0 = _mm_srli_epi32(ux, 23);
-        ux = _mm_and_si128(ux, _mm_set1_epi32(~0x7f800000u));
-        ux = _mm_or_si128(ux, _mm_castps_si128(_mm_set1_ps(0.5f)));
-        xi = _mm_castsi128_ps(ux);
-        emm0 = _mm_sub_epi32(emm0, _mm_set1_epi32(0x7f));
-        __m128 e = _mm_cvtepi32_ps(emm0);
-        e = _mm_add_ps(e, one);
-        __m128 mask = _mm_cmplt_ps(xi, _mm_set1_ps(0.707106781186547524f));
-        __m128 tmp = _mm_and_ps(xi, mask);
-        xi = _mm_sub_ps(xi, one);
-        e = _mm_sub_ps(e, _mm_and_ps(one, mask));
-        xi = _mm_add_ps(xi, tmp);
-        __m128 z = _mm_mul_ps(xi, xi);
-        __m128 y = _mm_set1_ps(7.0376836292e-2f);
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-1.1514610310e-1f));
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(1.1676998740e-1f));
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-1.2420140846e-1f));
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(1.4249322787e-1f));
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-1.6668057665e-1f));
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(2.0000714765e-1f));
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(-2.4999993993e-1f));
-        y = _mm_add_ps(_mm_mul_ps(y, xi), _mm_set1_ps(3.3333331174e-1f));
-        y = _mm_mul_ps(y, xi);
-        y = _mm_mul_ps(y, z);
-        y = _mm_add_ps(_mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)), y);
-        y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
-        xi = _mm_add_ps(xi, y);
-        xi = _mm_add_ps(_mm_mul_ps(e, _mm_set1_ps(0.693359375f)), xi);
-        xi = _mm_or_ps(xi, invalid_mask);
-        _mm_storeu_ps(o+i, xi);
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = logf(x[i]);
     }
+}
+
+static void MAG_HOTPROC mag_vlog_approx_f32( /* o = log x */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef MAG_SIMD_LOG_SINCOS
+    mag_simd_map_f32(mag_simd_logf, numel, o, x, i);
 #endif
     for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = logf(x[i]);
@@ -677,7 +1010,11 @@ static void MAG_HOTPROC mag_vsqr_f32( /* o = x² */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    for (int64_t i=0; i < numel; ++i)
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_sqr, numel, o, x, i);
+#endif
+    for (; i < numel; ++i) /* Process leftovers scalar-wise */
         o[i] = x[i]*x[i];
 }
 
@@ -686,7 +1023,11 @@ static void MAG_HOTPROC mag_vsqrt_f32( /* o = √x */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_sqrt, numel, o, x, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = sqrtf(x[i]);
     }
 }
@@ -696,25 +1037,19 @@ static void MAG_HOTPROC mag_vsin_f32( /* o = sin x */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-       int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    for (; i+3 < numel; i += 4) {
-        float32x4_t xi = vld1q_f32(x+i);
-        float32x4_t ocos;
-        mag_simd_sincos(xi, &xi, &ocos);
-        vst1q_f32(o+i, xi);
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-    /* TODO */
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-    /* TODO */
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    for (; i+3 < numel; i += 4) {
-        __m128 xi = _mm_loadu_ps(x+i);
-        __m128 ocos;
-        mag_simd_sincos(xi, &xi, &ocos);
-        _mm_storeu_ps(o+i, xi);
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = sinf(x[i]);
     }
+}
+
+static void MAG_HOTPROC mag_vsin_approx_f32( /* o = sin x */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef MAG_SIMD_LOG_SINCOS
+    mag_simd_map_f32(mag_simd_sinf, numel, o, x, i);
 #endif
     for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = sinf(x[i]);
@@ -726,25 +1061,19 @@ static void MAG_HOTPROC mag_vcos_f32( /* o = cos x */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    for (; i+3 < numel; i += 4) {
-        float32x4_t xi = vld1q_f32(x+i);
-        float32x4_t osin;
-        mag_simd_sincos(xi, &osin, &xi);
-        vst1q_f32(o+i, xi);
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-    /* TODO */
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-    /* TODO */
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    for (; i+3 < numel; i += 4) {
-        __m128 xi = _mm_loadu_ps(x+i);
-        __m128 osin;
-        mag_simd_sincos(xi, &osin, &xi);
-        _mm_storeu_ps(o+i, xi);
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = cosf(x[i]);
     }
+}
+
+static void MAG_HOTPROC mag_vcos_approx_f32( /* o = cos x */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef MAG_SIMD_LOG_SINCOS
+    mag_simd_map_f32(mag_simd_cosf, numel, o, x, i);
 #endif
     for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = cosf(x[i]);
@@ -766,25 +1095,23 @@ static void MAG_HOTPROC mag_vsoftmax_f32( /* softmax : ℝ -> (0, ∞), x |-> e^
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    for (; i+3 < numel; i += 4) {
-        vst1q_f32(o+i, mag_simd_expf(vld1q_f32(x+i)));
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-    for (; i+15 < numel; i += 16) {
-        _mm512_storeu_ps(o+i, mag_simd_expf(_mm512_loadu_ps(x+i)));
-    }
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-    for (; i+7 < numel; i += 8) {
-        _mm256_storeu_ps(o+i, mag_simd_expf(_mm256_loadu_ps(x+i)));
-    }
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    for (; i+3 < numel; i += 4) {
-        _mm_storeu_ps(o+i, mag_simd_expf(_mm_loadu_ps(x+i)));
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = expf(x[i]);
     }
+}
+
+static void MAG_HOTPROC mag_vsoftmax_approx_f32( /* softmax : ℝ -> (0, ∞), x |-> e^x */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_expf, numel, o, x, i);
 #endif
-    for (; i < numel; ++i) o[i] = expf(x[i]); /* Process leftovers scalar-wise */
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
+        o[i] = expf(x[i]);
+    }
 }
 
 static void MAG_HOTPROC mag_vsoftmax_dv_f32( /* softmax' = softmax : ℝ -> (0, ∞), x |-> e^x */
@@ -795,54 +1122,36 @@ static void MAG_HOTPROC mag_vsoftmax_dv_f32( /* softmax' = softmax : ℝ -> (0,
     mag_vsoftmax_f32(numel, o, x);
 }
 
+static void MAG_HOTPROC mag_vsoftmax_dv_approx_f32( /* softmax' = softmax : ℝ -> (0, ∞), x |-> e^x */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    mag_vsoftmax_approx_f32(numel, o, x);
+}
+
 static void MAG_HOTPROC mag_vsigmoid_f32( /* σ : ℝ -> (0, 1), x |-> 1/(1 + e^(-x)) */
     int64_t numel,
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    const float32x4_t one = vdupq_n_f32(1.0f);
-    const float32x4_t zero = vdupq_n_f32(0.0f);
-    for (; i+3 < numel; i += 4) {
-        float32x4_t xx = vld1q_f32(x+i);
-        float32x4_t neg_x = vsubq_f32(zero, xx);
-        float32x4_t exp_neg_x = mag_simd_expf(neg_x);
-        float32x4_t one_plus_exp_neg_x = vaddq_f32(one, exp_neg_x);
-        vst1q_f32(o+i, vdivq_f32(one, one_plus_exp_neg_x));
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-    __m512 one = _mm512_set1_ps(1.0f);
-    __m512 zero = _mm512_setzero_ps();
-    for (; i+15 < numel; i += 16) {
-        __m512 xx = _mm512_loadu_ps(x+i);
-        __m512 neg_x = _mm512_sub_ps(zero, xx);
-        __m512 exp_neg_x = mag_simd_expf(neg_x);
-        __m512 one_plus_exp_neg_x = _mm512_add_ps(one, exp_neg_x);
-        _mm512_storeu_ps(o+i, _mm512_div_ps(one, one_plus_exp_neg_x));
-    }
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-    __m256 one = _mm256_set1_ps(1.0f);
-    __m256 zero = _mm256_setzero_ps();
-    for (; i+7 < numel; i += 8) {
-        __m256 xx = _mm256_loadu_ps(x+i);
-        __m256 neg_x = _mm256_sub_ps(zero, xx);
-        __m256 exp_neg_x = mag_simd_expf(neg_x);
-        __m256 one_plus_exp_neg_x = _mm256_add_ps(one, exp_neg_x);
-        _mm256_storeu_ps(o+i, _mm256_div_ps(one, one_plus_exp_neg_x));
-    }
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    __m128 one = _mm_set1_ps(1.0f);
-    __m128 zero = _mm_setzero_ps();
-    for (; i+3 < numel; i += 4) {
-        __m128 xx = _mm_loadu_ps(x+i);
-        __m128 neg_x = _mm_sub_ps(zero, xx);
-        __m128 exp_neg_x = mag_simd_expf(neg_x);
-        __m128 one_plus_exp_neg_x = _mm_add_ps(one, exp_neg_x);
-        _mm_storeu_ps(o+i, _mm_div_ps(one, one_plus_exp_neg_x));
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = 1.0f / (1.0f + expf(-x[i]));
     }
+}
+
+static void MAG_HOTPROC mag_vsigmoid_approx_f32( /* σ : ℝ -> (0, 1), x |-> 1/(1 + e^(-x)) */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_sigmoid, numel, o, x, i);
 #endif
-    for (; i < numel; ++i) o[i] = 1.0f / (1.0f + expf(-x[i])); /* Process leftovers scalar-wise */
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
+        o[i] = 1.0f / (1.0f + expf(-x[i]));
+    }
 }
 
 static void MAG_HOTPROC mag_vsigmoid_dv_f32( /* σ' : ℝ -> (0, 1), x |-> x * (1-x) */
@@ -870,49 +1179,21 @@ static void MAG_HOTPROC mag_vsilu_f32( /* silu : ℝ -> ℝ, x |-> x/(1 + e^(-x)
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    float32x4_t one = vdupq_n_f32(1.0f);
-    float32x4_t zero = vdupq_n_f32(0.0f);
-    for (; i+3 < numel; i += 4) {
-        float32x4_t xx = vld1q_f32(x+i);
-        float32x4_t neg_x = vsubq_f32(zero, xx);
-        float32x4_t exp_neg_x = mag_simd_expf(neg_x);
-        float32x4_t one_plus_exp_neg_x = vaddq_f32(one, exp_neg_x);
-        vst1q_f32(o+i, vdivq_f32(xx, one_plus_exp_neg_x));
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-    __m512 one = _mm512_set1_ps(1);
-    __m512 zero = _mm512_setzero_ps();
-    for (; i+15 < numel; i += 16) {
-        __m512 xx = _mm512_loadu_ps(x+i);
-        __m512 neg_x = _mm512_sub_ps(zero, xx);
-        __m512 exp_neg_x = mag_simd_expf(neg_x);
-        __m512 one_plus_exp_neg_x = _mm512_add_ps(one, exp_neg_x);
-        _mm512_storeu_ps(o+i, _mm512_div_ps(xx, one_plus_exp_neg_x));
-    }
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-    __m256 one = _mm256_set1_ps(1);
-    __m256 zero = _mm256_setzero_ps();
-    for (; i+7 < numel; i += 8) {
-        const __m256 xx = _mm256_loadu_ps(x+i);
-        __m256 neg_x = _mm256_sub_ps(zero, xx);
-        __m256 exp_neg_x = mag_simd_expf(neg_x);
-        __m256 one_plus_exp_neg_x = _mm256_add_ps(one, exp_neg_x);
-        _mm256_storeu_ps(o+i, _mm256_div_ps(xx, one_plus_exp_neg_x));
-    }
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    __m128 one = _mm_set1_ps(1);
-    __m128 zero = _mm_setzero_ps();
-    for (; i+3 < numel; i += 4) {
-        __m128 xx = _mm_loadu_ps(x+i);
-        __m128 neg_x = _mm_sub_ps(zero, xx);
-        __m128 exp_neg_x = mag_simd_expf(neg_x);
-        __m128 one_plus_exp_neg_x = _mm_add_ps(one, exp_neg_x);
-        _mm_storeu_ps(o+i, _mm_div_ps(xx, one_plus_exp_neg_x));
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = x[i] / (1.0f + expf(-x[i]));
     }
+}
+
+static void MAG_HOTPROC mag_vsilu_approx_f32( /* silu : ℝ -> ℝ, x |-> x/(1 + e^(-x)) */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_silu, numel, o, x, i);
 #endif
-    for (; i < numel; ++i) {
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = x[i] / (1.0f + expf(-x[i]));
     }
 }
@@ -932,25 +1213,21 @@ static void MAG_HOTPROC mag_vtanh_f32( /* tanh : ℝ -> (-1, 1), x |-> tanh x */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    for (; i+3 < numel; i += 4) {
-        vst1q_f32(o+i, mag_simd_tanh(vld1q_f32(x+i)));
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-    for (; i+15 < numel; i += 16) {
-        _mm512_storeu_ps(o+i, mag_simd_tanh(_mm512_loadu_ps(x+i)));
-    }
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-    for (; i+7 < numel; i += 8) {
-        _mm256_storeu_ps(o+i, mag_simd_tanh(_mm256_loadu_ps(x+i)));
-    }
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    for (; i+3 < numel; i += 4) {
-        _mm_storeu_ps(o+i, mag_simd_tanh(_mm_loadu_ps(x+i)));
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = tanhf(x[i]);
     }
+}
+
+static void MAG_HOTPROC mag_vtanh_approx_f32( /* tanh : ℝ -> (-1, 1), x |-> tanh x */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_tanh, numel, o, x, i);
 #endif
-    for (; i < numel; ++i) {
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = tanhf(x[i]);
     }
 }
@@ -971,7 +1248,11 @@ static void MAG_HOTPROC mag_vrelu_f32( /* relu : ℝ -> ℝ^+, x |-> max {x, 0}
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    for (int64_t i=0; i < numel; ++i) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_relu, numel, o, x, i);
+#endif
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = mag_xmax(x[i], 0.0f);
     }
 }
@@ -991,57 +1272,21 @@ static void MAG_HOTPROC mag_vgelu_f32( /* gelu : ℝ -> ℝ, x |-> TODO */
     mag_f32_t* o,
     const mag_f32_t* x
 ) {
-    int64_t i=0;
-#if MAG_APPROXMATH && (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
-    float32x4_t half = vdupq_n_f32(0.5f);
-    float32x4_t one = vdupq_n_f32(1.0f);
-    float32x4_t coeff1 = vdupq_n_f32(0.79788456080286535587989211986876f);
-    float32x4_t coeff2 = vdupq_n_f32(MAG_GELU_COEFF);
-    for (; i+3 < numel; i += 4) {
-        float32x4_t xx = vld1q_f32(x+i);
-        float32x4_t a = vaddq_f32(one, vmulq_f32(coeff2, vmulq_f32(xx, xx)));
-        float32x4_t b = vaddq_f32(one, mag_simd_tanh(vmulq_f32(coeff1, vmulq_f32(xx, a))));
-        float32x4_t c = vmulq_f32(half, vmulq_f32(xx, b));
-        vst1q_f32(o+i, c);
-    }
-#elif MAG_APPROXMATH && defined(__AVX512F__) && defined(__AVX512DQ__)
-    __m512 half = _mm512_set1_ps(0.5f);
-    __m512 one = _mm512_set1_ps(1.0f);
-    __m512 coeff1 = _mm512_set1_ps(0.79788456080286535587989211986876f);
-    __m512 coeff2 = _mm512_set1_ps(MAG_GELU_COEFF);
-    for (; i+15 < numel; i += 16) {
-        __m512 xx = _mm512_loadu_ps(x+i);
-        __m512 a = _mm512_fmadd_ps(coeff2, _mm512_mul_ps(xx, xx), one);
-        __m512 b = _mm512_add_ps(one, mag_simd_tanh(_mm512_mul_ps(coeff1, _mm512_mul_ps(xx, a))));
-        __m512 c = _mm512_mul_ps(half, _mm512_mul_ps(xx, b));
-        _mm512_storeu_ps(o+i, c);
-    }
-#elif MAG_APPROXMATH && defined(__AVX2__) && defined(__FMA__)
-    __m256 half = _mm256_set1_ps(0.5f);
-    __m256 one = _mm256_set1_ps(1.0f);
-    __m256 coeff1 = _mm256_set1_ps(0.79788456080286535587989211986876f);
-    __m256 coeff2 = _mm256_set1_ps(MAG_GELU_COEFF);
-    for (; i+7 < numel; i += 8) {
-        __m256 xx = _mm256_loadu_ps(x+i);
-        __m256 a = _mm256_fmadd_ps(coeff2, _mm256_mul_ps(xx, xx), one);
-        __m256 b = _mm256_add_ps(one, mag_simd_tanh(_mm256_mul_ps(coeff1, _mm256_mul_ps(xx, a))));
-        __m256 c = _mm256_mul_ps(half, _mm256_mul_ps(xx, b));
-        _mm256_storeu_ps(o+i, c);
-    }
-#elif MAG_APPROXMATH && defined(__SSE2__)
-    __m128 half = _mm_set1_ps(0.5f);
-    __m128 one = _mm_set1_ps(1.0f);
-    __m128 coeff1 = _mm_set1_ps(0.79788456080286535587989211986876f);
-    __m128 coeff2 = _mm_set1_ps(MAG_GELU_COEFF);
-    for (; i+3 < numel; i += 4) {
-        __m128 xx = _mm_loadu_ps(x+i);
-        __m128 a = _mm_add_ps(one, _mm_mul_ps(coeff2, _mm_mul_ps(xx, xx)));
-        __m128 b = _mm_add_ps(one, mag_simd_tanh(_mm_mul_ps(coeff1, _mm_mul_ps(xx, a))));
-        __m128 c = _mm_mul_ps(half, _mm_mul_ps(xx, b));
-        _mm_storeu_ps(o+i, c);
+    for (int64_t i=0; i < numel; ++i) {
+        o[i] = 0.5f*x[i]*(1.0f + tanhf(0.79788456080286535587989211986876f*x[i]*(1.0f + MAG_GELU_COEFF*x[i]*x[i])));
     }
+}
+
+static void MAG_HOTPROC mag_vgelu_approx_f32( /* gelu : ℝ -> ℝ, x |-> TODO */
+    int64_t numel,
+    mag_f32_t* o,
+    const mag_f32_t* x
+) {
+    int64_t i=0;
+#ifdef mag_simd_map_f32
+    mag_simd_map_f32(mag_simd_gelu, numel, o, x, i);
 #endif
-    for (; i < numel; ++i) {
+    for (; i < numel; ++i) { /* Process leftovers scalar-wise */
         o[i] = 0.5f*x[i]*(1.0f + tanhf(0.79788456080286535587989211986876f*x[i]*(1.0f + MAG_GELU_COEFF*x[i]*x[i])));
     }
 }
@@ -1171,6 +1416,74 @@ static void MAG_HOTPROC mag_blas_sum_f32(const mag_compute_payload_t* payload) {
     *b_r = (mag_f32_t)sum;
 }
 
+#define MAG_BLAS_STREAM_BLOCK 1024 /* Elements per L1 resident staging block of streaming kernels. */
+
+static void mag_blas_prefetch_nta(const void* p, int64_t bytes) { /* Prefetch read-once data, minimizing cache pollution */
+    for (int64_t i=0; i < bytes; i += MAG_CACHE_LINE_SIZE) {
+        #if defined(__SSE__) || defined(_M_X64)
+            _mm_prefetch((const char*)p+i, _MM_HINT_NTA);
+        #elif defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch((const char*)p+i, 0, 0);
+        #endif
+    }
+}
+
+static void mag_blas_stream_store_f32(mag_f32_t* o, const mag_f32_t* x, int64_t numel) { /* o = x, with non-temporal stores bypassing the cache */
+    int64_t i=0;
+    #ifdef __AVX512F__
+        for (; i < numel && ((uintptr_t)(o+i) & 63); ++i) o[i] = x[i];
+        for (; i+15 < numel; i += 16)
+            _mm512_stream_ps(o+i, _mm512_loadu_ps(x+i));
+    #elif defined(__AVX__)
+        for (; i < numel && ((uintptr_t)(o+i) & 31); ++i) o[i] = x[i];
+        for (; i+7 < numel; i += 8)
+            _mm256_stream_ps(o+i, _mm256_loadu_ps(x+i));
+    #elif defined(__SSE2__) || defined(_M_X64)
+        for (; i < numel && ((uintptr_t)(o+i) & 15); ++i) o[i] = x[i];
+        for (; i+3 < numel; i += 4)
+            _mm_stream_ps(o+i, _mm_loadu_ps(x+i));
+    #elif defined(__aarch64__) && defined(__ARM_NEON) && (defined(__GNUC__) || defined(__clang__))
+        for (; i+7 < numel; i += 8) { /* STNP is a hint only, no alignment requirement */
+            float32x4_t a = vld1q_f32(x+i);
+            float32x4_t b = vld1q_f32(x+i+4);
+            __asm__ __volatile__("stnp %q0, %q1, [%2]" :: "w"(a), "w"(b), "r"(o+i) : "memory");
+        }
+    #endif
+    for (; i < numel; ++i) o[i] = x[i];
+}
+
+static void mag_blas_stream_fence(void) { /* Order weakly ordered non-temporal stores before the completion of the op */
+    #if defined(__SSE2__) || defined(_M_X64)
+        _mm_sfence();
+    #endif
+}
+
+/*
+** Large outputs are produced in L1 resident blocks and then streamed to memory. This avoids read-for-ownership traffic
+** and keeps the inputs (prefetched one block ahead) and other hot data in the cache.
+*/
+#define mag_blas_stream_apply(T, vmel, pr, prefetch, call) \
+    do { \
+        mag_alignas(MAG_CACHE_LINE_SIZE) mag_##T##_t blk[MAG_BLAS_STREAM_BLOCK]; \
+        for (int64_t bi=0; bi < (vmel); bi += MAG_BLAS_STREAM_BLOCK) { \
+            int64_t bn = mag_xmin(MAG_BLAS_STREAM_BLOCK, (vmel)-bi); \
+            prefetch; \
+            call; \
+            mag_blas_stream_store_##T((pr)+bi, blk, bn); \
+        } \
+        mag_blas_stream_fence(); \
+    } while (0)
+
+/*
+** Per-thread chunk of contiguous element-wise kernels. Rounded up to whole cache lines so that chunk boundaries
+** start 64B aligned (storage is cache line aligned) and no two threads write into the same output line.
+*/
+static int64_t mag_blas_chunk_size(int64_t numel, int64_t tc, int64_t elsize) {
+    int64_t line = mag_xmax(1, MAG_CACHE_LINE_SIZE/elsize);
+    int64_t chunk = (numel + tc - 1)/tc;
+    return (chunk + line - 1)/line*line;
+}
+
 #define mag_cpu_blas_impl_unary(T, name) \
     static void MAG_HOTPROC mag_blas_##name##_##T(const mag_compute_payload_t* payload) { \
         mag_tensor_t* r = payload->node; \
@@ -1182,7 +1495,7 @@ static void MAG_HOTPROC mag_blas_sum_f32(const mag_compute_payload_t* payload) {
         int64_t tc = payload->thread_num; \
         int64_t ti = payload->thread_idx; \
         int64_t numel = r->numel; \
-        int64_t chunk = (numel + tc - 1)/tc; \
+        int64_t chunk = mag_blas_chunk_size(numel, tc, sizeof(mag_##T##_t)); \
         int64_t ra = ti*chunk; \
         int64_t vmel = mag_xmin(ra + chunk, numel) - ra; \
         if (mag_unlikely(vmel <= 0)) return; \
@@ -1190,6 +1503,12 @@ static void MAG_HOTPROC mag_blas_sum_f32(const mag_compute_payload_t* payload) {
         const mag_##T##_t* px = bx + ra; \
         mag_bnd_chk(pr, br, mag_tensor_data_size(r)); \
         mag_bnd_chk(px, bx, mag_tensor_data_size(x)); \
+        if (mag_unlikely(numel*(int64_t)sizeof(mag_##T##_t) > payload->kernels->stream_threshold)) { \
+            mag_blas_stream_apply(T, vmel, pr, \
+                mag_blas_prefetch_nta(px+bi+MAG_BLAS_STREAM_BLOCK, bn*sizeof(mag_##T##_t)), \
+                mag_v##name##_##T(bn, blk, px+bi)); \
+            return; \
+        } \
         mag_v##name##_##T(vmel, pr, px); \
     }
 
@@ -1214,6 +1533,15 @@ mag_cpu_blas_impl_unary(f32, relu)
 mag_cpu_blas_impl_unary(f32, relu_dv)
 mag_cpu_blas_impl_unary(f32, gelu)
 mag_cpu_blas_impl_unary(f32, gelu_dv)
+mag_cpu_blas_impl_unary(f32, log_approx)
+mag_cpu_blas_impl_unary(f32, sin_approx)
+mag_cpu_blas_impl_unary(f32, cos_approx)
+mag_cpu_blas_impl_unary(f32, softmax_approx)
+mag_cpu_blas_impl_unary(f32, softmax_dv_approx)
+mag_cpu_blas_impl_unary(f32, sigmoid_approx)
+mag_cpu_blas_impl_unary(f32, silu_approx)
+mag_cpu_blas_impl_unary(f32, tanh_approx)
+mag_cpu_blas_impl_unary(f32, gelu_approx)
 
 #undef mag_cpu_blas_impl_unary
 
@@ -1229,7 +1557,7 @@ mag_cpu_blas_impl_unary(f32, gelu_dv)
         int64_t tc = payload->thread_num; \
         int64_t ti = payload->thread_idx; \
         int64_t numel = r->numel; \
-        int64_t chunk = (numel + tc - 1)/tc; \
+        int64_t chunk = mag_blas_chunk_size(numel, tc, sizeof(mag_##T##_t)); \
         int64_t ra = ti*chunk; \
         int64_t vmel = mag_xmin(ra + chunk, numel) - ra; \
         if (mag_unlikely(vmel <= 0)) return; \
@@ -1237,6 +1565,12 @@ mag_cpu_blas_impl_unary(f32, gelu_dv)
         const mag_##T##_t* px = bx + ra; \
         mag_bnd_chk(pr, br, mag_tensor_data_size(r)); \
         mag_bnd_chk(px, bx, mag_tensor_data_size(x)); \
+        if (mag_unlikely(numel*(int64_t)sizeof(mag_##T##_t) > payload->kernels->stream_threshold)) { \
+            mag_blas_stream_apply(T, vmel, pr, \
+                mag_blas_prefetch_nta(px+bi+MAG_BLAS_STREAM_BLOCK, bn*sizeof(mag_##T##_t)), \
+                mag_v##name##s_##T(bn, blk, px+bi, xi)); \
+            return; \
+        } \
         mag_v##name##s_##T(vmel, pr, px, xi); \
     }
 
@@ -1265,7 +1599,7 @@ mag_cpu_blas_impl_unary_scalar(f32, div)
         int64_t ti = payload->thread_idx; \
         if (xd0==yd0 && xd1==yd1 && xd2==yd2 && xd3==yd3 && xd4==yd4 && xd5==yd5) { \
             int64_t numel = r->numel; \
-            int64_t chunk = (numel + tc - 1)/tc; \
+            int64_t chunk = mag_blas_chunk_size(numel, tc, sizeof(mag_##T##_t)); \
             int64_t ra = ti*chunk; \
             int64_t vmel = mag_xmin(ra + chunk, numel) - ra; \
             if (mag_unlikely(vmel <= 0)) return; \
@@ -1275,6 +1609,13 @@ mag_cpu_blas_impl_unary_scalar(f32, div)
             mag_bnd_chk(pr, br, mag_tensor_data_size(r)); \
             mag_bnd_chk(px, bx, mag_tensor_data_size(x)); \
             mag_bnd_chk(py, by, mag_tensor_data_size(y)); \
+            if (mag_unlikely(numel*(int64_t)sizeof(mag_##T##_t) > payload->kernels->stream_threshold)) { \
+                mag_blas_stream_apply(T, vmel, pr, \
+                    (mag_blas_prefetch_nta(px+bi+MAG_BLAS_STREAM_BLOCK, bn*sizeof(mag_##T##_t)), \
+                     mag_blas_prefetch_nta(py+bi+MAG_BLAS_STREAM_BLOCK, bn*sizeof(mag_##T##_t))), \
+                    mag_v##name##_##T(bn, blk, px+bi, py+bi)); \
+                return; \
+            } \
             mag_v##name##_##T(vmel, pr, px, py); \
             return; \
         } \
@@ -1424,6 +1765,379 @@ static void MAG_HOTPROC mag_blas_matmul_f32(const mag_compute_payload_t* payload
     #endif
 }
 
+/*
+** Shape-specialized kernels, selected once per plan node by mag_blas_select_kernel.
+** Operands are dense and the loop bounds come from payload->kplan, so no shape or stride checks are left per call.
+*/
+#define mag_cpu_blas_impl_binary_spec(T, name) \
+    static void MAG_HOTPROC mag_blas_##name##_contig_##T(const mag_compute_payload_t* payload) { \
+        mag_tensor_t* r = payload->node; \
+        mag_##T##_t* br = mag_##T##p_mut(r); \
+        const mag_##T##_t* bx = mag_##T##p(r->op_inputs[0]); \
+        const mag_##T##_t* by = mag_##T##p(r->op_inputs[1]); \
+        int64_t numel = payload->kplan->dims[0]; \
+        int64_t chunk = mag_blas_chunk_size(numel, payload->thread_num, sizeof(mag_##T##_t)); \
+        int64_t ra = payload->thread_idx*chunk; \
+        int64_t vmel = mag_xmin(ra + chunk, numel) - ra; \
+        if (mag_unlikely(vmel <= 0)) return; \
+        mag_v##name##_##T(vmel, br+ra, bx+ra, by+ra); \
+    } \
+    static void MAG_HOTPROC mag_blas_##name##_bcast_scalar_##T(const mag_compute_payload_t* payload) { \
+        mag_tensor_t* r = payload->node; \
+        mag_##T##_t* br = mag_##T##p_mut(r); \
+        const mag_##T##_t* bx = mag_##T##p(r->op_inputs[0]); \
+        mag_##T##_t y = *mag_##T##p(r->op_inputs[1]); \
+        int64_t numel = payload->kplan->dims[0]; \
+        int64_t chunk = mag_blas_chunk_size(numel, payload->thread_num, sizeof(mag_##T##_t)); \
+        int64_t ra = payload->thread_idx*chunk; \
+        int64_t vmel = mag_xmin(ra + chunk, numel) - ra; \
+        if (mag_unlikely(vmel <= 0)) return; \
+        mag_v##name##s_##T(vmel, br+ra, bx+ra, y); \
+    } \
+    static void MAG_HOTPROC mag_blas_##name##_bcast_row_##T(const mag_compute_payload_t* payload) { \
+        mag_tensor_t* r = payload->node; \
+        mag_##T##_t* br = mag_##T##p_mut(r); \
+        const mag_##T##_t* bx = mag_##T##p(r->op_inputs[0]); \
+        const mag_##T##_t* by = mag_##T##p(r->op_inputs[1]); \
+        int64_t rows = payload->kplan->dims[0]; \
+        int64_t cols = payload->kplan->dims[1]; \
+        int64_t chunk = (rows + payload->thread_num - 1)/payload->thread_num; \
+        int64_t ra = payload->thread_idx*chunk; \
+        int64_t rb = mag_xmin(ra + chunk, rows); \
+        for (int64_t i=ra; i < rb; ++i) \
+            mag_v##name##_##T(cols, br + i*cols, bx + i*cols, by); \
+    }
+
+mag_cpu_blas_impl_binary_spec(f32, add)
+mag_cpu_blas_impl_binary_spec(f32, sub)
+mag_cpu_blas_impl_binary_spec(f32, mul)
+mag_cpu_blas_impl_binary_spec(f32, div)
+
+#undef mag_cpu_blas_impl_binary_spec
+
+static void MAG_HOTPROC mag_blas_matmul_gemv_f32(const mag_compute_payload_t* payload) { /* r = A x b, one dot product per row. */
+    mag_tensor_t* r = payload->node;
+    mag_f32_t* br = mag_f32p_mut(r);
+    const mag_f32_t* bx = mag_f32p(r->op_inputs[0]);
+    const mag_f32_t* by = mag_f32p(r->op_inputs[1]);
+    int64_t rows = payload->kplan->dims[0];
+    int64_t inner = payload->kplan->dims[1];
+    int64_t chunk = (rows + payload->thread_num - 1)/payload->thread_num;
+    int64_t ra = payload->thread_idx*chunk;
+    int64_t rb = mag_xmin(ra + chunk, rows);
+    for (int64_t i=ra; i < rb; ++i)
+        br[i] = mag_vdot_f32(inner, bx + i*inner, by);
+}
+
+static void MAG_HOTPROC mag_blas_matmul_small_f32(const mag_compute_payload_t* payload) { /* Single threaded, operands stay in cache. */
+    mag_tensor_t* r = payload->node;
+    mag_f32_t* restrict br = mag_f32p_mut(r);
+    const mag_f32_t* restrict bx = mag_f32p(r->op_inputs[0]);
+    const mag_f32_t* restrict by = mag_f32p(r->op_inputs[1]);
+    int64_t m = payload->kplan->dims[0];
+    int64_t k = payload->kplan->dims[1];
+    int64_t n = payload->kplan->dims[2];
+    memset(br, 0, m*n*sizeof(*br));
+    for (int64_t i=0; i < m; ++i) {
+        mag_f32_t* pr = br + n*i;
+        for (int64_t l=0; l < k; ++l) {
+            mag_f32_t a = bx[k*i + l];
+            const mag_f32_t* py = by + n*l;
+            for (int64_t j=0; j < n; ++j)
+                pr[j] += a*py[j];
+        }
+    }
+}
+
+#define MAG_BLAS_SMALL_GEMM_MAX (64*64*64) /* Multiply-adds below which a matmul runs on one thread. */
+
+static bool mag_blas_is_dense(const mag_tensor_t* t) { /* Contiguous in every dimension, not just the innermost. */
+    int64_t stride = 1;
+    for (int64_t i=0; i < MAG_MAX_DIMS; ++i) {
+        if (t->shape[i] != 1 && t->strides[i] != stride) return false;
+        stride *= t->shape[i];
+    }
+    return true;
+}
+
+static void mag_blas_select_kernel(const mag_kernel_registry_t* kernels, const mag_tensor_t* r, mag_kernel_plan_t* kp) {
+    static void (*const contig[4])(const mag_compute_payload_t*) = {&mag_blas_add_contig_f32, &mag_blas_sub_contig_f32, &mag_blas_mul_contig_f32, &mag_blas_div_contig_f32};
+    static void (*const bcast_scalar[4])(const mag_compute_payload_t*) = {&mag_blas_add_bcast_scalar_f32, &mag_blas_sub_bcast_scalar_f32, &mag_blas_mul_bcast_scalar_f32, &mag_blas_div_bcast_scalar_f32};
+    static void (*const bcast_row[4])(const mag_compute_payload_t*) = {&mag_blas_add_bcast_row_f32, &mag_blas_sub_bcast_row_f32, &mag_blas_mul_bcast_row_f32, &mag_blas_div_bcast_row_f32};
+    const mag_tensor_t* x = r->op_inputs[0];
+    const mag_tensor_t* y = r->op_inputs[1];
+    switch (r->op) {
+        case MAG_OP_ADD: case MAG_OP_SUB: case MAG_OP_MUL: case MAG_OP_DIV: {
+            if (r->dtype != MAG_DTYPE_F32 || !mag_blas_is_dense(r) || !mag_blas_is_dense(x) || !mag_blas_is_dense(y)) return;
+            if (r->numel*(int64_t)sizeof(mag_f32_t) > kernels->stream_threshold) return; /* Generic kernel streams large outputs past the cache. */
+            uint32_t bin = r->op - MAG_OP_ADD;
+            kp->dims[0] = r->numel;
+            if (!memcmp(x->shape, y->shape, sizeof(x->shape))) {
+                kp->fn = contig[bin];
+                kp->variant = MAG_KVAR_CONTIGUOUS;
+            } else if (y->numel == 1) {
+                kp->fn = bcast_scalar[bin];
+                kp->variant = MAG_KVAR_BCAST_SCALAR;
+            } else {
+                int64_t i = 0; /* y must equal the innermost dims of x and be 1 in the others, then it repeats every y->numel elements. */
+                while (i < MAG_MAX_DIMS && y->shape[i] == x->shape[i]) ++i;
+                for (int64_t j=i; j < MAG_MAX_DIMS; ++j) if (y->shape[j] != 1) return;
+                kp->fn = bcast_row[bin];
+                kp->variant = MAG_KVAR_BCAST_ROW;
+                kp->dims[0] = x->numel/y->numel;
+                kp->dims[1] = y->numel;
+            }
+        } return;
+        case MAG_OP_MATMUL: {
+        #ifndef MAG_ACCELERATE
+            if (r->dtype != MAG_DTYPE_F32 || !mag_blas_is_dense(r) || !mag_blas_is_dense(x) || !mag_blas_is_dense(y)) return;
+            int64_t m = x->shape[0], k = x->shape[1], n = y->shape[1];
+            if (n == 1) {
+                kp->fn = &mag_blas_matmul_gemv_f32;
+                kp->variant = MAG_KVAR_GEMV;
+                kp->dims[0] = m;
+                kp->dims[1] = k;
+            }
+            else if (m*k*n <= MAG_BLAS_SMALL_GEMM_MAX) {
+                kp->fn = &mag_blas_matmul_small_f32;
+                kp->variant = MAG_KVAR_SMALL_GEMM;
+                kp->dims[0] = m;
+                kp->dims[1] = k;
+                kp->dims[2] = n;
+            }
+        #else
+            (void)x, (void)y;
+        #endif
+        } return;
+        default: return;
+    }
+}
+
+static void MAG_HOTPROC mag_vaxpy_f32(int64_t numel, mag_f32_t a, const mag_f32_t* x, mag_f32_t* y) { /* y += a*x */
+    int64_t i=0;
+    #if (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+        for (; i+3 < numel; i += 4)
+            vst1q_f32(y+i, vfmaq_n_f32(vld1q_f32(y+i), vld1q_f32(x+i), a));
+    #elif defined(__AVX512F__)
+        __m512 va = _mm512_set1_ps(a);
+        for (; i+15 < numel; i += 16)
+            _mm512_storeu_ps(y+i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x+i), _mm512_loadu_ps(y+i)));
+    #elif defined(__AVX__) && defined(__FMA__)
+        __m256 va = _mm256_set1_ps(a);
+        for (; i+7 < numel; i += 8)
+            _mm256_storeu_ps(y+i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x+i), _mm256_loadu_ps(y+i)));
+    #elif defined(__SSE2__)
+        __m128 va = _mm_set1_ps(a);
+        for (; i+3 < numel; i += 4)
+            _mm_storeu_ps(y+i, _mm_add_ps(_mm_loadu_ps(y+i), _mm_mul_ps(va, _mm_loadu_ps(x+i))));
+    #endif
+    for (; i < numel; ++i) y[i] += a*x[i];
+}
+
+/*
+** Rows [r0, r1) of c = a x b for a CSR matrix a, b is (a->cols, n) and c is (a->rows, n), both row-major.
+** SpMV (n == 1) gathers b at the column indices of a row, SpMM accumulates scaled rows of b into the L1 resident row of c.
+*/
+static void MAG_HOTPROC mag_spmm_f32(const mag_csr_t* a, int64_t r0, int64_t r1, const mag_f32_t* b, int64_t n, mag_f32_t* c) {
+    const int64_t* rp = a->row_ptr;
+    const int32_t* ci = a->col_idx;
+    const mag_f32_t* v = a->values;
+    if (n == 1) {
+        for (int64_t r=r0; r < r1; ++r) {
+            int64_t k = rp[r], e = rp[r+1];
+            mag_f32_t sum = 0.0f;
+            #if defined(__AVX512F__)
+                __m512 acc = _mm512_setzero_ps();
+                for (; k+15 < e; k += 16)
+                    acc = _mm512_fmadd_ps(_mm512_loadu_ps(v+k), _mm512_i32gather_ps(_mm512_loadu_si512(ci+k), b, 4), acc);
+                sum = _mm512_reduce_add_ps(acc);
+            #elif defined(__AVX2__) && defined(__FMA__)
+                __m256 acc = _mm256_setzero_ps();
+                for (; k+7 < e; k += 8)
+                    acc = _mm256_fmadd_ps(_mm256_loadu_ps(v+k), _mm256_i32gather_ps(b, _mm256_loadu_si256((const __m256i*)(ci+k)), 4), acc);
+                __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+                s = _mm_hadd_ps(s, s);
+                s = _mm_hadd_ps(s, s);
+                sum = _mm_cvtss_f32(s);
+            #elif (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+                float32x4_t acc = vdupq_n_f32(0.0f);
+                for (; k+3 < e; k += 4) { /* No gather on NEON, the lanes are loaded one by one. */
+                    float32x4_t g = vld1q_dup_f32(b + ci[k]);
+                    g = vld1q_lane_f32(b + ci[k+1], g, 1);
+                    g = vld1q_lane_f32(b + ci[k+2], g, 2);
+                    g = vld1q_lane_f32(b + ci[k+3], g, 3);
+                    acc = vfmaq_f32(acc, vld1q_f32(v+k), g);
+                }
+                sum = vaddvq_f32(acc);
+            #endif
+            for (; k < e; ++k) sum += v[k]*b[ci[k]];
+            c[r] = sum;
+        }
+        return;
+    }
+    for (int64_t r=r0; r < r1; ++r) {
+        mag_f32_t* pc = c + r*n;
+        memset(pc, 0, n*sizeof(*pc));
+        for (int64_t k=rp[r]; k < rp[r+1]; ++k)
+            mag_vaxpy_f32(n, v[k], b + (int64_t)ci[k]*n, pc);
+    }
+}
+
+/*
+** 2:4 expansion tables indexed by a group nibble. AVX2 permutes 4 loaded values (lanes 0..3, lane 4 zero) into 8 columns,
+** the first group takes values 0 and 1, the second 2 and 3. NEON picks the bytes of the same values from a 16 byte register,
+** out of range indices give zero lanes. Invalid nibbles expand to zeros.
+*/
+#if defined(__AVX2__) && defined(__FMA__)
+static const int32_t mag_sp24_perm_lo[16][4] = {
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {0, 1, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {0, 4, 1, 4},
+    {4, 0, 1, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {0, 4, 4, 1},
+    {4, 0, 4, 1},
+    {4, 4, 0, 1},
+    {4, 4, 4, 4}
+};
+static const int32_t mag_sp24_perm_hi[16][4] = {
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {2, 3, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {2, 4, 3, 4},
+    {4, 2, 3, 4},
+    {4, 4, 4, 4},
+    {4, 4, 4, 4},
+    {2, 4, 4, 3},
+    {4, 2, 4, 3},
+    {4, 4, 2, 3},
+    {4, 4, 4, 4}
+};
+#elif (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+static const uint8_t mag_sp24_tbl_lo[16][16] = {
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0xff, 0xff, 0xff, 0xff, 0x04, 0x05, 0x06, 0x07, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x04, 0x05, 0x06, 0x07},
+    {0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0xff, 0xff, 0xff, 0xff, 0x04, 0x05, 0x06, 0x07},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}
+};
+static const uint8_t mag_sp24_tbl_hi[16][16] = {
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xff, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0c, 0x0d, 0x0e, 0x0f},
+    {0xff, 0xff, 0xff, 0xff, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xff, 0x0c, 0x0d, 0x0e, 0x0f},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}
+};
+#endif
+
+/*
+** Rows [r0, r1) of y = w x x for a 2:4 matrix w, x is (w->cols, n) and y is (w->rows, n), both row-major.
+** For n == 1 the kept values are expanded to dense columns in registers: AVX-512 expand-loads them under the position mask,
+** AVX2 permutes them and NEON uses table lookups. Wider products accumulate scaled rows of x like the CSR kernel.
+*/
+static void MAG_HOTPROC mag_sp24_matmul_f32(const mag_sp24_t* w, int64_t r0, int64_t r1, const mag_f32_t* x, int64_t n, mag_f32_t* y) {
+    int64_t groups = w->cols>>2;
+    if (n == 1) {
+        for (int64_t r=r0; r < r1; ++r) {
+            const mag_f32_t* v = w->values + r*(w->cols>>1);
+            const uint8_t* m = w->meta + r*w->meta_stride;
+            int64_t g = 0;
+            mag_f32_t sum = 0.0f;
+            #if defined(__AVX512F__)
+                __m512 acc = _mm512_setzero_ps();
+                for (; g+3 < groups; g += 4) { /* 16 columns from 8 values */
+                    uint32_t b = m[g>>1] | (uint32_t)m[(g>>1)+1]<<8;
+                    uint32_t k = 0;
+                    for (int q=0; q < 4; ++q) {
+                        uint32_t nib = (b >> (q<<2)) & 15;
+                        k |= ((1u<<(nib&3)) | (1u<<(nib>>2))) << (q<<2);
+                    }
+                    __m512 wv = _mm512_maskz_expandloadu_ps((__mmask16)k, v + (g<<1));
+                    acc = _mm512_fmadd_ps(wv, _mm512_loadu_ps(x + (g<<2)), acc);
+                }
+                sum = _mm512_reduce_add_ps(acc);
+            #elif defined(__AVX2__) && defined(__FMA__)
+                __m256 acc = _mm256_setzero_ps();
+                for (; g+1 < groups; g += 2) { /* 8 columns from 4 values */
+                    uint8_t b = m[g>>1];
+                    __m256 v4 = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_loadu_ps(v + (g<<1)), 0);
+                    __m256i idx = _mm256_set_m128i(
+                        _mm_loadu_si128((const __m128i*)mag_sp24_perm_hi[b>>4]),
+                        _mm_loadu_si128((const __m128i*)mag_sp24_perm_lo[b&15])
+                    );
+                    acc = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(v4, idx), _mm256_loadu_ps(x + (g<<2)), acc);
+                }
+                __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+                s = _mm_hadd_ps(s, s);
+                s = _mm_hadd_ps(s, s);
+                sum = _mm_cvtss_f32(s);
+            #elif (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+                float32x4_t acc = vdupq_n_f32(0.0f);
+                for (; g+1 < groups; g += 2) { /* 8 columns from 4 values */
+                    uint8_t b = m[g>>1];
+                    uint8x16_t vb = vld1q_u8((const uint8_t*)(v + (g<<1)));
+                    float32x4_t w0 = vreinterpretq_f32_u8(vqtbl1q_u8(vb, vld1q_u8(mag_sp24_tbl_lo[b&15])));
+                    float32x4_t w1 = vreinterpretq_f32_u8(vqtbl1q_u8(vb, vld1q_u8(mag_sp24_tbl_hi[b>>4])));
+                    acc = vfmaq_f32(acc, w0, vld1q_f32(x + (g<<2)));
+                    acc = vfmaq_f32(acc, w1, vld1q_f32(x + (g<<2) + 4));
+                }
+                sum = vaddvq_f32(acc);
+            #endif
+            for (; g < groups; ++g) {
+                uint32_t nib = (m[g>>1] >> ((g&1)<<2)) & 15;
+                sum += v[g<<1]*x[(g<<2) + (nib&3)] + v[(g<<1)+1]*x[(g<<2) + (nib>>2)];
+            }
+            y[r] = sum;
+        }
+        return;
+    }
+    for (int64_t r=r0; r < r1; ++r) {
+        const mag_f32_t* v = w->values + r*(w->cols>>1);
+        const uint8_t* m = w->meta + r*w->meta_stride;
+        mag_f32_t* py = y + r*n;
+        memset(py, 0, n*sizeof(*py));
+        for (int64_t g=0; g < groups; ++g) {
+            uint32_t nib = (m[g>>1] >> ((g&1)<<2)) & 15;
+            if (v[g<<1] != 0.0f) mag_vaxpy_f32(n, v[g<<1], x + ((g<<2) + (nib&3))*n, py);
+            if (v[(g<<1)+1] != 0.0f) mag_vaxpy_f32(n, v[(g<<1)+1], x + ((g<<2) + (nib>>2))*n, py);
+        }
+    }
+}
+
 #ifndef MAG_BLAS_SPECIALIZATION
 #error "BLAS specialization undefined"
 #endif
@@ -1671,7 +2385,31 @@ static void (*const backward_kernels[MAG_OP__NUM])(const mag_compute_payload_t*)
     [MAG_OP_MATMUL] = &mag_blas_matmul_f32,
 };
 
-void MAG_BLAS_SPECIALIZATION(mag_kernel_registry_t* kernels) {
+/* Kernels replaced in the registry when MAG_MATH_MODE_APPROX is active. NULL entries keep the precise kernel. */
+static void (*const approx_kernels[MAG_OP__NUM])(const mag_compute_payload_t*) = {
+    [MAG_OP_LOG] = &mag_blas_log_approx_f32,
+    [MAG_OP_SIN] = &mag_blas_sin_approx_f32,
+    [MAG_OP_COS] = &mag_blas_cos_approx_f32,
+    [MAG_OP_SOFTMAX] = &mag_blas_softmax_approx_f32,
+    [MAG_OP_SOFTMAX_DV] = &mag_blas_softmax_dv_approx_f32,
+    [MAG_OP_SIGMOID] = &mag_blas_sigmoid_approx_f32,
+    [MAG_OP_SILU] = &mag_blas_silu_approx_f32,
+    [MAG_OP_TANH] = &mag_blas_tanh_approx_f32,
+    [MAG_OP_GELU] = &mag_blas_gelu_approx_f32,
+};
+
+void MAG_BLAS_SPECIALIZATION(mag_kernel_registry_t* kernels, mag_math_mode_t mode) {
     memcpy(kernels->fwd, forward_kernels, sizeof(forward_kernels));
     memcpy(kernels->bwd, backward_kernels, sizeof(backward_kernels));
+    kernels->select = &mag_blas_select_kernel;
+    kernels->vadd = &mag_vadd_f32;
+    kernels->spmm = &mag_spmm_f32;
+    kernels->sp24_matmul = &mag_sp24_matmul_f32;
+    if (mode == MAG_MATH_MODE_APPROX) {
+        for (int i=0; i < MAG_OP__NUM; ++i) {
+            if (!approx_kernels[i]) continue;
+            kernels->fwd[i] = approx_kernels[i];
+            kernels->bwd[i] = approx_kernels[i];
+        }
+    }
 }
@@ -52,7 +52,18 @@ namespace mag::cuda {
             .eager_exec_fwd = nullptr,
             .eager_exec_bwd = nullptr,
             .alloc_storage = nullptr,
-            .free_storage = nullptr
+            .free_storage = nullptr,
+            .set_math_mode = nullptr,
+            .set_concurrent = nullptr,
+            .set_free_mode = nullptr,
+            .plan_kernel = nullptr,
+            .exec_planned_fwd = nullptr,
+            .record_event = nullptr,
+            .query_event = nullptr,
+            .wait_event = nullptr,
+            .vadd_host = nullptr,
+            .spmm_host = nullptr,
+            .sp24_matmul_host = nullptr
         };
         double vram;
         const char* unit;
@@ -4,6 +4,8 @@
 
 extern mag_compute_device_t* mag_init_device_cpu(mag_ctx_t* ctx, const mag_device_descriptor_t* desc);   /* Initialize CPU compute device. Implemented in magnetron_cpu.c */
 extern void mag_destroy_device_cpu(mag_compute_device_t* dvc);      /* Destroy CPU compute device. Implemented in magnetron_cpu.c */
+extern mag_compute_device_t* mag_init_device_cpu_stream(mag_ctx_t* ctx, const mag_device_descriptor_t* desc);    /* Initialize asynchronous CPU device. Implemented in magnetron_cpu.c */
+extern void mag_destroy_device_cpu_stream(mag_compute_device_t* dvc);   /* Destroy asynchronous CPU device. Implemented in magnetron_cpu.c */
 
 #ifdef MAG_ENABLE_CUDA
 extern mag_compute_device_t* mag_init_device_cuda(mag_ctx_t* ctx, const mag_device_descriptor_t* desc);  /* Initialize GPU compute device. Implemented in magnetron_cuda.cu */
@@ -26,6 +28,11 @@ static const mag_device_factory_t* const mag_device_factories[MAG_COMPUTE_DEVICE
 #else
     [MAG_COMPUTE_DEVICE_TYPE_GPU_CUDA] = NULL, /* CUDA not enabled. */
 #endif
+
+    [MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM] = &(mag_device_factory_t){
+        .init = &mag_init_device_cpu_stream,
+        .destroy = &mag_destroy_device_cpu_stream,
+    },
 };
 
 mag_compute_device_t* mag_init_dynamic_device(mag_ctx_t* ctx, const mag_device_descriptor_t* desc) {
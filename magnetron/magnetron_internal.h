@@ -30,6 +30,8 @@
 #else
 #include <unistd.h>
 #include <pthread.h>
+#include <errno.h>
+#include <time.h>
 #ifdef __FreeBSD__
 #include <pthread_np.h>
 #endif
@@ -70,6 +72,7 @@ extern "C" {
 #define MAG_PACKED __attribute__((packed))
 #define MAG_FALLTHROUGH __attribute__((fallthrough))
 #define MAG_UNUSED __attribute__((unused))
+#define MAG_THREAD_LOCAL __thread
 #define mag_likely(x) __builtin_expect(!!(x), 1)
 #define mag_unlikely(x) __builtin_expect(!!(x), 0)
 #define mag_ffs(x) ((uint32_t)__builtin_ctz(x))
@@ -118,6 +121,14 @@ static MAG_AINLINE bool mag_atomic_compare_exchange_strong(volatile mag_atomic_t
     return __atomic_compare_exchange(o, exp, des, false, order_succ, order_fail);
 }
 
+typedef int32_t mag_atomic32_t;     /* 32-bit atomic integer type, for packed counters */
+static MAG_AINLINE mag_atomic32_t mag_atomic32_fetch_add(volatile mag_atomic32_t* o, mag_atomic32_t x, mag_mo_t order) {
+    return __atomic_fetch_add(o, x, order);
+}
+static MAG_AINLINE mag_atomic32_t mag_atomic32_fetch_sub(volatile mag_atomic32_t* o, mag_atomic32_t x, mag_mo_t order) {
+    return __atomic_fetch_sub(o, x, order);
+}
+
 #else
 
 unsigned char _BitScanForward64(unsigned long*, unsigned __int64);
@@ -133,6 +144,7 @@ unsigned char _BitScanReverse64(unsigned long*, unsigned __int64);
 #define MAG_PACKED __declspec(align(1))
 #define MAG_FALLTHROUGH
 #define MAG_UNUSED
+#define MAG_THREAD_LOCAL __declspec(thread)
 #define mag_likely(x) (x)
 #define mag_unlikely(x) (x)
 static MAG_AINLINE uint32_t mag_ffs(const uint32_t x) {
@@ -204,6 +216,16 @@ static MAG_AINLINE bool mag_atomic_compare_exchange_strong(volatile mag_atomic_t
     else { *exp = old; return false; }
 }
 
+typedef long mag_atomic32_t;        /* 32-bit atomic integer type, for packed counters */
+static MAG_AINLINE mag_atomic32_t mag_atomic32_fetch_add(volatile mag_atomic32_t* o, mag_atomic32_t x, mag_mo_t order) {
+    (void)order;
+    return _InterlockedExchangeAdd(o, x);
+}
+static MAG_AINLINE mag_atomic32_t mag_atomic32_fetch_sub(volatile mag_atomic32_t* o, mag_atomic32_t x, mag_mo_t order) {
+    (void)order;
+    return _InterlockedExchangeAdd(o, -x);
+}
+
 #endif
 
 mag_static_assert(sizeof(0u) == 4);
@@ -382,6 +404,7 @@ typedef CONDITION_VARIABLE mag_cond_var_t;
 #define mag_cv_create(cv) InitializeConditionVariable(cv)
 #define mag_cv_destroy(cv)
 #define mag_cv_wait(cv, mtx) SleepConditionVariableSRW(cv, mtx, INFINITE, 0)
+#define mag_cv_wait_for(cv, mtx, ns) SleepConditionVariableSRW(cv, mtx, (DWORD)(((ns)+999999)/1000000 ? ((ns)+999999)/1000000 : 1), 0) /* Round up, a 0 ms wait would spin. */
 #define mag_cv_signal(cv) WakeConditionVariable(cv)
 #define mag_cv_broadcast(cv) WakeAllConditionVariable(cv)
 
@@ -401,18 +424,57 @@ typedef pthread_mutex_t mag_mutex_t;
 #define mag_mutex_unlock(mtx) mag_assert2(pthread_mutex_unlock(mtx) == 0)
 
 typedef pthread_cond_t mag_cond_var_t;
+#ifdef __APPLE__ /* No pthread_condattr_setclock, timed waits are relative. */
 #define mag_cv_create(cv) mag_assert2(pthread_cond_init(cv, NULL) == 0)
+#else
+static MAG_AINLINE void mag_cv_create(mag_cond_var_t* cv) { /* Timed waits use the monotonic clock, wall clock adjustments do not stretch them. */
+    pthread_condattr_t attr;
+    mag_assert2(pthread_condattr_init(&attr) == 0);
+    mag_assert2(pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0);
+    mag_assert2(pthread_cond_init(cv, &attr) == 0);
+    pthread_condattr_destroy(&attr);
+}
+#endif
 #define mag_cv_destroy(cv) mag_assert2(pthread_cond_destroy(cv) == 0)
 #define mag_cv_wait(cv, mtx) mag_assert2(pthread_cond_wait(cv, mtx) == 0)
 #define mag_cv_signal(cv) mag_assert2(pthread_cond_signal(cv) == 0)
 #define mag_cv_broadcast(cv) mag_assert2(pthread_cond_broadcast(cv) == 0)
 
+static MAG_AINLINE void mag_cv_wait_for(mag_cond_var_t* cv, mag_mutex_t* mtx, uint64_t ns) { /* Wait at most ns, callers recheck their condition. */
+    struct timespec ts;
+#ifdef __APPLE__
+    ts.tv_sec = (time_t)(ns/1000000000ull);
+    ts.tv_nsec = (long)(ns%1000000000ull);
+    int ret = pthread_cond_timedwait_relative_np(cv, mtx, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts); /* The clock set in mag_cv_create. */
+    uint64_t nsec = (uint64_t)ts.tv_nsec + ns;
+    ts.tv_sec += (time_t)(nsec/1000000000ull);
+    ts.tv_nsec = (long)(nsec%1000000000ull);
+    int ret = pthread_cond_timedwait(cv, mtx, &ts);
+#endif
+    mag_assert2(ret == 0 || ret == ETIMEDOUT);
+}
+
 #endif
 
 extern MAG_EXPORT void mag_thread_set_prio(mag_thread_sched_prio_t prio); /* Set thread scheduling priority of current thread. */
 extern MAG_EXPORT void mag_thread_set_name(const char* name); /* Set thread name. */
 extern MAG_EXPORT void mag_thread_yield(void); /* Yield current thread. */
 
+/* Spin lock for very short critical sections (pool refills, PRNG state). Yields while contended. */
+static MAG_AINLINE bool mag_spinlock_try_acquire(volatile mag_atomic_t* lock) {
+    mag_atomic_t exp = 0, des = 1;
+    return mag_atomic_load(lock, MAG_MO_RELAXED) == 0 && mag_atomic_compare_exchange_strong(lock, &exp, &des, MAG_MO_ACQUIRE, MAG_MO_RELAXED);
+}
+static MAG_AINLINE void mag_spinlock_acquire(volatile mag_atomic_t* lock) {
+    while (mag_unlikely(!mag_spinlock_try_acquire(lock)))
+        mag_thread_yield();
+}
+static MAG_AINLINE void mag_spinlock_release(volatile mag_atomic_t* lock) {
+    mag_atomic_store(lock, 0, MAG_MO_RELEASE);
+}
+
 typedef enum mag_op_t {
     MAG_OP_NOP,
     MAG_OP_CLONE,
@@ -484,7 +546,7 @@ typedef struct mag_op_meta_t {
     mag_op_param_type_t param_types[MAG_MAX_OP_PARAMS];     /* Parameter types */
     bool inplace;                                           /* Supports inplace execution */
     mag_tensor_t* (*r_alloc)(mag_tensor_t**, const mag_op_param_t*);
-    bool (*validator)(mag_op_t, mag_tensor_t*, mag_tensor_t**, const mag_op_param_t*);
+    bool (*validator)(mag_op_t, mag_tensor_t**, const mag_op_param_t*); /* Validates inputs before the result is constructed */
 } mag_op_meta_t;
 extern MAG_EXPORT const mag_op_meta_t* mag_op_meta_of(mag_op_t type);
 
@@ -495,6 +557,8 @@ struct mag_intrusive_chunk {
     mag_intrusive_chunk* next;          /* Link to next chunk */
 };
 
+typedef struct mag_pool_magazine_t mag_pool_magazine_t;
+
 /* Fast memory allocator for memory blocks of same size. Obtains a memory pool and freelist for fast de/allocation. */
 typedef struct mag_fixed_intrusive_pool {
     size_t block_size;                  /* Size of each allocated block */
@@ -507,29 +571,81 @@ typedef struct mag_fixed_intrusive_pool {
     uint64_t num_pool_hits;             /* Number of cache (pool) hits */
     uint64_t num_chunks;                /* Number of used chunks */
     uint64_t num_allocs;                /* Number of total allocations */
+    uint64_t id;                        /* Process-wide unique id, keys the thread-local magazines. Renewed on entering concurrent mode. */
+    volatile mag_atomic_t lock;         /* Guards chunks and free list in concurrent mode. */
+    bool concurrent;                    /* Thread-safe mode: per-thread magazines in front of the shared free list. */
+    mag_pool_magazine_t* magazines;     /* Registry of the per-thread magazines, guarded by lock. */
 } mag_fixed_intrusive_pool;
 
 extern MAG_EXPORT void mag_fixed_intrusive_pool_init(mag_fixed_intrusive_pool* pool, size_t block_size, size_t block_align, size_t blocks_per_chunk);
 extern MAG_EXPORT void* mag_fixed_intrusive_pool_malloc(mag_fixed_intrusive_pool* pool);
 extern MAG_EXPORT void mag_fixed_intrusive_pool_free(mag_fixed_intrusive_pool* pool, void* blk);
+extern MAG_EXPORT void mag_fixed_intrusive_pool_set_concurrent(mag_fixed_intrusive_pool* pool, bool concurrent);
 extern MAG_EXPORT void mag_fixed_intrusive_pool_destroy(mag_fixed_intrusive_pool* pool);
 extern MAG_EXPORT void mag_fixed_intrusive_pool_print_info(mag_fixed_intrusive_pool* pool, const char* name);
 
 /* Device interface to any compute backend device (CPU, GPU, TPU etc..) */
 typedef struct mag_compute_device_t mag_compute_device_t;
 
+/* Kernel variants a device can pick once for a plan node, whose shapes and strides are fixed. */
+typedef enum mag_kernel_variant_t {
+    MAG_KVAR_GENERIC,               /* Registry kernel, decides per call. */
+    MAG_KVAR_CONTIGUOUS,            /* Element-wise over equally shaped contiguous tensors. */
+    MAG_KVAR_BCAST_ROW,             /* Contiguous y repeats along x. */
+    MAG_KVAR_BCAST_SCALAR,          /* y has a single element. */
+    MAG_KVAR_GEMV,                  /* Matmul with a single output column. */
+    MAG_KVAR_SMALL_GEMM,            /* Matmul small enough for one thread. */
+
+    MAG_KVAR__NUM
+} mag_kernel_variant_t;
+
+/* Kernel selected for a plan node, with the loop bounds the variant needs. */
+struct mag_compute_payload_t;
+typedef struct mag_kernel_plan_t {
+    void (*fn)(const struct mag_compute_payload_t*);    /* Selected kernel, NULL for the registry kernel. */
+    mag_kernel_variant_t variant;                       /* Selected variant. */
+    uint32_t workers;                                   /* Intra-op workers. */
+    int64_t dims[3];                                    /* Variant specific loop bounds. */
+} mag_kernel_plan_t;
+
 /* Buffer interface on a compute device */
 typedef struct mag_storage_buffer_t mag_storage_buffer_t;
 struct mag_storage_buffer_t {
     uintptr_t base;                                                                                 /* Pointer to buffer on device. Might point to GPU or any other device memory. */
     size_t size;                                                                                    /* Size of buffer in bytes. */
     size_t alignment;                                                                               /* Alignment of buffer. */
+    volatile mag_atomic_t rc;                                                                       /* Number of tensors sharing this descriptor (base tensor and its views), atomic once frozen. */
+    volatile mag_atomic_t borrowers;                                                                /* Views of a frozen storage held by other contexts, see mag_tensor_share. */
     mag_compute_device_t* host;                                                                     /* Host device. */
     void (*set)(mag_storage_buffer_t* sto, size_t offs, uint8_t x);                                 /* Memset buffer. */
     void (*cpy_host_device)(mag_storage_buffer_t* sto, size_t offs, const void* src, size_t n);     /* Copy data from host to device. */
     void (*cpy_device_host)(mag_storage_buffer_t* sto, size_t offs, void* dst, size_t n);           /* Copy data from device to host. */
 };
 
+/* CSR sparse matrix in host memory. The nonzeros of row r are at [row_ptr[r], row_ptr[r+1]) of col_idx and values. */
+struct mag_csr_t {
+    mag_ctx_t* ctx;
+    int64_t rows;
+    int64_t cols;
+    int64_t nnz;
+    int64_t* row_ptr;   /* rows+1 offsets. */
+    int32_t* col_idx;   /* Column of each nonzero, ascending within a row. */
+    float* values;      /* Value of each nonzero. */
+};
+
+/*
+** 2:4 structured sparse matrix in host memory. Each group of 4 columns of a row keeps 2 values, zeros included if the group
+** has fewer nonzeros. The 2-bit positions of a group form one nibble i0 | i1<<2 with i0 < i1, groups 2g and 2g+1 share a byte.
+*/
+struct mag_sp24_t {
+    mag_ctx_t* ctx;
+    int64_t rows;
+    int64_t cols;       /* Multiple of 4. */
+    float* values;      /* rows x cols/2, the kept values in column order. */
+    uint8_t* meta;      /* rows x meta_stride position bytes. */
+    int64_t meta_stride;
+};
+
 /* Device interface to any compute backend device (CPU, GPU, TPU etc..) */
 struct mag_compute_device_t {
     char name[128];                                                             /* Device name. */
@@ -540,6 +656,17 @@ struct mag_compute_device_t {
     void (*eager_exec_bwd)(mag_compute_device_t* dvc, mag_tensor_t* root);      /* Execute a single op backwards. */
     void (*alloc_storage)(mag_compute_device_t* dvc, mag_storage_buffer_t* out, size_t size);
     void (*free_storage)(mag_compute_device_t* dvc, mag_storage_buffer_t* buf);
+    void (*set_math_mode)(mag_compute_device_t* dvc, mag_math_mode_t mode);   /* Switch accuracy of transcendental kernels. */
+    void (*set_concurrent)(mag_compute_device_t* dvc, bool concurrent);        /* Make device side allocators thread-safe. */
+    void (*set_free_mode)(mag_compute_device_t* dvc, mag_free_mode_t mode);    /* Start or stop background release of device memory. */
+    void (*plan_kernel)(mag_compute_device_t* dvc, const mag_tensor_t* node, mag_kernel_plan_t* out);         /* Select kernel variant for a plan node. */
+    void (*exec_planned_fwd)(mag_compute_device_t* dvc, mag_tensor_t* node, const mag_kernel_plan_t* kp);    /* Execute a single op forward with a selected kernel. */
+    uint64_t (*record_event)(mag_compute_device_t* dvc);                        /* Sequence number of the last submitted command. NULL on synchronous devices. */
+    bool (*query_event)(mag_compute_device_t* dvc, uint64_t ev);               /* Check if all commands up to ev completed. */
+    void (*wait_event)(mag_compute_device_t* dvc, uint64_t ev);                /* Wait until all commands up to ev completed. */
+    void (*vadd_host)(mag_compute_device_t* dvc, int64_t numel, float* o, const float* x, const float* y); /* Add host buffers with the device's SIMD kernel, used by collectives. */
+    void (*spmm_host)(mag_compute_device_t* dvc, mag_tensor_t* r, const mag_csr_t* a, const float* b, int64_t n); /* r = a x b for a host CSR matrix and a (cols, n) host buffer. */
+    void (*sp24_matmul_host)(mag_compute_device_t* dvc, mag_tensor_t* r, const mag_sp24_t* w, const float* x, int64_t n); /* r = w x x for a host 2:4 matrix and a (cols, n) host buffer. */
 };
 
 /* Device creation and destruction. */
@@ -658,32 +785,69 @@ extern const char* const mag_arm64_cap_names[MAG_ARM64_CAP__NUM];
 
 #endif
 
+#define MAG_MAX_CACHE_LEVELS 4
+
+typedef struct mag_cache_info_t {
+    uint64_t size;          /* Size of one instance in bytes. 0 if the level is not present. */
+    uint32_t line_size;     /* Cache line size in bytes. */
+    uint32_t shared_by;     /* Number of logical CPUs sharing one instance. */
+} mag_cache_info_t;
+
 /*
-** Context contains all isolated state and data.
-** Lifetimes of tensors and compute graphs are bound to the context - the context is the owner.
-** Context itself is not thread-safe, use a thread-local context or synchronize access. (Multiple contexts can be used.)
+** Host machine description. Queried once per process (see mag_system_host_info_get) and copied into each context.
+** Volatile values like free physical memory are not part of it and are queried on demand.
 */
-struct mag_ctx_t {
-    struct {
-        char os_name[128];                          /* OS name. */
-        char cpu_name[128];                         /* CPU name. */
-        uint32_t cpu_virtual_cores;                 /* Virtual CPUs. */
-        uint32_t cpu_physical_cores;                /* Physical CPU cores. */
-        uint32_t cpu_sockets;                       /* CPU sockets. */
-        uint64_t phys_mem_total;                    /* Total physical memory in bytes. */
-        uint64_t phys_mem_free;                     /* Free physical memory in bytes. */
+typedef struct mag_machine_info_t {
+    char os_name[128];                          /* OS name. */
+    char cpu_name[128];                         /* CPU name. */
+    uint32_t cpu_virtual_cores;                 /* Virtual CPUs. */
+    uint32_t cpu_physical_cores;                /* Physical CPU cores. */
+    uint32_t cpu_sockets;                       /* CPU sockets. */
+    mag_cache_info_t cpu_caches[MAG_MAX_CACHE_LEVELS]; /* Data/unified cache hierarchy of the first CPU, [0] = L1D. */
+    uint64_t cpu_llc_size;                      /* Last level cache size in bytes. 0 if unknown. */
 #if defined(__x86_64__) || defined(_M_X64)
-        uint64_t amd64_cpu_caps;                    /* x86-64 CPU features. Bitset of 1ull<<MAG_AMD64_CAP_* */
+    uint64_t amd64_cpu_caps;                    /* x86-64 CPU features. Bitset of 1ull<<MAG_AMD64_CAP_* */
 #elif defined (__aarch64__)
-        uint64_t arm64_cpu_caps;                    /* ARM64 CPU features. */
-        int64_t arm64_cpu_sve_width;                /* ARM64 SVE vector register width. */
+    uint64_t arm64_cpu_caps;                    /* ARM64 CPU features. */
+    int64_t arm64_cpu_sve_width;                /* ARM64 SVE vector register width. */
 #endif
-    } machine;
+} mag_machine_info_t;
+
+/*
+** Context contains all isolated state and data.
+** Lifetimes of tensors and compute graphs are bound to the context - the context is the owner.
+** By default the context is bound to its creating thread. In concurrent mode (mag_ctx_set_concurrent) tensors can be created
+** and ops run from several threads at once: allocations go through per-thread magazines and parallel ops share the worker pool.
+*/
+struct mag_ctx_t {
+    mag_machine_info_t machine;                     /* Host machine description. */
 #ifdef MAG_DEBUG
     mag_tensor_node_t* rc_tracked;                  /* Linked list of RC tensors for sanitize. */
 #endif
     mag_fixed_intrusive_pool tensor_pool;           /* Fixed-size memory pool for tensors. */
+    mag_fixed_intrusive_pool storage_pool;          /* Fixed-size memory pool for shared storage descriptors. */
+    mag_fixed_intrusive_pool tensor_cold_pool;      /* Fixed-size memory pool for cold tensor side tables. */
     mag_exec_mode_t exec_mode;
+    mag_math_mode_t math_mode;                      /* Accuracy of transcendental functions. */
+    bool concurrent;                                /* Tensors may be created and ops run from several threads. */
+    bool atomic_rc;                                 /* New tensors get atomic reference counts (MAG_TFLAG_ATOMIC_RC). */
+    bool atomic_rc_opt_in;                          /* Atomic reference counts requested by mag_ctx_set_atomic_refcount, kept when concurrent mode is left. */
+    volatile mag_atomic_t lock;                     /* Guards shared context state (PRNG, debug tracking) in concurrent mode. */
+    mag_storage_allocator_t storage_alloc;          /* Allocator for tensor storage. */
+    bool storage_alloc_custom;                      /* A custom storage allocator is installed, device caches are bypassed. */
+    volatile mag_atomic_t storage_allocs;           /* Storage statistics, see mag_storage_stats_t. */
+    volatile mag_atomic_t storage_frees;
+    volatile mag_atomic_t storage_bytes;
+    volatile mag_atomic_t storage_peak;
+    mag_free_mode_t free_mode;                      /* When storage of dead tensors is released. */
+    mag_storage_buffer_t** reclaim;                 /* Ring of storages queued for release by the deferred free modes. */
+    size_t reclaim_head;                            /* Index of the oldest queued storage. */
+    size_t reclaim_len;                             /* Number of queued storages. */
+    size_t reclaim_cap;                             /* Capacity of the reclaim queue. */
+    mag_storage_buffer_t** frozen;                  /* Storages of frozen tensors, pinned until the context is destroyed. */
+    size_t frozen_len;                              /* Number of pinned storages. */
+    size_t frozen_cap;                              /* Capacity of the pinned storage array. */
+    mag_plan_t* capture;                            /* Plan being recorded by mag_ctx_begin_capture, NULL otherwise. */
     bool profiler_enabled;
     mag_op_perf_info_t op_perf_mons_total[MAG_OP__NUM];
     union {
@@ -715,14 +879,28 @@ typedef enum mag_tensor_flags_t {
     MAG_TFLAG_VIEW = 1<<1,          /* Tensor is a view. */
     MAG_FLAG_GRAD = 1<<2,           /* Tensor is a gradient. */
     MAG_TFLAG_EXEC_EAGER = 1<<3,    /* Tensor is executed eagerly. */
+    MAG_TFLAG_FROZEN = 1<<4,        /* Tensor data is immutable and its storage can be shared with other contexts. */
+    MAG_TFLAG_ATOMIC_RC = 1<<5,     /* Reference counts are updated atomically, the tensor can be handed between threads. */
+    MAG_TFLAG_CONSUMED = 1<<6,      /* The caller's reference is handed to the next op, which may write its result into the buffer (see mag_tensor_consume). */
 
-    MAG_TFLAG_LEN = 4
+    MAG_TFLAG_LEN = 7
 } mag_tensor_flags_t;
 mag_static_assert(MAG_TFLAG_LEN <= 0xff);
 
 /*
 ** Tensor with up to 6 Dimensions.
 */
+/* Cold per-tensor data, only allocated when a name, user data or profiler stats are attached. */
+typedef struct mag_tensor_cold_t {
+    mag_perf_mon_t pmon;                             /* Performance monitor. */
+    void* ud;                                       /* User data. */
+    char name[MAG_MAX_TENSOR_NAME_LEN];              /* Tensor debug name. */
+} mag_tensor_cold_t;
+
+/*
+** Tensor header. Hot fields come first: the first cache line holds everything graph walks and dispatch touch,
+** shape and strides follow for the kernels. Rarely used data lives in the cold side table.
+*/
 struct mag_tensor_t {
     struct {
         uint32_t rc_strong;                         /* Strong reference count. */
@@ -731,23 +909,45 @@ struct mag_tensor_t {
         void (*dtor)(mag_tensor_t*);                 /* Debug destructor. */
 #endif
     } rcb;                                          /* Reference count control block. */
+    mag_storage_buffer_t* storage;                   /* Shared storage descriptor. */
+    mag_tensor_t* op_inputs[MAG_MAX_INPUT_TENSORS];   /* Input tensors for operators. */
+    mag_op_t op;                                     /* Opcode for operators. */
+    mag_dtype_t dtype;                               /* Data type of the tensor. */
+    mag_tensor_flags_t flags;                        /* Tensor flags. */
     mag_ctx_t* ctx;                                  /* Host context. */
+    int64_t numel;                                  /* Number of elements in the tensor. */
     int64_t rank;                                   /* Number of active dimensions. [1, MAX_DIMS] */
     int64_t shape[MAG_MAX_DIMS];                     /* Shape of the tensor. */
     int64_t strides[MAG_MAX_DIMS];                   /* Strides of the tensor. We store the strides in element counts and NOT in bytes. */
-    mag_dtype_t dtype;                               /* Data type of the tensor. */
-    mag_storage_buffer_t storage;                      /* Storage buffer. */
-    int64_t numel;                                  /* Number of elements in the tensor. */
-    mag_tensor_flags_t flags;                        /* Tensor flags. */
-    mag_op_t op;                                     /* Opcode for operators. */
-    mag_tensor_t* op_inputs[MAG_MAX_INPUT_TENSORS];   /* Input tensors for operators. */
     mag_op_param_t op_params[MAG_MAX_OP_PARAMS];      /* Operator parameters. */
     mag_tensor_t* view_uplink;                       /* View base tensor. */
     size_t view_offs;                               /* Offset in view tensor. */
     mag_tensor_t* grad;                              /* ∇f - Gradient tensor. */
-    mag_perf_mon_t pmon;                             /* Performance monitor. */
-    char name[MAG_MAX_TENSOR_NAME_LEN];              /* Tensor debug name. */
-    void* ud;                                       /* User data. */
+    mag_tensor_cold_t* cold;                         /* Cold side table, NULL until needed. */
+};
+#ifndef MAG_DEBUG
+mag_static_assert(offsetof(mag_tensor_t, rank) <= 64); /* Graph walk fields fit into one cache line. */
+mag_static_assert(sizeof(mag_tensor_t) <= 256);
+#endif
+
+/* Recorded op. Result and inputs are retained by the plan, op and parameters are restored on replay because out= ops re-target results. */
+typedef struct mag_plan_node_t {
+    mag_tensor_t* r;                                    /* Result tensor, written by the op. */
+    mag_op_t op;                                        /* Opcode. */
+    mag_tensor_t* inputs[MAG_MAX_INPUT_TENSORS];        /* Input tensors, rebound by mag_plan_bind. */
+    mag_op_param_t params[MAG_MAX_OP_PARAMS];           /* Operator parameters. */
+    mag_kernel_plan_t kernel;                           /* Kernel selected before the first replay. */
+} mag_plan_node_t;
+
+/* Ops recorded by graph capture or loaded from a graph file, in execution order. */
+struct mag_plan_t {
+    mag_ctx_t* ctx;                                     /* Host context. */
+    mag_plan_node_t* nodes;                             /* Recorded ops. */
+    size_t len;                                         /* Number of recorded ops. */
+    size_t cap;                                         /* Capacity of the node array. */
+    mag_tensor_t** outputs;                             /* Retained graph outputs, only set by mag_graph_load. */
+    size_t num_outputs;                                 /* Number of graph outputs. */
+    bool kernels_planned;                               /* Node kernels are selected, reset when inputs change. */
 };
 
 #define mag_load_local_storage_group_arr(arr, prefix) \
@@ -764,16 +964,25 @@ struct mag_tensor_t {
     (void)prefix##4; \
     (void)prefix##5
 
+typedef struct mag_kernel_registry_t mag_kernel_registry_t;
+
 typedef struct mag_compute_payload_t {
     int64_t thread_num;
     int64_t thread_idx;
     mag_tensor_t* node;
+    const mag_kernel_plan_t* kplan;     /* Selected kernel and loop bounds of a plan node, NULL in eager execution. */
+    const mag_kernel_registry_t* kernels; /* Registry the kernel was dispatched from. */
 } mag_compute_payload_t;
 
-typedef struct mag_kernel_registry_t {
+struct mag_kernel_registry_t {
     void (*fwd[MAG_OP__NUM])(const mag_compute_payload_t*);
     void (*bwd[MAG_OP__NUM])(const mag_compute_payload_t*);
-} mag_kernel_registry_t;
+    void (*select)(const mag_kernel_registry_t* kernels, const mag_tensor_t* node, mag_kernel_plan_t* kp);   /* Pick a specialized forward kernel, leaves kp->fn NULL if none fits. */
+    void (*vadd)(int64_t numel, float* o, const float* x, const float* y); /* Add of host buffers, used by collectives. */
+    void (*spmm)(const mag_csr_t* a, int64_t r0, int64_t r1, const float* b, int64_t n, float* c); /* Rows [r0, r1) of c = a x b. */
+    void (*sp24_matmul)(const mag_sp24_t* w, int64_t r0, int64_t r1, const float* x, int64_t n, float* y); /* Rows [r0, r1) of y = w x x. */
+    int64_t stream_threshold;   /* Output size in bytes above which element-wise kernels use non-temporal stores. Set by the device, kept across injections. */
+};
 
 #define mag_load_local_storage_group(xk, prefix, var) mag_load_local_storage_group_arr((xk)->var, prefix)
 
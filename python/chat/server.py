@@ -3,28 +3,30 @@ from math import ceil
 from dotenv import load_dotenv
 from flask import Flask, render_template, request
 import magnetron as mag
-from magnetron.models import *
+from magnetron.model import SequentialModel, DenseLayer
 
 load_dotenv()
 
 EPOCHS: int = 10000
 LEARNING_RATE: float = 0.8
+BATCH_SIZE: int = 16 # Requests served by one forward pass
+BATCH_TIMEOUT_US: int = 2000 # Longest time a request waits for others to join its batch
 
-# Inputs
-inputs = [
-    mag.Tensor.const([0.0, 0.0]),
-    mag.Tensor.const([0.0, 1.0]),
-    mag.Tensor.const([1.0, 0.0]),
-    mag.Tensor.const([1.0, 1.0])
-]
-
-# Targets
-targets = [
-    mag.Tensor.const([0.0]),
-    mag.Tensor.const([1.0]),
-    mag.Tensor.const([1.0]),
-    mag.Tensor.const([0.0])
-]
+# Inputs: shape (4, 2)
+inputs = mag.Tensor.const([
+    [0.0, 0.0],
+    [0.0, 1.0],
+    [1.0, 0.0],
+    [1.0, 1.0]
+])
+
+# Targets: shape (4, 1)
+targets = mag.Tensor.const([
+    [0.0],
+    [1.0],
+    [1.0],
+    [0.0]
+])
 
 mlp = SequentialModel([
     DenseLayer(2, 4),
@@ -35,6 +37,14 @@ mlp = SequentialModel([
 print('Training XOR model...')
 losses = mlp.train(inputs, targets, EPOCHS, LEARNING_RATE)
 
+# Record one batched forward pass, one request per column, and let the batcher replay it for concurrent requests
+ctx = mag.Context.active()
+batch_input = mag.Tensor.zeros((2, BATCH_SIZE))
+ctx.begin_capture()
+batch_output = mlp.forward(batch_input)
+plan = ctx.end_capture()
+batcher = mag.Batcher(plan, batch_input, batch_output, batch_dim=1, timeout_us=BATCH_TIMEOUT_US)
+
 print('Launching Flask server...')
 app = Flask(__name__)
 
@@ -50,9 +60,8 @@ def get_response():
         splits = message.split(' ')
         a: float = float(splits[0])
         b: float = float(splits[1])
-        inp = mag.Tensor.const([a, b])
-        result: float = mlp.forward(inp).scalar()
-        result_rounded: float = mlp.forward(inp, activation=mag.Operator.HARD_SIGMOID).scalar()
+        result: float = batcher.infer([a, b])[0]
+        result_rounded: float = round(result)
         return f'{a} ^ {b} = {result} ≈ {result_rounded} => {int(result_rounded) == 1}'
     except:
         return 'Please enter a valid input. Enter two numbers (between 0 and 1) seperated by spaces. For example: 1 1 or 1 0 or 0 0.'
@@ -60,9 +69,9 @@ def get_response():
 
 @app.route('/api/v1/system_info')
 def get_system_info():
-    ctx = mag.Context.active
+    ctx = mag.Context.active()
     return f'{ctx.os_name} | {ctx.cpu_name} ({ctx.cpu_virtual_cores}) | {ctx.physical_memory_total / (1 << 30)} GiB RAM | {(ctx.total_allocated_pool_memory / (1 << 20)):.2f} MiB POOL'
 
 
 if __name__ == '__main__':
-    app.run(host='0.0.0.0', use_reloader=False)  #  host='0.0.0.0'
+    app.run(host='0.0.0.0', use_reloader=False, threaded=True)  #  host='0.0.0.0'
@@ -4,6 +4,7 @@ __MAG_CDECLS: str = '''
 typedef enum mag_compute_device_type_t {
 MAG_COMPUTE_DEVICE_TYPE_CPU = 0,
 MAG_COMPUTE_DEVICE_TYPE_GPU_CUDA = 1,
+MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM = 2,
 MAG_COMPUTE_DEVICE_TYPE__NUM
 } mag_compute_device_type_t;
 extern   const char* mag_device_type_get_name(mag_compute_device_type_t op);
@@ -12,6 +13,17 @@ MAG_EXEC_MODE_EAGER = 0,
 MAG_EXEC_MODE_DEFERRED = 1,
 MAG_EXEC_MODE__NUM
 } mag_exec_mode_t;
+typedef enum mag_math_mode_t {
+MAG_MATH_MODE_PRECISE = 0,
+MAG_MATH_MODE_APPROX = 1,
+MAG_MATH_MODE__NUM
+} mag_math_mode_t;
+typedef enum mag_free_mode_t {
+MAG_FREE_MODE_IMMEDIATE = 0,
+MAG_FREE_MODE_DEFERRED = 1,
+MAG_FREE_MODE_BACKGROUND = 2,
+MAG_FREE_MODE__NUM
+} mag_free_mode_t;
 typedef enum mag_prng_algorithm_t {
 MAG_PRNG_MERSENNE_TWISTER = 0,
 MAG_PRNG_PCG = 1,
@@ -40,11 +52,43 @@ typedef struct mag_device_descriptor_t {
 mag_compute_device_type_t type;
 uint32_t thread_count;
 uint32_t cuda_device_id;
+uint64_t stream_threshold;
 } mag_device_descriptor_t;
+typedef struct mag_storage_stats_t {
+uint64_t num_allocs;
+uint64_t num_frees;
+uint64_t bytes_live;
+uint64_t bytes_peak;
+uint64_t bytes_reserved;
+} mag_storage_stats_t;
+typedef struct mag_storage_allocator_t {
+void* (*alloc)(void* ud, size_t size, size_t align);
+void (*free)(void* ud, void* blk, size_t size);
+void (*stats)(void* ud, mag_storage_stats_t* out);
+void* ud;
+} mag_storage_allocator_t;
 extern   mag_ctx_t* mag_ctx_create(mag_compute_device_type_t device);
 extern   mag_ctx_t* mag_ctx_create2(const mag_device_descriptor_t* device_info);
 extern   mag_exec_mode_t mag_ctx_get_exec_mode(const mag_ctx_t* _ptr);
 extern   void mag_ctx_set_exec_mode(mag_ctx_t* _ptr, mag_exec_mode_t mode);
+extern   mag_math_mode_t mag_ctx_get_math_mode(const mag_ctx_t* _ptr);
+extern   void mag_ctx_set_math_mode(mag_ctx_t* _ptr, mag_math_mode_t mode);
+extern   bool mag_ctx_is_concurrent(const mag_ctx_t* _ptr);
+extern   void mag_ctx_set_concurrent(mag_ctx_t* _ptr, bool concurrent);
+extern   mag_free_mode_t mag_ctx_get_free_mode(const mag_ctx_t* _ptr);
+extern   void mag_ctx_set_free_mode(mag_ctx_t* _ptr, mag_free_mode_t mode);
+extern   void mag_ctx_reclaim(mag_ctx_t* _ptr);
+typedef uint64_t mag_event_t;
+extern   bool mag_ctx_is_async(const mag_ctx_t* _ptr);
+extern   void mag_ctx_synchronize(mag_ctx_t* _ptr);
+extern   mag_event_t mag_ctx_record_event(mag_ctx_t* _ptr);
+extern   bool mag_ctx_query_event(mag_ctx_t* _ptr, mag_event_t ev);
+extern   void mag_ctx_wait_event(mag_ctx_t* _ptr, mag_event_t ev);
+extern   void mag_ctx_get_storage_allocator(const mag_ctx_t* _ptr, mag_storage_allocator_t* out);
+extern   void mag_ctx_set_storage_allocator(mag_ctx_t* _ptr, const mag_storage_allocator_t* allocator);
+extern   void mag_ctx_get_storage_stats(const mag_ctx_t* _ptr, mag_storage_stats_t* out);
+extern   bool mag_ctx_get_atomic_refcount(const mag_ctx_t* _ptr);
+extern   void mag_ctx_set_atomic_refcount(mag_ctx_t* _ptr, bool atomic);
 extern   mag_prng_algorithm_t mag_ctx_get_prng_algorithm(const mag_ctx_t* _ptr);
 extern   void mag_ctx_set_prng_algorithm(mag_ctx_t* _ptr, mag_prng_algorithm_t algorithm, uint64_t seed);
 extern   mag_compute_device_type_t mag_ctx_get_compute_device_type(const mag_ctx_t* _ptr);
@@ -56,6 +100,9 @@ extern   uint32_t mag_ctx_get_cpu_physical_cores(const mag_ctx_t* _ptr);
 extern   uint32_t mag_ctx_get_cpu_sockets(const mag_ctx_t* _ptr);
 extern   uint64_t mag_ctx_get_physical_memory_total(const mag_ctx_t* _ptr);
 extern   uint64_t mag_ctx_get_physical_memory_free(const mag_ctx_t* _ptr);
+extern   uint64_t mag_ctx_get_cpu_cache_size(const mag_ctx_t* _ptr, uint32_t level);
+extern   uint32_t mag_ctx_get_cpu_cache_line_size(const mag_ctx_t* _ptr, uint32_t level);
+extern   uint32_t mag_ctx_get_cpu_cache_shared_by(const mag_ctx_t* _ptr, uint32_t level);
 extern   bool mag_ctx_is_numa_system(const mag_ctx_t* _ptr);
 extern   size_t mag_ctx_get_total_tensors_created(const mag_ctx_t* _ptr);
 extern   void mag_ctx_profile_start_recording(mag_ctx_t* _ptr);
@@ -150,6 +197,86 @@ extern   mag_tensor_t* mag_muls_(mag_tensor_t* x, float xi);
 extern   mag_tensor_t* mag_divs(mag_tensor_t* x, float xi);
 extern   mag_tensor_t* mag_divs_(mag_tensor_t* x, float xi);
 extern   mag_tensor_t* mag_matmul(mag_tensor_t* a, mag_tensor_t* b);
+extern   mag_tensor_t* mag_clone_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_mean_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_min_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_max_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_sum_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_abs_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_neg_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_log_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_sqr_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_sqrt_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_sin_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_cos_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_step_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_softmax_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_softmax_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_sigmoid_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_sigmoid_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_hard_sigmoid_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_silu_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_silu_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_tanh_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_tanh_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_relu_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_relu_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_gelu_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_gelu_dv_out(mag_tensor_t* x, mag_tensor_t* out);
+extern   mag_tensor_t* mag_add_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern   mag_tensor_t* mag_sub_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern   mag_tensor_t* mag_mul_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern   mag_tensor_t* mag_div_out(mag_tensor_t* x, mag_tensor_t* y, mag_tensor_t* out);
+extern   mag_tensor_t* mag_adds_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern   mag_tensor_t* mag_subs_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern   mag_tensor_t* mag_muls_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern   mag_tensor_t* mag_divs_out(mag_tensor_t* x, float xi, mag_tensor_t* out);
+extern   mag_tensor_t* mag_matmul_out(mag_tensor_t* a, mag_tensor_t* b, mag_tensor_t* out);
+typedef struct mag_plan_t mag_plan_t;
+extern   void mag_ctx_begin_capture(mag_ctx_t* _ptr);
+extern   mag_plan_t* mag_ctx_end_capture(mag_ctx_t* _ptr);
+extern   bool mag_ctx_is_capturing(const mag_ctx_t* _ptr);
+extern   size_t mag_plan_get_num_nodes(const mag_plan_t* plan);
+extern   size_t mag_plan_get_num_outputs(const mag_plan_t* plan);
+extern   mag_tensor_t* mag_plan_get_output(const mag_plan_t* plan, size_t idx);
+extern   mag_tensor_t* mag_plan_find_tensor(const mag_plan_t* plan, const char* name);
+extern   void mag_plan_bind(mag_plan_t* plan, mag_tensor_t* handle, mag_tensor_t* input);
+extern   void mag_plan_replay(mag_plan_t* plan);
+extern   size_t mag_plan_optimize(mag_plan_t* plan);
+extern   void mag_plan_destroy(mag_plan_t* plan);
+extern   void mag_graph_save(mag_tensor_t** outputs, size_t num_outputs, const char* file);
+extern   mag_plan_t* mag_graph_load(mag_ctx_t* _ptr, const char* file);
+typedef struct mag_comm_t mag_comm_t;
+extern   mag_comm_t* mag_comm_create(mag_ctx_t* _ptr, const char* name, uint64_t session, uint32_t rank, uint32_t world_size, size_t slot_size);
+extern   void mag_comm_destroy(mag_comm_t* comm);
+extern   uint32_t mag_comm_get_rank(const mag_comm_t* comm);
+extern   uint32_t mag_comm_get_world_size(const mag_comm_t* comm);
+extern   void mag_comm_barrier(mag_comm_t* comm);
+extern   void mag_comm_all_reduce(mag_comm_t* comm, mag_tensor_t* t, bool average);
+extern   void mag_comm_all_reduce_start(mag_comm_t* comm, mag_tensor_t* t, bool average);
+extern   void mag_comm_wait(mag_comm_t* comm);
+typedef struct mag_batcher_t mag_batcher_t;
+extern   mag_batcher_t* mag_batcher_create(mag_plan_t* plan, mag_tensor_t* input, int64_t in_dim, mag_tensor_t* output, int64_t out_dim, uint64_t timeout_us);
+extern   void mag_batcher_destroy(mag_batcher_t* b);
+extern   void mag_batcher_infer(mag_batcher_t* b, const float* x, float* y);
+extern   void mag_batcher_get_stats(mag_batcher_t* b, uint64_t* num_requests, uint64_t* num_batches);
+typedef struct mag_csr_t mag_csr_t;
+extern   mag_csr_t* mag_csr_from_dense(mag_tensor_t* t);
+extern   mag_csr_t* mag_csr_from_coo(mag_ctx_t* _ptr, int64_t rows, int64_t cols, int64_t nnz, const int64_t* row_idx, const int64_t* col_idx, const float* values);
+extern   mag_tensor_t* mag_csr_to_dense(const mag_csr_t* a);
+extern   void mag_csr_destroy(mag_csr_t* a);
+extern   int64_t mag_csr_get_rows(const mag_csr_t* a);
+extern   int64_t mag_csr_get_cols(const mag_csr_t* a);
+extern   int64_t mag_csr_get_nnz(const mag_csr_t* a);
+extern   mag_tensor_t* mag_spmv(const mag_csr_t* a, mag_tensor_t* x);
+extern   mag_tensor_t* mag_spmm(const mag_csr_t* a, mag_tensor_t* b);
+typedef struct mag_sp24_t mag_sp24_t;
+extern   mag_sp24_t* mag_sp24_from_dense(mag_tensor_t* t, bool prune);
+extern   mag_tensor_t* mag_sp24_to_dense(const mag_sp24_t* w);
+extern   void mag_sp24_destroy(mag_sp24_t* w);
+extern   int64_t mag_sp24_get_rows(const mag_sp24_t* w);
+extern   int64_t mag_sp24_get_cols(const mag_sp24_t* w);
+extern   mag_tensor_t* mag_sp24_matmul(const mag_sp24_t* w, mag_tensor_t* x);
 extern   void mag_tensor_incref(mag_tensor_t* t);
 extern   bool mag_tensor_decref(mag_tensor_t* t);
 extern   void mag_tensor_copy_buffer_from(mag_tensor_t* t, const void* data, size_t size);
@@ -158,6 +285,12 @@ extern   void mag_tensor_fill_random_uniform(mag_tensor_t* t, float min, float m
 extern   void mag_tensor_fill_random_normal(mag_tensor_t* t, float mean, float stddev);
 extern   uint64_t mag_tensor_get_packed_refcounts(const mag_tensor_t* t);
 extern   void mag_tensor_retain(mag_tensor_t* t);
+extern   bool mag_tensor_consume(mag_tensor_t* t);
+extern   void mag_tensor_freeze(mag_tensor_t* t);
+extern   bool mag_tensor_is_frozen(const mag_tensor_t* t);
+extern   void mag_tensor_set_atomic_refcount(mag_tensor_t* t);
+extern   bool mag_tensor_has_atomic_refcount(const mag_tensor_t* t);
+extern   mag_tensor_t* mag_tensor_share(mag_ctx_t* _ptr, mag_tensor_t* src);
 extern   size_t mag_tensor_get_memory_usage(const mag_tensor_t* t);
 extern   void mag_tensor_print(const mag_tensor_t* t, bool with_header, bool with_data);
 extern   void mag_tensor_set_name(mag_tensor_t* t, const char* name);
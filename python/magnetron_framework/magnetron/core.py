@@ -7,6 +7,7 @@
 # See also https://wiki.python.org/moin/DebuggingWithGdb
 
 import faulthandler
+import sys
 import weakref
 from dataclasses import dataclass
 from os import getenv
@@ -79,6 +80,22 @@ class ComputeDevice:
 
             self.num_threads = num_threads
 
+    class CPUStream:
+        """
+        Asynchronous CPU device configuration. Ops are queued and run in order on a submission thread.
+        """
+        def __init__(self, num_threads: int = 0):
+            """
+            Initializes a new asynchronous CPU device configuration.
+
+            Parameters
+            ----------
+            num_threads : int, optional
+                Number of threads to use, 0 for automatic, by default 0.
+            """
+
+            self.num_threads = num_threads
+
     class CUDA:
         """
         CUDA device configuration.
@@ -95,6 +112,23 @@ class ComputeDevice:
 
             self.device_id = device_id
 
+class MathMode(Enum):
+    """
+    Accuracy of transcendental functions (exp, log, sin, cos, tanh, ...) on the CPU.
+    """
+    PRECISE = 0  # libm, accurate to ~1 ULP
+    APPROX = 1  # SIMD approximations, faster but slightly less accurate
+
+
+class FreeMode(Enum):
+    """
+    When storage of dead tensors is released.
+    """
+    IMMEDIATE = 0  # Free as soon as the last tensor referencing the storage dies
+    DEFERRED = 1  # Queue and free in batches, freed buffers are cached for reuse
+    BACKGROUND = 2  # Like deferred, buffers are returned to the OS by a background thread
+
+
 class PRNGAlgorithm(Enum):
     """
     Pseudorandom number generator algorithms.
@@ -171,7 +205,7 @@ class ExecutionMode(Enum):
 @dataclass
 class GlobalConfig:
     verbose: bool = (getenv('MAG_VERBOSE', '0') == '1')
-    compute_device: ComputeDevice.CPU | ComputeDevice.CUDA = ComputeDevice.CPU()
+    compute_device: ComputeDevice.CPU | ComputeDevice.CPUStream | ComputeDevice.CUDA = ComputeDevice.CPU()
 
 
 class Context:
@@ -199,14 +233,14 @@ class Context:
             Context._active = Context(GlobalConfig.compute_device)
         return Context._active
 
-    def __init__(self, device: ComputeDevice.CPU | ComputeDevice.CUDA, *, execution_mode: ExecutionMode = ExecutionMode.EAGER):
+    def __init__(self, device: ComputeDevice.CPU | ComputeDevice.CPUStream | ComputeDevice.CUDA, *, execution_mode: ExecutionMode = ExecutionMode.EAGER):
         """
         Initializes a new magnetron context.
 
         Parameters
         ----------
         device : ComputeDevice
-            The compute device (CPU or CUDA).
+            The compute device (CPU, CPUStream or CUDA).
         execution_mode : ExecutionMode, optional
             The execution mode (eager or deferred), by default EAGER.
         """
@@ -217,6 +251,9 @@ class Context:
         elif isinstance(device, ComputeDevice.CUDA):
             descriptor.type = 1
             descriptor.cuda_device_id = abs(device.device_id)
+        elif isinstance(device, ComputeDevice.CPUStream):
+            descriptor.type = 2
+            descriptor.thread_count = abs(device.num_threads)
         self._ptr = C.mag_ctx_create2(descriptor)
         self.execution_mode = execution_mode
 
@@ -256,6 +293,186 @@ class Context:
         """
         C.mag_ctx_set_exec_mode(self._ptr, mode.value)
 
+    @property
+    def math_mode(self) -> MathMode:
+        """
+        Returns the accuracy mode of transcendental functions.
+
+        Returns
+        -------
+        MathMode
+            The current math mode (PRECISE or APPROX).
+        """
+        return MathMode(C.mag_ctx_get_math_mode(self._ptr))
+
+    @math_mode.setter
+    def math_mode(self, mode: MathMode):
+        """
+        Sets the accuracy mode of transcendental functions.
+
+        Parameters
+        ----------
+        mode : MathMode
+            Desired mode (PRECISE or APPROX).
+        """
+        C.mag_ctx_set_math_mode(self._ptr, mode.value)
+
+    @property
+    def concurrent(self) -> bool:
+        """
+        Returns whether several threads may create tensors and run ops on this context.
+
+        Returns
+        -------
+        bool
+            True if concurrent mode is enabled.
+        """
+        return C.mag_ctx_is_concurrent(self._ptr)
+
+    @concurrent.setter
+    def concurrent(self, enable: bool):
+        """
+        Enables or disables concurrent mode. Must be toggled from the thread that created the context,
+        while no other thread uses it.
+
+        Parameters
+        ----------
+        enable : bool
+            True to allow use from several threads.
+        """
+        C.mag_ctx_set_concurrent(self._ptr, enable)
+
+    @property
+    def free_mode(self) -> FreeMode:
+        """
+        Returns when storage of dead tensors is released.
+
+        Returns
+        -------
+        FreeMode
+            The current free mode.
+        """
+        return FreeMode(C.mag_ctx_get_free_mode(self._ptr))
+
+    @free_mode.setter
+    def free_mode(self, mode: FreeMode):
+        """
+        Sets when storage of dead tensors is released. Switching to immediate reclaims all queued storage.
+
+        Parameters
+        ----------
+        mode : FreeMode
+            The free mode to use.
+        """
+        C.mag_ctx_set_free_mode(self._ptr, mode.value)
+
+    def reclaim(self) -> None:
+        """
+        Frees all storage queued by the deferred free modes, e.g. after a training step.
+        """
+        C.mag_ctx_reclaim(self._ptr)
+
+    @property
+    def is_async(self) -> bool:
+        """
+        Returns whether the compute device runs ops asynchronously.
+
+        Returns
+        -------
+        bool
+            True if ops return before they ran.
+        """
+        return C.mag_ctx_is_async(self._ptr)
+
+    def synchronize(self) -> None:
+        """
+        Waits until the compute device finished all submitted work. Reading tensor data synchronizes implicitly.
+        """
+        C.mag_ctx_synchronize(self._ptr)
+
+    def record_event(self) -> int:
+        """
+        Records an event after the work submitted so far.
+
+        Returns
+        -------
+        int
+            Event handle for query_event and wait_event.
+        """
+        return C.mag_ctx_record_event(self._ptr)
+
+    def query_event(self, event: int) -> bool:
+        """
+        Checks without blocking if the work before an event completed.
+
+        Parameters
+        ----------
+        event : int
+            Event returned by record_event.
+
+        Returns
+        -------
+        bool
+            True if the work completed.
+        """
+        return C.mag_ctx_query_event(self._ptr, event)
+
+    def wait_event(self, event: int) -> None:
+        """
+        Waits until the work before an event completed.
+
+        Parameters
+        ----------
+        event : int
+            Event returned by record_event.
+        """
+        C.mag_ctx_wait_event(self._ptr, event)
+
+    @property
+    def storage_stats(self) -> dict[str, int]:
+        """
+        Returns statistics of the tensor storage allocated by this context.
+
+        Returns
+        -------
+        dict[str, int]
+            Number of allocations and frees, live, peak and allocator reserved bytes.
+        """
+        stats: ffi.CData = ffi.new('mag_storage_stats_t*')
+        C.mag_ctx_get_storage_stats(self._ptr, stats)
+        return {
+            'num_allocs': stats.num_allocs,
+            'num_frees': stats.num_frees,
+            'bytes_live': stats.bytes_live,
+            'bytes_peak': stats.bytes_peak,
+            'bytes_reserved': stats.bytes_reserved,
+        }
+
+    @property
+    def atomic_refcount(self) -> bool:
+        """
+        Returns whether new tensors get atomic reference counts.
+
+        Returns
+        -------
+        bool
+            True if atomic reference counts are enabled.
+        """
+        return C.mag_ctx_get_atomic_refcount(self._ptr)
+
+    @atomic_refcount.setter
+    def atomic_refcount(self, enable: bool):
+        """
+        Gives new tensors atomic reference counts, so they can be handed between threads.
+        Enabled automatically by concurrent mode.
+
+        Parameters
+        ----------
+        enable : bool
+            True to use atomic reference counts.
+        """
+        C.mag_ctx_set_atomic_refcount(self._ptr, enable)
+
     @property
     def prng_algorithm(self) -> PRNGAlgorithm:
         """
@@ -268,187 +485,812 @@ class Context:
         """
         return PRNGAlgorithm(C.mag_ctx_get_prng_algorithm(self._ptr))
 
-    @prng_algorithm.setter
-    def prng_algorithm(self, algorithm: PRNGAlgorithm):
+    @prng_algorithm.setter
+    def prng_algorithm(self, algorithm: PRNGAlgorithm):
+        """
+        Sets the PRNG algorithm and re-seeds it.
+
+        Parameters
+        ----------
+        algorithm : PRNGAlgorithm
+            The desired PRNG algorithm.
+        """
+        C.mag_ctx_set_prng_algorithm(self._ptr, algorithm.value, 0)
+
+    @property
+    def os_name(self) -> str:
+        """
+        Returns the operating system name.
+
+        Returns
+        -------
+        str
+            The OS name (e.g., "Linux").
+        """
+        return ffi.string(C.mag_ctx_get_os_name(self._ptr)).decode('utf-8')
+
+    @property
+    def cpu_name(self) -> str:
+        """
+        Returns the CPU name/brand string.
+
+        Returns
+        -------
+        str
+            The CPU name.
+        """
+        return ffi.string(C.mag_ctx_get_cpu_name(self._ptr)).decode('utf-8')
+
+    @property
+    def cpu_virtual_cores(self) -> int:
+        """
+        Returns the number of virtual CPU cores (logical processors).
+
+        Returns
+        -------
+        int
+            Count of virtual CPU cores.
+        """
+        return C.mag_ctx_get_cpu_virtual_cores(self._ptr)
+
+    @property
+    def cpu_physical_cores(self) -> int:
+        """
+        Returns the number of physical CPU cores.
+
+        Returns
+        -------
+        int
+            Count of physical CPU cores.
+        """
+        return C.mag_ctx_get_cpu_physical_cores(self._ptr)
+
+    @property
+    def cpu_sockets(self) -> int:
+        """
+        Returns the number of CPU sockets present on the system.
+
+        Returns
+        -------
+        int
+            CPU socket count.
+        """
+        return C.mag_ctx_get_cpu_sockets(self._ptr)
+
+    @property
+    def physical_memory_total(self) -> int:
+        """
+        Returns the total physical memory (RAM) in bytes.
+
+        Returns
+        -------
+        int
+            Total system memory in bytes.
+        """
+        return C.mag_ctx_get_physical_memory_total(self._ptr)
+
+    @property
+    def physical_memory_free(self) -> int:
+        """
+        Returns the amount of free physical memory (RAM) in bytes.
+
+        Returns
+        -------
+        int
+            Free memory in bytes.
+        """
+        return C.mag_ctx_get_physical_memory_free(self._ptr)
+
+    @property
+    def physical_memory_used(self) -> int:
+        """
+        Returns the amount of used physical memory (RAM) in bytes.
+
+        Returns
+        -------
+        int
+            Used memory in bytes.
+        """
+        return abs(self.physical_memory_total - self.physical_memory_free)
+
+    def cpu_cache_size(self, level: int) -> int:
+        """
+        Returns the size of the data/unified CPU cache at the given level.
+
+        Parameters
+        ----------
+        level : int
+            Cache level, 1 = L1 data cache, 2 = L2, 3 = L3.
+
+        Returns
+        -------
+        int
+            Cache size in bytes, 0 if the level is not present or unknown.
+        """
+        return C.mag_ctx_get_cpu_cache_size(self._ptr, level)
+
+    def cpu_cache_line_size(self, level: int) -> int:
+        """
+        Returns the line size of the CPU cache at the given level.
+
+        Parameters
+        ----------
+        level : int
+            Cache level, 1 = L1 data cache, 2 = L2, 3 = L3.
+
+        Returns
+        -------
+        int
+            Line size in bytes, 0 if unknown.
+        """
+        return C.mag_ctx_get_cpu_cache_line_size(self._ptr, level)
+
+    def cpu_cache_shared_by(self, level: int) -> int:
+        """
+        Returns the number of logical CPUs sharing one instance of the CPU cache at the given level.
+
+        Parameters
+        ----------
+        level : int
+            Cache level, 1 = L1 data cache, 2 = L2, 3 = L3.
+
+        Returns
+        -------
+        int
+            Logical CPU count, 0 if unknown.
+        """
+        return C.mag_ctx_get_cpu_cache_shared_by(self._ptr, level)
+
+    @property
+    def is_numa_system(self) -> bool:
+        """
+        Checks if the system uses Non-Uniform Memory Access (NUMA).
+
+        Returns
+        -------
+        bool
+            True if NUMA is supported, False otherwise.
+        """
+        return C.mag_ctx_is_numa_system(self._ptr)
+
+    @property
+    def total_allocated_pool_memory(self) -> int:
+        """
+        Returns the total allocated memory (pool) by this context.
+
+        Returns
+        -------
+        int
+            Total allocated memory in bytes.
+        """
+        return C.mag_ctx_total_allocated_pool_memory(self._ptr)
+
+    @property
+    def total_tensors_created(self) -> int:
+        """
+        Returns the total number of tensors created (including views).
+
+        Returns
+        -------
+        int
+            Count of all tensors created.
+        """
+        return C.mag_ctx_get_total_tensors_created(self._ptr)
+
+    @property
+    def total_tensors_allocated(self) -> int:
+        """
+        Returns the total number of allocated tensors (not including views).
+
+        Returns
+        -------
+        int
+            Count of allocated tensors.
+        """
+        return C.mag_ctx_get_total_tensors_allocated(self._ptr)
+
+    def start_profiler(self) -> None:
+        """
+        Starts recording profiling information for operations.
+        Profiling must be stopped to produce a report. Slightly reduces performance.
+        """
+        C.mag_ctx_profile_start_recording(self._ptr)
+
+    def stop_profiler(self, export_csv_file: str | None = None) -> None:
+        """
+        Stops recording profiling information and generates a report.
+
+        Parameters
+        ----------
+        export_csv_file : str, optional
+            Path to export a CSV profiling report. If None, only an internal report is generated.
+        """
+        csv_file = ffi.NULL if export_csv_file is None else bytes(export_csv_file, 'utf-8')
+        C.mag_ctx_profile_stop_recording(self._ptr, csv_file)
+
+    def begin_capture(self) -> None:
+        """
+        Starts recording ops into a plan. Ops still execute while being recorded.
+        """
+        C.mag_ctx_begin_capture(self._ptr)
+
+    def end_capture(self) -> 'Plan':
+        """
+        Stops recording ops.
+
+        Returns
+        -------
+        Plan
+            The recorded plan, which replays the ops without Python dispatch.
+        """
+        return Plan(C.mag_ctx_end_capture(self._ptr))
+
+    @property
+    def is_capturing(self) -> bool:
+        """
+        Returns whether ops are being recorded into a plan.
+
+        Returns
+        -------
+        bool
+            True between begin_capture and end_capture.
+        """
+        return C.mag_ctx_is_capturing(self._ptr)
+
+    def __del__(self):
+        """
+        Destructor that releases context resources.
+        """
+        C.mag_ctx_destroy(self._ptr)
+        self._ptr = ffi.NULL
+
+
+class Plan:
+    """
+    Ops recorded by Context.begin_capture and Context.end_capture, or loaded from a graph file by Plan.load.
+    The plan keeps all recorded tensors alive and replays the kernels into the same buffers, skipping validation,
+    allocation and Python dispatch.
+    """
+
+    def __init__(self, ptr: ffi.CData) -> None:
+        assert ptr != ffi.NULL, 'Invalid plan pointer'
+        self._ptr = ptr
+
+    def __del__(self) -> None:
+        if hasattr(self, '_ptr') and self._ptr != ffi.NULL:
+            C.mag_plan_destroy(self._ptr)
+        self._ptr = ffi.NULL
+
+    @property
+    def num_nodes(self) -> int:
+        """
+        Returns the number of recorded ops.
+
+        Returns
+        -------
+        int
+            Count of recorded ops.
+        """
+        return C.mag_plan_get_num_nodes(self._ptr)
+
+    @staticmethod
+    def save(outputs: list['Tensor'], file_path: str) -> None:
+        """
+        Saves the op graph computing the outputs together with the data of its weights and inputs.
+
+        Parameters
+        ----------
+        outputs : list[Tensor]
+            The graph outputs.
+        file_path : str
+            File path to save the graph. Appends '.magnetron' if not present.
+        """
+        if not file_path.endswith('.magnetron'):
+            file_path += '.magnetron'
+        ptrs = ffi.new('mag_tensor_t*[]', [t._ptr for t in outputs])
+        C.mag_graph_save(ptrs, len(outputs), bytes(file_path, 'utf-8'))
+
+    @classmethod
+    def load(cls, file_path: str) -> 'Plan':
+        """
+        Loads a graph saved by Plan.save into the active context. No op runs until the first replay.
+
+        Parameters
+        ----------
+        file_path : str
+            Path to the .magnetron file.
+
+        Returns
+        -------
+        Plan
+            The loaded plan.
+
+        Raises
+        ------
+        RuntimeError
+            If the graph section of the file is corrupt.
+        """
+        assert file_path.endswith('.magnetron'), 'File must be a magnetron file'
+        ptr = C.mag_graph_load(Context.active()._ptr, bytes(file_path, 'utf-8'))
+        if ptr == ffi.NULL:
+            raise RuntimeError(f'Corrupt graph file: {file_path}')
+        return cls(ptr)
+
+    @property
+    def outputs(self) -> list['Tensor']:
+        """
+        Returns the graph outputs of a loaded plan.
+
+        Returns
+        -------
+        list[Tensor]
+            Output tensors, empty for captured plans.
+        """
+        outputs = []
+        for i in range(C.mag_plan_get_num_outputs(self._ptr)):
+            ptr = C.mag_plan_get_output(self._ptr, i)
+            C.mag_tensor_incref(ptr)
+            outputs.append(Tensor(ptr))
+        return outputs
+
+    def find(self, name: str) -> 'Tensor | None':
+        """
+        Finds an input or result of the plan by name, e.g. to fill a graph input before replay.
+
+        Parameters
+        ----------
+        name : str
+            The tensor name.
+
+        Returns
+        -------
+        Tensor | None
+            The tensor, or None if the plan has none of that name.
+        """
+        ptr = C.mag_plan_find_tensor(self._ptr, bytes(name, 'utf-8'))
+        if ptr == ffi.NULL:
+            return None
+        C.mag_tensor_incref(ptr)
+        return Tensor(ptr)
+
+    def bind(self, handle: 'Tensor', tensor: 'Tensor') -> None:
+        """
+        Replaces a captured input tensor by another tensor of the same shape and dtype.
+
+        Parameters
+        ----------
+        handle : Tensor
+            The tensor used as input while capturing.
+        tensor : Tensor
+            The tensor to read instead on replay.
+        """
+        C.mag_plan_bind(self._ptr, handle._ptr, tensor._ptr)
+
+    def replay(self) -> None:
+        """
+        Re-runs all recorded ops in order.
+        """
+        C.mag_plan_replay(self._ptr)
+
+    def optimize(self) -> int:
+        """
+        Evaluates ops on frozen tensors once, forwards identities such as x*1, merges duplicate ops and drops
+        ops whose results are no longer referenced. Element-wise ops reuse the buffer of a dead intermediate input.
+        Call it before binding inputs.
+
+        Returns
+        -------
+        int
+            Number of removed ops.
+        """
+        return C.mag_plan_optimize(self._ptr)
+
+
+class Communicator:
+    """
+    Data-parallel group of processes on one host, which exchange tensors through shared memory.
+    Start one process per rank with the same name, session and world size. Every rank must issue the same
+    collectives in the same order, on F32 tensors of equal size.
+    """
+
+    def __init__(self, name: str, session: int, rank: int, world_size: int, *, slot_size: int = 0, ctx: Context | None = None) -> None:
+        """
+        Joins the group, waits until all ranks joined.
+
+        Parameters
+        ----------
+        name : str
+            Group name shared by all ranks.
+        session : int
+            Launch id shared by all ranks and new for every launch, e.g. the launcher's pid. Ranks never
+            join a segment left over by an earlier launch of the same name.
+        rank : int
+            Rank of this process, in [0, world_size).
+        world_size : int
+            Number of processes.
+        slot_size : int, optional
+            Bytes reduced per step, 0 for the default.
+        ctx : Context, optional
+            Context of the reduced tensors, the active context by default.
+        """
+        ctx = ctx or Context.active()
+        self._ptr = C.mag_comm_create(ctx._ptr, name.encode('utf-8'), session, rank, world_size, slot_size)
+
+    def __del__(self) -> None:
+        if hasattr(self, '_ptr') and self._ptr != ffi.NULL:
+            C.mag_comm_destroy(self._ptr)
+        self._ptr = ffi.NULL
+
+    @property
+    def rank(self) -> int:
+        """
+        Returns the rank of this process.
+
+        Returns
+        -------
+        int
+            Rank in [0, world_size).
+        """
+        return C.mag_comm_get_rank(self._ptr)
+
+    @property
+    def world_size(self) -> int:
+        """
+        Returns the number of processes in the group.
+
+        Returns
+        -------
+        int
+            Number of ranks.
+        """
+        return C.mag_comm_get_world_size(self._ptr)
+
+    def barrier(self) -> None:
+        """
+        Waits until all ranks arrived.
+        """
+        C.mag_comm_barrier(self._ptr)
+
+    def all_reduce(self, tensor: 'Tensor', *, average: bool = False) -> None:
+        """
+        Sums the tensor over all ranks in place.
+
+        Parameters
+        ----------
+        tensor : Tensor
+            Contiguous F32 tensor, overwritten by the result.
+        average : bool, optional
+            Divide the sum by the world size, by default False.
+        """
+        C.mag_comm_all_reduce(self._ptr, tensor._ptr, average)
+
+    def all_reduce_start(self, tensor: 'Tensor', *, average: bool = False) -> None:
+        """
+        Starts all_reduce in the background and returns. Do not touch the tensor before wait returns.
+
+        Parameters
+        ----------
+        tensor : Tensor
+            Contiguous F32 tensor, overwritten by the result.
+        average : bool, optional
+            Divide the sum by the world size, by default False.
+        """
+        C.mag_comm_all_reduce_start(self._ptr, tensor._ptr, average)
+
+    def wait(self) -> None:
+        """
+        Waits for all reductions started by all_reduce_start.
+        """
+        C.mag_comm_wait(self._ptr)
+
+
+class Batcher:
+    """
+    Serves single-sample inference requests from many threads by running them in batches through a plan.
+    A scheduler thread waits until the batch is full or the oldest request waited timeout_us, copies the samples
+    into the batch slots of the input, replays the plan once and hands each caller its slot of the output.
+    """
+
+    def __init__(self, plan: Plan, input: 'Tensor', output: 'Tensor', *, batch_dim: int = 1, timeout_us: int = 1000) -> None:
+        """
+        Starts the scheduler thread. Do not replay the plan elsewhere while the batcher lives.
+
+        Parameters
+        ----------
+        plan : Plan
+            Plan computing output from input.
+        input : Tensor
+            Contiguous 2D F32 plan input, batch_dim indexes the samples.
+        output : Tensor
+            Contiguous 2D F32 plan output, batch_dim indexes the samples.
+        batch_dim : int, optional
+            Dimension of input and output which indexes the samples, by default 1 (one sample per column).
+        timeout_us : int, optional
+            Longest time in microseconds a request waits for the batch to fill, by default 1000.
+        """
+        assert input.shape[batch_dim] == output.shape[batch_dim], 'Input and output batch sizes differ'
+        self._plan = plan # The batcher does not retain the plan
+        self._in_features = input.shape[1 - batch_dim]
+        self._out_features = output.shape[1 - batch_dim]
+        self._ptr = C.mag_batcher_create(plan._ptr, input._ptr, batch_dim, output._ptr, batch_dim, timeout_us)
+
+    def __del__(self) -> None:
+        if hasattr(self, '_ptr') and self._ptr != ffi.NULL:
+            C.mag_batcher_destroy(self._ptr)
+        self._ptr = ffi.NULL
+
+    def infer(self, sample: list[float]) -> list[float]:
         """
-        Sets the PRNG algorithm and re-seeds it.
+        Runs the plan on one sample, blocking until its batch finished. Thread-safe.
 
         Parameters
         ----------
-        algorithm : PRNGAlgorithm
-            The desired PRNG algorithm.
-        """
-        C.mag_ctx_set_prng_algorithm(self._ptr, algorithm.value, 0)
-
-    @property
-    def os_name(self) -> str:
-        """
-        Returns the operating system name.
+        sample : list[float]
+            Input features.
 
         Returns
         -------
-        str
-            The OS name (e.g., "Linux").
+        list[float]
+            Output features.
         """
-        return ffi.string(C.mag_ctx_get_os_name(self._ptr)).decode('utf-8')
+        assert len(sample) == self._in_features, f'Expected {self._in_features} features, got {len(sample)}'
+        x = ffi.new('float[]', sample)
+        y = ffi.new('float[]', self._out_features)
+        C.mag_batcher_infer(self._ptr, x, y)
+        return list(y)
 
     @property
-    def cpu_name(self) -> str:
+    def stats(self) -> tuple[int, int]:
         """
-        Returns the CPU name/brand string.
+        Returns the number of requests and batches run so far.
 
         Returns
         -------
-        str
-            The CPU name.
+        tuple[int, int]
+            Requests and batches, their ratio is the average batch size.
         """
-        return ffi.string(C.mag_ctx_get_cpu_name(self._ptr)).decode('utf-8')
+        num_requests = ffi.new('uint64_t*')
+        num_batches = ffi.new('uint64_t*')
+        C.mag_batcher_get_stats(self._ptr, num_requests, num_batches)
+        return num_requests[0], num_batches[0]
 
-    @property
-    def cpu_virtual_cores(self) -> int:
-        """
-        Returns the number of virtual CPU cores (logical processors).
 
-        Returns
-        -------
-        int
-            Count of virtual CPU cores.
+class CSRMatrix:
+    """
+    Sparse matrix in compressed sparse row format. Stores only the nonzeros, so memory and the cost of
+    products grow with their count instead of rows x cols.
+    """
+
+    def __init__(self, ptr: ffi.CData) -> None:
         """
-        return C.mag_ctx_get_cpu_virtual_cores(self._ptr)
+        Internal constructor. Use from_dense or from_coo.
+        """
+        assert ptr != ffi.NULL, 'Invalid sparse matrix pointer'
+        self._ptr = ptr
 
-    @property
-    def cpu_physical_cores(self) -> int:
+    def __del__(self) -> None:
+        if hasattr(self, '_ptr') and self._ptr != ffi.NULL:
+            C.mag_csr_destroy(self._ptr)
+        self._ptr = ffi.NULL
+
+    @staticmethod
+    def from_dense(tensor: 'Tensor') -> 'CSRMatrix':
         """
-        Returns the number of physical CPU cores.
+        Compresses a dense matrix, dropping its zeros.
+
+        Parameters
+        ----------
+        tensor : Tensor
+            Contiguous 2D F32 tensor.
 
         Returns
         -------
-        int
-            Count of physical CPU cores.
+        CSRMatrix
+            The nonzeros of the tensor.
         """
-        return C.mag_ctx_get_cpu_physical_cores(self._ptr)
+        return CSRMatrix(C.mag_csr_from_dense(tensor._ptr))
 
-    @property
-    def cpu_sockets(self) -> int:
+    @staticmethod
+    def from_coo(shape: tuple[int, int], rows: list[int], cols: list[int], values: list[float], *, ctx: Context | None = None) -> 'CSRMatrix':
         """
-        Returns the number of CPU sockets present on the system.
+        Builds a matrix from coordinate lists in any order. Duplicate coordinates add up into one
+        nonzero, and the columns of each row are sorted.
+
+        Parameters
+        ----------
+        shape : tuple[int, int]
+            Rows and columns of the matrix.
+        rows : list[int]
+            Row of each nonzero.
+        cols : list[int]
+            Column of each nonzero.
+        values : list[float]
+            Value of each nonzero.
+        ctx : Context, optional
+            Context of the matrix, the active context by default.
 
         Returns
         -------
-        int
-            CPU socket count.
+        CSRMatrix
+            The assembled matrix.
         """
-        return C.mag_ctx_get_cpu_sockets(self._ptr)
+        assert len(rows) == len(cols) == len(values), 'Coordinate lists differ in length'
+        ctx = ctx or Context.active()
+        ptr = C.mag_csr_from_coo(ctx._ptr, shape[0], shape[1], len(values),
+                                 ffi.new('int64_t[]', rows), ffi.new('int64_t[]', cols), ffi.new('float[]', values))
+        return CSRMatrix(ptr)
 
-    @property
-    def physical_memory_total(self) -> int:
+    def to_dense(self) -> 'Tensor':
         """
-        Returns the total physical memory (RAM) in bytes.
+        Expands the matrix into a dense tensor.
 
         Returns
         -------
-        int
-            Total system memory in bytes.
+        Tensor
+            New 2D F32 tensor.
         """
-        return C.mag_ctx_get_physical_memory_total(self._ptr)
+        return Tensor(C.mag_csr_to_dense(self._ptr))
 
     @property
-    def physical_memory_free(self) -> int:
+    def shape(self) -> tuple[int, int]:
         """
-        Returns the amount of free physical memory (RAM) in bytes.
+        Returns the rows and columns of the matrix.
 
         Returns
         -------
-        int
-            Free memory in bytes.
+        tuple[int, int]
+            Matrix shape.
         """
-        return C.mag_ctx_get_physical_memory_free(self._ptr)
+        return C.mag_csr_get_rows(self._ptr), C.mag_csr_get_cols(self._ptr)
 
     @property
-    def physical_memory_used(self) -> int:
+    def nnz(self) -> int:
         """
-        Returns the amount of used physical memory (RAM) in bytes.
+        Returns the number of stored nonzeros.
 
         Returns
         -------
         int
-            Used memory in bytes.
+            Nonzero count.
         """
-        return abs(self.physical_memory_total - self.physical_memory_free)
+        return C.mag_csr_get_nnz(self._ptr)
 
-    @property
-    def is_numa_system(self) -> bool:
+    def __matmul__(self, other: 'Tensor') -> 'Tensor':
         """
-        Checks if the system uses Non-Uniform Memory Access (NUMA).
+        Multiplies with a dense vector (SpMV) or matrix (SpMM): A @ x.
+
+        Parameters
+        ----------
+        other : Tensor
+            Contiguous F32 tensor, 1D with one element per column or 2D with one row per column.
 
         Returns
         -------
-        bool
-            True if NUMA is supported, False otherwise.
+        Tensor
+            Dense product, 1D for a vector and 2D for a matrix.
         """
-        return C.mag_ctx_is_numa_system(self._ptr)
+        if other.rank == 1:
+            return Tensor(C.mag_spmv(self._ptr, other._ptr))
+        return Tensor(C.mag_spmm(self._ptr, other._ptr))
 
-    @property
-    def total_allocated_pool_memory(self) -> int:
+
+class Sparse24Matrix:
+    """
+    Weight matrix with 2:4 structured sparsity, at most 2 nonzeros in every group of 4 columns of a row.
+    Stores the kept values and their 2-bit positions, about half the bytes of the dense matrix.
+    """
+
+    def __init__(self, ptr: ffi.CData) -> None:
         """
-        Returns the total allocated memory (pool) by this context.
+        Internal constructor. Use from_dense.
+        """
+        assert ptr != ffi.NULL, 'Invalid 2:4 matrix pointer'
+        self._ptr = ptr
+
+    def __del__(self) -> None:
+        if hasattr(self, '_ptr') and self._ptr != ffi.NULL:
+            C.mag_sp24_destroy(self._ptr)
+        self._ptr = ffi.NULL
+
+    @staticmethod
+    def from_dense(tensor: 'Tensor', *, prune: bool = False) -> 'Sparse24Matrix':
+        """
+        Compresses a dense matrix.
+
+        Parameters
+        ----------
+        tensor : Tensor
+            Contiguous 2D F32 tensor with a multiple of 4 columns.
+        prune : bool, optional
+            Keep the 2 largest magnitudes of each group, by default False, which requires the tensor to be 2:4 sparse already.
 
         Returns
         -------
-        int
-            Total allocated memory in bytes.
+        Sparse24Matrix
+            The compressed matrix.
         """
-        return C.mag_ctx_total_allocated_pool_memory(self._ptr)
+        return Sparse24Matrix(C.mag_sp24_from_dense(tensor._ptr, prune))
 
-    @property
-    def total_tensors_created(self) -> int:
+    def to_dense(self) -> 'Tensor':
         """
-        Returns the total number of tensors created (including views).
+        Expands the matrix into a dense tensor.
 
         Returns
         -------
-        int
-            Count of all tensors created.
+        Tensor
+            New 2D F32 tensor.
         """
-        return C.mag_ctx_get_total_tensors_created(self._ptr)
+        return Tensor(C.mag_sp24_to_dense(self._ptr))
 
     @property
-    def total_tensors_allocated(self) -> int:
+    def shape(self) -> tuple[int, int]:
         """
-        Returns the total number of allocated tensors (not including views).
+        Returns the rows and columns of the matrix.
 
         Returns
         -------
-        int
-            Count of allocated tensors.
-        """
-        return C.mag_ctx_get_total_tensors_allocated(self._ptr)
-
-    def start_profiler(self) -> None:
-        """
-        Starts recording profiling information for operations.
-        Profiling must be stopped to produce a report. Slightly reduces performance.
+        tuple[int, int]
+            Matrix shape.
         """
-        C.mag_ctx_profile_start_recording(self._ptr)
+        return C.mag_sp24_get_rows(self._ptr), C.mag_sp24_get_cols(self._ptr)
 
-    def stop_profiler(self, export_csv_file: str | None = None) -> None:
+    def __matmul__(self, other: 'Tensor') -> 'Tensor':
         """
-        Stops recording profiling information and generates a report.
+        Multiplies with a dense vector or matrix: W @ x.
 
         Parameters
         ----------
-        export_csv_file : str, optional
-            Path to export a CSV profiling report. If None, only an internal report is generated.
-        """
-        csv_file = ffi.NULL if export_csv_file is None else bytes(export_csv_file, 'utf-8')
-        C.mag_ctx_profile_stop_recording(self._ptr, csv_file)
+        other : Tensor
+            Contiguous F32 tensor, 1D with one element per column or 2D with one row per column.
 
-    def __del__(self):
-        """
-        Destructor that releases context resources.
+        Returns
+        -------
+        Tensor
+            Dense product of the same rank as other.
         """
-        C.mag_ctx_destroy(self._ptr)
-        self._ptr = ffi.NULL
+        return Tensor(C.mag_sp24_matmul(self._ptr, other._ptr))
+
+
+def _refcount(obj: object) -> int:
+    return sys.getrefcount(obj)
+
+
+def _probe_operand(t: object) -> int:
+    return _refcount(t)
+
+
+class _RefProbe:
+    """Mirrors the call paths of Tensor._into and the Tensor arithmetic operators down to _operand."""
+
+    def unary(self) -> int:
+        return self._into()
+
+    def _into(self) -> int:
+        return _probe_operand(self)
+
+    def __add__(self, other: object) -> int:
+        return _probe_operand(self)
+
+
+def _temporary_refcounts() -> tuple[int, int]:
+    """
+    Refcounts of an expression temporary seen in Tensor._into and in an arithmetic operator.
+    A count is 0 if the interpreter reports the same count for a named tensor, then nothing is consumed.
+    """
+    unary, binary = _RefProbe().unary(), _RefProbe() + 0
+    named = _RefProbe()
+    return (unary if named.unary() > unary else 0), (binary if named + 0 > binary else 0)
+
+
+_TEMP_REFS_UNARY, _TEMP_REFS_BINARY = _temporary_refcounts()
+
+
+def _operand(t: 'Tensor', temp_refs: int) -> ffi.CData:
+    """Returns the pointer of t, and hands its reference to the op if t is an expression temporary (see mag_tensor_consume)."""
+    if temp_refs and _refcount(t) == temp_refs and C.mag_tensor_consume(t._ptr):
+        ptr, t._ptr = t._ptr, ffi.NULL
+        return ptr
+    return t._ptr
 
 
 class Tensor:
@@ -1055,6 +1897,43 @@ class Tensor:
         """
         return C.mag_tensor_is_contiguous(self._ptr)
 
+    @property
+    def is_frozen(self) -> bool:
+        """
+        Checks if the tensor data is immutable and shareable across contexts.
+
+        Returns
+        -------
+        bool
+            True if frozen, otherwise False.
+        """
+        return C.mag_tensor_is_frozen(self._ptr)
+
+    @property
+    def has_atomic_refcount(self) -> bool:
+        """
+        Checks if the tensor reference count is updated atomically.
+
+        Returns
+        -------
+        bool
+            True if the tensor can be handed between threads.
+        """
+        return C.mag_tensor_has_atomic_refcount(self._ptr)
+
+    def set_atomic_refcount(self) -> 'Tensor':
+        """
+        Makes the reference count of this tensor atomic, so it can be handed between threads without copying.
+        Must be called before any views of the tensor are created.
+
+        Returns
+        -------
+        Tensor
+            This tensor.
+        """
+        C.mag_tensor_set_atomic_refcount(self._ptr)
+        return self
+
     def is_close(self, other: 'Tensor', eps: float = -1.0, print_eq_percent: bool = False) -> (bool, float):
         """
         Checks if the tensor is close to another _ptr within a given epsilon.
@@ -1147,16 +2026,28 @@ class Tensor:
         assert self.channels in (1, 3, 4), 'Invalid number of color channels'
         C.mag_tensor_save_image(self._ptr, bytes(file_path, 'utf-8'))
 
-    def clone(self) -> 'Tensor':
+    def _into(self, out: 'Tensor | None', op: ffi.CData, op_out: ffi.CData, *args) -> 'Tensor':
+        """Runs op into a new tensor, or op_out into the existing output tensor out."""
+        if out is None:
+            return Tensor(op(_operand(self, _TEMP_REFS_UNARY), *args))
+        assert op_out(self._ptr, *args, out._ptr) != ffi.NULL, 'Output tensor shape, dtype or layout does not match the result'
+        return out
+
+    def clone(self, out: 'Tensor | None' = None) -> 'Tensor':
         """
         Creates a new _ptr with the same data as this one (deep copy).
 
+        Parameters
+        ----------
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
+
         Returns
         -------
         Tensor
             A cloned tensor.
         """
-        return Tensor(C.mag_clone(self._ptr))
+        return self._into(out, C.mag_clone, C.mag_clone_out)
 
     def view(self) -> 'Tensor':
         """
@@ -1169,6 +2060,36 @@ class Tensor:
         """
         return Tensor(C.mag_view(self._ptr))
 
+    def freeze(self) -> 'Tensor':
+        """
+        Makes the tensor data immutable, so it can be shared with other contexts without copying.
+        Must be called before any views of the tensor are created.
+
+        Returns
+        -------
+        Tensor
+            This tensor.
+        """
+        C.mag_tensor_freeze(self._ptr)
+        return self
+
+    def share(self, ctx: Context) -> 'Tensor':
+        """
+        Creates a copy-free view of this frozen tensor inside another context.
+        The context owning this tensor must outlive the returned view, destroying it earlier aborts.
+
+        Parameters
+        ----------
+        ctx : Context
+            The context to create the view in.
+
+        Returns
+        -------
+        Tensor
+            A view tensor owned by ctx.
+        """
+        return Tensor(C.mag_tensor_share(ctx._ptr, self._ptr))
+
     def transpose(self) -> 'Tensor':
         """
         Transposes the tensor (swaps the last two dimensions). Same as tensor.T.
@@ -1216,33 +2137,33 @@ class Tensor:
                 assert axes[i] != axes[j], f'Duplicate axis: {axes[i]}'
         return Tensor(C.mag_permute(self._ptr, *axes))
 
-    def mean(self) -> 'Tensor':
+    def mean(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes the mean of all elements in the tensor."""
-        return Tensor(C.mag_mean(self._ptr))
+        return self._into(out, C.mag_mean, C.mag_mean_out)
 
-    def min(self) -> 'Tensor':
+    def min(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes the minimum value in the tensor."""
-        return Tensor(C.mag_min(self._ptr))
+        return self._into(out, C.mag_min, C.mag_min_out)
 
-    def max(self) -> 'Tensor':
+    def max(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes the maximum value in the tensor."""
-        return Tensor(C.mag_max(self._ptr))
+        return self._into(out, C.mag_max, C.mag_max_out)
 
-    def sum(self) -> 'Tensor':
+    def sum(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes the sum of all elements in the tensor."""
-        return Tensor(C.mag_sum(self._ptr))
+        return self._into(out, C.mag_sum, C.mag_sum_out)
 
-    def abs(self) -> 'Tensor':
+    def abs(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise absolute value."""
-        return Tensor(C.mag_abs(self._ptr))
+        return self._into(out, C.mag_abs, C.mag_abs_out)
 
     def abs_(self) -> 'Tensor':
         """In-place element-wise absolute value."""
         return Tensor(C.mag_abs_(self._ptr))
 
-    def neg(self) -> 'Tensor':
+    def neg(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise negation."""
-        return Tensor(C.mag_neg(self._ptr))
+        return self._into(out, C.mag_neg, C.mag_neg_out)
 
     def neg_(self) -> 'Tensor':
         """In-place element-wise negation."""
@@ -1252,55 +2173,55 @@ class Tensor:
         """Overloads unary negation: -X."""
         return self.neg()
 
-    def log(self) -> 'Tensor':
+    def log(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise natural logarithm."""
-        return Tensor(C.mag_log(self._ptr))
+        return self._into(out, C.mag_log, C.mag_log_out)
 
     def log_(self) -> 'Tensor':
         """In-place element-wise natural logarithm."""
         return Tensor(C.mag_log_(self._ptr))
 
-    def sqr(self) -> 'Tensor':
+    def sqr(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise square of values."""
-        return Tensor(C.mag_sqr(self._ptr))
+        return self._into(out, C.mag_sqr, C.mag_sqr_out)
 
     def sqr_(self) -> 'Tensor':
         """In-place element-wise square of values."""
         return Tensor(C.mag_sqr_(self._ptr))
 
-    def sqrt(self) -> 'Tensor':
+    def sqrt(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise square root."""
-        return Tensor(C.mag_sqrt(self._ptr))
+        return self._into(out, C.mag_sqrt, C.mag_sqrt_out)
 
     def sqrt_(self) -> 'Tensor':
         """In-place element-wise square root."""
         return Tensor(C.mag_sqrt_(self._ptr))
 
-    def sin(self) -> 'Tensor':
+    def sin(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise sine."""
-        return Tensor(C.mag_sin(self._ptr))
+        return self._into(out, C.mag_sin, C.mag_sin_out)
 
     def sin_(self) -> 'Tensor':
         """In-place element-wise sine."""
         return Tensor(C.mag_sin_(self._ptr))
 
-    def cos(self) -> 'Tensor':
+    def cos(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise cosine."""
-        return Tensor(C.mag_cos(self._ptr))
+        return self._into(out, C.mag_cos, C.mag_cos_out)
 
     def cos_(self) -> 'Tensor':
         """In-place element-wise cosine."""
         return Tensor(C.mag_cos_(self._ptr))
 
-    def heaviside_step(self) -> 'Tensor':
+    def heaviside_step(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Computes element-wise Heaviside step function."""
-        return Tensor(C.mag_step(self._ptr))
+        return self._into(out, C.mag_step, C.mag_step_out)
 
     def heaviside_step_(self) -> 'Tensor':
         """In-place element-wise Heaviside step function."""
         return Tensor(C.mag_step_(self._ptr))
 
-    def softmax(self, derivative: bool = False) -> 'Tensor':
+    def softmax(self, derivative: bool = False, out: 'Tensor | None' = None) -> 'Tensor':
         """
         Applies softmax or its derivative on the tensor.
 
@@ -1308,19 +2229,23 @@ class Tensor:
         ----------
         derivative : bool, optional
             If True, computes softmax derivative instead of softmax, by default False.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
 
         Returns
         -------
         Tensor
             The transformed tensor.
         """
-        return Tensor(C.mag_softmax_dv(self._ptr) if derivative else C.mag_softmax(self._ptr))
+        if derivative:
+            return self._into(out, C.mag_softmax_dv, C.mag_softmax_dv_out)
+        return self._into(out, C.mag_softmax, C.mag_softmax_out)
 
     def softmax_(self, derivative: bool = False) -> 'Tensor':
         """In-place softmax or softmax derivative."""
         return Tensor(C.mag_softmax_dv_(self._ptr) if derivative else C.mag_softmax_(self._ptr))
 
-    def sigmoid(self, derivative: bool = False) -> 'Tensor':
+    def sigmoid(self, derivative: bool = False, out: 'Tensor | None' = None) -> 'Tensor':
         """
         Applies sigmoid or its derivative on the tensor.
 
@@ -1328,27 +2253,31 @@ class Tensor:
         ----------
         derivative : bool, optional
             If True, computes sigmoid derivative, by default False.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
 
         Returns
         -------
         Tensor
             The transformed tensor.
         """
-        return Tensor(C.mag_sigmoid_dv(self._ptr) if derivative else C.mag_sigmoid(self._ptr))
+        if derivative:
+            return self._into(out, C.mag_sigmoid_dv, C.mag_sigmoid_dv_out)
+        return self._into(out, C.mag_sigmoid, C.mag_sigmoid_out)
 
     def sigmoid_(self, derivative: bool = False) -> 'Tensor':
         """In-place sigmoid or sigmoid derivative."""
         return Tensor(C.mag_sigmoid_dv_(self._ptr) if derivative else C.mag_sigmoid_(self._ptr))
 
-    def hard_sigmoid(self) -> 'Tensor':
+    def hard_sigmoid(self, out: 'Tensor | None' = None) -> 'Tensor':
         """Applies hard sigmoid to the tensor."""
-        return Tensor(C.mag_hard_sigmoid(self._ptr))
+        return self._into(out, C.mag_hard_sigmoid, C.mag_hard_sigmoid_out)
 
     def hard_sigmoid_(self) -> 'Tensor':
         """In-place hard sigmoid."""
         return Tensor(C.mag_hard_sigmoid_(self._ptr))
 
-    def silu(self, derivative: bool = False) -> 'Tensor':
+    def silu(self, derivative: bool = False, out: 'Tensor | None' = None) -> 'Tensor':
         """
         Applies SiLU (Sigmoid-Weighted Linear Unit) or its derivative.
 
@@ -1356,19 +2285,23 @@ class Tensor:
         ----------
         derivative : bool, optional
             If True, applies SiLU derivative, by default False.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
 
         Returns
         -------
         Tensor
             The transformed tensor.
         """
-        return C.mag_silu_dv(self._ptr) if derivative else C.mag_silu(self._ptr)
+        if derivative:
+            return self._into(out, C.mag_silu_dv, C.mag_silu_dv_out)
+        return self._into(out, C.mag_silu, C.mag_silu_out)
 
     def silu_(self, derivative: bool = False) -> 'Tensor':
         """In-place SiLU or SiLU derivative."""
         return Tensor(C.mag_silu_dv_(self._ptr) if derivative else C.mag_silu_(self._ptr))
 
-    def tanh(self, derivative: bool = False) -> 'Tensor':
+    def tanh(self, derivative: bool = False, out: 'Tensor | None' = None) -> 'Tensor':
         """
         Applies hyperbolic tangent or its derivative.
 
@@ -1376,19 +2309,23 @@ class Tensor:
         ----------
         derivative : bool, optional
             If True, computes tanh derivative, by default False.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
 
         Returns
         -------
         Tensor
             The transformed tensor.
         """
-        return Tensor(C.mag_tanh_dv(self._ptr) if derivative else C.mag_tanh(self._ptr))
+        if derivative:
+            return self._into(out, C.mag_tanh_dv, C.mag_tanh_dv_out)
+        return self._into(out, C.mag_tanh, C.mag_tanh_out)
 
     def tanh_(self, derivative: bool = False) -> 'Tensor':
         """In-place tanh or tanh derivative."""
         return Tensor(C.mag_tanh_dv_(self._ptr) if derivative else C.mag_tanh_(self._ptr))
 
-    def relu(self, derivative: bool = False) -> 'Tensor':
+    def relu(self, derivative: bool = False, out: 'Tensor | None' = None) -> 'Tensor':
         """
         Applies ReLU (Rectified Linear Unit) or its derivative.
 
@@ -1396,19 +2333,23 @@ class Tensor:
         ----------
         derivative : bool, optional
             If True, computes ReLU derivative, by default False.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
 
         Returns
         -------
         Tensor
             The transformed tensor.
         """
-        return Tensor(C.mag_relu_dv(self._ptr) if derivative else C.mag_relu(self._ptr))
+        if derivative:
+            return self._into(out, C.mag_relu_dv, C.mag_relu_dv_out)
+        return self._into(out, C.mag_relu, C.mag_relu_out)
 
     def relu_(self, derivative: bool = False) -> 'Tensor':
         """In-place ReLU or ReLU derivative."""
         return Tensor(C.mag_relu_dv_(self._ptr) if derivative else C.mag_relu_(self._ptr))
 
-    def gelu(self, derivative: bool = False) -> 'Tensor':
+    def gelu(self, derivative: bool = False, out: 'Tensor | None' = None) -> 'Tensor':
         """
         Applies GELU (Gaussian Error Linear Unit) or its derivative.
 
@@ -1416,22 +2357,124 @@ class Tensor:
         ----------
         derivative : bool, optional
             If True, computes GELU derivative, by default False.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
 
         Returns
         -------
         Tensor
             The transformed tensor.
         """
-        return Tensor(C.mag_gelu_dv(self._ptr) if derivative else C.mag_gelu(self._ptr))
+        if derivative:
+            return self._into(out, C.mag_gelu_dv, C.mag_gelu_dv_out)
+        return self._into(out, C.mag_gelu, C.mag_gelu_out)
 
     def gelu_(self, derivative: bool = False) -> 'Tensor':
         """In-place GELU or GELU derivative."""
         return Tensor(C.mag_gelu_dv_(self._ptr) if derivative else C.mag_gelu_(self._ptr))
 
+    def add(self, other: object | int | float, out: 'Tensor | None' = None) -> 'Tensor':
+        """
+        Element-wise addition with another tensor or scalar.
+
+        Parameters
+        ----------
+        other : Tensor or scalar
+            Right hand side operand.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
+
+        Returns
+        -------
+        Tensor
+            The result, which is out if given.
+        """
+        if isinstance(other, Tensor):
+            return self._into(out, C.mag_add, C.mag_add_out, other._ptr)
+        return self._into(out, C.mag_adds, C.mag_adds_out, float(other))
+
+    def sub(self, other: object | int | float, out: 'Tensor | None' = None) -> 'Tensor':
+        """
+        Element-wise subtraction with another tensor or scalar.
+
+        Parameters
+        ----------
+        other : Tensor or scalar
+            Right hand side operand.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
+
+        Returns
+        -------
+        Tensor
+            The result, which is out if given.
+        """
+        if isinstance(other, Tensor):
+            return self._into(out, C.mag_sub, C.mag_sub_out, other._ptr)
+        return self._into(out, C.mag_subs, C.mag_subs_out, float(other))
+
+    def mul(self, other: object | int | float, out: 'Tensor | None' = None) -> 'Tensor':
+        """
+        Element-wise multiplication with another tensor or scalar.
+
+        Parameters
+        ----------
+        other : Tensor or scalar
+            Right hand side operand.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
+
+        Returns
+        -------
+        Tensor
+            The result, which is out if given.
+        """
+        if isinstance(other, Tensor):
+            return self._into(out, C.mag_mul, C.mag_mul_out, other._ptr)
+        return self._into(out, C.mag_muls, C.mag_muls_out, float(other))
+
+    def div(self, other: object | int | float, out: 'Tensor | None' = None) -> 'Tensor':
+        """
+        Element-wise division with another tensor or scalar.
+
+        Parameters
+        ----------
+        other : Tensor or scalar
+            Right hand side operand.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
+
+        Returns
+        -------
+        Tensor
+            The result, which is out if given.
+        """
+        if isinstance(other, Tensor):
+            return self._into(out, C.mag_div, C.mag_div_out, other._ptr)
+        return self._into(out, C.mag_divs, C.mag_divs_out, float(other))
+
+    def matmul(self, other: 'Tensor', out: 'Tensor | None' = None) -> 'Tensor':
+        """
+        Matrix multiplication with another tensor.
+
+        Parameters
+        ----------
+        other : Tensor
+            Right hand side matrix.
+        out : Tensor, optional
+            Existing tensor to write the result into, by default a new tensor is allocated.
+
+        Returns
+        -------
+        Tensor
+            The result, which is out if given. out must not alias self or other.
+        """
+        return self._into(out, C.mag_matmul, C.mag_matmul_out, other._ptr)
+
     def __add__(self, other: object | int | float) -> 'Tensor':
         """Element-wise addition with another _ptr or scalar."""
-        return Tensor(C.mag_add(self._ptr, other._ptr) if isinstance(other, Tensor) else C.mag_adds(self._ptr,
-                                                                                                    float(other)))
+        x = _operand(self, _TEMP_REFS_BINARY)
+        return Tensor(C.mag_add(x, other._ptr) if isinstance(other, Tensor) else C.mag_adds(x, float(other)))
 
     def __iadd__(self, other: object | int | float) -> 'Tensor':
         """In-place element-wise addition."""
@@ -1440,8 +2483,8 @@ class Tensor:
 
     def __sub__(self, other: object | int | float) -> 'Tensor':
         """Element-wise subtraction with another _ptr or scalar."""
-        return Tensor(C.mag_sub(self._ptr, other._ptr) if isinstance(other, Tensor) else C.mag_subs(self._ptr,
-                                                                                                    float(other)))
+        x = _operand(self, _TEMP_REFS_BINARY)
+        return Tensor(C.mag_sub(x, other._ptr) if isinstance(other, Tensor) else C.mag_subs(x, float(other)))
 
     def __isub__(self, other: object | int | float) -> 'Tensor':
         """In-place element-wise subtraction."""
@@ -1450,8 +2493,8 @@ class Tensor:
 
     def __mul__(self, other: object | int | float) -> 'Tensor':
         """Element-wise multiplication with another _ptr or scalar."""
-        return Tensor(C.mag_mul(self._ptr, other._ptr) if isinstance(other, Tensor) else C.mag_muls(self._ptr,
-                                                                                                    float(other)))
+        x = _operand(self, _TEMP_REFS_BINARY)
+        return Tensor(C.mag_mul(x, other._ptr) if isinstance(other, Tensor) else C.mag_muls(x, float(other)))
 
     def __imul__(self, other: object | int | float) -> 'Tensor':
         """In-place element-wise multiplication."""
@@ -1460,8 +2503,8 @@ class Tensor:
 
     def __truediv__(self, other: object | int | float) -> 'Tensor':
         """Element-wise division with another _ptr or scalar."""
-        return Tensor(C.mag_div(self._ptr, other._ptr) if isinstance(other, Tensor) else C.mag_divs(self._ptr,
-                                                                                                    float(other)))
+        x = _operand(self, _TEMP_REFS_BINARY)
+        return Tensor(C.mag_div(x, other._ptr) if isinstance(other, Tensor) else C.mag_divs(x, float(other)))
 
     def __itruediv__(self, other: object | int | float) -> 'Tensor':
         """In-place element-wise division."""
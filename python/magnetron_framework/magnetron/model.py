@@ -4,7 +4,7 @@
 import time
 from abc import ABC
 
-from magnetron import Tensor
+from magnetron import Communicator, Context, Tensor
 
 
 class Layer(ABC):
@@ -33,7 +33,12 @@ class Optim:
     @staticmethod
     def mse(y: Tensor, y_hat: Tensor) -> float:
         """Mean Squared Error"""
-        return (y - y_hat).sqr_().mean()[0]
+        return Optim.mse_tensor(y, y_hat)[0]
+
+    @staticmethod
+    def mse_tensor(y: Tensor, y_hat: Tensor) -> Tensor:
+        """Mean Squared Error as scalar tensor"""
+        return (y - y_hat).sqr_().mean()
 
     @staticmethod
     def cross_entropy(y: Tensor, y_hat: Tensor) -> float:
@@ -83,14 +88,16 @@ class SequentialModel(Model):
             x = layer.forward(x)
         return x
 
-    def backward(self, outputs: Tensor, targets: Tensor, rate: float):
+    def backward(self, outputs: Tensor, targets: Tensor, rate: float, on_layer=None):
         error = outputs - targets
         delta = error * outputs.sigmoid(derivative=True)
         for i in reversed(range(len(self.layers))):
             is_hidden = (i > 0)
             delta = self.layers[i].backward(is_hidden, delta, rate)
+            if on_layer is not None:
+                on_layer(self.layers[i])
 
-    def train(self, inputs: Tensor, targets: Tensor, epochs: int, rate: float):
+    def train(self, inputs: Tensor, targets: Tensor, epochs: int, rate: float, comm: Communicator | None = None):
         print(f'Training started for {epochs} epochs with learning rate {rate}')
         import time
         start_time = time.time_ns()
@@ -98,15 +105,54 @@ class SequentialModel(Model):
         inputs = inputs.transpose().clone()
         targets = targets.transpose().clone()
 
+        # The first epoch runs eagerly and records the training step, later epochs replay it into the same buffers.
+        # With a communicator every rank trains on its own shard. The step is recorded as one plan per layer, so the
+        # parameters of a layer are averaged over the ranks while the backward pass of the layers before it runs.
+        # The ranks start from the averaged initial parameters. From equal parameters, averaging the SGD-updated
+        # parameters equals updating with the averaged gradients, so they stay equal after every step.
+        if comm is not None:
+            for layer in self.layers:
+                self._all_reduce_start(comm, layer)
+            comm.wait()
+        ctx = Context.active()
+        plans = None
+        loss_tensor = None
         losses = []
         for epoch in range(epochs):
-            output = self.forward(inputs)
-            self.backward(output, targets, rate)
-            loss = Optim.mse(output, targets)
+            if plans is None:
+                plans = []
+
+                def on_layer(layer: DenseLayer):
+                    plans.append((ctx.end_capture(), layer))
+                    self._all_reduce_start(comm, layer)
+                    ctx.begin_capture()
+
+                ctx.begin_capture()
+                output = self.forward(inputs)
+                self.backward(output, targets, rate, on_layer if comm is not None else None)
+                loss_tensor = Optim.mse_tensor(output, targets)
+                plans.append((ctx.end_capture(), None))
+                if comm is not None:
+                    comm.wait()
+                for plan, _ in plans:
+                    plan.optimize()
+            else:
+                for plan, layer in plans:
+                    plan.replay()
+                    if layer is not None:
+                        self._all_reduce_start(comm, layer)
+                if comm is not None:
+                    comm.wait()
+            loss = loss_tensor[0]
             losses.append(loss)
             if epoch % self.loss_epoch_step == 0:
                 print(f'Epoch: {epoch}, Loss: {loss:.6f}')
 
         duration = (time.time_ns() - start_time) / 1e9
         print(f'Training finished in {duration:.2f} seconds')
-        return losses
\ No newline at end of file
+        return losses
+
+    @staticmethod
+    def _all_reduce_start(comm: Communicator, layer: DenseLayer):
+        comm.all_reduce_start(layer.weight, average=True)
+        comm.all_reduce_start(layer.bias, average=True)
\ No newline at end of file
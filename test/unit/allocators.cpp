@@ -1,6 +1,8 @@
 // (c) 2025 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
 
 #include "prelude.hpp"
+#include <thread>
+#include <vector>
 
 TEST(allocators, fixed_intrusive_pool_alloc_free) {
     mag_fixed_intrusive_pool pool {};
@@ -40,6 +42,29 @@ TEST(allocators, fixed_intrusive_pool_exhaust_pool) {
     mag_fixed_intrusive_pool_destroy(&pool);
 }
 
+TEST(allocators, fixed_intrusive_pool_concurrent_drains_all_magazines) {
+    mag_fixed_intrusive_pool pool {};
+    mag_fixed_intrusive_pool_init(&pool, sizeof(int), alignof(int), 64);
+    mag_fixed_intrusive_pool_set_concurrent(&pool, true);
+    std::vector<std::thread> threads {};
+    for (int t=0; t < 4; ++t) { // Each thread leaves its blocks in its magazine and exits.
+        threads.emplace_back([&pool] {
+            void* blocks[16];
+            for (auto& b : blocks) b = mag_fixed_intrusive_pool_malloc(&pool);
+            for (auto* b : blocks) mag_fixed_intrusive_pool_free(&pool, b);
+        });
+    }
+    for (auto& t : threads) t.join();
+    ASSERT_EQ(pool.num_chunks, 1);
+    mag_fixed_intrusive_pool_set_concurrent(&pool, false);
+    std::uint64_t hits = pool.num_freelist_hits;
+    for (int i=0; i < 64; ++i) // All 64 blocks of the first chunk must be back in the free list.
+        [[maybe_unused]] void* volatile x = mag_fixed_intrusive_pool_malloc(&pool);
+    ASSERT_EQ(pool.num_chunks, 1);
+    ASSERT_EQ(pool.num_freelist_hits, hits + 64);
+    mag_fixed_intrusive_pool_destroy(&pool);
+}
+
 #ifndef _MSC_VER // MSVC fucks around with linking a __declspex(dllexport) ed function ptr. TODO: fix
 
 TEST(allocators, alloc_small) {
@@ -70,3 +95,53 @@ TEST(allocators, alloc_aligned) {
         mag_free_aligned(i);
     }
 }
+
+TEST(allocators, custom_storage_allocator) {
+    struct counting_arena final {
+        std::size_t allocs = 0;
+        std::size_t frees = 0;
+        std::size_t live = 0;
+    } arena {};
+    mag_storage_allocator_t allocator {
+        .alloc = [](void* ud, std::size_t size, std::size_t align) -> void* {
+            auto* a = static_cast<counting_arena*>(ud);
+            ++a->allocs;
+            a->live += size;
+            return mag_alloc_aligned(size, align);
+        },
+        .free = [](void* ud, void* blk, std::size_t size) -> void {
+            auto* a = static_cast<counting_arena*>(ud);
+            ++a->frees;
+            a->live -= size;
+            mag_free_aligned(blk);
+        },
+        .stats = [](void* ud, mag_storage_stats_t* out) -> void {
+            out->bytes_reserved = static_cast<counting_arena*>(ud)->live;
+        },
+        .ud = &arena
+    };
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_ctx_set_storage_allocator(ctx, &allocator);
+    mag_tensor_t* small = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 4); /* Would come from the slab with the default allocator. */
+    mag_tensor_t* big = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 128, 128);
+    mag_tensor_t* view = mag_view(big);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(mag_tensor_data_ptr(big)) % 64, 0);
+    ASSERT_EQ(arena.allocs, 2);
+    mag_storage_stats_t stats {};
+    mag_ctx_get_storage_stats(ctx, &stats);
+    ASSERT_EQ(stats.num_allocs, 2);
+    ASSERT_EQ(stats.bytes_live, 16 + 128*128*4);
+    ASSERT_EQ(stats.bytes_reserved, arena.live);
+    mag_tensor_decref(view);
+    mag_tensor_decref(big);
+    mag_tensor_decref(small);
+    ASSERT_EQ(arena.frees, 2);
+    ASSERT_EQ(arena.live, 0);
+    mag_ctx_get_storage_stats(ctx, &stats);
+    ASSERT_EQ(stats.bytes_live, 0);
+    ASSERT_EQ(stats.bytes_peak, 16 + 128*128*4);
+    mag_ctx_set_storage_allocator(ctx, nullptr); /* Back to slab, buffer cache and global allocator. */
+    mag_tensor_decref(mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 4));
+    ASSERT_EQ(arena.allocs, 2);
+    mag_ctx_destroy(ctx);
+}
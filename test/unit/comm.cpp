@@ -0,0 +1,92 @@
+// (c) 2025 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "prelude.hpp"
+
+#ifndef _WIN32
+
+#include <csignal>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static constexpr std::uint32_t world_size = 4;
+static constexpr std::int64_t numel = 10007; // Several chunks of a small slot, uneven shares
+
+// Returns the number of mismatches, run by every rank.
+static int run_rank(const std::string& name, std::uint64_t session, std::uint32_t rank) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_comm_t* comm = mag_comm_create(ctx, name.c_str(), session, rank, world_size, 1024);
+    int failures = 0;
+    auto* a = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, numel);
+    auto* b = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, numel);
+    auto* buf = static_cast<float*>(mag_tensor_data_ptr(a));
+    for (std::int64_t i=0; i < numel; ++i)
+        buf[i] = static_cast<float>(rank + 1)*static_cast<float>(i % 7);
+    mag_tensor_fill(b, static_cast<float>(rank));
+
+    mag_comm_all_reduce(comm, a, false);
+    for (std::int64_t i=0; i < numel; ++i)
+        failures += buf[i] != 10.0f*static_cast<float>(i % 7); // 1+2+3+4
+
+    mag_comm_all_reduce_start(comm, a, true);
+    mag_comm_all_reduce_start(comm, b, true);
+    mag_comm_wait(comm);
+    auto* bbuf = static_cast<const float*>(mag_tensor_data_ptr(b));
+    for (std::int64_t i=0; i < numel; ++i) {
+        failures += buf[i] != 10.0f*static_cast<float>(i % 7);
+        failures += bbuf[i] != 1.5f; // (0+1+2+3)/4
+    }
+
+    mag_comm_barrier(comm);
+    mag_comm_destroy(comm);
+    mag_tensor_decref(b);
+    mag_tensor_decref(a);
+    mag_ctx_destroy(ctx);
+    return failures;
+}
+
+static void run_group(const std::string& name, std::uint64_t session) {
+    pid_t children[world_size-1];
+    for (std::uint32_t r=1; r < world_size; ++r) {
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0) _exit(run_rank(name, session, r) ? 1 : 0);
+        children[r-1] = pid;
+    }
+    ASSERT_EQ(run_rank(name, session, 0), 0);
+    for (pid_t pid : children) {
+        int status = 0;
+        ASSERT_EQ(waitpid(pid, &status, 0), pid);
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(WEXITSTATUS(status), 0);
+    }
+}
+
+TEST(comm, all_reduce_processes) {
+    run_group("test_" + std::to_string(getpid()), static_cast<std::uint64_t>(getpid()));
+}
+
+TEST(comm, replaces_stale_segment) {
+    std::string name = "test_stale_" + std::to_string(getpid());
+    pid_t crashed = fork(); // rank 0 of an earlier launch, killed while waiting for its group
+    ASSERT_GE(crashed, 0);
+    if (crashed == 0) {
+        mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+        mag_comm_create(ctx, name.c_str(), 1, 0, world_size, 1024);
+        _exit(1);
+    }
+    std::string path = "/mag_" + name;
+    int fd;
+    while ((fd = shm_open(path.c_str(), O_RDONLY, 0)) < 0)
+        usleep(1000);
+    close(fd);
+    usleep(100*1000);
+    ASSERT_EQ(kill(crashed, SIGKILL), 0);
+    ASSERT_EQ(waitpid(crashed, nullptr, 0), crashed);
+
+    run_group(name, 2); // joiners may map the stale segment first and must move on to the new one
+}
+
+#endif
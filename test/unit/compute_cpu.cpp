@@ -562,3 +562,93 @@ TEST(compute_cpu, threaded_add) {
     mag_tensor_decref(R);
     mag_ctx_destroy(ctx);
 }
+
+// Odd lengths hit the masked or overlapping tails of every SIMD width, including vectors shorter than one register.
+TEST(compute_cpu, simd_tails) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    for (std::int64_t numel : {1, 7, 15, 17, 33}) {
+        mag_tensor_t* x = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, numel);
+        mag_tensor_t* y = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, numel);
+        mag_tensor_fill_random_uniform(x, -1.0f, 1.0f);
+        mag_tensor_fill_random_uniform(y, 0.5f, 2.0f);
+        const auto* b_x = static_cast<const float*>(mag_tensor_data_ptr(x));
+        const auto* b_y = static_cast<const float*>(mag_tensor_data_ptr(y));
+
+        const auto check = [&](mag_tensor_t* r, auto&& scalar_op) {
+            ASSERT_EQ(mag_tensor_numel(r), numel);
+            const auto* b_r = static_cast<const float*>(mag_tensor_data_ptr(r));
+            for (std::int64_t i=0; i < numel; ++i)
+                ASSERT_FLOAT_EQ(b_r[i], scalar_op(b_x[i], b_y[i])) << "numel=" << numel << " i=" << i;
+            mag_tensor_decref(r);
+        };
+        check(mag_add(x, y), [](float a, float b) { return a + b; });
+        check(mag_sub(x, y), [](float a, float b) { return a - b; });
+        check(mag_mul(x, y), [](float a, float b) { return a * b; });
+        check(mag_div(x, y), [](float a, float b) { return a / b; });
+        check(mag_adds(x, 0.25f), [](float a, float) { return a + 0.25f; });
+        check(mag_subs(x, 0.25f), [](float a, float) { return a - 0.25f; });
+        check(mag_muls(x, 3.0f), [](float a, float) { return a * 3.0f; });
+        check(mag_divs(x, 3.0f), [](float a, float) { return a / 3.0f; });
+        check(mag_abs(x), [](float a, float) { return std::abs(a); });
+        check(mag_neg(x), [](float a, float) { return -a; });
+        check(mag_sqr(x), [](float a, float) { return a*a; });
+        check(mag_sqrt(y), [](float, float b) { return std::sqrt(b); });
+        check(mag_relu(x), [](float a, float) { return std::max(a, 0.0f); });
+
+        std::vector<float> x_origin {};
+        mag_tensor_buf_f32_to_vec(x, x_origin);
+        mag_tensor_t* r = mag_add_(x, y); // in-place, output aliases the first input
+        const auto* b_r = static_cast<const float*>(mag_tensor_data_ptr(r));
+        for (std::int64_t i=0; i < numel; ++i)
+            ASSERT_FLOAT_EQ(b_r[i], x_origin[i] + b_y[i]) << "numel=" << numel << " i=" << i;
+        mag_tensor_decref(r);
+
+        mag_tensor_decref(y);
+        mag_tensor_decref(x);
+    }
+    mag_ctx_destroy(ctx);
+}
+
+// A one byte threshold sends every contiguous element-wise op through the non-temporal store path.
+TEST(compute_cpu, stream_stores_match_regular_kernels) {
+    mag_device_descriptor_t desc {};
+    desc.type = MAG_COMPUTE_DEVICE_TYPE_CPU;
+    desc.thread_count = 4;
+    mag_ctx_t* ref_ctx = mag_ctx_create2(&desc);
+    desc.stream_threshold = 1;
+    mag_ctx_t* nt_ctx = mag_ctx_create2(&desc);
+    constexpr std::int64_t numel = 3*1024 + 37; // several staging blocks and an unaligned tail
+    std::vector<float> vx(numel), vy(numel);
+    for (std::int64_t i=0; i < numel; ++i) {
+        vx[i] = static_cast<float>(i % 97) - 48.5f;
+        vy[i] = static_cast<float>(i % 13) + 0.5f;
+    }
+    const auto make = [&](mag_ctx_t* ctx, const std::vector<float>& v) {
+        mag_tensor_t* t = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, numel);
+        std::memcpy(mag_tensor_data_ptr(t), v.data(), numel*sizeof(float));
+        return t;
+    };
+    mag_tensor_t* rx = make(ref_ctx, vx);
+    mag_tensor_t* ry = make(ref_ctx, vy);
+    mag_tensor_t* nx = make(nt_ctx, vx);
+    mag_tensor_t* ny = make(nt_ctx, vy);
+    const auto check = [&](mag_tensor_t* a, mag_tensor_t* b) {
+        const auto* pa = static_cast<const float*>(mag_tensor_data_ptr(a));
+        const auto* pb = static_cast<const float*>(mag_tensor_data_ptr(b));
+        for (std::int64_t i=0; i < numel; ++i)
+            ASSERT_EQ(pa[i], pb[i]) << "i=" << i;
+        mag_tensor_decref(a);
+        mag_tensor_decref(b);
+    };
+    check(mag_add(rx, ry), mag_add(nx, ny));
+    check(mag_div(rx, ry), mag_div(nx, ny));
+    check(mag_muls(rx, 0.5f), mag_muls(nx, 0.5f));
+    check(mag_relu(rx), mag_relu(nx));
+    check(mag_sigmoid(rx), mag_sigmoid(nx));
+    mag_tensor_decref(ny);
+    mag_tensor_decref(nx);
+    mag_tensor_decref(ry);
+    mag_tensor_decref(rx);
+    mag_ctx_destroy(nt_ctx);
+    mag_ctx_destroy(ref_ctx);
+}
@@ -1,6 +1,10 @@
 // (c) 2025 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
 
 #include "prelude.hpp"
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
 
 TEST(ctx, create_destroy_cpu) {
     mag_set_log_mode(true);
@@ -10,6 +14,52 @@ TEST(ctx, create_destroy_cpu) {
     mag_set_log_mode(false);
 }
 
+TEST(ctx, math_mode_switch) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_t* x = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 1031);
+    mag_tensor_fill_random_uniform(x, -5.0f, 5.0f);
+    const auto* b_x = static_cast<const float*>(mag_tensor_data_ptr(x));
+
+    mag_ctx_set_math_mode(ctx, MAG_MATH_MODE_PRECISE);
+    ASSERT_EQ(mag_ctx_get_math_mode(ctx), MAG_MATH_MODE_PRECISE);
+    mag_tensor_t* r = mag_tanh(x);
+    const auto* b_r = static_cast<const float*>(mag_tensor_data_ptr(r));
+    for (std::int64_t i=0; i < mag_tensor_numel(x); ++i) {
+        ASSERT_FLOAT_EQ(b_r[i], std::tanh(b_x[i]));
+    }
+    mag_tensor_decref(r);
+
+    mag_ctx_set_math_mode(ctx, MAG_MATH_MODE_APPROX);
+    ASSERT_EQ(mag_ctx_get_math_mode(ctx), MAG_MATH_MODE_APPROX);
+    r = mag_tanh(x);
+    b_r = static_cast<const float*>(mag_tensor_data_ptr(r));
+    for (std::int64_t i=0; i < mag_tensor_numel(x); ++i) {
+        ASSERT_NEAR(b_r[i], std::tanh(b_x[i]), 1e-6f);
+    }
+    mag_tensor_decref(r);
+
+    mag_tensor_decref(x);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(ctx, cpu_cache_topology) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    for (std::uint32_t level=1; level <= 4; ++level) {
+        std::uint64_t size = mag_ctx_get_cpu_cache_size(ctx, level);
+        if (!size) continue;
+        std::uint32_t line = mag_ctx_get_cpu_cache_line_size(ctx, level);
+        if (line) {
+            ASSERT_EQ(line & (line-1), 0);
+        }
+        if (level > 1 && mag_ctx_get_cpu_cache_size(ctx, level-1)) {
+            ASSERT_GE(size, mag_ctx_get_cpu_cache_size(ctx, level-1));
+        }
+    }
+    ASSERT_EQ(mag_ctx_get_cpu_cache_size(ctx, 0), 0);
+    ASSERT_EQ(mag_ctx_get_cpu_cache_size(ctx, 5), 0);
+    mag_ctx_destroy(ctx);
+}
+
 #ifdef MAG_ENABLE_CUDA
 TEST(ctx, create_destroy_cuda) {
     mag_set_log_mode(true);
@@ -19,3 +69,71 @@ TEST(ctx, create_destroy_cuda) {
     mag_set_log_mode(false);
 }
 #endif
+
+TEST(ctx, concurrent_eager_ops) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    ASSERT_FALSE(mag_ctx_is_concurrent(ctx));
+    mag_ctx_set_concurrent(ctx, true);
+    ASSERT_TRUE(mag_ctx_is_concurrent(ctx));
+    mag_tensor_t* w = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 16, 16); /* Shared read-only weight. */
+    mag_tensor_fill(w, 2.0f);
+    std::atomic_int failures {};
+    std::vector<std::thread> threads {};
+    for (int t=0; t < 4; ++t) {
+        threads.emplace_back([=, &failures] {
+            for (int i=0; i < 500; ++i) {
+                mag_tensor_t* x = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 16, 16);
+                mag_tensor_fill(x, static_cast<float>(t));
+                mag_tensor_t* r = mag_add(x, w);
+                mag_tensor_t* s = mag_sum(r);
+                if (*static_cast<const float*>(mag_tensor_data_ptr(s)) != 256.0f*static_cast<float>(t+2))
+                    ++failures;
+                mag_tensor_decref(s);
+                mag_tensor_decref(r);
+                mag_tensor_decref(x);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    ASSERT_EQ(failures.load(), 0);
+    mag_tensor_decref(w);
+    mag_ctx_set_concurrent(ctx, false);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(ctx, cpu_stream_in_order) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM);
+    ASSERT_EQ(mag_ctx_get_compute_device_type(ctx), MAG_COMPUTE_DEVICE_TYPE_CPU_STREAM);
+    ASSERT_TRUE(mag_ctx_is_async(ctx));
+    mag_tensor_t* x = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 64, 64);
+    mag_tensor_fill(x, 0.0f); // Queued memset
+    for (int i=0; i < 1000; ++i) { // Wraps the command queue, intermediates die while their ops are queued
+        mag_tensor_t* r = mag_adds(x, 1.0f);
+        mag_tensor_t* s = mag_muls(r, 0.5f);
+        mag_tensor_decref(r);
+        mag_tensor_decref(x);
+        x = s;
+    }
+    mag_event_t ev = mag_ctx_record_event(ctx);
+    mag_ctx_wait_event(ctx, ev);
+    ASSERT_TRUE(mag_ctx_query_event(ctx, ev));
+    mag_tensor_set_scalar_virtual_index(x, 0, 42.0f); // Queued copy
+    ASSERT_FLOAT_EQ(mag_tensor_get_scalar_virtual_index(x, 0), 42.0f);
+    const auto* buf = static_cast<const float*>(mag_tensor_data_ptr(x));
+    for (std::int64_t i=1; i < mag_tensor_numel(x); ++i)
+        ASSERT_FLOAT_EQ(buf[i], 1.0f); // x = (x+1)/2 converges to 1
+
+    mag_ctx_begin_capture(ctx);
+    mag_tensor_t* y = mag_tanh(x);
+    mag_plan_t* plan = mag_ctx_end_capture(ctx);
+    mag_tensor_fill(x, 0.5f);
+    mag_plan_replay(plan);
+    mag_ctx_synchronize(ctx);
+    buf = static_cast<const float*>(mag_tensor_data_ptr(y));
+    for (std::int64_t i=0; i < mag_tensor_numel(y); ++i)
+        ASSERT_FLOAT_EQ(buf[i], std::tanh(0.5f));
+    mag_plan_destroy(plan);
+    mag_tensor_decref(y);
+    mag_tensor_decref(x);
+    mag_ctx_destroy(ctx);
+}
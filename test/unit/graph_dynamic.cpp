@@ -1,6 +1,10 @@
 // (c) 2025 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
 
 #include "prelude.hpp"
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
 
 TEST(graph_dynamic, simple) {
     mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
@@ -39,4 +43,296 @@ TEST(graph_dynamic, simple) {
     mag_tensor_decref(X);
 
     mag_ctx_destroy(ctx);
-}
\ No newline at end of file
+}
+
+TEST(graph_dynamic, capture_replay) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+
+    // relu((W * X) + B), captured once and replayed with new inputs
+
+    auto* W = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(W, 0.5f);
+    auto* X = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(X, 2.0f);
+    auto* B = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(B, -0.5f);
+
+    mag_ctx_begin_capture(ctx);
+    ASSERT_TRUE(mag_ctx_is_capturing(ctx));
+    auto* WX = mag_mul(W, X);
+    auto* WXB = mag_add(WX, B);
+    auto* Y = mag_relu(WXB);
+    mag_plan_t* plan = mag_ctx_end_capture(ctx);
+    ASSERT_FALSE(mag_ctx_is_capturing(ctx));
+    ASSERT_EQ(mag_plan_get_num_nodes(plan), 3);
+    auto* buf = static_cast<const float*>(mag_tensor_data_ptr(Y));
+    for (std::int64_t i=0; i < mag_tensor_numel(Y); ++i) // captured ops run eagerly
+        ASSERT_FLOAT_EQ(buf[i], 0.5f);
+
+    mag_storage_stats_t before {};
+    mag_ctx_get_storage_stats(ctx, &before);
+    mag_tensor_fill(X, 4.0f); // inputs are fixed buffers, refresh them in place
+    mag_plan_replay(plan);
+    for (std::int64_t i=0; i < mag_tensor_numel(Y); ++i)
+        ASSERT_FLOAT_EQ(buf[i], 1.5f);
+
+    auto* X2 = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(X2, -2.0f);
+    mag_plan_bind(plan, X, X2); // or rebind them
+    mag_plan_replay(plan);
+    for (std::int64_t i=0; i < mag_tensor_numel(Y); ++i)
+        ASSERT_FLOAT_EQ(buf[i], 0.0f);
+    mag_storage_stats_t after {};
+    mag_ctx_get_storage_stats(ctx, &after);
+    ASSERT_EQ(after.num_allocs, before.num_allocs + 1); // only X2
+
+    mag_tensor_decref(Y);
+    mag_tensor_decref(WXB);
+    mag_tensor_decref(WX);
+    mag_plan_destroy(plan);
+    mag_tensor_decref(X2);
+    mag_tensor_decref(B);
+    mag_tensor_decref(X);
+    mag_tensor_decref(W);
+
+    mag_ctx_destroy(ctx);
+}
+
+TEST(graph_dynamic, aliased_out) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    auto* x = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(x, 1.0f);
+    auto* y = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(y, 2.0f);
+
+    // x += y inside an eager capture: the plan node keeps its own copy of the inputs
+    mag_ctx_begin_capture(ctx);
+    ASSERT_EQ(mag_add_out(x, y, x), x);
+    mag_plan_t* plan = mag_ctx_end_capture(ctx);
+    const auto* buf = static_cast<const float*>(mag_tensor_data_ptr(x));
+    ASSERT_FLOAT_EQ(buf[0], 3.0f);
+    mag_plan_replay(plan);
+    ASSERT_FLOAT_EQ(buf[0], 5.0f);
+    mag_graph_save(&x, 1, "aliased_out.magnetron"); // x holds data now, no self-loop to walk
+    std::remove("aliased_out.magnetron");
+
+    // deferred ops only run later, an aliased output would be a cycle and a re-targeted one would lose its producer
+    mag_ctx_set_exec_mode(ctx, MAG_EXEC_MODE_DEFERRED);
+    ASSERT_EQ(mag_add_out(x, y, x), nullptr);
+    ASSERT_EQ(mag_mul_out(y, x, y), nullptr);
+    auto* out = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    ASSERT_EQ(mag_mul_out(x, y, out), out);
+    ASSERT_EQ(mag_add_out(x, y, out), nullptr);
+    mag_ctx_set_exec_mode(ctx, MAG_EXEC_MODE_EAGER);
+
+    mag_tensor_decref(out);
+    mag_plan_destroy(plan);
+    mag_tensor_decref(y);
+    mag_tensor_decref(x);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(graph_dynamic, optimize_plan) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+
+    // Y = (sigmoid(X)*sigmoid(X) + 0) + ((C*2)ᵀ)ᵀ*1, C is frozen
+
+    auto* X = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(X, 0.0f);
+    auto* C = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 2);
+    mag_tensor_fill(C, 3.0f);
+    mag_tensor_freeze(C);
+
+    mag_ctx_begin_capture(ctx);
+    auto* S1 = mag_sigmoid(X);
+    auto* S2 = mag_sigmoid(X);
+    auto* SS = mag_mul(S1, S2);
+    auto* C2 = mag_muls(C, 2.0f);
+    auto* T1 = mag_transpose(C2);
+    auto* T2 = mag_transpose(T1);
+    auto* T2c = mag_clone(T2);
+    auto* One = mag_muls(T2c, 1.0f);
+    auto* A = mag_adds(SS, 0.0f);
+    auto* Y = mag_add(A, One);
+    mag_plan_t* plan = mag_ctx_end_capture(ctx);
+    ASSERT_EQ(mag_plan_get_num_nodes(plan), 10);
+    for (auto* t : {S1, S2, SS, C2, T1, T2, T2c, One, A})
+        mag_tensor_decref(t);
+
+    ASSERT_EQ(mag_plan_optimize(plan), 7); // sigmoid, mul and add are left
+    ASSERT_EQ(mag_plan_get_num_nodes(plan), 3);
+    auto* buf = static_cast<const float*>(mag_tensor_data_ptr(Y));
+    mag_tensor_fill(X, 100.0f);
+    mag_plan_replay(plan);
+    for (std::int64_t i=0; i < mag_tensor_numel(Y); ++i)
+        ASSERT_FLOAT_EQ(buf[i], 7.0f);
+
+    mag_tensor_decref(Y);
+    mag_plan_destroy(plan);
+    mag_tensor_decref(C);
+    mag_tensor_decref(X);
+
+    mag_ctx_destroy(ctx);
+}
+
+TEST(graph_dynamic, optimize_reuses_dead_buffers) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+
+    // Y = tanh(relu(sigmoid(X))), the intermediates die after capture
+
+    auto* X = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 8, 8);
+    mag_tensor_fill(X, 1.0f);
+    mag_ctx_begin_capture(ctx);
+    auto* S = mag_sigmoid(X);
+    auto* R = mag_relu(S);
+    auto* Y = mag_tanh(R);
+    mag_plan_t* plan = mag_ctx_end_capture(ctx);
+    mag_tensor_decref(S);
+    mag_tensor_decref(R);
+
+    mag_storage_stats_t before {}, after {};
+    mag_ctx_get_storage_stats(ctx, &before);
+    ASSERT_EQ(mag_plan_optimize(plan), 0);
+    mag_ctx_get_storage_stats(ctx, &after);
+    ASSERT_EQ(before.bytes_live - after.bytes_live, 2*mag_tensor_data_size(Y)); // relu and tanh write into the sigmoid buffer
+    auto* buf = static_cast<const float*>(mag_tensor_data_ptr(Y));
+    for (std::int64_t i=0; i < mag_tensor_numel(Y); ++i)
+        ASSERT_FLOAT_EQ(buf[i], std::tanh(1.0f/(1.0f + std::exp(-1.0f))));
+
+    mag_tensor_fill(X, -2.0f);
+    mag_plan_replay(plan);
+    for (std::int64_t i=0; i < mag_tensor_numel(Y); ++i)
+        ASSERT_FLOAT_EQ(buf[i], std::tanh(1.0f/(1.0f + std::exp(2.0f))));
+
+    mag_tensor_decref(Y);
+    mag_plan_destroy(plan);
+    mag_tensor_decref(X);
+
+    mag_ctx_destroy(ctx);
+}
+
+TEST(graph_dynamic, plan_kernel_variants) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+
+    auto* X = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 4, 3);
+    mag_tensor_fill_random_uniform(X, -1.0f, 1.0f);
+    auto* Y = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 4, 3);
+    mag_tensor_fill_random_uniform(Y, -1.0f, 1.0f);
+    auto* S = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 1);
+    mag_tensor_fill(S, 2.0f);
+    auto* Row = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 4, 1);
+    mag_tensor_fill_random_uniform(Row, -1.0f, 1.0f);
+    auto* V = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 3, 1);
+    mag_tensor_fill_random_uniform(V, -1.0f, 1.0f);
+    auto* M = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 3, 2);
+    mag_tensor_fill_random_uniform(M, -1.0f, 1.0f);
+    auto* Sq = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 3, 3);
+    mag_tensor_fill_random_uniform(Sq, -1.0f, 1.0f);
+
+    mag_ctx_begin_capture(ctx);
+    mag_tensor_t* results[] = {
+        mag_add(X, Y),
+        mag_mul(X, S),
+        mag_sub(X, Row),
+        mag_matmul(X, V),
+        mag_matmul(X, M),
+    };
+    auto* T = mag_transpose(Sq);
+    auto* G = mag_add(T, Sq); // transposed operand keeps the generic kernel
+    mag_plan_t* plan = mag_ctx_end_capture(ctx);
+
+    std::vector<std::vector<float>> eager {};
+    for (auto* r : results) {
+        auto* buf = static_cast<const float*>(mag_tensor_data_ptr(r));
+        eager.emplace_back(buf, buf + mag_tensor_numel(r));
+    }
+    std::vector<float> eager_g (static_cast<const float*>(mag_tensor_data_ptr(G)), static_cast<const float*>(mag_tensor_data_ptr(G)) + 9);
+    for (auto* r : results)
+        mag_tensor_fill(r, 0.0f);
+    mag_tensor_fill(G, 0.0f);
+
+    mag_plan_replay(plan);
+    ASSERT_TRUE(plan->kernels_planned);
+    ASSERT_EQ(plan->nodes[0].kernel.variant, MAG_KVAR_CONTIGUOUS);
+    ASSERT_EQ(plan->nodes[1].kernel.variant, MAG_KVAR_BCAST_SCALAR);
+    ASSERT_EQ(plan->nodes[2].kernel.variant, MAG_KVAR_BCAST_ROW);
+    ASSERT_EQ(plan->nodes[3].kernel.variant, MAG_KVAR_GEMV);
+    ASSERT_EQ(plan->nodes[4].kernel.variant, MAG_KVAR_SMALL_GEMM);
+    ASSERT_EQ(plan->nodes[6].kernel.variant, MAG_KVAR_GENERIC);
+    for (std::size_t i=0; i < std::size(results); ++i) {
+        auto* buf = static_cast<const float*>(mag_tensor_data_ptr(results[i]));
+        for (std::int64_t j=0; j < mag_tensor_numel(results[i]); ++j)
+            ASSERT_NEAR(buf[j], eager[i][j], 1e-5f);
+    }
+    auto* g = static_cast<const float*>(mag_tensor_data_ptr(G));
+    for (std::int64_t j=0; j < 9; ++j)
+        ASSERT_FLOAT_EQ(g[j], eager_g[j]);
+
+    mag_plan_bind(plan, X, Y); // rebinding selects kernels again
+    ASSERT_FALSE(plan->kernels_planned);
+
+    mag_plan_destroy(plan);
+    for (auto* r : results)
+        mag_tensor_decref(r);
+    for (auto* t : {G, T, Sq, M, V, Row, S, Y, X})
+        mag_tensor_decref(t);
+
+    mag_ctx_destroy(ctx);
+}
+
+TEST(graph_dynamic, batcher_infer) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+
+    // relu(W @ X), the columns of X and Y are the samples of a batch
+
+    constexpr std::int64_t in = 4, out = 3, batch = 8;
+    auto* W = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, out, in);
+    auto* w = static_cast<float*>(mag_tensor_data_ptr(W));
+    for (std::int64_t i=0; i < out*in; ++i)
+        w[i] = static_cast<float>(i % 5) - 2.0f;
+    auto* X = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, in, batch);
+    mag_tensor_fill(X, 0.0f);
+
+    mag_ctx_begin_capture(ctx);
+    auto* WX = mag_matmul(W, X);
+    auto* Y = mag_relu(WX);
+    mag_plan_t* plan = mag_ctx_end_capture(ctx);
+    mag_batcher_t* batcher = mag_batcher_create(plan, X, 1, Y, 1, 2000);
+
+    constexpr int num_threads = 32;
+    std::vector<int> failures(num_threads);
+    std::vector<std::thread> threads {};
+    for (int t=0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int r=0; r < 4; ++r) {
+                float x[in], y[out];
+                for (std::int64_t i=0; i < in; ++i)
+                    x[i] = static_cast<float>(t + r) - static_cast<float>(i);
+                mag_batcher_infer(batcher, x, y);
+                for (std::int64_t o=0; o < out; ++o) {
+                    float acc = 0.0f;
+                    for (std::int64_t i=0; i < in; ++i)
+                        acc += w[o*in + i]*x[i];
+                    failures[t] += std::abs(y[o] - std::max(acc, 0.0f)) > 1e-4f;
+                }
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    for (int t=0; t < num_threads; ++t)
+        ASSERT_EQ(failures[t], 0);
+
+    std::uint64_t num_requests = 0, num_batches = 0;
+    mag_batcher_get_stats(batcher, &num_requests, &num_batches);
+    ASSERT_EQ(num_requests, num_threads*4);
+    ASSERT_LT(num_batches, num_requests); // concurrent samples share batches
+
+    mag_batcher_destroy(batcher);
+    mag_tensor_decref(Y);
+    mag_tensor_decref(WX);
+    mag_plan_destroy(plan);
+    mag_tensor_decref(X);
+    mag_tensor_decref(W);
+
+    mag_ctx_destroy(ctx);
+}
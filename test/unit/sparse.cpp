@@ -0,0 +1,204 @@
+// (c) 2025 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "prelude.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Fills a rows x cols tensor with ~density nonzeros, row 0 dense to unbalance the rows.
+static mag_tensor_t* random_sparse(mag_ctx_t* ctx, std::int64_t rows, std::int64_t cols, float density) {
+    auto* t = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, rows, cols);
+    auto* buf = static_cast<float*>(mag_tensor_data_ptr(t));
+    std::mt19937 gen {42};
+    std::uniform_real_distribution<float> dist {-1.0f, 1.0f};
+    for (std::int64_t i=0; i < rows*cols; ++i)
+        buf[i] = i < cols || dist(gen) < 2.0f*density - 1.0f ? dist(gen) : 0.0f;
+    return t;
+}
+
+TEST(sparse, dense_round_trip) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    auto* t = random_sparse(ctx, 37, 53, 0.05f);
+    const auto* x = static_cast<const float*>(mag_tensor_data_ptr(t));
+    std::int64_t nnz = 0;
+    for (std::int64_t i=0; i < mag_tensor_numel(t); ++i)
+        nnz += x[i] != 0.0f;
+
+    mag_csr_t* a = mag_csr_from_dense(t);
+    ASSERT_EQ(mag_csr_get_rows(a), 37);
+    ASSERT_EQ(mag_csr_get_cols(a), 53);
+    ASSERT_EQ(mag_csr_get_nnz(a), nnz);
+    auto* d = mag_csr_to_dense(a);
+    const auto* y = static_cast<const float*>(mag_tensor_data_ptr(d));
+    for (std::int64_t i=0; i < mag_tensor_numel(t); ++i)
+        ASSERT_EQ(x[i], y[i]);
+
+    mag_tensor_decref(d);
+    mag_csr_destroy(a);
+    mag_tensor_decref(t);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(sparse, from_coo) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    std::vector<std::int64_t> rows {2, 0, 2, 1, 0};
+    std::vector<std::int64_t> cols {1, 3, 1, 0, 0};
+    std::vector<float> vals {1.0f, 2.0f, 3.0f, 4.0f, 5.0f}; // (2, 1) twice, merged into one entry
+    mag_csr_t* a = mag_csr_from_coo(ctx, 3, 4, 5, rows.data(), cols.data(), vals.data());
+    ASSERT_EQ(mag_csr_get_nnz(a), 4);
+    const std::int64_t row_ptr[4] = {0, 2, 3, 4};
+    const std::int32_t col_idx[4] = {0, 3, 0, 1}; // sorted within each row
+    for (std::int64_t r=0; r <= 3; ++r)
+        ASSERT_EQ(a->row_ptr[r], row_ptr[r]);
+    for (std::int64_t k=0; k < 4; ++k)
+        ASSERT_EQ(a->col_idx[k], col_idx[k]);
+    auto* d = mag_csr_to_dense(a);
+    const auto* y = static_cast<const float*>(mag_tensor_data_ptr(d));
+    const float expected[12] = {
+        5.0f, 0.0f, 0.0f, 2.0f,
+        4.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 4.0f, 0.0f, 0.0f
+    };
+    for (std::int64_t i=0; i < 12; ++i)
+        ASSERT_EQ(y[i], expected[i]);
+
+    mag_tensor_decref(d);
+    mag_csr_destroy(a);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(sparse, spmv_spmm) {
+    mag_device_descriptor_t desc {};
+    desc.type = MAG_COMPUTE_DEVICE_TYPE_CPU;
+    desc.thread_count = 4; // rows are split by nonzeros across the workers
+    mag_ctx_t* ctx = mag_ctx_create2(&desc);
+    constexpr std::int64_t m = 301, k = 517, n = 67;
+    auto* ad = random_sparse(ctx, m, k, 0.02f);
+    mag_csr_t* a = mag_csr_from_dense(ad);
+    const auto* pa = static_cast<const float*>(mag_tensor_data_ptr(ad));
+
+    auto* b = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, k, n);
+    mag_tensor_fill_random_uniform(b, -1.0f, 1.0f);
+    const auto* pb = static_cast<const float*>(mag_tensor_data_ptr(b));
+    auto* r = mag_spmm(a, b);
+    ASSERT_EQ(mag_tensor_shape(r)[0], m);
+    ASSERT_EQ(mag_tensor_shape(r)[1], n);
+    const auto* pr = static_cast<const float*>(mag_tensor_data_ptr(r));
+    for (std::int64_t i=0; i < m; ++i) {
+        for (std::int64_t j=0; j < n; ++j) {
+            float acc = 0.0f;
+            for (std::int64_t p=0; p < k; ++p)
+                acc += pa[i*k + p]*pb[p*n + j];
+            ASSERT_NEAR(pr[i*n + j], acc, 1e-4f);
+        }
+    }
+
+    auto* x = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, k);
+    mag_tensor_fill_random_uniform(x, -1.0f, 1.0f);
+    const auto* px = static_cast<const float*>(mag_tensor_data_ptr(x));
+    auto* y = mag_spmv(a, x);
+    ASSERT_EQ(mag_tensor_shape(y)[0], m);
+    const auto* py = static_cast<const float*>(mag_tensor_data_ptr(y));
+    for (std::int64_t i=0; i < m; ++i) {
+        float acc = 0.0f;
+        for (std::int64_t p=0; p < k; ++p)
+            acc += pa[i*k + p]*px[p];
+        ASSERT_NEAR(py[i], acc, 1e-4f);
+    }
+
+    mag_tensor_decref(y);
+    mag_tensor_decref(x);
+    mag_tensor_decref(r);
+    mag_tensor_decref(b);
+    mag_csr_destroy(a);
+    mag_tensor_decref(ad);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(sparse, sp24_prune_round_trip) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    auto* t = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 2, 8);
+    auto* x = static_cast<float*>(mag_tensor_data_ptr(t));
+    const float dense[16] = {
+        1.0f, -4.0f, 3.0f, 2.0f,    0.0f, 0.0f, 0.0f, 5.0f,
+        0.5f, 0.0f, -0.5f, 0.25f,   0.0f, 0.0f, 0.0f, 0.0f
+    };
+    const float pruned[16] = {
+        0.0f, -4.0f, 3.0f, 0.0f,    0.0f, 0.0f, 0.0f, 5.0f,
+        0.5f, 0.0f, -0.5f, 0.0f,    0.0f, 0.0f, 0.0f, 0.0f
+    };
+    for (std::int64_t i=0; i < 16; ++i)
+        x[i] = dense[i];
+
+    mag_sp24_t* w = mag_sp24_from_dense(t, true);
+    ASSERT_EQ(mag_sp24_get_rows(w), 2);
+    ASSERT_EQ(mag_sp24_get_cols(w), 8);
+    auto* d = mag_sp24_to_dense(w);
+    const auto* y = static_cast<const float*>(mag_tensor_data_ptr(d));
+    for (std::int64_t i=0; i < 16; ++i)
+        ASSERT_EQ(y[i], pruned[i]);
+
+    mag_sp24_t* w2 = mag_sp24_from_dense(d, false); // already 2:4
+    auto* d2 = mag_sp24_to_dense(w2);
+    const auto* y2 = static_cast<const float*>(mag_tensor_data_ptr(d2));
+    for (std::int64_t i=0; i < 16; ++i)
+        ASSERT_EQ(y2[i], pruned[i]);
+
+    mag_tensor_decref(d2);
+    mag_sp24_destroy(w2);
+    mag_tensor_decref(d);
+    mag_sp24_destroy(w);
+    mag_tensor_decref(t);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(sparse, sp24_matmul) {
+    mag_device_descriptor_t desc {};
+    desc.type = MAG_COMPUTE_DEVICE_TYPE_CPU;
+    desc.thread_count = 4;
+    mag_ctx_t* ctx = mag_ctx_create2(&desc);
+    constexpr std::int64_t m = 129, k = 4*29, n = 19; // column groups leave tails for every vector width
+    auto* t = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, m, k);
+    mag_tensor_fill_random_uniform(t, -1.0f, 1.0f);
+    mag_sp24_t* w = mag_sp24_from_dense(t, true);
+    auto* wd = mag_sp24_to_dense(w);
+    const auto* pw = static_cast<const float*>(mag_tensor_data_ptr(wd));
+
+    auto* x = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, k);
+    mag_tensor_fill_random_uniform(x, -1.0f, 1.0f);
+    const auto* px = static_cast<const float*>(mag_tensor_data_ptr(x));
+    auto* y = mag_sp24_matmul(w, x);
+    ASSERT_EQ(mag_tensor_rank(y), 1);
+    const auto* py = static_cast<const float*>(mag_tensor_data_ptr(y));
+    for (std::int64_t i=0; i < m; ++i) {
+        float acc = 0.0f;
+        for (std::int64_t p=0; p < k; ++p)
+            acc += pw[i*k + p]*px[p];
+        ASSERT_NEAR(py[i], acc, 1e-4f);
+    }
+
+    auto* b = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, k, n);
+    mag_tensor_fill_random_uniform(b, -1.0f, 1.0f);
+    const auto* pb = static_cast<const float*>(mag_tensor_data_ptr(b));
+    auto* r = mag_sp24_matmul(w, b);
+    ASSERT_EQ(mag_tensor_shape(r)[0], m);
+    ASSERT_EQ(mag_tensor_shape(r)[1], n);
+    const auto* pr = static_cast<const float*>(mag_tensor_data_ptr(r));
+    for (std::int64_t i=0; i < m; ++i) {
+        for (std::int64_t j=0; j < n; ++j) {
+            float acc = 0.0f;
+            for (std::int64_t p=0; p < k; ++p)
+                acc += pw[i*k + p]*pb[p*n + j];
+            ASSERT_NEAR(pr[i*n + j], acc, 1e-4f);
+        }
+    }
+
+    mag_tensor_decref(r);
+    mag_tensor_decref(b);
+    mag_tensor_decref(y);
+    mag_tensor_decref(x);
+    mag_tensor_decref(wd);
+    mag_sp24_destroy(w);
+    mag_tensor_decref(t);
+    mag_ctx_destroy(ctx);
+}
@@ -5,6 +5,7 @@
 #include <cstring>
 #include <cmath>
 #include <filesystem>
+#include <thread>
 
 TEST(mag_tensor_t, init_1d) {
     mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
@@ -626,3 +627,252 @@ TEST(mag_tensor_t, rc_ref_inplace_op) {
     mag_tensor_decref(x);
     mag_ctx_destroy(ctx);
 }
+
+TEST(mag_tensor_t, small_storage_slab) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    std::vector<mag_tensor_t*> tensors {};
+    for (int64_t i=0; i < 1024; ++i) {
+        mag_tensor_t* t = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 1+(i&63));
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(mag_tensor_data_ptr(t)) % 64, 0);
+        mag_tensor_fill(t, static_cast<float>(i));
+        tensors.emplace_back(t);
+    }
+    for (std::size_t i=0; i < tensors.size(); ++i) {
+        auto* buf = static_cast<const float*>(mag_tensor_data_ptr(tensors[i]));
+        for (int64_t j=0; j < mag_tensor_numel(tensors[i]); ++j)
+            ASSERT_EQ(buf[j], static_cast<float>(i));
+    }
+    for (std::size_t i=0; i < tensors.size(); i += 2) /* Free every other slot and reuse the holes. */
+        mag_tensor_decref(tensors[i]);
+    for (std::size_t i=0; i < tensors.size(); i += 2) {
+        tensors[i] = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 64);
+        mag_tensor_fill(tensors[i], -1.0f);
+    }
+    for (std::size_t i=1; i < tensors.size(); i += 2)
+        ASSERT_EQ(*static_cast<const float*>(mag_tensor_data_ptr(tensors[i])), static_cast<float>(i));
+    for (auto* t : tensors)
+        mag_tensor_decref(t);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(mag_tensor_t, shared_storage_and_cold_data) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_t* base = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 8, 8);
+    ASSERT_STREQ(mag_tensor_get_name(base), "");
+    ASSERT_EQ(mag_tensor_get_user_data(base), nullptr);
+    mag_tensor_set_name(base, "base");
+    int ud = 42;
+    mag_tensor_set_user_data(base, &ud);
+    mag_tensor_t* view = mag_view(base);
+    ASSERT_EQ(view->storage, base->storage);
+    ASSERT_EQ(mag_tensor_data_ptr(view), mag_tensor_data_ptr(base));
+    ASSERT_STREQ(mag_tensor_get_name(view), "");
+    mag_tensor_decref(base); /* View keeps the shared storage alive. */
+    mag_tensor_fill(view, 3.0f);
+    ASSERT_EQ(*static_cast<const float*>(mag_tensor_data_ptr(view)), 3.0f);
+    ASSERT_STREQ(mag_tensor_get_name(base), "base");
+    ASSERT_EQ(mag_tensor_get_user_data(base), &ud);
+    mag_tensor_decref(view);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(mag_tensor_t, frozen_share_across_contexts) {
+    mag_ctx_t* owner = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_t* w = mag_tensor_create_2d(owner, MAG_DTYPE_F32, 32, 32);
+    mag_tensor_fill(w, 1.5f);
+    ASSERT_FALSE(mag_tensor_is_frozen(w));
+    mag_tensor_freeze(w);
+    ASSERT_TRUE(mag_tensor_is_frozen(w));
+    mag_tensor_t* wt = mag_transpose(w); /* Views inherit the frozen state. */
+    ASSERT_TRUE(mag_tensor_is_frozen(wt));
+    mag_tensor_decref(wt);
+    std::thread worker {[w] {
+        mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+        mag_tensor_t* sw = mag_tensor_share(ctx, w);
+        ASSERT_EQ(mag_tensor_data_ptr(sw), mag_tensor_data_ptr(w)); /* No copy. */
+        ASSERT_EQ(mag_atomic_load(&w->storage->borrowers, MAG_MO_SEQ_CST), 1); /* Owner context can not be destroyed now. */
+        ASSERT_TRUE(mag_tensor_is_frozen(sw));
+        mag_tensor_t* x = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 32, 32);
+        mag_tensor_fill(x, 0.5f);
+        mag_tensor_t* r = mag_add(x, sw);
+        const auto* buf = static_cast<const float*>(mag_tensor_data_ptr(r));
+        for (int64_t i=0; i < mag_tensor_numel(r); ++i)
+            ASSERT_EQ(buf[i], 2.0f);
+        mag_tensor_decref(r);
+        mag_tensor_decref(x);
+        mag_tensor_decref(sw);
+        mag_ctx_destroy(ctx);
+    }};
+    worker.join();
+    ASSERT_EQ(mag_atomic_load(&w->storage->borrowers, MAG_MO_SEQ_CST), 0);
+    ASSERT_EQ(*static_cast<const float*>(mag_tensor_data_ptr(w)), 1.5f);
+    mag_tensor_decref(w);
+    mag_ctx_destroy(owner);
+}
+
+TEST(mag_tensor_t, atomic_refcount_handoff) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_t* single = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 4);
+    ASSERT_FALSE(mag_tensor_has_atomic_refcount(single));
+    mag_tensor_set_atomic_refcount(single);
+    ASSERT_TRUE(mag_tensor_has_atomic_refcount(single));
+    ASSERT_TRUE(mag_tensor_decref(single));
+
+    mag_ctx_set_concurrent(ctx, true); /* Implies atomic refcounts for new tensors. */
+    ASSERT_TRUE(mag_ctx_get_atomic_refcount(ctx));
+    std::vector<mag_tensor_t*> batches {};
+    for (int i=0; i < 256; ++i) {
+        mag_tensor_t* t = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 8);
+        ASSERT_TRUE(mag_tensor_has_atomic_refcount(t));
+        mag_tensor_fill(t, static_cast<float>(i));
+        mag_tensor_retain(t); /* One reference for the producer, one for the consumer. */
+        batches.emplace_back(t);
+    }
+    std::vector<float> seen(batches.size()); /* Asserted on the main thread, gtest assertions only return from the lambda. */
+    std::thread consumer {[&batches, &seen] {
+        for (std::size_t i=0; i < batches.size(); ++i) {
+            mag_tensor_t* v = mag_view(batches[i]);
+            seen[i] = *static_cast<const float*>(mag_tensor_data_ptr(v));
+            mag_tensor_decref(v);
+            mag_tensor_decref(batches[i]);
+        }
+    }};
+    for (auto* t : batches)
+        mag_tensor_decref(t);
+    consumer.join();
+    for (std::size_t i=0; i < seen.size(); ++i)
+        ASSERT_EQ(seen[i], static_cast<float>(i));
+    mag_ctx_set_concurrent(ctx, false);
+    ASSERT_FALSE(mag_ctx_get_atomic_refcount(ctx));
+
+    mag_ctx_set_atomic_refcount(ctx, true); /* An explicit opt-in survives leaving concurrent mode. */
+    mag_ctx_set_concurrent(ctx, true);
+    mag_ctx_set_concurrent(ctx, false);
+    ASSERT_TRUE(mag_ctx_get_atomic_refcount(ctx));
+    mag_ctx_set_atomic_refcount(ctx, false);
+    ASSERT_FALSE(mag_ctx_get_atomic_refcount(ctx));
+    mag_ctx_destroy(ctx);
+}
+
+TEST(mag_tensor_t, deferred_free_modes) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    ASSERT_EQ(mag_ctx_get_free_mode(ctx), MAG_FREE_MODE_IMMEDIATE);
+    mag_ctx_set_free_mode(ctx, MAG_FREE_MODE_DEFERRED);
+    mag_tensor_t* a = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 64, 64);
+    void* pa = mag_tensor_data_ptr(a);
+    mag_tensor_decref(a);
+    mag_tensor_t* b = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 64, 64);
+    void* pb = mag_tensor_data_ptr(b);
+    ASSERT_NE(pb, pa); /* Storage of a is still queued. */
+    mag_tensor_decref(b);
+    mag_ctx_reclaim(ctx);
+    mag_tensor_t* c = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 60, 64); /* Same size class, reuses the last cached buffer. */
+    ASSERT_EQ(mag_tensor_data_ptr(c), pb);
+    mag_tensor_decref(c);
+
+    mag_ctx_set_free_mode(ctx, MAG_FREE_MODE_BACKGROUND);
+    for (int step=0; step < 3; ++step) { /* Exceed the reclaim batch, buffers too large for the cache go to the background thread. */
+        std::vector<mag_tensor_t*> acts {};
+        for (int i=0; i < 1100; ++i) {
+            mag_tensor_t* t = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 64+(i&7)*1024);
+            mag_tensor_fill(t, static_cast<float>(i));
+            acts.emplace_back(t);
+        }
+        acts.emplace_back(mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 17<<20));
+        for (auto* t : acts)
+            mag_tensor_decref(t);
+        ASSERT_LE(ctx->reclaim_len, ctx->reclaim_cap); /* The full queue drains a few entries per release. */
+        ASSERT_GT(ctx->reclaim_len, ctx->reclaim_cap/2);
+    }
+    mag_ctx_set_free_mode(ctx, MAG_FREE_MODE_IMMEDIATE);
+    ASSERT_EQ(ctx->reclaim_len, 0);
+    ASSERT_EQ(mag_ctx_get_free_mode(ctx), MAG_FREE_MODE_IMMEDIATE);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(mag_tensor_t, out_variants_reuse_storage) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_t* a = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 4, 8);
+    mag_tensor_t* b = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 8, 4);
+    mag_tensor_t* r = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 4, 8);
+    mag_tensor_t* mm = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 4, 4);
+    mag_tensor_t* s = mag_tensor_create_1d(ctx, MAG_DTYPE_F32, 1);
+    mag_tensor_fill(a, 2.0f);
+    mag_tensor_fill(b, 0.5f);
+    mag_storage_stats_t before {};
+    mag_ctx_get_storage_stats(ctx, &before);
+    for (int i=0; i < 8; ++i) { /* Steady-state loop, no storage is allocated. */
+        ASSERT_EQ(mag_add_out(a, a, r), r);
+        ASSERT_EQ(mag_muls_out(r, 0.5f, r), r); /* Output may alias an input. */
+        ASSERT_EQ(mag_matmul_out(a, b, mm), mm);
+        ASSERT_EQ(mag_sum_out(mm, s), s);
+    }
+    mag_storage_stats_t after {};
+    mag_ctx_get_storage_stats(ctx, &after);
+    ASSERT_EQ(after.num_allocs, before.num_allocs);
+    for (int64_t i=0; i < mag_tensor_numel(r); ++i)
+        ASSERT_FLOAT_EQ(static_cast<const float*>(mag_tensor_data_ptr(r))[i], 2.0f);
+    for (int64_t i=0; i < mag_tensor_numel(mm); ++i)
+        ASSERT_FLOAT_EQ(static_cast<const float*>(mag_tensor_data_ptr(mm))[i], 8.0f);
+    ASSERT_FLOAT_EQ(*static_cast<const float*>(mag_tensor_data_ptr(s)), 128.0f);
+    ASSERT_EQ(s->op, MAG_OP_SUM); /* The output is re-targeted to its latest producer. */
+    ASSERT_EQ(mag_add_out(a, a, mm), nullptr); /* Shape mismatch. */
+    ASSERT_EQ(mag_matmul_out(a, b, a), nullptr); /* Wrong shape, and matmul must not alias. */
+    mag_tensor_t* t = mag_transpose(r);
+    ASSERT_EQ(mag_add_out(b, b, t), nullptr); /* Output must be contiguous. */
+    mag_tensor_decref(t);
+    mag_tensor_decref(s);
+    mag_tensor_decref(mm);
+    mag_tensor_decref(r);
+    mag_tensor_decref(b);
+    mag_tensor_decref(a);
+    mag_ctx_destroy(ctx);
+}
+
+TEST(mag_tensor_t, consumed_temporary_donates_storage) {
+    mag_ctx_t* ctx = mag_ctx_create(MAG_COMPUTE_DEVICE_TYPE_CPU);
+    mag_tensor_t* a = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 4, 8);
+    mag_tensor_fill(a, -2.0f);
+    mag_storage_stats_t before {};
+    mag_ctx_get_storage_stats(ctx, &before);
+
+    // relu(a*3 + 1): every temporary is handed to the next op, which writes into its buffer
+    mag_tensor_t* t = mag_muls(a, 3.0f);
+    ASSERT_TRUE(mag_tensor_consume(t));
+    mag_tensor_t* u = mag_adds(t, 1.0f);
+    ASSERT_EQ(u, t);
+    ASSERT_TRUE(mag_tensor_consume(u));
+    mag_tensor_t* r = mag_relu(u);
+    ASSERT_EQ(r, t);
+    ASSERT_EQ(static_cast<std::uint32_t>(mag_tensor_get_packed_refcounts(r)), 1);
+    mag_storage_stats_t after {};
+    mag_ctx_get_storage_stats(ctx, &after);
+    ASSERT_EQ(after.num_allocs, before.num_allocs + 1);
+    for (int64_t i=0; i < mag_tensor_numel(r); ++i)
+        ASSERT_FLOAT_EQ(static_cast<const float*>(mag_tensor_data_ptr(r))[i], 0.0f);
+
+    // a second reference keeps the buffer, the consumed one is still released
+    mag_tensor_incref(r);
+    ASSERT_TRUE(mag_tensor_consume(r));
+    mag_tensor_t* n = mag_neg(r);
+    ASSERT_NE(n, r);
+    ASSERT_EQ(static_cast<std::uint32_t>(mag_tensor_get_packed_refcounts(r)), 1);
+
+    // a smaller broadcast operand is not the result's shape
+    mag_tensor_t* row = mag_tensor_create_2d(ctx, MAG_DTYPE_F32, 1, 8);
+    mag_tensor_fill(row, 1.0f);
+    ASSERT_TRUE(mag_tensor_consume(row));
+    mag_tensor_t* s = mag_add(a, row);
+    ASSERT_NE(s, row);
+    ASSERT_FLOAT_EQ(static_cast<const float*>(mag_tensor_data_ptr(s))[0], -1.0f);
+
+    mag_ctx_set_exec_mode(ctx, MAG_EXEC_MODE_DEFERRED);
+    ASSERT_FALSE(mag_tensor_consume(a));
+    mag_ctx_set_exec_mode(ctx, MAG_EXEC_MODE_EAGER);
+
+    mag_tensor_decref(s);
+    mag_tensor_decref(n);
+    mag_tensor_decref(r);
+    mag_tensor_decref(a);
+    mag_ctx_destroy(ctx);
+}